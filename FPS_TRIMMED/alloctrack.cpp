@@ -0,0 +1,276 @@
+#include "alloctrack.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+
+// Everything the hooks touch is constant-initialised, so counting works from the first allocation
+// of the process (before main, before any constructor has run) and never allocates itself
+typedef struct ZoneSlot {
+    std::atomic<const char*> name;
+    std::atomic<uint64_t> allocations;
+    std::atomic<uint64_t> cAllocations;
+    std::atomic<uint64_t> bytes;
+} ZoneSlot;
+
+typedef struct ThreadAllocState {
+    AllocStats stats;
+    int zone;        // Index into zones; 0 outside any zone
+    bool steady;
+    int allowDepth;  // ALLOW_ALLOCATIONS scopes entered
+    bool inNew;      // Inside operator new: the malloc it calls is counted as a new
+    bool reporting;  // Inside the violation report (which may allocate)
+} ThreadAllocState;
+
+static ZoneSlot zones[maxAllocZones];
+static std::atomic<int> zoneCount(0);
+static std::mutex zoneMutex; // Registering a zone only
+static std::atomic<uint64_t> totalAllocations(0), totalCAllocations(0), totalFrees(0), totalBytes(0);
+static std::atomic<uint64_t> violations(0);
+static std::atomic<bool> abortOnViolations(true);
+static thread_local ThreadAllocState threadState = {};
+
+static void reportViolation(size_t size) {
+    ThreadAllocState& state = threadState;
+    violations.fetch_add(1, std::memory_order_relaxed);
+    state.reporting = true;
+    const char* zone = state.zone > 0 ? zones[state.zone].name.load(std::memory_order_acquire) : "(no zone)";
+    fprintf(stderr, "Allocation of %llu bytes in steady state, zone %s\n", (unsigned long long)size, zone);
+    if (abortOnViolations.load(std::memory_order_relaxed)) abort();
+    state.reporting = false;
+}
+
+static void recordAllocation(size_t size, bool fromNew) {
+    ThreadAllocState& state = threadState;
+    (fromNew ? state.stats.allocations : state.stats.cAllocations)++;
+    state.stats.bytes += size;
+    (fromNew ? totalAllocations : totalCAllocations).fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add(size, std::memory_order_relaxed);
+    if (state.zone > 0) {
+        ZoneSlot& slot = zones[state.zone];
+        (fromNew ? slot.allocations : slot.cAllocations).fetch_add(1, std::memory_order_relaxed);
+        slot.bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+    if (fromNew && state.steady && state.allowDepth == 0 && !state.reporting) reportViolation(size);
+}
+
+// Called by the C allocator hooks
+static void recordCAllocation(size_t size) {
+    recordAllocation(size, threadState.inNew);
+}
+
+static void recordFree() {
+    threadState.stats.frees++;
+    totalFrees.fetch_add(1, std::memory_order_relaxed);
+}
+
+//// Hooks
+#if FPS_TRACK_ALLOCATIONS
+#if defined(__GLIBC__)
+// Replaces the C allocator for the whole process (GLU, the GL driver and the C++ runtime included)
+// and forwards to glibc's own
+#define C_ALLOCATOR_HOOKED 1
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* p, size_t size);
+void __libc_free(void* p);
+
+void* malloc(size_t size) {
+    void* p = __libc_malloc(size);
+    if (p) recordCAllocation(size);
+    return p;
+}
+
+void* calloc(size_t count, size_t size) {
+    void* p = __libc_calloc(count, size);
+    if (p) recordCAllocation(count * size);
+    return p;
+}
+
+// A resize counts as a new block (it may well be one)
+void* realloc(void* p, size_t size) {
+    void* resized = __libc_realloc(p, size);
+    if (p && (resized || size == 0)) recordFree();
+    if (resized) recordCAllocation(size);
+    return resized;
+}
+
+void free(void* p) {
+    if (p) recordFree();
+    __libc_free(p);
+}
+}
+#elif defined(_MSC_VER) && defined(_DEBUG)
+// The debug CRT reports every heap operation (new included, which calls malloc)
+#define C_ALLOCATOR_HOOKED 1
+static int __cdecl crtAllocHook(int type, void*, size_t size, int blockType, long, const unsigned char*, int) {
+    if (blockType == _CRT_BLOCK) return TRUE; // The CRT's own bookkeeping
+    if (type == _HOOK_ALLOC || type == _HOOK_REALLOC) recordCAllocation(size);
+    else if (type == _HOOK_FREE) recordFree();
+    return TRUE;
+}
+static int crtHookInstalled = (_CrtSetAllocHook(crtAllocHook), 1);
+#else
+#define C_ALLOCATOR_HOOKED 0 // Only new/delete are counted
+#endif
+
+// With the C allocator hooked, the malloc below does the counting (as a new); otherwise new counts
+// itself
+static void* allocateForNew(size_t size) {
+#if C_ALLOCATOR_HOOKED
+    threadState.inNew = true;
+    void* p = malloc(size ? size : 1);
+    threadState.inNew = false;
+#else
+    void* p = malloc(size ? size : 1);
+    if (p) recordAllocation(size, true);
+#endif
+    return p;
+}
+
+void* operator new(size_t size) {
+    void* p = allocateForNew(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocateForNew(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t& nothrow) noexcept {
+    return operator new(size, nothrow);
+}
+
+void operator delete(void* p) noexcept {
+#if !C_ALLOCATOR_HOOKED
+    if (p) recordFree();
+#endif
+    free(p);
+}
+
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { operator delete(p); }
+#endif
+
+//// Queries
+bool allocationTrackingEnabled() {
+#if FPS_TRACK_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocStats allocationTotals() {
+    AllocStats stats = { totalAllocations.load(std::memory_order_relaxed), totalCAllocations.load(std::memory_order_relaxed),
+                         totalFrees.load(std::memory_order_relaxed), totalBytes.load(std::memory_order_relaxed) };
+    return stats;
+}
+
+AllocStats threadAllocations() {
+    return threadState.stats;
+}
+
+// Slot 0 is never handed out: it stands for "outside any zone"
+int allocZoneCount() {
+    return zoneCount.load(std::memory_order_acquire);
+}
+
+const char* allocZoneName(int zone) {
+    return zones[zone + 1].name.load(std::memory_order_acquire);
+}
+
+AllocStats allocZoneStats(int zone) {
+    const ZoneSlot& slot = zones[zone + 1];
+    AllocStats stats = { slot.allocations.load(std::memory_order_relaxed), slot.cAllocations.load(std::memory_order_relaxed), 0,
+                         slot.bytes.load(std::memory_order_relaxed) };
+    return stats;
+}
+
+void setSteadyState(bool steady) {
+    threadState.steady = steady;
+}
+
+bool inSteadyState() {
+    return threadState.steady;
+}
+
+void setAllocationAssert(bool abortOnViolation) {
+    abortOnViolations.store(abortOnViolation, std::memory_order_relaxed);
+}
+
+uint64_t allocationViolations() {
+    return violations.load(std::memory_order_relaxed);
+}
+
+void printAllocationReport(const char* title) {
+    if (!allocationTrackingEnabled()) return;
+    AllocStats totals = allocationTotals();
+    printf("%s: %llu new, %llu C allocations (%.1f MB), %llu frees, %llu new in steady state\n", title,
+        (unsigned long long)totals.allocations, (unsigned long long)totals.cAllocations, totals.bytes / (1024.0 * 1024.0),
+        (unsigned long long)totals.frees, (unsigned long long)allocationViolations());
+
+    int order[maxAllocZones];
+    int count = allocZoneCount();
+    for (int i = 0; i < count; i++) order[i] = i;
+    std::sort(order, order + count, [](int a, int b) {
+        AllocStats first = allocZoneStats(a), second = allocZoneStats(b);
+        return first.allocations + first.cAllocations > second.allocations + second.cAllocations;
+    });
+    for (int i = 0; i < count; i++) {
+        AllocStats stats = allocZoneStats(order[i]);
+        if (stats.allocations + stats.cAllocations == 0) continue;
+        printf("  %-24s %10llu new %10llu C %10.1f KB\n", allocZoneName(order[i]), (unsigned long long)stats.allocations,
+            (unsigned long long)stats.cAllocations, stats.bytes / 1024.0);
+    }
+}
+
+//// Scopes
+static int findZone(const char* name) {
+    int count = zoneCount.load(std::memory_order_acquire);
+    for (int i = 1; i <= count; i++) {
+        if (zones[i].name.load(std::memory_order_acquire) == name) return i;
+    }
+
+    std::lock_guard<std::mutex> lock(zoneMutex);
+    count = zoneCount.load(std::memory_order_relaxed);
+    for (int i = 1; i <= count; i++) {
+        if (zones[i].name.load(std::memory_order_relaxed) == name) return i;
+    }
+    if (count + 1 >= maxAllocZones) return 0; // Full: counted as outside any zone
+    zones[count + 1].name.store(name, std::memory_order_release);
+    zoneCount.store(count + 1, std::memory_order_release);
+    return count + 1;
+}
+
+AllocZoneScope::AllocZoneScope(const char* name) {
+    previous = threadState.zone;
+    threadState.zone = findZone(name);
+}
+
+AllocZoneScope::~AllocZoneScope() {
+    threadState.zone = previous;
+}
+
+AllowAllocationsScope::AllowAllocationsScope() {
+    threadState.allowDepth++;
+}
+
+AllowAllocationsScope::~AllowAllocationsScope() {
+    threadState.allowDepth--;
+}
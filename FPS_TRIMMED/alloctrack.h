@@ -0,0 +1,75 @@
+#pragma once
+// Allocation tracking
+// Debug and benchmark builds (FPS_TRACK_ALLOCATIONS, on by default when _DEBUG is defined) hook
+// the global new/delete and the C allocator (malloc/calloc/realloc/free on glibc, the debug CRT's
+// allocation hook on Windows), so every heap allocation in the process is counted: in total, per
+// thread, and per zone. A zone is a named scope (ALLOC_ZONE) around a phase of the sim tick or the
+// frame, so a report says where the allocations came from, not just how many there were.
+// A thread that has finished warming up declares steady state; from then on any new it makes
+// outside an ALLOW_ALLOCATIONS scope is reported with its zone and size, and aborts the process
+// unless asserting has been turned off (the benchmarks count them instead). C allocations (GLU,
+// the GL driver, C libraries) are counted separately and never asserted on: some drivers allocate
+// inside draw calls (Mesa's llvmpipe does on every one), and that isn't ours to fix.
+// Without FPS_TRACK_ALLOCATIONS nothing is hooked and the functions below do nothing.
+#include <cstdint>
+
+#if !defined(FPS_TRACK_ALLOCATIONS) && defined(_DEBUG)
+#define FPS_TRACK_ALLOCATIONS 1
+#endif
+
+typedef struct AllocStats {
+    uint64_t allocations;  // new (the C++ runtime and this code's containers)
+    uint64_t cAllocations; // malloc, calloc and realloc called directly (GLU, the GL driver, C libraries)
+    uint64_t frees;        // Both kinds
+    uint64_t bytes;        // Requested, both kinds
+} AllocStats;
+
+const int maxAllocZones = 64;
+
+// Whether this build counts allocations (the stats below are all zero when it doesn't)
+bool allocationTrackingEnabled();
+
+AllocStats allocationTotals(); // The whole process
+AllocStats threadAllocations(); // The calling thread
+
+// Zones seen so far (registered the first time one is entered), with what was allocated in them
+int allocZoneCount();
+const char* allocZoneName(int zone);
+AllocStats allocZoneStats(int zone);
+
+// Calling thread: from now on, new is a violation (see above)
+void setSteadyState(bool steady);
+bool inSteadyState();
+
+// Abort on a violation (default) or only count and report it
+void setAllocationAssert(bool abortOnViolation);
+uint64_t allocationViolations();
+
+// Prints every zone that allocated, busiest first
+void printAllocationReport(const char* title);
+
+// Scopes; use the macros, which compile to nothing without tracking. name must be a string
+// literal (zones are told apart by pointer)
+class AllocZoneScope {
+public:
+    explicit AllocZoneScope(const char* name);
+    ~AllocZoneScope();
+private:
+    int previous;
+};
+
+class AllowAllocationsScope {
+public:
+    AllowAllocationsScope();
+    ~AllowAllocationsScope();
+};
+
+#define ALLOC_CONCAT_(a, b) a##b
+#define ALLOC_CONCAT(a, b) ALLOC_CONCAT_(a, b)
+#if FPS_TRACK_ALLOCATIONS
+#define ALLOC_ZONE(name) AllocZoneScope ALLOC_CONCAT(allocZone, __LINE__)(name)
+#define ALLOW_ALLOCATIONS() AllowAllocationsScope ALLOC_CONCAT(allowAllocations, __LINE__)
+#else
+#define ALLOC_ZONE(name) ((void)0)
+#define ALLOW_ALLOCATIONS() ((void)0)
+#endif
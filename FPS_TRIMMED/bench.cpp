@@ -0,0 +1,617 @@
+// Headless benchmark runner for the simulation (no window, no GL)
+// Runs named, scripted scenarios for a fixed number of ticks and reports
+// tick-time statistics, job thread utilisation and the time of each job of the tick, allocations,
+// cache misses and peak RSS as JSON.
+//
+// Build (Linux):  g++ -O3 -std=c++17 -DFPS_TRACK_ALLOCATIONS sim.cpp timerwheel.cpp pose.cpp flowfield.cpp crowd.cpp
+//                     checkpoint.cpp jobs.cpp workers.cpp scenequery.cpp alloctrack.cpp bench.cpp -lpthread -o fps_bench
+// Usage:          fps_bench [--scenario name]... [--ticks N] [--out file.json]
+//                           [--budget scenario:metric=value]... [--list]
+//                           [--checkpoint file] [--save-checkpoint file] [--threads N]
+// --checkpoint starts every scenario from a saved state instead of its own setup (its script still
+// runs); --save-checkpoint saves the state the last scenario ends in. --threads sets the number of
+// job pool threads (default: one per core, minus the one running the tick).
+// Metrics usable in budgets: mean_ms, p50_ms, p99_ms, max_ms, stddev_ms, allocs, steady_allocs, peak_rss_kb,
+// query_ms (scene queries per tick, scenequery.h: the robots' line-of-sight checks and the script's)
+// Every scenario's steady_allocs budget is 0: after warmUpTicks the tick must not allocate.
+// Allocations are counted by alloctrack.h, so only when built with FPS_TRACK_ALLOCATIONS (-1 otherwise).
+// The process exits with status 1 when any budget is exceeded. A scenario over time budgets only
+// is run once more first, and fails if it is over again: a shared machine that stalls a few ticks
+// passes on the second run, a real slowdown doesn't.
+// On Linux each scenario runs in a child process, so its peak RSS is its own.
+#include "alloctrack.h"
+#include "checkpoint.h"
+#include "scenequery.h"
+#include "sim.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+// Peak resident set size of the process in KB. Each scenario runs in a process of its own where it
+// can (runInChild()), so this is the scenario's; on Windows it is the whole run's so far
+static long peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return (long)(counters.PeakWorkingSetSize / 1024);
+    }
+    return 0;
+#else
+#ifdef __linux__
+    // VmHWM is current; ru_maxrss can lag behind it until the resident set first shrinks
+    if (FILE* file = fopen("/proc/self/status", "r")) {
+        char line[128];
+        long kb = -1;
+        while (kb < 0 && fgets(line, sizeof(line), file)) sscanf(line, "VmHWM: %ld kB", &kb);
+        fclose(file);
+        if (kb >= 0) return kb;
+    }
+#endif
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss; // Already in KB on Linux
+#endif
+}
+
+//// Cache miss counting
+// A hardware counter for the calling thread, enabled only while simTick() runs. Linux only, and
+// unavailable in many VMs and containers (or with perf_event_paranoid too high): then -1.
+static int openCacheMissCounter() {
+#ifdef _WIN32
+    return -1;
+#else
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_CACHE_MISSES;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#endif
+}
+
+static void enableCounter(int counter, bool enable) {
+#ifndef _WIN32
+    if (counter >= 0) ioctl(counter, enable ? PERF_EVENT_IOC_ENABLE : PERF_EVENT_IOC_DISABLE, 0);
+#endif
+}
+
+static long long closeCounter(int counter) {
+    long long count = -1;
+#ifndef _WIN32
+    if (counter < 0) return -1;
+    if (read(counter, &count, sizeof(count)) != sizeof(count)) count = -1;
+    close(counter);
+#endif
+    return count;
+}
+
+static const char* startCheckpoint = nullptr; // --checkpoint
+static const char* endCheckpoint = nullptr;   // --save-checkpoint
+
+const unsigned int tickMs = 10; // Simulated time per tick (matches the 10ms animation timers)
+const int warmUpTicks = 20;     // Ticks after these are in steady state (alloctrack.h)
+
+//// Scenarios
+// Random position inside the arena walls
+static float randomArenaCoord() {
+    return (float)(rand() % (2 * planeSize - 4) - (planeSize - 2));
+}
+
+static void spawnRobotArmy(int count) {
+    setRobotCount(count);
+    spawnRobots();
+}
+
+// Bullets leave the arena, so the storm scripts keep topping it up to this
+static int bulletStormSize = 0;
+
+static void spawnStormBullets(int count) {
+    for (int i = 0; i < count; i++) {
+        float dirX = (float)(rand() % 200 - 100);
+        float dirY = (float)(rand() % 200 - 100);
+        float dirZ = (float)(rand() % 200 - 100);
+        float length = sqrt(dirX * dirX + dirY * dirY + dirZ * dirZ) + 0.0001f;
+
+        Bullet bullet = { randomArenaCoord(), (float)(rand() % planeSize), randomArenaCoord(),
+                          dirX / length, dirY / length, dirZ / length,
+                          (i % 2) == 0 };
+        bullets.push_back(bullet);
+    }
+}
+
+static void spawnBulletStorm(int count) {
+    bulletStormSize = count;
+    bullets.reserve(count);
+    spawnStormBullets(count);
+    for (int i = 0; i < 16; i++) {
+        spawnSphere();
+    }
+    reserveSimStorage(); // For the storm's bullets and spheres, not just the robots'
+}
+
+void setupIdle() {
+    setRobotCount(0);
+}
+
+void setupRobots2() { spawnRobotArmy(2); }
+void setupRobots100() { spawnRobotArmy(100); }
+void setupRobots10k() { spawnRobotArmy(10000); }
+
+// Crowds spawn packed into the strip at the far wall, the worst case for separation
+void setupCrowd2500() { spawnRobotArmy(2500); }
+void setupCrowd5000() { spawnRobotArmy(5000); }
+void setupCrowd10k() { spawnRobotArmy(10000); }
+void setupCrowd20k() { spawnRobotArmy(20000); }
+
+// 1,000 armed robots: every fire interval each of them shoots
+void setupVolley1000() { spawnRobotArmy(1000); }
+
+void setupBulletStorm10k() {
+    setRobotCount(0);
+    spawnBulletStorm(10000);
+}
+
+void setupBulletStorm100k() {
+    setRobotCount(0);
+    spawnBulletStorm(100000);
+}
+
+void scriptBulletStorm(int tick) {
+    if ((int)bullets.size() < bulletStormSize) spawnStormBullets(bulletStormSize - (int)bullets.size());
+}
+
+void setupMassDeath() {
+    spawnRobotArmy(5000);
+    for (RobotDetail& detail : robotDetails) {
+        detail.health = 1;
+    }
+}
+
+// Tick 1: a player bullet lands on every robot so they all die on the same tick
+void scriptMassDeath(int tick) {
+    if (tick != 1) return;
+    for (const Robot& robot : robots) {
+        Bullet bullet = { robot.pos.x, robot.pos.y, robot.pos.z, 0.0f, 0.0f, 0.0f, true };
+        bullets.push_back(bullet);
+    }
+}
+
+// Over a thousand scene queries a tick against robots and spheres scattered over the arena, mostly
+// the robots' kind: line-of-sight rays to the cannon from points around it. Then fewer rays that
+// find what they hit (hitscan), nearest-robot searches, and sphere overlaps around the robots
+const int querySightRays = 1024, queryRays = 64, queryOverlaps = 64, queryNearest = 64, maxOverlapsPerQuery = 16;
+static std::vector<SceneRay> benchSightRays, benchRays;
+static std::vector<SceneHit> benchSightHits, benchRayHits, benchNearestHits;
+static std::vector<SceneSphereQuery> benchOverlaps;
+static std::vector<SceneNearestQuery> benchNearest;
+static std::vector<SceneObject> benchOverlapObjects;
+static std::vector<int> benchOverlapCounts;
+
+void setupSceneQueries() {
+    spawnRobotArmy(500);
+    for (Robot& robot : robots) {
+        robot.pos.x = randomArenaCoord();
+        robot.pos.z = randomArenaCoord();
+    }
+    for (int i = 0; i < 500; i++) {
+        spawnSphere();
+    }
+    reserveSimStorage();
+
+    benchSightRays.resize(querySightRays);
+    const glm::vec3 target(cameraX, cameraY - 1.5f, cameraZ); // Where robots aim (fireBatchedBullets())
+    for (SceneRay& ray : benchSightRays) {
+        ray.origin = glm::vec3(randomArenaCoord(), 1.0f + (float)(rand() % 8), randomArenaCoord());
+        ray.maxDistance = glm::length(target - ray.origin);
+        ray.dir = (target - ray.origin) / ray.maxDistance;
+        ray.mask = SCENE_MASK_ROBOTS | SCENE_MASK_SPHERES | SCENE_MASK_ARENA;
+        ray.ignoreRobot = -1;
+    }
+    benchRays.resize(queryRays);
+    for (SceneRay& ray : benchRays) {
+        float angle = (float)(rand() % 3600) * 0.1f * 0.0174533f;
+        ray.origin = glm::vec3(randomArenaCoord(), 1.0f + (float)(rand() % 8), randomArenaCoord());
+        ray.dir = glm::vec3(cosf(angle), -0.05f, sinf(angle));
+        ray.dir = ray.dir / glm::length(ray.dir);
+        ray.maxDistance = 2.0f * planeSize;
+        ray.mask = SCENE_MASK_ALL;
+        ray.ignoreRobot = -1;
+    }
+    benchOverlaps.resize(queryOverlaps);
+    benchNearest.resize(queryNearest);
+    for (SceneNearestQuery& query : benchNearest) {
+        query = { glm::vec3(randomArenaCoord(), 4.0f, randomArenaCoord()), 2.0f * planeSize, SCENE_MASK_ROBOTS };
+    }
+    benchSightHits.resize(querySightRays);
+    benchRayHits.resize(queryRays);
+    benchNearestHits.resize(queryNearest);
+    benchOverlapObjects.resize(queryOverlaps * maxOverlapsPerQuery);
+    benchOverlapCounts.resize(queryOverlaps);
+}
+
+void scriptSceneQueries(int tick) {
+    for (int i = 0; i < queryOverlaps; i++) {
+        const Robot& robot = robots[i % robots.size()];
+        benchOverlaps[i] = { glm::vec3(robot.pos.x, robot.pos.y, robot.pos.z), 3.0f, SCENE_MASK_ROBOTS | SCENE_MASK_SPHERES };
+    }
+    occludedInScene(benchSightRays.data(), benchSightHits.data(), querySightRays);
+    raycastScene(benchRays.data(), benchRayHits.data(), queryRays);
+    overlapScene(benchOverlaps.data(), queryOverlaps, maxOverlapsPerQuery, benchOverlapObjects.data(), benchOverlapCounts.data());
+    nearestInScene(benchNearest.data(), benchNearestHits.data(), queryNearest);
+}
+
+void setupSphereSwarm() {
+    setRobotCount(0);
+    for (int i = 0; i < 2000; i++) {
+        spawnSphere();
+    }
+}
+
+// The player sweeps the cannon across the swarm and fires every few ticks
+void scriptSphereSwarm(int tick) {
+    cameraAngleH = 0.6f * sin(tick * 0.01f);
+    if (tick % 5 == 0) {
+        fireBullet();
+    }
+}
+
+struct Budget {
+    double meanMs = -1.0, p50Ms = -1.0, p99Ms = -1.0, maxMs = -1.0, stddevMs = -1.0;
+    double allocs = -1.0, steadyAllocs = 0.0, peakRssKb = -1.0; // -1 = not budgeted
+    double queryMs = -1.0;
+};
+
+struct Scenario {
+    const char* name;
+    int ticks;
+    void (*setup)();
+    void (*script)(int tick); // Optional per-tick script, runs before the tick
+    Budget budget;
+};
+
+static Budget p99Budget(double p99Ms) {
+    Budget budget;
+    budget.p99Ms = p99Ms;
+    return budget;
+}
+
+// For a scenario whose heavy tick is one of the few p99 leaves out
+static Budget spikeBudget(double p99Ms, double maxMs) {
+    Budget budget = p99Budget(p99Ms);
+    budget.maxMs = maxMs;
+    return budget;
+}
+
+static Budget queryBudget(double p99Ms, double queryMs) {
+    Budget budget = p99Budget(p99Ms);
+    budget.queryMs = queryMs;
+    return budget;
+}
+
+// Time budgets sit above the slowest of eight default runs on one shared core, and at least half
+// again over the median one
+static Scenario scenarios[] = {
+    { "idle_arena",        600, setupIdle,            nullptr,           p99Budget(0.05) },
+    { "robots_2",          600, setupRobots2,         nullptr,           p99Budget(0.05) },
+    { "robots_100",        600, setupRobots100,       nullptr,           p99Budget(0.2) },
+    // Its p99 is a fire tick: a refit of all 10000 robots' boxes for the line-of-sight rays, on top of
+    // separating the pack (4.0-6.4 ms measured, median 4.6); the same budget as crowd_10000
+    { "robots_10000",      300, setupRobots10k,       nullptr,           p99Budget(10.0) },
+    // Budgets grow linearly with robot count: an O(n^2) step would blow the larger ones
+    { "crowd_2500",        300, setupCrowd2500,       nullptr,           p99Budget(2.5) },
+    { "crowd_5000",        300, setupCrowd5000,       nullptr,           p99Budget(5.0) },
+    { "crowd_10000",       300, setupCrowd10k,        nullptr,           p99Budget(10.0) },
+    { "crowd_20000",       300, setupCrowd20k,        nullptr,           p99Budget(20.0) },
+    { "volley_1000",       600, setupVolley1000,      nullptr,           p99Budget(2.0) },
+    { "bullet_storm_10k",  300, setupBulletStorm10k,  scriptBulletStorm, p99Budget(2.0) },
+    { "bullet_storm_100k", 100, setupBulletStorm100k, scriptBulletStorm, p99Budget(20.0) },
+    // Every robot dies on tick 1, the slowest, which p99 drops: max_ms budgets that tick (35-44 ms
+    // measured, most of it the rescans for bullets whose robot an earlier bullet killed), p99 the 299 after it
+    { "mass_robot_death",  300, setupMassDeath,       scriptMassDeath,   spikeBudget(5.0, 60.0) },
+    { "sphere_swarm",      600, setupSphereSwarm,     scriptSphereSwarm, p99Budget(5.0) },
+    // query_ms includes posing the robots the limb tests reach (0.92-1.04 ms measured, median 0.94)
+    { "scene_queries",     300, setupSceneQueries,    scriptSceneQueries, queryBudget(2.0, 1.5) },
+};
+const int numScenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+struct Result {
+    double meanMs, p50Ms, p99Ms, maxMs, stddevMs;
+    double utilisation; // Mean over the ticks
+    int threads;
+    std::string jobs;   // JSON object body: mean ms per job
+    long long allocs, allocBytes; // new during the ticks
+    long long steadyAllocs;       // new during the ticks after warmUpTicks
+    long long cacheMisses; // -1 when the counter is unavailable
+    double queriesPerTick, queryMs; // Scene queries, mean per tick
+    long peakRssKb;
+    std::string exceeded; // JSON list body of the budgets that failed
+    bool onlyTime;        // All of them time budgets, which a busy machine can blow
+};
+
+static Scenario* findScenario(const char* name) {
+    for (int i = 0; i < numScenarios; i++) {
+        if (strcmp(scenarios[i].name, name) == 0) return &scenarios[i];
+    }
+    return nullptr;
+}
+
+static void checkBudget(Result& result, const char* metric, double value, double limit) {
+    if (limit >= 0.0 && value > limit) {
+        if (!result.exceeded.empty()) result.exceeded += ", ";
+        result.exceeded += "\"";
+        result.exceeded += metric;
+        result.exceeded += "\"";
+    }
+}
+
+Result runScenario(const Scenario& scenario, int ticks) {
+    // Fresh state (and a fixed seed) for every scenario so runs are comparable
+    resetSimulation();
+    srand(1234);
+    if (startCheckpoint) {
+        auto start = std::chrono::steady_clock::now();
+        if (!loadCheckpoint(startCheckpoint)) exit(2);
+        fprintf(stderr, "Loaded %s (%zu robots) in %.3f ms\n", startCheckpoint, robots.size(),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    else {
+        scenario.setup();
+    }
+
+    std::vector<double> tickTimes;
+    tickTimes.reserve(ticks);
+    AllocStats allocsBefore = allocationTotals();
+    uint64_t violationsBefore = allocationViolations();
+    int cacheCounter = openCacheMissCounter();
+    double utilisationTotal = 0.0, serialMsTotal = 0.0;
+    std::vector<double> jobMsTotal;
+    double queriesTotal = 0.0, queryMsTotal = 0.0;
+
+    for (int tick = 0; tick < ticks; tick++) {
+        if (tick == warmUpTicks) setSteadyState(true);
+        resetSceneQueryStats();
+        if (scenario.script) {
+            ALLOW_ALLOCATIONS(); // The scenario's doing, not the tick's
+            scenario.script(tick);
+        }
+
+        enableCounter(cacheCounter, true);
+        auto start = std::chrono::steady_clock::now();
+        simTick(tickMs);
+        auto end = std::chrono::steady_clock::now();
+        enableCounter(cacheCounter, false);
+
+        tickTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        utilisationTotal += simTickStats.utilisation;
+        serialMsTotal += simTickStats.serialMs;
+        SceneQueryStats queries = sceneQueryStats();
+        queriesTotal += queries.rays + queries.overlaps + queries.nearest;
+        queryMsTotal += queries.ms;
+        jobMsTotal.resize(simJobs.jobCount());
+        for (int job = 0; job < simJobs.jobCount(); job++) jobMsTotal[job] += simJobs.jobMs(job);
+    }
+    setSteadyState(false);
+
+    Result result;
+    result.utilisation = ticks > 0 ? utilisationTotal / ticks : 0.0;
+    result.threads = simTickStats.threads;
+    result.queriesPerTick = ticks > 0 ? queriesTotal / ticks : 0.0;
+    result.queryMs = ticks > 0 ? queryMsTotal / ticks : 0.0;
+    char entry[96];
+    snprintf(entry, sizeof(entry), "\"serial\": %.4f", ticks > 0 ? serialMsTotal / ticks : 0.0);
+    result.jobs = entry;
+    for (int job = 0; job < (int)jobMsTotal.size(); job++) {
+        snprintf(entry, sizeof(entry), ", \"%s\": %.4f", simJobs.jobName(job), jobMsTotal[job] / ticks);
+        result.jobs += entry;
+    }
+    AllocStats allocsAfter = allocationTotals();
+    bool counted = allocationTrackingEnabled();
+    result.allocs = counted ? (long long)(allocsAfter.allocations - allocsBefore.allocations) : -1;
+    result.allocBytes = counted ? (long long)(allocsAfter.bytes - allocsBefore.bytes) : -1;
+    result.steadyAllocs = counted ? (long long)(allocationViolations() - violationsBefore) : -1;
+    result.cacheMisses = closeCounter(cacheCounter);
+
+    if (endCheckpoint) {
+        auto start = std::chrono::steady_clock::now();
+        if (!saveCheckpoint(endCheckpoint)) exit(2);
+        fprintf(stderr, "Saved %s (%zu robots) in %.3f ms\n", endCheckpoint, robots.size(),
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+    result.peakRssKb = peakRssKb();
+
+    double total = 0.0;
+    for (double t : tickTimes) total += t;
+    std::sort(tickTimes.begin(), tickTimes.end());
+    size_t n = tickTimes.size();
+    result.meanMs = n ? total / n : 0.0;
+
+    double variance = 0.0;
+    for (double t : tickTimes) variance += (t - result.meanMs) * (t - result.meanMs);
+    result.stddevMs = n ? sqrt(variance / n) : 0.0;
+    result.p50Ms = n ? tickTimes[n / 2] : 0.0;
+    result.p99Ms = n ? tickTimes[std::min(n - 1, (size_t)ceil(n * 0.99) - 1)] : 0.0;
+    result.maxMs = n ? tickTimes[n - 1] : 0.0;
+
+    const Budget& budget = scenario.budget;
+    checkBudget(result, "mean_ms", result.meanMs, budget.meanMs);
+    checkBudget(result, "p50_ms", result.p50Ms, budget.p50Ms);
+    checkBudget(result, "p99_ms", result.p99Ms, budget.p99Ms);
+    checkBudget(result, "max_ms", result.maxMs, budget.maxMs);
+    checkBudget(result, "stddev_ms", result.stddevMs, budget.stddevMs);
+    checkBudget(result, "query_ms", result.queryMs, budget.queryMs);
+    size_t timeExceeded = result.exceeded.size();
+    checkBudget(result, "allocs", (double)result.allocs, budget.allocs);
+    checkBudget(result, "steady_allocs", (double)result.steadyAllocs, budget.steadyAllocs);
+    checkBudget(result, "peak_rss_kb", (double)result.peakRssKb, budget.peakRssKb);
+    result.onlyTime = timeExceeded > 0 && result.exceeded.size() == timeExceeded;
+    return result;
+}
+
+// Parses "scenario:metric=value" and applies it to the scenario's budget
+static bool parseBudget(const char* spec) {
+    char name[64], metric[32];
+    double value;
+    if (sscanf(spec, "%63[^:]:%31[^=]=%lf", name, metric, &value) != 3) return false;
+
+    Scenario* scenario = findScenario(name);
+    if (!scenario) return false;
+
+    Budget& budget = scenario->budget;
+    if (strcmp(metric, "mean_ms") == 0) budget.meanMs = value;
+    else if (strcmp(metric, "p50_ms") == 0) budget.p50Ms = value;
+    else if (strcmp(metric, "p99_ms") == 0) budget.p99Ms = value;
+    else if (strcmp(metric, "max_ms") == 0) budget.maxMs = value;
+    else if (strcmp(metric, "stddev_ms") == 0) budget.stddevMs = value;
+    else if (strcmp(metric, "allocs") == 0) budget.allocs = value;
+    else if (strcmp(metric, "steady_allocs") == 0) budget.steadyAllocs = value;
+    else if (strcmp(metric, "peak_rss_kb") == 0) budget.peakRssKb = value;
+    else if (strcmp(metric, "query_ms") == 0) budget.queryMs = value;
+    else return false;
+    return true;
+}
+
+// How a scenario run went (also the exit status of the child that ran it; 2 is taken by exit(2))
+enum RunOutcome {
+    RUN_PASSED = 0,
+    RUN_FAILED = 1,
+    RUN_AGAIN = 3, // Over time budgets only, and it has another try: no JSON entry was written
+};
+
+// Runs a scenario and writes its line of the report and its JSON entry
+static RunOutcome reportScenario(FILE* out, const Scenario& scenario, int ticks, bool more, bool lastTry) {
+    Result result = runScenario(scenario, ticks);
+    bool again = result.onlyTime && !lastTry;
+
+    fprintf(stderr, "%-18s mean %8.3f ms  p99 %8.3f ms  max %8.3f ms  stddev %8.3f ms  busy %3.0f%% of %d  queries %.0f in %.3f ms  allocs %lld (%lld steady)  cache misses %lld%s%s%s\n",
+        scenario.name, result.meanMs, result.p99Ms, result.maxMs, result.stddevMs, result.utilisation * 100.0, result.threads,
+        result.queriesPerTick, result.queryMs, result.allocs, result.steadyAllocs, result.cacheMisses,
+        result.exceeded.empty() ? "" : "  OVER BUDGET: ", result.exceeded.c_str(), again ? " (running it again)" : "");
+    if (again) return RUN_AGAIN;
+
+    fprintf(out,
+        "    { \"name\": \"%s\", \"ticks\": %d, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, "
+        "\"max_ms\": %.4f, \"stddev_ms\": %.4f, \"threads\": %d, \"utilisation\": %.3f, \"job_ms\": { %s }, "
+        "\"queries\": %.1f, \"query_ms\": %.4f, "
+        "\"allocs\": %lld, \"alloc_bytes\": %lld, \"steady_allocs\": %lld, \"cache_misses\": %lld, \"peak_rss_kb\": %ld, "
+        "\"budget_exceeded\": [%s] }%s\n",
+        scenario.name, ticks, result.meanMs, result.p50Ms, result.p99Ms, result.maxMs, result.stddevMs,
+        result.threads, result.utilisation, result.jobs.c_str(), result.queriesPerTick, result.queryMs,
+        result.allocs, result.allocBytes, result.steadyAllocs, result.cacheMisses, result.peakRssKb, result.exceeded.c_str(),
+        more ? "," : "");
+    return result.exceeded.empty() ? RUN_PASSED : RUN_FAILED;
+}
+
+// Runs reportScenario() in a child process on Linux, so the scenario's peak resident set size
+// isn't the high-water mark of every scenario before it (this process never runs one). A child
+// that can't finish (a bad checkpoint) ends the run as it would have without the fork
+static RunOutcome runInChild(FILE* out, const Scenario& scenario, int ticks, bool more, bool lastTry) {
+#ifdef __linux__
+    fflush(nullptr); // Or the child flushes a copy of whatever is buffered too
+    pid_t child = fork();
+    if (child == 0) {
+        RunOutcome outcome = reportScenario(out, scenario, ticks, more, lastTry);
+        fflush(nullptr);
+        _exit(outcome);
+    }
+    if (child > 0) {
+        int status = 0;
+        if (waitpid(child, &status, 0) != child || !WIFEXITED(status)) exit(2);
+        int outcome = WEXITSTATUS(status);
+        if (outcome != RUN_PASSED && outcome != RUN_FAILED && outcome != RUN_AGAIN) exit(2);
+        return (RunOutcome)outcome;
+    }
+#endif
+    return reportScenario(out, scenario, ticks, more, lastTry);
+}
+
+int main(int argc, char** argv) {
+    std::vector<Scenario*> selected;
+    int ticksOverride = 0;
+    const char* outPath = "bench_results.json";
+    setAllocationAssert(false); // Steady-state allocations are counted against the budgets instead
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            Scenario* scenario = findScenario(argv[++i]);
+            if (!scenario) {
+                fprintf(stderr, "Unknown scenario: %s\n", argv[i]);
+                return 2;
+            }
+            selected.push_back(scenario);
+        }
+        else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticksOverride = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--budget") == 0 && i + 1 < argc) {
+            if (!parseBudget(argv[++i])) {
+                fprintf(stderr, "Bad budget: %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            startCheckpoint = argv[++i];
+        }
+        else if (strcmp(argv[i], "--save-checkpoint") == 0 && i + 1 < argc) {
+            endCheckpoint = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            setJobPoolSize(atoi(argv[++i]));
+        }
+        else if (strcmp(argv[i], "--list") == 0) {
+            for (const Scenario& scenario : scenarios) printf("%s\n", scenario.name);
+            return 0;
+        }
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (selected.empty()) {
+        for (Scenario& scenario : scenarios) selected.push_back(&scenario);
+    }
+    if (!allocationTrackingEnabled()) {
+        fprintf(stderr, "Built without FPS_TRACK_ALLOCATIONS: allocations are not counted\n");
+    }
+
+    FILE* out = stdout;
+    if (strcmp(outPath, "-") != 0 && !(out = fopen(outPath, "w"))) {
+        fprintf(stderr, "Could not open file: %s\n", outPath);
+        return 2;
+    }
+
+    bool passed = true;
+    fprintf(out, "{\n  \"tick_ms\": %u,\n  \"scenarios\": [\n", tickMs);
+    for (size_t i = 0; i < selected.size(); i++) {
+        const Scenario& scenario = *selected[i];
+        int ticks = ticksOverride > 0 ? ticksOverride : scenario.ticks;
+        bool more = i + 1 < selected.size();
+        RunOutcome outcome = runInChild(out, scenario, ticks, more, false);
+        if (outcome == RUN_AGAIN) outcome = runInChild(out, scenario, ticks, more, true);
+        passed = passed && outcome == RUN_PASSED;
+    }
+    fprintf(out, "  ],\n  \"passed\": %s\n}\n", passed ? "true" : "false");
+    if (out != stdout) fclose(out);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,343 @@
+#include "checkpoint.h"
+#include "pose.h"
+#include "scenequery.h"
+#include "sim.h"
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Records are saved as raw bytes, which is only sound while they stay plain data
+static_assert(std::is_trivially_copyable<Robot>::value, "Robot must stay trivially copyable");
+static_assert(std::is_trivially_copyable<RobotDetail>::value, "RobotDetail must stay trivially copyable");
+static_assert(std::is_trivially_copyable<Bullet>::value, "Bullet must stay trivially copyable");
+static_assert(std::is_trivially_copyable<Sphere>::value, "Sphere must stay trivially copyable");
+
+static const char checkpointMagic[8] = { 'F', 'P', 'S', 'C', 'K', 'P', 'T', '\0' };
+const uint32_t byteOrderMark = 0x01020304; // Reads back differently on a machine of the other endianness
+const uint64_t sectionAlignment = 64;
+
+// Callbacks a pending timer may have, saved by index (function addresses change between runs)
+static const TimerCallback timerCallbacks[] = {
+    robotFireHandler, disableCannonHandler, enableCannonHandler,
+    robotHitReset, robotDeactivate, robotDestroyHandler
+};
+const int numTimerCallbacks = sizeof(timerCallbacks) / sizeof(timerCallbacks[0]);
+const int firstRobotCallback = 3; // This one and those after it take a robot index as their value
+
+// Which robot handle refers to a timer (so cancel() still finds it after loading)
+enum TimerOwner { OWNER_NONE, OWNER_HIT_RESET, OWNER_ANIMATION };
+
+struct CheckpointTimer {
+    uint64_t delay;    // Ticks after the saved sim time
+    int32_t value;
+    uint16_t callback; // Index into timerCallbacks
+    uint16_t owner;    // TimerOwner
+    int32_t ownerRobot;
+    uint32_t reserved;
+};
+
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    uint32_t headerSize, robotSize, detailSize, bulletSize, sphereSize, timerSize; // Layout the file was written with
+    uint32_t robotCount, bulletCount, sphereCount, timerCount; // robotCount covers the details too
+    uint64_t robotOffset, detailOffset, bulletOffset, sphereOffset, timerOffset;
+    uint64_t fileSize;
+    uint64_t simTime;
+
+    // Player and cannon
+    float cameraX, cameraY, cameraZ;
+    float cameraAngleH, cameraAngleV;
+    float jumpVelocity;
+    float cannonAngle;
+    Sphere cannonCollisionSphere;
+    uint8_t isJumping, isCannonDisabled, padding[2];
+
+    // Robot fire schedule, bullet numbering and the shared walk cycle
+    float robotFireInterval, robotFireActive;
+    uint32_t robotFireOrigin, robotFireCheckedTo, nextBulletId;
+    RobotGait robotGait;
+    float scaleRobot;
+};
+
+static uint64_t alignUp(uint64_t offset) {
+    return (offset + sectionAlignment - 1) & ~(sectionAlignment - 1);
+}
+
+static int callbackId(TimerCallback callback) {
+    for (int i = 0; i < numTimerCallbacks; i++) {
+        if (timerCallbacks[i] == callback) return i;
+    }
+    return -1;
+}
+
+bool saveCheckpoint(const char* path) {
+    // Pending timers, as delays from now
+    std::vector<CheckpointTimer> timers;
+    std::vector<TimerHandle> handles;
+    bool unknownCallback = false;
+    const uint64_t now = simTimers.now();
+    simTimers.forEachPending([&](TimerHandle handle, uint64_t expiry, TimerCallback callback, int value) {
+        int id = callbackId(callback);
+        if (id < 0) {
+            unknownCallback = true;
+            return;
+        }
+        CheckpointTimer timer = {};
+        timer.delay = expiry - now;
+        timer.value = value;
+        timer.callback = (uint16_t)id;
+        timer.owner = OWNER_NONE;
+        timer.ownerRobot = -1;
+        timers.push_back(timer);
+        handles.push_back(handle);
+    });
+    if (unknownCallback) {
+        fprintf(stderr, "Checkpoint: a pending timer has a callback checkpoints don't know\n");
+        return false;
+    }
+
+    // Match the robots' live handles to their timers through the node index
+    int maxNode = -1;
+    for (const TimerHandle& handle : handles) maxNode = handle.index > maxNode ? handle.index : maxNode;
+    std::vector<int> timerOfNode(maxNode + 1, -1);
+    for (size_t t = 0; t < handles.size(); t++) timerOfNode[handles[t].index] = (int)t;
+
+    auto claim = [&](const TimerHandle& handle, TimerOwner owner, int robotIndex) {
+        if (handle.index < 0 || handle.index > maxNode) return;
+        int t = timerOfNode[handle.index];
+        if (t < 0 || handles[t].generation != handle.generation) return; // Already fired or cancelled
+        timers[t].owner = (uint16_t)owner;
+        timers[t].ownerRobot = robotIndex;
+    };
+    for (size_t i = 0; i < robotDetails.size(); i++) {
+        claim(robotDetails[i].hitResetTimer, OWNER_HIT_RESET, (int)i);
+        claim(robotDetails[i].animationTimer, OWNER_ANIMATION, (int)i);
+    }
+
+    CheckpointHeader header = {};
+    memcpy(header.magic, checkpointMagic, sizeof(checkpointMagic));
+    header.version = checkpointVersion;
+    header.byteOrder = byteOrderMark;
+    header.headerSize = sizeof(CheckpointHeader);
+    header.robotSize = sizeof(Robot);
+    header.detailSize = sizeof(RobotDetail);
+    header.bulletSize = sizeof(Bullet);
+    header.sphereSize = sizeof(Sphere);
+    header.timerSize = sizeof(CheckpointTimer);
+    header.robotCount = (uint32_t)robots.size();
+    header.bulletCount = (uint32_t)bullets.size();
+    header.sphereCount = (uint32_t)spheres.size();
+    header.timerCount = (uint32_t)timers.size();
+    header.robotOffset = alignUp(sizeof(CheckpointHeader));
+    header.detailOffset = alignUp(header.robotOffset + robots.size() * sizeof(Robot));
+    header.bulletOffset = alignUp(header.detailOffset + robotDetails.size() * sizeof(RobotDetail));
+    header.sphereOffset = alignUp(header.bulletOffset + bullets.size() * sizeof(Bullet));
+    header.timerOffset = alignUp(header.sphereOffset + spheres.size() * sizeof(Sphere));
+    header.fileSize = header.timerOffset + timers.size() * sizeof(CheckpointTimer);
+    header.simTime = now;
+
+    header.cameraX = cameraX;
+    header.cameraY = cameraY;
+    header.cameraZ = cameraZ;
+    header.cameraAngleH = cameraAngleH;
+    header.cameraAngleV = cameraAngleV;
+    header.jumpVelocity = jumpVelocity;
+    header.cannonAngle = cannonAngle;
+    header.cannonCollisionSphere = cannonCollisionSphere;
+    header.isJumping = isJumping ? 1 : 0;
+    header.isCannonDisabled = isCannonDisabled ? 1 : 0;
+    header.robotFireInterval = robotFireInterval;
+    header.robotFireActive = robotFireActive;
+    header.robotFireOrigin = robotFireOrigin;
+    header.robotFireCheckedTo = robotFireCheckedTo;
+    header.nextBulletId = nextBulletId;
+    header.robotGait = robotGait;
+    header.scaleRobot = scaleRobot;
+
+    // Assemble the whole file in memory so it goes out in one write
+    std::vector<uint8_t> file((size_t)header.fileSize, 0);
+    memcpy(file.data(), &header, sizeof(header));
+    if (!robots.empty()) memcpy(&file[(size_t)header.robotOffset], robots.data(), robots.size() * sizeof(Robot));
+    if (!robotDetails.empty()) memcpy(&file[(size_t)header.detailOffset], robotDetails.data(), robotDetails.size() * sizeof(RobotDetail));
+    if (!bullets.empty()) memcpy(&file[(size_t)header.bulletOffset], bullets.data(), bullets.size() * sizeof(Bullet));
+    if (!spheres.empty()) memcpy(&file[(size_t)header.sphereOffset], spheres.data(), spheres.size() * sizeof(Sphere));
+    if (!timers.empty()) memcpy(&file[(size_t)header.timerOffset], timers.data(), timers.size() * sizeof(CheckpointTimer));
+
+    // Handles index this process's timer wheel: store them empty, loading re-links them from the timers
+    RobotDetail* savedDetails = (RobotDetail*)&file[(size_t)header.detailOffset];
+    for (size_t i = 0; i < robotDetails.size(); i++) {
+        savedDetails[i].hitResetTimer = TimerHandle();
+        savedDetails[i].animationTimer = TimerHandle();
+    }
+
+    FILE* out = fopen(path, "wb");
+    if (!out) {
+        fprintf(stderr, "Checkpoint: could not open %s for writing\n", path);
+        return false;
+    }
+    bool written = fwrite(file.data(), 1, file.size(), out) == file.size();
+    written = fclose(out) == 0 && written;
+    if (!written) fprintf(stderr, "Checkpoint: could not write %s\n", path);
+    return written;
+}
+
+//// Loading
+// Read-only view of a whole file
+struct MappedFile {
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#endif
+};
+
+static void unmapFile(MappedFile& mapped) {
+#ifdef _WIN32
+    if (mapped.data) UnmapViewOfFile(mapped.data);
+    if (mapped.mapping) CloseHandle(mapped.mapping);
+    if (mapped.file != INVALID_HANDLE_VALUE) CloseHandle(mapped.file);
+#else
+    if (mapped.data) munmap((void*)mapped.data, mapped.size);
+#endif
+    mapped = MappedFile();
+}
+
+static bool mapFile(const char* path, MappedFile& mapped) {
+#ifdef _WIN32
+    mapped.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (mapped.file == INVALID_HANDLE_VALUE || !GetFileSizeEx(mapped.file, &size) || size.QuadPart == 0) {
+        unmapFile(mapped);
+        return false;
+    }
+    mapped.size = (size_t)size.QuadPart;
+    mapped.mapping = CreateFileMappingA(mapped.file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapped.mapping) mapped.data = (const uint8_t*)MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        void* data = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            mapped.data = (const uint8_t*)data;
+            mapped.size = (size_t)info.st_size;
+        }
+    }
+    close(fd); // The mapping keeps the file alive
+#endif
+    if (!mapped.data) {
+        unmapFile(mapped);
+        return false;
+    }
+    return true;
+}
+
+// A section lies inside the file and starts aligned
+static bool sectionFits(const MappedFile& mapped, uint64_t offset, uint64_t count, uint64_t recordSize) {
+    return offset % sectionAlignment == 0 && offset <= mapped.size && count <= (mapped.size - offset) / recordSize;
+}
+
+// Everything is checked before the sim is touched, so a bad file can't leave it half-loaded
+static const char* validate(const MappedFile& mapped, const CheckpointHeader& header) {
+    if (memcmp(header.magic, checkpointMagic, sizeof(checkpointMagic)) != 0) return "not a checkpoint";
+    if (header.version != checkpointVersion) return "unsupported version";
+    if (header.byteOrder != byteOrderMark) return "written on a machine of different endianness";
+    if (header.headerSize != sizeof(CheckpointHeader) || header.robotSize != sizeof(Robot) || header.detailSize != sizeof(RobotDetail) ||
+        header.bulletSize != sizeof(Bullet) || header.sphereSize != sizeof(Sphere) ||
+        header.timerSize != sizeof(CheckpointTimer)) return "written by a build with a different data layout";
+    if (header.fileSize != mapped.size) return "truncated";
+    if (!sectionFits(mapped, header.robotOffset, header.robotCount, sizeof(Robot)) ||
+        !sectionFits(mapped, header.detailOffset, header.robotCount, sizeof(RobotDetail)) ||
+        !sectionFits(mapped, header.bulletOffset, header.bulletCount, sizeof(Bullet)) ||
+        !sectionFits(mapped, header.sphereOffset, header.sphereCount, sizeof(Sphere)) ||
+        !sectionFits(mapped, header.timerOffset, header.timerCount, sizeof(CheckpointTimer))) return "section out of bounds";
+
+    const CheckpointTimer* timers = (const CheckpointTimer*)(mapped.data + header.timerOffset);
+    for (uint32_t t = 0; t < header.timerCount; t++) {
+        const CheckpointTimer& timer = timers[t];
+        if (timer.callback >= numTimerCallbacks || timer.delay == 0 || timer.delay > UINT32_MAX) return "bad timer";
+        if (timer.callback >= firstRobotCallback && (uint32_t)timer.value >= header.robotCount) return "bad timer robot";
+        if (timer.owner > OWNER_ANIMATION || (timer.owner != OWNER_NONE && (uint32_t)timer.ownerRobot >= header.robotCount)) return "bad timer owner";
+    }
+    return nullptr;
+}
+
+bool loadCheckpoint(const char* path) {
+    MappedFile mapped;
+    if (!mapFile(path, mapped)) {
+        fprintf(stderr, "Checkpoint: could not map %s\n", path);
+        return false;
+    }
+
+    CheckpointHeader header;
+    const char* problem = "truncated";
+    if (mapped.size >= sizeof(CheckpointHeader)) {
+        memcpy(&header, mapped.data, sizeof(header));
+        problem = validate(mapped, header);
+    }
+    if (problem) {
+        fprintf(stderr, "Checkpoint: %s: %s\n", path, problem);
+        unmapFile(mapped);
+        return false;
+    }
+
+    // Bulk copies straight out of the mapping
+    const Robot* savedRobots = (const Robot*)(mapped.data + header.robotOffset);
+    const RobotDetail* savedDetails = (const RobotDetail*)(mapped.data + header.detailOffset);
+    const Bullet* savedBullets = (const Bullet*)(mapped.data + header.bulletOffset);
+    const Sphere* savedSpheres = (const Sphere*)(mapped.data + header.sphereOffset);
+    const CheckpointTimer* timers = (const CheckpointTimer*)(mapped.data + header.timerOffset);
+
+    simTimers.clear(header.simTime);
+    robots.assign(savedRobots, savedRobots + header.robotCount);
+    robotDetails.assign(savedDetails, savedDetails + header.robotCount);
+    bullets.assign(savedBullets, savedBullets + header.bulletCount);
+    spheres.assign(savedSpheres, savedSpheres + header.sphereCount);
+
+    cameraX = header.cameraX;
+    cameraY = header.cameraY;
+    cameraZ = header.cameraZ;
+    cameraAngleH = header.cameraAngleH;
+    cameraAngleV = header.cameraAngleV;
+    jumpVelocity = header.jumpVelocity;
+    cannonAngle = header.cannonAngle;
+    cannonCollisionSphere = header.cannonCollisionSphere;
+    isJumping = header.isJumping != 0;
+    isCannonDisabled = header.isCannonDisabled != 0;
+    robotFireInterval = header.robotFireInterval;
+    robotFireActive = header.robotFireActive;
+    robotFireOrigin = header.robotFireOrigin;
+    robotFireCheckedTo = header.robotFireCheckedTo;
+    nextBulletId = header.nextBulletId;
+    robotGait = header.robotGait;
+    scaleRobot = header.scaleRobot;
+    activeKeys.reset(); // Held keys belong to the session, not the save
+
+    for (uint32_t t = 0; t < header.timerCount; t++) {
+        const CheckpointTimer& timer = timers[t];
+        TimerHandle handle = simTimers.schedule((uint32_t)timer.delay, timerCallbacks[timer.callback], timer.value);
+        if (timer.owner == OWNER_HIT_RESET) robotDetails[timer.ownerRobot].hitResetTimer = handle;
+        if (timer.owner == OWNER_ANIMATION) robotDetails[timer.ownerRobot].animationTimer = handle;
+    }
+    reserveSimStorage();
+
+    unmapFile(mapped);
+    invalidateRobotPoses();
+    invalidateSceneTree(); // The first tick's robot fire looks through the loaded state
+    return true;
+}
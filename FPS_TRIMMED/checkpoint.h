@@ -0,0 +1,15 @@
+#pragma once
+// Save states for the simulation
+// A checkpoint is one file holding everything simTick() reads: robots (both the hot and the detail
+// array), bullets, spheres, the player and cannon, the robot fire schedule and every pending timer.
+// Records are stored in their in-memory layout at aligned offsets, so saving is one bulk write and
+// loading maps the file and copies each array in one go, with no per-field parsing. The header records the layout it was
+// written with, and a build whose layout differs refuses the file instead of misreading it.
+
+const unsigned int checkpointVersion = 2;
+
+// Writes the current sim state to path; false (with a message on stderr) on failure
+bool saveCheckpoint(const char* path);
+
+// Replaces the sim state with the one saved at path; on failure the sim is left untouched
+bool loadCheckpoint(const char* path);
@@ -0,0 +1,150 @@
+#include "crowd.h"
+#include "sim.h"
+#include "workers.h"
+#include <algorithm>
+#include <vector>
+
+const int crowdGridSize = (int)(2 * planeSize / crowdCellSize); // Cells per side
+const int crowdCellCount = crowdGridSize * crowdGridSize;
+
+const float separationStrength = 0.02f; // Fraction of the overlap resolved per tick
+const float maxPushPerTick = 0.05f;     // Keeps packed crowds from jittering
+const int maxNeighbours = 8;            // Overlapping robots that push on one robot per tick
+const int maxCandidates = 32;           // Robots looked at per robot per tick: bounds the work however densely they're packed
+const int cellGrain = 64;               // Cells per chunk handed to a job thread
+
+// Own cell first, so a capped scan still sees the closest robots
+const int neighbourOffsets[9][2] = { { 0, 0 }, { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 }, { -1, -1 }, { 1, -1 }, { -1, 1 }, { 1, 1 } };
+
+struct CrowdGrid {
+    std::vector<int> cellStart; // Robots of cell c are entries[cellStart[c] .. cellStart[c + 1])
+    std::vector<int> entries;   // Robot indices sorted by cell
+    std::vector<float> entryX, entryZ; // Their positions, in the same order (neighbour reads stay contiguous)
+    std::vector<int> robotCell; // Cell of each robot (-1 if not in the grid)
+    std::vector<float> pushX, pushZ;
+};
+static CrowdGrid grid;
+
+static int crowdCellCoord(float world) {
+    int cell = (int)((world + planeSize) / crowdCellSize);
+    return std::min(std::max(cell, 0), crowdGridSize - 1);
+}
+
+// Counting sort of the active robots into the grid
+static void buildCrowdGrid() {
+    const int count = (int)robots.size();
+    grid.cellStart.assign(crowdCellCount + 1, 0);
+    grid.robotCell.resize(count);
+
+    for (int i = 0; i < count; i++) {
+        if (!robots[i].isActive) {
+            grid.robotCell[i] = -1;
+            continue;
+        }
+        int cell = crowdCellCoord(robots[i].pos.z) * crowdGridSize + crowdCellCoord(robots[i].pos.x);
+        grid.robotCell[i] = cell;
+        grid.cellStart[cell + 1]++;
+    }
+    for (int c = 0; c < crowdCellCount; c++) {
+        grid.cellStart[c + 1] += grid.cellStart[c];
+    }
+
+    int total = grid.cellStart[crowdCellCount];
+    grid.entries.resize(total);
+    grid.entryX.resize(total);
+    grid.entryZ.resize(total);
+    for (int i = count - 1; i >= 0; i--) {
+        if (grid.robotCell[i] < 0) continue;
+        int e = --grid.cellStart[grid.robotCell[i] + 1];
+        grid.entries[e] = i;
+        grid.entryX[e] = robots[i].pos.x;
+        grid.entryZ[e] = robots[i].pos.z;
+    }
+    // Placing walked each cell's end slot (cellStart[c + 1]) back to the cell's start; shift down one
+    for (int c = 0; c < crowdCellCount; c++) grid.cellStart[c] = grid.cellStart[c + 1];
+    grid.cellStart[crowdCellCount] = total;
+}
+
+// Gathers the pushes on the robots of cells [begin, end) (a parallelFor body: each robot is in
+// one cell, so chunks write disjoint entries of pushX/pushZ)
+static void gatherPushes(int begin, int end, int worker, void* context) {
+    const float separation = std::min(2.0f * scaleRobot, crowdCellSize); // Two robot radii
+    const float separationSquared = separation * separation;
+
+    for (int cell = begin; cell < end; cell++) {
+        int cellX = cell % crowdGridSize;
+        int cellZ = cell / crowdGridSize;
+
+        for (int self = grid.cellStart[cell]; self < grid.cellStart[cell + 1]; self++) {
+            int i = grid.entries[self];
+            if (robots[i].isDestroyed) continue; // Falling robots stay put but still push
+            float selfX = grid.entryX[self];
+            float selfZ = grid.entryZ[self];
+
+            int neighbours = 0, candidates = 0;
+            float pushX = 0.0f, pushZ = 0.0f;
+
+            for (int n = 0; n < 9 && neighbours < maxNeighbours && candidates < maxCandidates; n++) {
+                int x = cellX + neighbourOffsets[n][0];
+                int z = cellZ + neighbourOffsets[n][1];
+                if (x < 0 || z < 0 || x >= crowdGridSize || z >= crowdGridSize) continue;
+
+                int other = z * crowdGridSize + x;
+                for (int e = grid.cellStart[other]; e < grid.cellStart[other + 1]; e++) {
+                    if (e == self) continue;
+                    if (++candidates > maxCandidates) break;
+
+                    float dx = selfX - grid.entryX[e];
+                    float dz = selfZ - grid.entryZ[e];
+                    float distanceSquared = dx * dx + dz * dz;
+                    if (distanceSquared >= separationSquared) continue;
+
+                    if (distanceSquared < 1e-6f) {
+                        // Exactly on top of each other: split along x by entry order
+                        pushX += self < e ? separation : -separation;
+                    }
+                    else {
+                        float distance = sqrt(distanceSquared);
+                        float overlap = (separation - distance) / distance; // Scales (dx, dz) to the overlap
+                        pushX += dx * overlap;
+                        pushZ += dz * overlap;
+                    }
+
+                    if (++neighbours >= maxNeighbours) break;
+                }
+            }
+
+            grid.pushX[i] = pushX * separationStrength;
+            grid.pushZ[i] = pushZ * separationStrength;
+        }
+    }
+}
+
+void separateRobots() {
+    buildCrowdGrid();
+
+    const int count = (int)robots.size();
+    grid.pushX.assign(count, 0.0f);
+    grid.pushZ.assign(count, 0.0f);
+
+    // Pushes are gathered first and applied afterwards so the result doesn't depend on robot order.
+    // Robots are visited in cell order so the cells being read stay in cache.
+    parallelFor(crowdCellCount, cellGrain, gatherPushes, nullptr);
+
+    for (int i = 0; i < count; i++) {
+        float pushX = grid.pushX[i];
+        float pushZ = grid.pushZ[i];
+        float lengthSquared = pushX * pushX + pushZ * pushZ;
+        if (lengthSquared == 0.0f) continue;
+
+        if (lengthSquared > maxPushPerTick * maxPushPerTick) {
+            float scale = maxPushPerTick / sqrt(lengthSquared);
+            pushX *= scale;
+            pushZ *= scale;
+        }
+
+        Robot& robot = robots[i];
+        robot.pos.x += pushX;
+        robot.pos.z += pushZ;
+    }
+}
@@ -0,0 +1,11 @@
+#pragma once
+// Robot-robot separation
+// Robot positions are binned into a uniform grid over the arena once per tick (a counting sort
+// into flat arrays, reused between ticks), and each robot only reads the 3x3 cells around it.
+// A pairwise check would be O(n^2); this stays O(n) up to tens of thousands of robots.
+// The per-robot pass runs in chunks of cells on the job threads.
+
+const float crowdCellSize = 4.0f; // World units per cell, at least the separation distance
+
+// Pushes overlapping living robots apart (run after the robots have moved for the tick)
+void separateRobots();
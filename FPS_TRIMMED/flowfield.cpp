@@ -0,0 +1,71 @@
+#include "flowfield.h"
+#include "sim.h"
+#include <algorithm>
+#include <vector>
+
+const int flowGridSize = (int)(2 * planeSize / flowCellSize); // Cells per side
+const int flowCellCount = flowGridSize * flowGridSize;
+
+struct FlowField {
+    std::vector<float> dirX, dirZ;
+    int targetCell = -1;
+    float targetX = 0.0f, targetZ = 0.0f;
+};
+static FlowField field;
+
+static void ensureAllocated() {
+    if ((int)field.dirX.size() == flowCellCount) return;
+    field.dirX.resize(flowCellCount);
+    field.dirZ.resize(flowCellCount);
+}
+
+static int cellCoord(float world) {
+    int cell = (int)((world + planeSize) / flowCellSize);
+    return std::min(std::max(cell, 0), flowGridSize - 1);
+}
+
+static int cellAt(float x, float z) {
+    return cellCoord(z) * flowGridSize + cellCoord(x);
+}
+
+// Per-cell directions towards the target (the exact target position, not its cell's centre)
+static void rebuild() {
+    for (int cell = 0; cell < flowCellCount; cell++) {
+        field.dirX[cell] = 0.0f;
+        field.dirZ[cell] = 0.0f;
+        if (cell == field.targetCell) continue;
+
+        float fromX = (cell % flowGridSize + 0.5f) * flowCellSize - planeSize;
+        float fromZ = (cell / flowGridSize + 0.5f) * flowCellSize - planeSize;
+        float dirX = field.targetX - fromX;
+        float dirZ = field.targetZ - fromZ;
+        float length = sqrt(dirX * dirX + dirZ * dirZ);
+        if (length > 0.0f) {
+            field.dirX[cell] = dirX / length;
+            field.dirZ[cell] = dirZ / length;
+        }
+    }
+}
+
+void updateFlowField(float targetX, float targetZ) {
+    ensureAllocated();
+
+    int target = cellAt(targetX, targetZ);
+    if (target == field.targetCell) return;
+
+    field.targetCell = target;
+    field.targetX = targetX;
+    field.targetZ = targetZ;
+    rebuild();
+}
+
+void sampleFlowField(float x, float z, float& dirX, float& dirZ) {
+    if (field.dirX.empty()) {
+        dirX = 0.0f;
+        dirZ = 0.0f;
+        return;
+    }
+    int cell = cellAt(x, z);
+    dirX = field.dirX[cell];
+    dirZ = field.dirZ[cell];
+}
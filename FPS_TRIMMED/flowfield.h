@@ -0,0 +1,14 @@
+#pragma once
+// Shared flow-field navigation for the robots
+// One grid over the arena holds, per cell, the unit direction a robot should walk to reach the
+// player. It's rebuilt only when the player enters a new cell, and every robot samples it in O(1),
+// so navigation cost doesn't grow with robot count. The arena is open, so each cell's direction is
+// straight at the player; obstacles would need a path search here when the arena gets any.
+
+const float flowCellSize = 2.0f; // World units per cell (about one robot across)
+
+// Recomputes the field if the target moved to another cell
+void updateFlowField(float targetX, float targetZ);
+
+// Steering direction (unit length on XZ, or zero at the target) for a robot standing at (x, z)
+void sampleFlowField(float x, float z, float& dirX, float& dirZ);
@@ -0,0 +1,63 @@
+// Dedicated headless server (no window, no GL)
+// Runs the sim at a fixed 100 Hz and serves it to clients over UDP (see server.h).
+//
+// Build (Linux):  g++ -O3 -std=c++17 sim.cpp timerwheel.cpp pose.cpp flowfield.cpp crowd.cpp jobs.cpp workers.cpp scenequery.cpp alloctrack.cpp net.cpp netcodec.cpp server.cpp fps_server.cpp -lpthread -o fps_server
+// Usage:          fps_server [--port N] [--robots N] [--max-clients N]
+#include "server.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+int main(int argc, char** argv) {
+    int port = 27015;
+    int robotCount = NUM_ROBOTS;
+    int maxClients = 16;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--robots") == 0 && i + 1 < argc) {
+            robotCount = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-clients") == 0 && i + 1 < argc) {
+            maxClients = atoi(argv[++i]);
+        }
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    setRobotCount(robotCount);
+    spawnRobots();
+    if (!startServer((uint16_t)port, maxClients)) {
+        fprintf(stderr, "Could not open UDP port %d\n", port);
+        return 1;
+    }
+    fprintf(stderr, "Serving %d robots on UDP port %u\n", robotCount, serverPort());
+
+    const std::chrono::milliseconds step(serverTickMs);
+    auto nextTick = std::chrono::steady_clock::now();
+    double busyMs = 0.0;
+    while (true) {
+        auto start = std::chrono::steady_clock::now();
+        runServerTick();
+        busyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Status line every 5s
+        const uint32_t reportTicks = 500;
+        if (serverTickCount() % reportTicks == 0) {
+            fprintf(stderr, "tick %u  clients %d  mean tick %.3f ms\n", serverTickCount(), serverClientCount(), busyMs / reportTicks);
+            busyMs = 0.0;
+        }
+
+        // Fixed rate; after a long stall resume from now instead of catching up
+        nextTick += step;
+        auto now = std::chrono::steady_clock::now();
+        if (now - nextTick > 10 * step) nextTick = now;
+        std::this_thread::sleep_until(nextTick);
+    }
+}
@@ -0,0 +1,234 @@
+#include <GL/glew.h>
+#include "framecapture.h"
+#include "pngwrite.h"
+#include "spscqueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+
+// A readback in flight
+typedef struct CaptureSlot {
+    GLuint buffer;
+    GLsync fence;   // Null without fences
+    bool busy;
+    uint64_t frame; // Frame number it holds
+} CaptureSlot;
+
+// A frame handed to the writer: which of frameBuffers holds it
+typedef struct CapturedFrame {
+    int buffer;
+    uint64_t frame;
+} CapturedFrame;
+
+static bool active = false;
+static int captureWidth, captureHeight;
+static CaptureFormat captureFormat;
+static std::string captureDirectory;
+static bool useFences;
+
+static CaptureSlot slots[captureRingSize];
+static int nextSlot = 0; // Next slot to issue into; the busy ones after it (wrapping) are older
+static uint64_t frameNumber = 0;
+static CaptureStats stats;
+
+// Frame buffers are allocated once per capture and passed between the threads by index
+static std::vector<uint8_t> frameBuffers[captureFrameBuffers];
+static SpscQueue<CapturedFrame, captureFrameBuffers + 1> filledFrames; // Render thread -> writer
+static SpscQueue<int, captureFrameBuffers + 1> freeBuffers;            // Writer -> render thread
+static std::thread writerThread;
+static std::atomic<bool> writerRunning(false);
+static std::atomic<uint64_t> framesWritten(0);
+
+//// Writer thread
+static void writeFrame(const CapturedFrame& captured, FILE* raw, std::vector<uint8_t>& row) {
+    const uint8_t* pixels = frameBuffers[captured.buffer].data();
+    if (captureFormat == CAPTURE_PNG) {
+        char path[512];
+        snprintf(path, sizeof(path), "%s/frame_%06llu.png", captureDirectory.c_str(), (unsigned long long)captured.frame);
+        if (!writePng(path, captureWidth, captureHeight, pixels, true)) {
+            fprintf(stderr, "Could not write %s\n", path);
+        }
+        return;
+    }
+
+    // Raw: RGB, top row first (GL reads bottom-up RGBA)
+    for (int y = captureHeight - 1; y >= 0; y--) {
+        const uint8_t* source = pixels + (size_t)y * captureWidth * 4;
+        for (int x = 0; x < captureWidth; x++) {
+            memcpy(&row[(size_t)x * 3], source + (size_t)x * 4, 3);
+        }
+        fwrite(row.data(), 1, row.size(), raw);
+    }
+}
+
+static void writerThreadMain(FILE* raw) {
+    std::vector<uint8_t> row((size_t)captureWidth * 3);
+    while (true) {
+        CapturedFrame captured;
+        if (filledFrames.pop(captured)) {
+            writeFrame(captured, raw, row);
+            framesWritten.fetch_add(1, std::memory_order_relaxed);
+            freeBuffers.push(captured.buffer);
+            continue;
+        }
+        if (!writerRunning.load(std::memory_order_acquire)) break; // Stopped and drained
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (raw) fclose(raw);
+}
+
+//// Render thread
+bool startCapture(const char* directory, int width, int height, CaptureFormat format) {
+    if (active || !GLEW_VERSION_1_5 || width <= 0 || height <= 0) return false;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    FILE* raw = nullptr;
+    if (format == CAPTURE_RAW) {
+        std::string path = std::string(directory) + "/capture.rgb";
+        if (!(raw = fopen(path.c_str(), "wb"))) {
+            fprintf(stderr, "Could not open file: %s\n", path.c_str());
+            return false;
+        }
+    }
+
+    captureWidth = width;
+    captureHeight = height;
+    captureFormat = format;
+    captureDirectory = directory;
+    useFences = GLEW_VERSION_3_2 || GLEW_ARB_sync;
+    frameNumber = 0;
+    stats = CaptureStats();
+    framesWritten.store(0);
+
+    size_t frameSize = (size_t)width * height * 4;
+    for (int i = 0; i < captureRingSize; i++) {
+        glGenBuffers(1, &slots[i].buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slots[i].buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, frameSize, nullptr, GL_STREAM_READ);
+        slots[i].fence = nullptr;
+        slots[i].busy = false;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    nextSlot = 0;
+
+    for (int i = 0; i < captureFrameBuffers; i++) {
+        frameBuffers[i].resize(frameSize);
+        freeBuffers.push(i);
+    }
+
+    writerRunning.store(true);
+    writerThread = std::thread(writerThreadMain, raw);
+    active = true;
+    return true;
+}
+
+// Whether a slot's readback has finished (wait: block until it has)
+static bool slotReady(const CaptureSlot& slot, bool wait) {
+    if (!useFences) return wait || frameNumber - slot.frame >= captureRingSize - 1;
+    GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? 1000000000ull : 0);
+    return status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED;
+}
+
+// Copies a finished readback out of its PBO for the writer, and frees the slot (wait: for the
+// writer to free a buffer too, instead of dropping the frame)
+static void collectSlot(CaptureSlot& slot, bool wait) {
+    int buffer;
+    bool haveBuffer = freeBuffers.pop(buffer);
+    while (!haveBuffer && wait) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        haveBuffer = freeBuffers.pop(buffer);
+    }
+    if (haveBuffer) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        const void* mapped = glMapBuffer(GL_PIXEL_PACK_BUFFER, GL_READ_ONLY);
+        if (mapped) {
+            memcpy(frameBuffers[buffer].data(), mapped, frameBuffers[buffer].size());
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            filledFrames.push({ buffer, slot.frame });
+            stats.framesQueued++;
+        }
+        else {
+            freeBuffers.push(buffer);
+            stats.framesDropped++;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+    else {
+        stats.framesDropped++; // Writer behind
+    }
+
+    if (slot.fence) glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+    slot.busy = false;
+}
+
+// Collects finished readbacks, oldest first (stops at the first unfinished one unless waiting)
+static void collectSlots(bool wait) {
+    for (int i = 0; i < captureRingSize; i++) {
+        CaptureSlot& slot = slots[(nextSlot + i) % captureRingSize];
+        if (!slot.busy) continue;
+        if (!slotReady(slot, wait)) break;
+        collectSlot(slot, wait);
+    }
+}
+
+void captureFrame() {
+    if (!active) return;
+    auto start = std::chrono::steady_clock::now();
+    frameNumber++;
+
+    collectSlots(false);
+
+    CaptureSlot& slot = slots[nextSlot];
+    if (slot.busy) {
+        stats.framesDropped++; // All readbacks still in flight: skip this frame rather than wait
+    }
+    else {
+        // Into the PBO: glReadPixels returns without waiting for the frame to finish
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(0, 0, captureWidth, captureHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        slot.fence = useFences ? glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0) : nullptr;
+        slot.frame = frameNumber;
+        slot.busy = true;
+        nextSlot = (nextSlot + 1) % captureRingSize;
+    }
+
+    stats.renderThreadMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void stopCapture() {
+    if (!active) return;
+    collectSlots(true);
+    for (CaptureSlot& slot : slots) {
+        glDeleteBuffers(1, &slot.buffer);
+    }
+
+    writerRunning.store(false, std::memory_order_release);
+    writerThread.join();
+
+    // Both queues are empty again; the frame buffers go back to the allocator
+    int buffer;
+    while (freeBuffers.pop(buffer)) {}
+    for (std::vector<uint8_t>& frame : frameBuffers) {
+        std::vector<uint8_t>().swap(frame);
+    }
+    active = false;
+}
+
+bool capturing() {
+    return active;
+}
+
+CaptureStats captureStats() {
+    CaptureStats current = stats;
+    current.framesWritten = framesWritten.load(std::memory_order_relaxed);
+    return current;
+}
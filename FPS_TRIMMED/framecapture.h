@@ -0,0 +1,38 @@
+#pragma once
+// In-engine frame capture
+// Records the frames being drawn without stalling the GPU. captureFrame() only queues a copy of the
+// back buffer into one of a ring of pixel buffer objects and fences it. The copy is picked up a frame
+// or two later, once its fence has signalled, and handed to a writer thread. That thread encodes
+// and writes it, so neither readback nor disk I/O waits on the render thread. When the writer falls
+// behind, frames are dropped (and counted) rather than holding up the game.
+// Needs a current GL context with buffer objects (GL 1.5); fences (GL 3.2 / ARB_sync) are used when
+// present, otherwise a frame is mapped once the ring has gone round.
+#include <cstdint>
+
+enum CaptureFormat {
+    CAPTURE_PNG, // One PNG per frame: exact, but encoding limits the sustained frame rate
+    CAPTURE_RAW  // One file of packed RGB frames, top row first (turn into video with ffmpeg's rawvideo input)
+};
+
+const int captureRingSize = 3;     // PBOs in flight: readback completes up to two frames later
+const int captureFrameBuffers = 8; // Frames waiting for the writer thread before new ones are dropped
+
+typedef struct CaptureStats {
+    uint64_t framesQueued;  // Read back and handed to the writer
+    uint64_t framesWritten;
+    uint64_t framesDropped; // Ring or writer full
+    double renderThreadMs;  // Total time spent in captureFrame() on the render thread
+} CaptureStats;
+
+// Starts recording frames of width x height into directory (created if needed); false if capture
+// isn't possible (no buffer objects) or already running
+bool startCapture(const char* directory, int width, int height, CaptureFormat format);
+
+// Render thread, after the frame is drawn and before the swap
+void captureFrame();
+
+// Collects the frames still in flight, waits for the writer to finish them and stops it
+void stopCapture();
+
+bool capturing();
+CaptureStats captureStats();
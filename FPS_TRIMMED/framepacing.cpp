@@ -0,0 +1,185 @@
+#include "framepacing.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#ifdef _WIN32
+#define NOMINMAX // std::min/max below
+#include <windows.h>
+#include <timeapi.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+typedef std::chrono::steady_clock PacingClock;
+
+static PacingMode mode = PACING_VSYNC;
+static float capHz = pacingDefaultCapHz;
+static bool frameRequested = true; // Draw the first frame
+static bool frameStarted = false;  // waitForFrame() said yes and the frame isn't presented yet
+static PacingClock::time_point nextFrameStart;
+static PacingClock::time_point lastPresent;
+static bool presentedBefore = false;
+
+static uint32_t histogram[pacingHistogramBuckets];
+static uint64_t frameCount = 0;
+static float slowestMs = 0.0f;
+
+static const char* modeNames[NUM_PACING_MODES] = { "vsync", "capped", "uncapped" };
+
+void setPacingMode(PacingMode newMode, float newCapHz) {
+#ifdef _WIN32
+    // Sleeps otherwise round up to the 15.6 ms default timer tick, far beyond the spin window
+    static bool timerPeriodSet = false;
+    if (!timerPeriodSet) {
+        timeBeginPeriod(1);
+        timerPeriodSet = true;
+    }
+#endif
+    mode = newMode;
+    capHz = newCapHz > 0.0f ? newCapHz : pacingDefaultCapHz;
+    nextFrameStart = PacingClock::now();
+    frameRequested = true;
+}
+
+PacingMode pacingMode() {
+    return mode;
+}
+
+float pacingCapHz() {
+    return capHz;
+}
+
+const char* pacingModeName(PacingMode pacing) {
+    return modeNames[pacing];
+}
+
+bool parsePacingMode(const char* text, PacingMode& pacing, float& hz) {
+    if (strcmp(text, "vsync") == 0) {
+        pacing = PACING_VSYNC;
+        return true;
+    }
+    if (strcmp(text, "uncapped") == 0) {
+        pacing = PACING_UNCAPPED;
+        return true;
+    }
+    if (strncmp(text, "cap", 3) == 0) {
+        pacing = PACING_CAPPED;
+        hz = pacingDefaultCapHz;
+        if (text[3] == '\0') return true;
+        if (text[3] != '=') return false;
+        hz = (float)atof(text + 4);
+        return hz > 0.0f;
+    }
+    return false;
+}
+
+void requestFrame() {
+    frameRequested = true;
+}
+
+bool waitForFrame() {
+    if (frameStarted) return false; // Already posted; display() hasn't run yet
+
+    if (mode == PACING_UNCAPPED) {
+        frameStarted = true;
+        return true;
+    }
+
+    if (!frameRequested) {
+        // Nothing new: a short sleep keeps a new snapshot's wait under a millisecond without spinning
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return false;
+    }
+
+    if (mode == PACING_CAPPED) {
+        // OS sleeps overshoot by up to a scheduler tick, so sleep short of the deadline and spin the rest
+        auto now = PacingClock::now();
+        auto spin = std::chrono::duration_cast<PacingClock::duration>(std::chrono::duration<float, std::milli>(pacingSpinMs));
+        if (nextFrameStart - now > spin) {
+            std::this_thread::sleep_for(nextFrameStart - now - spin);
+            return false; // Let the caller pick up any newer snapshot first
+        }
+        while (PacingClock::now() < nextFrameStart) {
+            std::this_thread::yield();
+        }
+
+        // Keep a steady cadence; after a long frame start over from now instead of bunching frames up
+        auto period = std::chrono::duration_cast<PacingClock::duration>(std::chrono::duration<float>(1.0f / capHz));
+        now = PacingClock::now();
+        nextFrameStart += period;
+        if (nextFrameStart < now) nextFrameStart = now + period;
+    }
+
+    frameStarted = true;
+    return true;
+}
+
+float framePresented() {
+    auto now = PacingClock::now();
+    frameRequested = false;
+    frameStarted = false;
+
+    float ms = 0.0f;
+    if (presentedBefore) {
+        ms = std::chrono::duration<float, std::milli>(now - lastPresent).count();
+        int bucket = std::min((int)(ms / pacingHistogramBucketMs), pacingHistogramBuckets - 1);
+        histogram[bucket]++;
+        frameCount++;
+        slowestMs = std::max(slowestMs, ms);
+    }
+    lastPresent = now;
+    presentedBefore = true;
+    return ms;
+}
+
+float frameTimePercentileMs(float p) {
+    if (frameCount == 0) return 0.0f;
+    uint64_t rank = (uint64_t)(p / 100.0f * (frameCount - 1));
+    uint64_t seen = 0;
+    for (int i = 0; i < pacingHistogramBuckets; i++) {
+        seen += histogram[i];
+        if (seen > rank) return std::min((i + 1) * pacingHistogramBucketMs, slowestMs); // Bucket's upper edge
+    }
+    return slowestMs;
+}
+
+uint64_t framesPresented() {
+    return frameCount;
+}
+
+void resetFrameStats() {
+    memset(histogram, 0, sizeof(histogram));
+    frameCount = 0;
+    slowestMs = 0.0f;
+    presentedBefore = false;
+}
+
+void printFrameReport() {
+    if (frameCount == 0) return;
+
+    if (mode == PACING_CAPPED) printf("Frame times (%s %.0f Hz, %llu frames):", modeNames[mode], capHz, (unsigned long long)frameCount);
+    else printf("Frame times (%s, %llu frames):", modeNames[mode], (unsigned long long)frameCount);
+    printf(" p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+        frameTimePercentileMs(50.0f), frameTimePercentileMs(90.0f), frameTimePercentileMs(99.0f), slowestMs);
+
+    // 1 ms rows, empty rows skipped
+    const int bucketsPerRow = (int)(1.0f / pacingHistogramBucketMs);
+    const int barWidth = 50;
+    uint32_t tallest = 0;
+    for (int row = 0; row * bucketsPerRow < pacingHistogramBuckets; row++) {
+        uint32_t count = 0;
+        for (int i = row * bucketsPerRow; i < (row + 1) * bucketsPerRow; i++) count += histogram[i];
+        tallest = std::max(tallest, count);
+    }
+    for (int row = 0; row * bucketsPerRow < pacingHistogramBuckets; row++) {
+        uint32_t count = 0;
+        for (int i = row * bucketsPerRow; i < (row + 1) * bucketsPerRow; i++) count += histogram[i];
+        if (count == 0) continue;
+
+        int width = std::max((int)((uint64_t)count * barWidth / tallest), 1);
+        bool last = (row + 1) * bucketsPerRow >= pacingHistogramBuckets;
+        printf("%4d%s ms %8u %.*s\n", row, last ? "+" : " ", count, width, "##################################################");
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+// Frame pacing
+// Decides when the render thread draws. Redisplay requests (a new sim snapshot, a resize) are
+// coalesced so at most one frame is drawn per request however often they arrive, and the idle
+// callback sleeps instead of spinning while nothing is due. Presented frame times go into a
+// histogram for the perf panel and the exit report.
+// No GL in here; the caller sets the swap interval for PACING_VSYNC.
+#include <cstdint>
+
+enum PacingMode {
+    PACING_VSYNC,    // Swap waits for the display; draw whenever there's something new
+    PACING_CAPPED,   // Frames start no closer than 1 / capHz apart: sleep, then spin the last stretch
+    PACING_UNCAPPED, // Draw continuously, new state or not (benchmarking)
+    NUM_PACING_MODES
+};
+
+const float pacingDefaultCapHz = 120.0f;
+const float pacingSpinMs = 1.5f;          // Capped: spin (not sleep) this close to the deadline
+const float pacingHistogramBucketMs = 0.25f;
+const int pacingHistogramBuckets = 400;   // Up to 100 ms; slower frames land in the last bucket
+
+void setPacingMode(PacingMode mode, float capHz);
+PacingMode pacingMode();
+float pacingCapHz();
+const char* pacingModeName(PacingMode mode);
+
+// Parses "vsync", "uncapped", "cap" or "cap=<hz>"; returns false if not recognised
+bool parsePacingMode(const char* text, PacingMode& mode, float& capHz);
+
+// Something changed that should be drawn (coalesced until the next framePresented())
+void requestFrame();
+
+// Idle callback: true when a frame should be drawn now (then it doesn't ask again until presented).
+// Otherwise it has slept for a short while, so the caller can just return.
+bool waitForFrame();
+
+// After the swap: records the time since the previous present and returns it (0 for the first)
+float framePresented();
+
+// Presented frame-time percentile (p in [0, 100]) from the histogram, in ms
+float frameTimePercentileMs(float p);
+uint64_t framesPresented();
+
+// Resets the histogram (e.g. after switching modes)
+void resetFrameStats();
+
+// Prints the histogram and percentiles to stdout
+void printFrameReport();
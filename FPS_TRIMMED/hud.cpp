@@ -0,0 +1,183 @@
+#include "hud.h"
+#include <cstddef>
+
+static std::vector<HudVertex> vertices;
+
+// 5x7 font for ASCII 32-95, one byte per row from the top, bit 4 the leftmost pixel
+static const uint8_t hudFont[64][hudGlyphHeight] = {
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00 }, // ' '
+    { 0x04, 0x04, 0x04, 0x04, 0x00, 0x00, 0x04 }, // '!'
+    { 0x0A, 0x0A, 0x0A, 0x00, 0x00, 0x00, 0x00 }, // '"'
+    { 0x0A, 0x0A, 0x1F, 0x0A, 0x1F, 0x0A, 0x0A }, // '#'
+    { 0x04, 0x0F, 0x14, 0x0E, 0x05, 0x1E, 0x04 }, // '$'
+    { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 }, // '%'
+    { 0x0C, 0x12, 0x14, 0x08, 0x15, 0x12, 0x0D }, // '&'
+    { 0x0C, 0x04, 0x08, 0x00, 0x00, 0x00, 0x00 }, // '''
+    { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 }, // '('
+    { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 }, // ')'
+    { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 }, // '*'
+    { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 }, // '+'
+    { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 }, // ','
+    { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 }, // '-'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C }, // '.'
+    { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, // '/'
+    { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, // '0'
+    { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E }, // '1'
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, // '2'
+    { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E }, // '3'
+    { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, // '4'
+    { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E }, // '5'
+    { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, // '6'
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 }, // '7'
+    { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, // '8'
+    { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C }, // '9'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, // ':'
+    { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x04, 0x08 }, // ';'
+    { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 }, // '<'
+    { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 }, // '='
+    { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 }, // '>'
+    { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x00, 0x04 }, // '?'
+    { 0x0E, 0x11, 0x01, 0x0D, 0x15, 0x15, 0x0E }, // '@'
+    { 0x0E, 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11 }, // 'A'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E }, // 'B'
+    { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, // 'C'
+    { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C }, // 'D'
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, // 'E'
+    { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 }, // 'F'
+    { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, // 'G'
+    { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, // 'H'
+    { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, // 'I'
+    { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C }, // 'J'
+    { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, // 'K'
+    { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F }, // 'L'
+    { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, // 'M'
+    { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 }, // 'N'
+    { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // 'O'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 }, // 'P'
+    { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, // 'Q'
+    { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 }, // 'R'
+    { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, // 'S'
+    { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 }, // 'T'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, // 'U'
+    { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 }, // 'V'
+    { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, // 'W'
+    { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 }, // 'X'
+    { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, // 'Y'
+    { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F }, // 'Z'
+    { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E }, // '['
+    { 0x00, 0x10, 0x08, 0x04, 0x02, 0x01, 0x00 }, // '\'
+    { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E }, // ']'
+    { 0x04, 0x0A, 0x11, 0x00, 0x00, 0x00, 0x00 }, // '^'
+    { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F }, // '_'
+};
+
+//// Atlas layout (texels, row 0 at the bottom as GL stores it)
+const int atlasSize = 256;
+const int crosshairSize = 128;                   // Crosshair in [0, 128) x [0, 128)
+const int whiteX = 128, whiteY = 0, whiteSize = 4;
+const int fontY = 128;                           // Glyph cells of 6x8, 16 to a row, from here up
+const int fontColumns = 16;
+const int cellWidth = hudGlyphWidth + 1, cellHeight = hudGlyphHeight + 1;
+
+// Atlas coords of each sprite (s0, t0, s1, t1)
+static const float spriteCoords[NUM_HUD_SPRITES][4] = {
+    { (whiteX + 2.0f) / atlasSize, (whiteY + 2.0f) / atlasSize, (whiteX + 2.0f) / atlasSize, (whiteY + 2.0f) / atlasSize },
+    { 0.0f, 0.0f, (float)crosshairSize / atlasSize, (float)crosshairSize / atlasSize },
+};
+
+static void setTexel(HudAtlas& atlas, int x, int y, uint8_t r, uint8_t g, uint8_t b, uint8_t a) {
+    uint8_t* texel = &atlas.rgba[((size_t)y * atlas.width + x) * 4];
+    texel[0] = r;
+    texel[1] = g;
+    texel[2] = b;
+    texel[3] = a;
+}
+
+void buildHudAtlas(const uint8_t* crosshairRgba, int crosshairWidth, int crosshairHeight, HudAtlas& atlas) {
+    atlas.width = atlasSize;
+    atlas.height = atlasSize;
+    atlas.rgba.assign((size_t)atlasSize * atlasSize * 4, 0);
+
+    // Crosshair, box-filtered down (images come top row first, so rows are flipped)
+    if (crosshairRgba && crosshairWidth > 0 && crosshairHeight > 0) {
+        for (int y = 0; y < crosshairSize; y++) {
+            int sourceY0 = y * crosshairHeight / crosshairSize;
+            int sourceY1 = (y + 1) * crosshairHeight / crosshairSize;
+            if (sourceY1 <= sourceY0) sourceY1 = sourceY0 + 1;
+            for (int x = 0; x < crosshairSize; x++) {
+                int sourceX0 = x * crosshairWidth / crosshairSize;
+                int sourceX1 = (x + 1) * crosshairWidth / crosshairSize;
+                if (sourceX1 <= sourceX0) sourceX1 = sourceX0 + 1;
+
+                unsigned int sum[4] = { 0, 0, 0, 0 };
+                for (int sy = sourceY0; sy < sourceY1; sy++) {
+                    for (int sx = sourceX0; sx < sourceX1; sx++) {
+                        const uint8_t* texel = &crosshairRgba[((size_t)sy * crosshairWidth + sx) * 4];
+                        for (int c = 0; c < 4; c++) sum[c] += texel[c];
+                    }
+                }
+                unsigned int count = (unsigned int)((sourceY1 - sourceY0) * (sourceX1 - sourceX0));
+                setTexel(atlas, x, crosshairSize - 1 - y,
+                    (uint8_t)(sum[0] / count), (uint8_t)(sum[1] / count), (uint8_t)(sum[2] / count), (uint8_t)(sum[3] / count));
+            }
+        }
+    }
+
+    for (int y = 0; y < whiteSize; y++) {
+        for (int x = 0; x < whiteSize; x++) setTexel(atlas, whiteX + x, whiteY + y, 255, 255, 255, 255);
+    }
+
+    // Glyphs are white so the vertex color tints them
+    for (int glyph = 0; glyph < 64; glyph++) {
+        int cellX = (glyph % fontColumns) * cellWidth;
+        int cellY = fontY + (glyph / fontColumns) * cellHeight;
+        for (int row = 0; row < hudGlyphHeight; row++) {
+            for (int col = 0; col < hudGlyphWidth; col++) {
+                if (hudFont[glyph][row] & (0x10 >> col)) {
+                    setTexel(atlas, cellX + col, cellY + hudGlyphHeight - 1 - row, 255, 255, 255, 255);
+                }
+            }
+        }
+    }
+}
+
+void hudBegin() {
+    vertices.clear();
+}
+
+static void addQuad(float x, float y, float width, float height, float s0, float t0, float s1, float t1, HudColor color) {
+    vertices.push_back({ x, y, s0, t0, color });
+    vertices.push_back({ x + width, y, s1, t0, color });
+    vertices.push_back({ x + width, y + height, s1, t1, color });
+    vertices.push_back({ x, y + height, s0, t1, color });
+}
+
+void hudSprite(HudSprite sprite, float x, float y, float width, float height, HudColor color) {
+    const float* coords = spriteCoords[sprite];
+    addQuad(x, y, width, height, coords[0], coords[1], coords[2], coords[3], color);
+}
+
+void hudRect(float x, float y, float width, float height, HudColor color) {
+    hudSprite(HUD_SPRITE_WHITE, x, y, width, height, color);
+}
+
+float hudText(float x, float y, float scale, HudColor color, const char* text) {
+    float startX = x;
+    for (const char* c = text; *c; c++) {
+        int code = (unsigned char)*c;
+        if (code >= 'a' && code <= 'z') code -= 'a' - 'A';
+        if (code > ' ' && code < ' ' + 64) {
+            int glyph = code - ' ';
+            float s0 = (float)((glyph % fontColumns) * cellWidth) / atlasSize;
+            float t0 = (float)(fontY + (glyph / fontColumns) * cellHeight) / atlasSize;
+            addQuad(x, y, hudGlyphWidth * scale, hudGlyphHeight * scale,
+                s0, t0, s0 + (float)hudGlyphWidth / atlasSize, t0 + (float)hudGlyphHeight / atlasSize, color);
+        }
+        x += hudGlyphAdvance * scale;
+    }
+    return x - startX;
+}
+
+const std::vector<HudVertex>& hudVertices() {
+    return vertices;
+}
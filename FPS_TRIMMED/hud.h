@@ -0,0 +1,51 @@
+#pragma once
+// 2D HUD layer
+// Everything drawn flat on the screen (crosshair, panels, graphs, text) is queued during the frame
+// into one vertex array and drawn with one call against one atlas texture, which holds the
+// sprites, a built-in 5x7 bitmap font and a white block for solid fills. Positions are window
+// pixels with the origin at the bottom left, so layouts follow the real viewport size.
+// No GL in here; the caller uploads the atlas once and draws hudVertices() as GL_QUADS.
+#include <cstdint>
+#include <vector>
+
+typedef struct HudColor {
+    uint8_t r, g, b, a;
+} HudColor;
+
+// 20 bytes: position, atlas coords, color (GL_UNSIGNED_BYTE x4)
+typedef struct HudVertex {
+    float x, y;
+    float s, t;
+    HudColor color;
+} HudVertex;
+
+enum HudSprite {
+    HUD_SPRITE_WHITE,     // Solid fills
+    HUD_SPRITE_CROSSHAIR,
+    NUM_HUD_SPRITES
+};
+
+const int hudGlyphWidth = 5;
+const int hudGlyphHeight = 7;
+const int hudGlyphAdvance = hudGlyphWidth + 1; // Per character, at scale 1
+
+typedef struct HudAtlas {
+    int width = 0, height = 0;
+    std::vector<uint8_t> rgba;
+} HudAtlas;
+
+// Lays out the atlas: the crosshair image (RGBA, resampled to fit; null leaves it blank), the font
+// and the white block
+void buildHudAtlas(const uint8_t* crosshairRgba, int crosshairWidth, int crosshairHeight, HudAtlas& atlas);
+
+// Starts a new frame's HUD (keeps the array's capacity)
+void hudBegin();
+
+void hudSprite(HudSprite sprite, float x, float y, float width, float height, HudColor color);
+void hudRect(float x, float y, float width, float height, HudColor color);
+
+// Text in the built-in font, bottom-left at (x, y), scale pixels per font pixel. Covers ASCII
+// 32-95; lowercase is drawn as uppercase. Returns the width drawn.
+float hudText(float x, float y, float scale, HudColor color, const char* text);
+
+const std::vector<HudVertex>& hudVertices();
@@ -0,0 +1,358 @@
+#include "jobs.h"
+#include "alloctrack.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+
+typedef JobGraph::Task Task;
+
+const int dequeCapacity = 4096; // Tasks queued on one thread; pushes past that run the task right away
+const int idleSpins = 64;       // Empty steal rounds before a pool thread goes to sleep
+
+// Chase-Lev deque: the owning thread pushes and pops at the bottom, other threads steal from the
+// top. Only a steal racing the owner for the last task needs a compare-and-swap.
+class TaskDeque {
+public:
+    // Owner only. False if the deque is full
+    bool push(Task* task) {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        if (b - t >= dequeCapacity) return false;
+        buffer[b & (dequeCapacity - 1)].store(task, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_seq_cst); // Publishes the task (and orders it before the sleeper check)
+        return true;
+    }
+
+    // Owner only: the most recently pushed task, or null
+    Task* pop() {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        bottom.store(b, std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_seq_cst);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed); // Was empty
+            return nullptr;
+        }
+        Task* task = buffer[b & (dequeCapacity - 1)].load(std::memory_order_relaxed);
+        if (t == b) {
+            // Last task: whoever moves top first gets it
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) task = nullptr;
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return task;
+    }
+
+    // Any thread: the oldest task, or null (also when another thread got there first)
+    Task* steal() {
+        int64_t t = top.load(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_seq_cst);
+        if (t >= b) return nullptr;
+        Task* task = buffer[t & (dequeCapacity - 1)].load(std::memory_order_relaxed);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+        return task;
+    }
+
+    bool empty() const {
+        return top.load(std::memory_order_seq_cst) >= bottom.load(std::memory_order_seq_cst);
+    }
+
+private:
+    // On separate cache lines so steals don't contend with the owner's pushes
+    alignas(64) std::atomic<int64_t> top{ 0 };
+    alignas(64) std::atomic<int64_t> bottom{ 0 };
+    std::atomic<Task*> buffer[dequeCapacity];
+};
+
+struct JobThreads {
+    TaskDeque deques[maxJobThreads]; // Pool threads first, then the caller slots
+    std::vector<std::thread> threads;
+    int poolSize = 0;
+    std::atomic<bool> callerSlotTaken[maxCallerThreads] = {};
+    std::recursive_mutex sharedSlotTurn; // Held while a graph runs on the shared index (nested ones too)
+
+    // Sleeping pool threads
+    std::mutex mutex;
+    std::condition_variable wake;
+    unsigned int wakeGeneration = 0;
+    std::atomic<int> sleeping{ 0 };
+    bool stopping = false;
+};
+static JobThreads jobThreads;
+static int requestedPoolSize = 0;
+
+static thread_local int jobThreadIndex = -1;
+
+// Gives a caller slot back when its thread exits
+struct CallerSlot {
+    int slot = -1;
+    ~CallerSlot() {
+        if (slot >= 0) jobThreads.callerSlotTaken[slot].store(false, std::memory_order_release);
+    }
+};
+static thread_local CallerSlot callerSlot;
+
+static bool anyQueued() {
+    for (int i = 0; i < jobThreadCount(); i++) {
+        if (!jobThreads.deques[i].empty()) return true;
+    }
+    return false;
+}
+
+// Own deque first, then a steal from each of the others in turn
+static Task* findTask(int thread) {
+    if (Task* task = jobThreads.deques[thread].pop()) return task;
+    int count = jobThreadCount();
+    for (int i = 1; i < count; i++) {
+        if (Task* task = jobThreads.deques[(thread + i) % count].steal()) return task;
+    }
+    return nullptr;
+}
+
+// After pushing `tasks` tasks: wakes pool threads that went to sleep
+static void wakeJobThreads(int tasks) {
+    if (jobThreads.sleeping.load(std::memory_order_seq_cst) == 0) return;
+    {
+        std::lock_guard<std::mutex> lock(jobThreads.mutex);
+        jobThreads.wakeGeneration++;
+    }
+    if (tasks > 1) jobThreads.wake.notify_all();
+    else jobThreads.wake.notify_one();
+}
+
+static void jobThreadMain(int thread) {
+    jobThreadIndex = thread;
+    int idleRounds = 0;
+    for (;;) {
+        if (Task* task = findTask(thread)) {
+            task->graph->runTask(task, thread);
+            idleRounds = 0;
+            continue;
+        }
+        if (++idleRounds < idleSpins) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        // Counted as sleeping before the last look, so a push either sees us or we see it
+        std::unique_lock<std::mutex> lock(jobThreads.mutex);
+        if (jobThreads.stopping) return;
+        unsigned int seenGeneration = jobThreads.wakeGeneration;
+        jobThreads.sleeping.fetch_add(1, std::memory_order_seq_cst);
+        if (!anyQueued()) {
+            jobThreads.wake.wait(lock, [&] { return jobThreads.stopping || jobThreads.wakeGeneration != seenGeneration; });
+        }
+        jobThreads.sleeping.fetch_sub(1, std::memory_order_seq_cst);
+        idleRounds = 0;
+    }
+}
+
+static void stopJobThreads() {
+    {
+        std::lock_guard<std::mutex> lock(jobThreads.mutex);
+        jobThreads.stopping = true;
+        jobThreads.wakeGeneration++;
+    }
+    jobThreads.wake.notify_all();
+    for (std::thread& thread : jobThreads.threads) thread.join();
+    jobThreads.threads.clear();
+}
+
+static void startJobThreads() {
+    int threads = requestedPoolSize;
+    if (threads <= 0) threads = (int)std::thread::hardware_concurrency() - 1; // The caller works too
+    jobThreads.poolSize = std::min(std::max(threads, 0), maxJobThreads - maxCallerThreads - 1);
+    for (int i = 0; i < jobThreads.poolSize; i++) {
+        jobThreads.threads.emplace_back(jobThreadMain, i);
+    }
+    atexit(stopJobThreads);
+}
+
+static void ensureJobThreads() {
+    static bool started = (startJobThreads(), true);
+    (void)started;
+}
+
+void setJobPoolSize(int threads) {
+    requestedPoolSize = threads;
+}
+
+int jobThreadCount() {
+    ensureJobThreads();
+    return jobThreads.poolSize + maxCallerThreads + 1; // The caller slots, then the shared index
+}
+
+int currentJobThread() {
+    if (jobThreadIndex >= 0) return jobThreadIndex;
+    ensureJobThreads();
+    for (int slot = 0; slot < maxCallerThreads; slot++) {
+        bool taken = false;
+        if (jobThreads.callerSlotTaken[slot].compare_exchange_strong(taken, true)) {
+            callerSlot.slot = slot;
+            jobThreadIndex = jobThreads.poolSize + slot;
+            return jobThreadIndex;
+        }
+    }
+    jobThreadIndex = jobThreads.poolSize + maxCallerThreads; // Every slot in use: share the last index
+    return jobThreadIndex;
+}
+
+//// Graphs
+JobGraph::Node::Node(const Node& other)
+    : name(other.name), function(other.function), context(other.context), count(other.count), grain(other.grain),
+      firstTask(other.firstTask), taskCount(other.taskCount), prerequisites(other.prerequisites),
+      dependents(other.dependents), waitingOn(other.waitingOn.load()), chunksLeft(other.chunksLeft.load()),
+      busyNs(other.busyNs.load()) {
+}
+
+void JobGraph::clear() {
+    nodeCount = 0;
+}
+
+JobId JobGraph::add(const char* name, JobFunction function, void* context, int count, int grain) {
+    if (nodeCount == (int)nodes.size()) nodes.emplace_back();
+    Node& node = nodes[nodeCount];
+    node.name = name;
+    node.function = function;
+    node.context = context;
+    node.count = std::max(count, 0);
+    node.grain = std::max(grain, 1);
+    node.prerequisites = 0;
+    node.dependents.clear();
+    return nodeCount++;
+}
+
+void JobGraph::dependsOn(JobId job, JobId prerequisite) {
+    nodes[prerequisite].dependents.push_back(job);
+    nodes[job].prerequisites++;
+}
+
+void JobGraph::reserveTasks(int count) {
+    if ((int)tasks.size() < count) tasks.resize(count);
+}
+
+void JobGraph::run() {
+    int thread = currentJobThread();
+    bool shared = thread == jobThreads.poolSize + maxCallerThreads;
+    auto start = std::chrono::steady_clock::now();
+    if (shared) {
+        // Its deque would be pushed to by every thread on the index at once: run alone, in place
+        std::lock_guard<std::recursive_mutex> turn(jobThreads.sharedSlotTurn);
+        runInPlace(thread);
+    } else if (jobThreads.poolSize == 0) {
+        runInPlace(thread);
+    } else {
+        runOnPool(thread);
+    }
+
+    lastStats.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    lastStats.busyMs = busyNs.load(std::memory_order_relaxed) * 1e-6;
+    lastStats.threads = shared ? 1 : jobThreads.poolSize + 1;
+}
+
+// No pool threads to share with (or on the shared index): each job is one call over all its items, made as soon as its
+// prerequisites have run. Queuing chunks would only add overhead to the same serial work
+void JobGraph::runInPlace(int thread) {
+    for (int i = 0; i < nodeCount; i++) {
+        nodes[i].waitingOn.store(nodes[i].prerequisites, std::memory_order_relaxed);
+        nodes[i].busyNs.store(0, std::memory_order_relaxed);
+    }
+    busyNs.store(0, std::memory_order_relaxed);
+    steady = inSteadyState();
+
+    // Jobs are usually added after what they depend on, so one pass tends to run them all
+    for (int ran = 0; ran < nodeCount;) {
+        for (int i = 0; i < nodeCount; i++) {
+            Node& node = nodes[i];
+            if (node.waitingOn.load(std::memory_order_relaxed) != 0) continue;
+            node.waitingOn.store(-1, std::memory_order_relaxed); // Done
+            if (node.count > 0) call(i, 0, node.count, thread);
+            for (JobId dependent : node.dependents) nodes[dependent].waitingOn.fetch_sub(1, std::memory_order_relaxed);
+            ran++;
+        }
+    }
+}
+
+void JobGraph::runOnPool(int thread) {
+    // Lay out every job's chunks
+    int taskTotal = 0;
+    for (int i = 0; i < nodeCount; i++) {
+        Node& node = nodes[i];
+        node.firstTask = taskTotal;
+        node.taskCount = (node.count + node.grain - 1) / node.grain;
+        taskTotal += node.taskCount;
+    }
+    if ((int)tasks.size() < taskTotal) tasks.resize(taskTotal);
+    for (int i = 0; i < nodeCount; i++) {
+        Node& node = nodes[i];
+        for (int k = 0; k < node.taskCount; k++) {
+            int begin = k * node.grain;
+            tasks[node.firstTask + k] = { this, i, begin, std::min(begin + node.grain, node.count) };
+        }
+        node.waitingOn.store(node.prerequisites, std::memory_order_relaxed);
+        node.chunksLeft.store(node.taskCount, std::memory_order_relaxed);
+        node.busyNs.store(0, std::memory_order_relaxed);
+    }
+    busyNs.store(0, std::memory_order_relaxed);
+    steady = inSteadyState();
+    jobsLeft.store(nodeCount, std::memory_order_release);
+
+    for (int i = 0; i < nodeCount; i++) {
+        if (nodes[i].prerequisites == 0) schedule(i, thread);
+    }
+
+    // Work on whatever is queued (this graph's or another's) until the last job finishes
+    while (jobsLeft.load(std::memory_order_acquire) > 0) {
+        if (Task* task = findTask(thread)) task->graph->runTask(task, thread);
+        else std::this_thread::yield();
+    }
+}
+
+// Queues a job whose prerequisites have all finished
+void JobGraph::schedule(JobId job, int thread) {
+    Node& node = nodes[job];
+    if (node.taskCount == 0) {
+        finish(job, thread);
+        return;
+    }
+
+    // Last chunk first: this thread pops from the front of the job, thieves take from the back
+    TaskDeque& deque = jobThreads.deques[thread];
+    for (int k = node.taskCount - 1; k >= 0; k--) {
+        Task* task = &tasks[node.firstTask + k];
+        if (!deque.push(task)) runTask(task, thread);
+    }
+    wakeJobThreads(node.taskCount);
+}
+
+void JobGraph::runTask(Task* task, int thread) {
+    call(task->job, task->begin, task->end, thread);
+    if (nodes[task->job].chunksLeft.fetch_sub(1, std::memory_order_acq_rel) == 1) finish(task->job, thread);
+}
+
+// Runs items [begin, end) of a job, timed
+void JobGraph::call(JobId job, int begin, int end, int thread) {
+    Node& node = nodes[job];
+    auto start = std::chrono::steady_clock::now();
+    {
+        // Whatever a job allocates is put down to it, and is a violation if the graph's caller is in steady state
+        ALLOC_ZONE(node.name);
+        bool threadSteady = inSteadyState();
+        setSteadyState(steady);
+        node.function(begin, end, thread, node.context);
+        setSteadyState(threadSteady);
+    }
+    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    node.busyNs.fetch_add(ns, std::memory_order_relaxed);
+    busyNs.fetch_add(ns, std::memory_order_relaxed);
+}
+
+void JobGraph::finish(JobId job, int thread) {
+    for (JobId dependent : nodes[job].dependents) {
+        if (nodes[dependent].waitingOn.fetch_sub(1, std::memory_order_acq_rel) == 1) schedule(dependent, thread);
+    }
+    // Last: once this reaches zero run() may return and the graph be rebuilt
+    jobsLeft.fetch_sub(1, std::memory_order_acq_rel);
+}
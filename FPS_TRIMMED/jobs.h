@@ -0,0 +1,109 @@
+#pragma once
+// Work-stealing job system
+// A pool of worker threads, one per core, each with its own deque of tasks. A thread pushes and
+// pops tasks at the bottom of its own deque; idle threads steal from the top of the others', so
+// work spreads without a shared queue everyone contends on. Threads that run a graph (the sim
+// thread, the render thread) get a deque too and work on tasks while they wait for it.
+//
+// Work is described as a JobGraph: jobs, each split into chunks of [begin, end) over `count`
+// items, plus "runs after" edges between jobs. A job's chunks are queued as soon as every job it
+// depends on has finished, so independent jobs run side by side. Graphs can be run from inside a
+// job (nested parallel loops). Nothing allocates once a graph has been built at its largest size.
+// With no pool threads (one core) a graph runs each job in place as a single call instead.
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Runs items [begin, end) of a job; thread is the job thread running it (0..jobThreadCount()-1),
+// so it can index per-thread buffers
+typedef void (*JobFunction)(int begin, int end, int thread, void* context);
+
+typedef int JobId;
+
+const int maxJobThreads = 16;    // Pool threads plus the threads that run graphs
+const int maxCallerThreads = 4;  // Threads outside the pool that may run graphs at the same time
+
+// Pool threads to start (call before anything runs a graph; 0 = one per core, minus the caller)
+void setJobPoolSize(int threads);
+
+// Upper bound of the thread index passed to JobFunctions
+int jobThreadCount();
+
+// Index of the calling thread (claims a caller slot for threads outside the pool). Threads that
+// find every slot taken share the last index, jobThreadCount() - 1: their graphs run in place,
+// one thread at a time
+int currentJobThread();
+
+// Timings of one run of a graph
+struct JobGraphStats {
+    double wallMs = 0.0; // From run() to the last job finishing
+    double busyMs = 0.0; // Sum over threads of the time spent in the graph's chunks
+    int threads = 1;     // Threads that could have worked on it (pool plus the caller)
+
+    // Fraction of the available thread time spent doing work
+    float utilisation() const { return wallMs > 0.0 ? (float)(busyMs / (wallMs * threads)) : 0.0f; }
+};
+
+class JobGraph {
+public:
+    // Removes every job, keeping the storage for the next build
+    void clear();
+
+    // Adds a job of `count` items run in chunks of `grain` (count 1: a single call). A job with
+    // no items still orders the jobs around it
+    JobId add(const char* name, JobFunction function, void* context, int count = 1, int grain = 1);
+
+    // `job` starts only after `prerequisite` has finished
+    void dependsOn(JobId job, JobId prerequisite);
+
+    // Runs every job and returns once all have finished; the calling thread works on them too
+    void run();
+
+    // Makes room for `count` chunks over all the jobs, so run() doesn't allocate while there are no more
+    void reserveTasks(int count);
+
+    int jobCount() const { return nodeCount; }
+    const char* jobName(JobId job) const { return nodes[job].name; }
+    double jobMs(JobId job) const { return nodes[job].busyNs.load(std::memory_order_relaxed) * 1e-6; } // Last run, summed over chunks
+    const JobGraphStats& stats() const { return lastStats; }
+
+    // One chunk of a job, as queued on the deques
+    struct Task {
+        JobGraph* graph;
+        JobId job;
+        int begin, end;
+    };
+    void runTask(Task* task, int thread); // Called by whichever job thread took the task
+
+private:
+    struct Node {
+        const char* name = "";
+        JobFunction function = nullptr;
+        void* context = nullptr;
+        int count = 0, grain = 1;
+        int firstTask = 0, taskCount = 0;
+        int prerequisites = 0;
+        std::vector<JobId> dependents;
+
+        std::atomic<int> waitingOn{ 0 };      // Prerequisites still running
+        std::atomic<int> chunksLeft{ 0 };
+        std::atomic<int64_t> busyNs{ 0 };
+
+        Node() = default;
+        Node(const Node& other); // Nodes are only copied while the graph is being built
+    };
+
+    std::vector<Node> nodes;
+    int nodeCount = 0;
+    std::vector<Task> tasks;
+    bool steady = false; // The caller of run() was in steady state (alloctrack.h)
+    std::atomic<int> jobsLeft{ 0 };
+    std::atomic<int64_t> busyNs{ 0 };
+    JobGraphStats lastStats;
+
+    void runInPlace(int thread);
+    void runOnPool(int thread);
+    void call(JobId job, int begin, int end, int thread);
+    void schedule(JobId job, int thread);
+    void finish(JobId job, int thread);
+};
@@ -0,0 +1,113 @@
+#include "latency.h"
+#include "sim.h"
+#include <algorithm>
+#include <cstdio>
+
+typedef std::chrono::steady_clock LatencyClock;
+
+typedef struct PendingInput {
+    uint32_t sequence;
+    LatencyInput kind;
+    int dx, dy;
+    LatencyClock::time_point sent;
+    bool latched;   // Its look went into a frame's view before the sim applied it
+    bool presented; // Its to-present latency is recorded
+} PendingInput;
+
+// Inputs sent and not yet applied by a presented snapshot, oldest first
+static PendingInput pending[latencyPendingInputs];
+static int pendingFirst = 0, pendingCount = 0;
+
+static float samples[NUM_LATENCY_INPUTS][NUM_LATENCY_STAGES][latencySamples];
+static int sampleCount[NUM_LATENCY_INPUTS][NUM_LATENCY_STAGES];
+static int sampleNext[NUM_LATENCY_INPUTS][NUM_LATENCY_STAGES];
+
+static const char* inputNames[NUM_LATENCY_INPUTS] = { "look", "fire", "key" };
+
+static void addSample(LatencyInput kind, LatencyStage stage, LatencyClock::duration elapsed) {
+    float ms = std::chrono::duration<float, std::milli>(elapsed).count();
+    samples[kind][stage][sampleNext[kind][stage]] = std::max(ms, 0.0f);
+    sampleNext[kind][stage] = (sampleNext[kind][stage] + 1) % latencySamples;
+    sampleCount[kind][stage] = std::min(sampleCount[kind][stage] + 1, latencySamples);
+}
+
+// Sequence numbers wrap, so compare by difference
+static bool appliedBy(uint32_t sequence, uint32_t appliedSequence) {
+    return (int32_t)(sequence - appliedSequence) <= 0;
+}
+
+void inputSent(uint32_t sequence, LatencyInput kind, int dx, int dy) {
+    if (sequence == 0) return;
+
+    if (pendingCount == latencyPendingInputs) {
+        // The sim is far behind; the oldest input goes unmeasured
+        pendingFirst = (pendingFirst + 1) % latencyPendingInputs;
+        pendingCount--;
+    }
+    PendingInput& input = pending[(pendingFirst + pendingCount) % latencyPendingInputs];
+    input.sequence = sequence;
+    input.kind = kind;
+    input.dx = dx;
+    input.dy = dy;
+    input.sent = LatencyClock::now();
+    input.latched = false;
+    input.presented = false;
+    pendingCount++;
+}
+
+void latchLook(uint32_t appliedSequence, float& angleH, float& angleV) {
+    for (int i = 0; i < pendingCount; i++) {
+        PendingInput& input = pending[(pendingFirst + i) % latencyPendingInputs];
+        if (input.kind != LATENCY_LOOK || appliedBy(input.sequence, appliedSequence)) continue;
+        applyLookDelta(angleH, angleV, input.dx, input.dy);
+        input.latched = true;
+    }
+}
+
+void inputsPresented(uint32_t appliedSequence, LatencyClock::time_point appliedTime) {
+    auto now = LatencyClock::now();
+
+    // Applied inputs are at the front. appliedTime is the latest tick that applied any; when frames
+    // are slower than the sim, earlier inputs in the same snapshot were applied a tick or so sooner.
+    while (pendingCount > 0) {
+        PendingInput& input = pending[pendingFirst];
+        if (!appliedBy(input.sequence, appliedSequence)) break;
+
+        addSample(input.kind, LATENCY_TO_SIM, appliedTime - input.sent);
+        if (!input.presented) addSample(input.kind, LATENCY_TO_PRESENT, now - input.sent);
+        pendingFirst = (pendingFirst + 1) % latencyPendingInputs;
+        pendingCount--;
+    }
+
+    for (int i = 0; i < pendingCount; i++) {
+        PendingInput& input = pending[(pendingFirst + i) % latencyPendingInputs];
+        if (input.latched && !input.presented) {
+            addSample(input.kind, LATENCY_TO_PRESENT, now - input.sent);
+            input.presented = true;
+        }
+    }
+}
+
+float inputLatencyPercentileMs(LatencyInput kind, LatencyStage stage, float p) {
+    static float sorted[latencySamples];
+    int count = sampleCount[kind][stage];
+    if (count == 0) return 0.0f;
+
+    std::copy(samples[kind][stage], samples[kind][stage] + count, sorted);
+    int rank = std::min((int)(p / 100.0f * (count - 1) + 0.5f), count - 1);
+    std::nth_element(sorted, sorted + rank, sorted + count);
+    return sorted[rank];
+}
+
+void printLatencyReport() {
+    for (int kind = 0; kind < NUM_LATENCY_INPUTS; kind++) {
+        LatencyInput input = (LatencyInput)kind;
+        if (sampleCount[kind][LATENCY_TO_PRESENT] == 0) continue;
+
+        printf("Input latency (%s, last %d): to sim p50 %.2f ms, p99 %.2f ms; to present p50 %.2f ms, p90 %.2f ms, p99 %.2f ms\n",
+            inputNames[kind], sampleCount[kind][LATENCY_TO_PRESENT],
+            inputLatencyPercentileMs(input, LATENCY_TO_SIM, 50.0f), inputLatencyPercentileMs(input, LATENCY_TO_SIM, 99.0f),
+            inputLatencyPercentileMs(input, LATENCY_TO_PRESENT, 50.0f), inputLatencyPercentileMs(input, LATENCY_TO_PRESENT, 90.0f),
+            inputLatencyPercentileMs(input, LATENCY_TO_PRESENT, 99.0f));
+    }
+}
@@ -0,0 +1,45 @@
+#pragma once
+// Input-to-present latency
+// Every input the GLUT callbacks send is stamped with the time it arrived. The render thread
+// follows it through the sim (the snapshot's lastInput / inputsApplied say when a tick applied it)
+// to the buffer swap of the first frame that shows its effect, and keeps the latest samples per
+// input kind for percentiles.
+// Mouse look is also late-latched: looks the sim hasn't taken yet are applied to the snapshot's
+// aim just before the view is built, so a look is on screen in the next frame instead of after
+// the next tick. Its latency then ends at that frame.
+#include <chrono>
+#include <cstdint>
+
+enum LatencyInput {
+    LATENCY_LOOK,
+    LATENCY_FIRE,
+    LATENCY_KEY,
+    NUM_LATENCY_INPUTS
+};
+
+enum LatencyStage {
+    LATENCY_TO_SIM,     // Input to the tick that applied it
+    LATENCY_TO_PRESENT, // Input to the swap of the first frame showing it
+    NUM_LATENCY_STAGES
+};
+
+const int latencyPendingInputs = 256; // Matches the sim input queue
+const int latencySamples = 1024;      // Latest samples kept per input and stage
+
+// Input thread: stamps an input sendSimInput() accepted (sequence 0, a full queue, is ignored)
+void inputSent(uint32_t sequence, LatencyInput kind, int dx, int dy);
+
+// Render thread, before building the view: turns angleH/angleV (the snapshot's) by the look inputs
+// after appliedSequence, which the snapshot doesn't include yet. One at a time, as the sim will
+// apply them, so the pitch is clamped after each rather than once for their sum
+void latchLook(uint32_t appliedSequence, float& angleH, float& angleV);
+
+// Render thread, after the swap: records the latency of every input this frame showed (applied
+// by the snapshot's tick, or latched) and drops the ones the sim has applied
+void inputsPresented(uint32_t appliedSequence, std::chrono::steady_clock::time_point appliedTime);
+
+// Latency percentile (p in [0, 100]) over the kept samples, in ms; 0 without samples
+float inputLatencyPercentileMs(LatencyInput kind, LatencyStage stage, float p);
+
+// Prints percentiles per input and stage to stdout
+void printLatencyReport();
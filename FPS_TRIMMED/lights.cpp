@@ -0,0 +1,280 @@
+#include "lights.h"
+#include <algorithm>
+#include <cmath>
+
+const float maxStepSeconds = 0.1f; // As the particles: a stall doesn't put every light out at once
+
+// The light each kind of effect leaves (radius 0: none)
+typedef struct EffectLightLook {
+    float radius;
+    float color[3];
+    float intensity;
+    float life; // Seconds
+} EffectLightLook;
+
+static const EffectLightLook effectLooks[NUM_SIM_EFFECTS] = {
+    { 8.0f,  { 1.0f, 0.8f, 0.45f }, 1.5f, 0.08f },  // Muzzle flash
+    { 4.0f,  { 1.0f, 0.55f, 0.2f }, 1.0f, 0.15f },  // Robot hit
+    { 14.0f, { 1.0f, 0.5f, 0.15f }, 2.0f, 0.6f },   // Robot destroyed: the explosion
+    { 0.0f,  { 0.0f, 0.0f, 0.0f },  0.0f, 0.0f },   // Robot smoke
+    { 6.0f,  { 1.0f, 0.4f, 0.2f },  1.5f, 0.25f },  // Cannon hit
+};
+
+// Bullets glow as they fly
+const float bulletLightRadius = 3.0f;
+const float bulletLightColor[3] = { 1.0f, 0.9f, 0.3f };
+const float bulletLightIntensity = 0.6f;
+
+// World space, fading linearly to nothing over life
+typedef struct PooledLight {
+    float x, y, z, radius;
+    float r, g, b, intensity;
+    float age, life;
+} PooledLight;
+
+static std::vector<PooledLight> pool;
+static int poolCount = 0;
+static uint64_t lastSimTime = 0;
+static bool clockStarted = false;
+
+// The clusters each visible light may cover, from binning's first pass to its second
+typedef struct LightBounds {
+    short tileX0, tileX1, tileY0, tileY1, slice0, slice1;
+} LightBounds;
+static std::vector<LightBounds> frameBounds;
+static std::vector<int> clusterFill;
+
+// Where the frame's cluster walls are: tile edges in eye-space x / depth and y / depth, and
+// slice edges as depths
+static float tileEdgesX[lightTilesX + 1], tileEdgesY[lightTilesY + 1], sliceEdges[lightSlices + 1];
+
+static void createPool() {
+    if (!pool.empty()) return;
+    pool.resize(maxEffectLights);
+    frameBounds.resize(maxFrameLights);
+    clusterFill.resize(lightClusterCount);
+}
+
+void spawnLight(float x, float y, float z, float radius, float r, float g, float b, float intensity, float life) {
+    createPool();
+    if (poolCount == maxEffectLights || radius <= 0.0f || life <= 0.0f) return;
+    PooledLight light = { x, y, z, radius, r, g, b, intensity, 0.0f, life };
+    pool[poolCount++] = light;
+}
+
+void spawnEffectLight(const SimEffect& effect) {
+    if (effect.type < 0 || effect.type >= NUM_SIM_EFFECTS) return;
+    const EffectLightLook& look = effectLooks[effect.type];
+    spawnLight(effect.x, effect.y, effect.z, look.radius, look.color[0], look.color[1], look.color[2], look.intensity, look.life);
+}
+
+void updateLights(uint64_t simTime) {
+    createPool();
+    float dt = 0.0f;
+    if (clockStarted && simTime > lastSimTime) {
+        dt = std::min((float)(simTime - lastSimTime) * 0.001f, maxStepSeconds);
+    }
+    lastSimTime = simTime;
+    clockStarted = true;
+    if (dt <= 0.0f) return;
+
+    int kept = 0;
+    for (int i = 0; i < poolCount; i++) {
+        PooledLight& light = pool[i];
+        light.age += dt;
+        if (light.age >= light.life) continue;
+        pool[kept++] = light;
+    }
+    poolCount = kept;
+}
+
+void clearLights() {
+    poolCount = 0;
+    clockStarted = false;
+}
+
+int liveLights() {
+    return poolCount;
+}
+
+//// Binning
+// The camera's frame, as gluLookAt() builds it from setCamera()'s aim
+typedef struct ViewFrame {
+    float eye[3];
+    float right[3], up[3], forward[3];
+    float scaleX, scaleY; // Eye-space x / depth to NDC
+    float zNear, zFar;
+} ViewFrame;
+
+static ViewFrame makeViewFrame(const RenderView& view) {
+    ViewFrame frame;
+    frame.eye[0] = view.eyeX;
+    frame.eye[1] = view.eyeY;
+    frame.eye[2] = view.eyeZ;
+    frame.forward[0] = sinf(view.angleH) * cosf(view.angleV);
+    frame.forward[1] = sinf(view.angleV);
+    frame.forward[2] = -cosf(view.angleH) * cosf(view.angleV);
+    // right = forward x (0, 1, 0), up = right x forward
+    float rightLength = sqrtf(frame.forward[2] * frame.forward[2] + frame.forward[0] * frame.forward[0]);
+    frame.right[0] = -frame.forward[2] / rightLength;
+    frame.right[1] = 0.0f;
+    frame.right[2] = frame.forward[0] / rightLength;
+    frame.up[0] = frame.right[1] * frame.forward[2] - frame.right[2] * frame.forward[1];
+    frame.up[1] = frame.right[2] * frame.forward[0] - frame.right[0] * frame.forward[2];
+    frame.up[2] = frame.right[0] * frame.forward[1] - frame.right[1] * frame.forward[0];
+    frame.scaleY = 1.0f / tanf(view.fovYDegrees * 0.5f * 3.14159265f / 180.0f);
+    frame.scaleX = frame.scaleY / view.aspect;
+    frame.zNear = view.zNear;
+    frame.zFar = view.zFar;
+    return frame;
+}
+
+static inline int clampTile(float ndc, int tiles) {
+    return std::min(std::max((int)floorf((ndc * 0.5f + 0.5f) * tiles), 0), tiles - 1);
+}
+
+// Eye-space light and the clusters its sphere may touch: the screen rectangle of the box around it
+// (projected at its nearest and farthest depth) and the slices of its depth range. False when
+// it's off screen
+static bool boundLight(const ViewFrame& frame, const LightClusters& clusters, float x, float y, float z, float radius,
+    PointLight& light, LightBounds& bounds) {
+    float offset[3] = { x - frame.eye[0], y - frame.eye[1], z - frame.eye[2] };
+    float eyeX = offset[0] * frame.right[0] + offset[1] * frame.right[1] + offset[2] * frame.right[2];
+    float eyeY = offset[0] * frame.up[0] + offset[1] * frame.up[1] + offset[2] * frame.up[2];
+    float depth = offset[0] * frame.forward[0] + offset[1] * frame.forward[1] + offset[2] * frame.forward[2];
+    if (depth + radius < frame.zNear || depth - radius > frame.zFar) return false;
+
+    float nearest = std::max(depth - radius, frame.zNear);
+    float farthest = std::min(depth + radius, frame.zFar);
+    float left = std::min((eyeX - radius) / nearest, (eyeX - radius) / farthest) * frame.scaleX;
+    float rightEdge = std::max((eyeX + radius) / nearest, (eyeX + radius) / farthest) * frame.scaleX;
+    float bottom = std::min((eyeY - radius) / nearest, (eyeY - radius) / farthest) * frame.scaleY;
+    float top = std::max((eyeY + radius) / nearest, (eyeY + radius) / farthest) * frame.scaleY;
+    if (left > 1.0f || rightEdge < -1.0f || bottom > 1.0f || top < -1.0f) return false;
+
+    bounds.tileX0 = (short)clampTile(left, lightTilesX);
+    bounds.tileX1 = (short)clampTile(rightEdge, lightTilesX);
+    bounds.tileY0 = (short)clampTile(bottom, lightTilesY);
+    bounds.tileY1 = (short)clampTile(top, lightTilesY);
+    bounds.slice0 = (short)std::min(std::max((int)floorf(logf(nearest) * clusters.sliceScale - clusters.sliceBias), 0), lightSlices - 1);
+    bounds.slice1 = (short)std::min(std::max((int)floorf(logf(farthest) * clusters.sliceScale - clusters.sliceBias), 0), lightSlices - 1);
+
+    light.x = eyeX;
+    light.y = eyeY;
+    light.z = -depth; // GL eye space looks down -z
+    light.radius = radius;
+    return true;
+}
+
+// Whether an eye-space light's sphere reaches a cluster: the box around the cluster's slab of the
+// frustum, against the sphere
+static bool touchesCluster(const PointLight& light, int tileX, int tileY, int slice) {
+    float near = sliceEdges[slice], far = sliceEdges[slice + 1];
+    float x0 = tileEdgesX[tileX], x1 = tileEdgesX[tileX + 1];
+    float y0 = tileEdgesY[tileY], y1 = tileEdgesY[tileY + 1];
+    float minX = std::min(x0 * near, x0 * far), maxX = std::max(x1 * near, x1 * far);
+    float minY = std::min(y0 * near, y0 * far), maxY = std::max(y1 * near, y1 * far);
+    float depth = -light.z;
+    float dx = std::max(std::max(minX - light.x, light.x - maxX), 0.0f);
+    float dy = std::max(std::max(minY - light.y, light.y - maxY), 0.0f);
+    float dz = std::max(std::max(near - depth, depth - far), 0.0f);
+    return dx * dx + dy * dy + dz * dz <= light.radius * light.radius;
+}
+
+// Calls visit(cluster) for each cluster a light's sphere reaches. The light's screen rectangle
+// holds many clusters its sphere misses, most of all for a light seen at a grazing angle, so each
+// slice takes the rectangle of just the sphere's slab in it, and each cluster of that is tested
+template <typename Visitor>
+static void forEachCluster(const ViewFrame& frame, const PointLight& light, const LightBounds& bounds, Visitor visit) {
+    float depth = -light.z;
+    for (int s = bounds.slice0; s <= bounds.slice1; s++) {
+        float near = std::max(sliceEdges[s], depth - light.radius);
+        float far = std::min(sliceEdges[s + 1], depth + light.radius);
+        float dz = std::max(std::max(near - depth, depth - far), 0.0f);
+        float sectionSquared = light.radius * light.radius - dz * dz;
+        if (sectionSquared < 0.0f) continue;
+        float section = sqrtf(sectionSquared);
+        int tileX0 = std::max(clampTile(std::min((light.x - section) / near, (light.x - section) / far) * frame.scaleX, lightTilesX), (int)bounds.tileX0);
+        int tileX1 = std::min(clampTile(std::max((light.x + section) / near, (light.x + section) / far) * frame.scaleX, lightTilesX), (int)bounds.tileX1);
+        int tileY0 = std::max(clampTile(std::min((light.y - section) / near, (light.y - section) / far) * frame.scaleY, lightTilesY), (int)bounds.tileY0);
+        int tileY1 = std::min(clampTile(std::max((light.y + section) / near, (light.y + section) / far) * frame.scaleY, lightTilesY), (int)bounds.tileY1);
+        for (int ty = tileY0; ty <= tileY1; ty++) {
+            int row = (s * lightTilesY + ty) * lightTilesX;
+            for (int tx = tileX0; tx <= tileX1; tx++) {
+                if (touchesCluster(light, tx, ty, s)) visit(row + tx);
+            }
+        }
+    }
+}
+
+// Adds a visible light to the frame (first pass)
+static void addFrameLight(const ViewFrame& frame, LightClusters& clusters, float x, float y, float z, float radius,
+    const float* color, float intensity) {
+    PointLight light;
+    LightBounds bounds;
+    if (!boundLight(frame, clusters, x, y, z, radius, light, bounds)) return;
+    if (clusters.lightCount == maxFrameLights) {
+        clusters.overflow++;
+        return;
+    }
+    light.r = color[0] * intensity;
+    light.g = color[1] * intensity;
+    light.b = color[2] * intensity;
+    light.intensity = intensity;
+    forEachCluster(frame, light, bounds, [](int c) { clusterFill[c]++; });
+    clusters.lights[clusters.lightCount] = light;
+    frameBounds[clusters.lightCount] = bounds;
+    clusters.lightCount++;
+}
+
+void clusterLights(const SimSnapshot& snapshot, const RenderView& view, LightClusters& clusters) {
+    createPool();
+    if (clusters.lights.size() != (size_t)maxFrameLights) {
+        clusters.lights.resize(maxFrameLights);
+        clusters.ranges.resize(2 * lightClusterCount);
+        clusters.indices.resize(maxClusterLightIndices);
+    }
+    const ViewFrame frame = makeViewFrame(view);
+    clusters.sliceScale = lightSlices / logf(view.zFar / view.zNear);
+    clusters.sliceBias = logf(view.zNear) * clusters.sliceScale;
+    for (int t = 0; t <= lightTilesX; t++) tileEdgesX[t] = (2.0f * t / lightTilesX - 1.0f) / frame.scaleX;
+    for (int t = 0; t <= lightTilesY; t++) tileEdgesY[t] = (2.0f * t / lightTilesY - 1.0f) / frame.scaleY;
+    for (int s = 0; s <= lightSlices; s++) sliceEdges[s] = view.zNear * powf(view.zFar / view.zNear, (float)s / lightSlices);
+    clusters.lightCount = 0;
+    clusters.indexCount = 0;
+    clusters.overflow = 0;
+    std::fill(clusterFill.begin(), clusterFill.end(), 0);
+
+    // First pass: which clusters each light touches, and how many lights each cluster gets
+    for (int i = 0; i < poolCount; i++) {
+        const PooledLight& light = pool[i];
+        float color[3] = { light.r, light.g, light.b };
+        addFrameLight(frame, clusters, light.x, light.y, light.z, light.radius, color, light.intensity * (1.0f - light.age / light.life));
+    }
+    for (const Bullet& bullet : snapshot.bullets) {
+        addFrameLight(frame, clusters, bullet.x, bullet.y, bullet.z, bulletLightRadius, bulletLightColor, bulletLightIntensity);
+    }
+
+    // Each cluster's range, capped
+    float* ranges = clusters.ranges.data();
+    int first = 0;
+    for (int c = 0; c < lightClusterCount; c++) {
+        int count = std::min(std::min(clusterFill[c], maxLightsPerCluster), maxClusterLightIndices - first);
+        if (count < clusterFill[c]) clusters.overflow++;
+        ranges[2 * c] = (float)first;
+        ranges[2 * c + 1] = (float)count;
+        clusterFill[c] = 0;
+        first += count;
+    }
+    clusters.indexCount = first;
+
+    // Second pass: the indices, in light order
+    float* indices = clusters.indices.data();
+    for (int l = 0; l < clusters.lightCount; l++) {
+        forEachCluster(frame, clusters.lights[l], frameBounds[l], [&](int c) {
+            int& fill = clusterFill[c];
+            if (fill == (int)ranges[2 * c + 1]) return; // Full
+            indices[(int)ranges[2 * c] + fill++] = (float)l;
+        });
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+// Dynamic point lights: muzzle flashes, bullet glows, impacts and explosions
+// Effects (SimEffect, sim.h) leave a short-lived light in a fixed-capacity pool, aged by sim time
+// like the particles; every bullet in flight adds a small glow for the frame it's drawn in. Each
+// frame the visible lights are binned into a 3D grid of clusters over the view frustum: screen
+// tiles across, depth slices (spaced exponentially) deep. A light goes into every cluster its
+// sphere reaches, so a fragment only shades the few lights in its own cluster and the cost per
+// pixel follows how many lights overlap there, not how many there are. No GL in here:
+// render.cpp uploads the grid and shades with it.
+#include "renderprep.h"
+#include "simthread.h"
+#include <vector>
+
+// Fine enough that a cluster across the arena is no bigger than a bullet's glow: a coarser grid
+// hands each pixel lights that don't reach it
+const int lightTilesX = 32, lightTilesY = 18, lightSlices = 48;
+const int lightClusterCount = lightTilesX * lightTilesY * lightSlices;
+const int maxEffectLights = 1024;      // Pool capacity; lights that don't fit are dropped
+const int maxFrameLights = 1024;       // Visible lights binned per frame, effects first, then bullets
+const int maxLightsPerCluster = 64;    // Bounds the per-pixel cost; the rest of a crowded cluster is dropped
+const int maxClusterLightIndices = lightClusterCount * 8; // Past this, clusters are cut short
+
+// 32 bytes, laid out for upload: eye-space position and radius, then color (premultiplied by
+// intensity)
+typedef struct PointLight {
+    float x, y, z, radius;
+    float r, g, b, intensity;
+} PointLight;
+
+// One frame's grid. Cluster c = (slice * lightTilesY + tileY) * lightTilesX + tileX shades
+// ranges[2c + 1] lights, listed from indices[ranges[2c]]
+typedef struct LightClusters {
+    std::vector<PointLight> lights;   // Eye space
+    std::vector<float> ranges;        // First index and count per cluster (as floats, for a texture)
+    std::vector<float> indices;       // Light indices, per cluster (likewise)
+    int lightCount;
+    int indexCount;
+    int overflow;                     // Lights past maxFrameLights, plus clusters that were cut short
+    float sliceScale, sliceBias;      // slice = log(depth) * sliceScale - sliceBias
+} LightClusters;
+
+// Adds the light an effect makes (some make none)
+void spawnEffectLight(const SimEffect& effect);
+
+// A light at a world position that fades out over life seconds (radius in world units)
+void spawnLight(float x, float y, float z, float radius, float r, float g, float b, float intensity, float life);
+
+// Ages and fades the pool up to simTime (sim ms), as updateParticles()
+void updateLights(uint64_t simTime);
+
+// Removes every light and restarts the clock
+void clearLights();
+
+int liveLights();
+
+// Bins the pool's lights and the snapshot's bullets into the view's clusters
+void clusterLights(const SimSnapshot& snapshot, const RenderView& view, LightClusters& clusters);
@@ -0,0 +1,423 @@
+#include "mesh.h"
+#include "workers.h"
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// Welding hashes and compares vertices as raw bytes, which needs them free of padding
+static_assert(sizeof(MeshVertex) == 20, "MeshVertex must stay packed");
+
+static uint32_t packSigned10(float value) {
+    if (value > 1.0f) value = 1.0f;
+    if (value < -1.0f) value = -1.0f;
+    return (uint32_t)(int32_t)lrintf(value * 511.0f) & 0x3FF;
+}
+
+static float unpackSigned10(uint32_t bits) {
+    int32_t value = (int32_t)(bits << 22) >> 22; // Sign-extend the low 10 bits
+    float unit = (float)value / 511.0f;
+    return unit < -1.0f ? -1.0f : unit;
+}
+
+uint32_t packNormal(float x, float y, float z) {
+    return packSigned10(x) | (packSigned10(y) << 10) | (packSigned10(z) << 20);
+}
+
+void unpackNormal(uint32_t packed, float& x, float& y, float& z) {
+    x = unpackSigned10(packed);
+    y = unpackSigned10(packed >> 10);
+    z = unpackSigned10(packed >> 20);
+}
+
+int16_t packTexCoord(float value) {
+    float fixed = value * meshUvScale;
+    if (fixed > 32767.0f) fixed = 32767.0f;
+    if (fixed < -32768.0f) fixed = -32768.0f;
+    return (int16_t)lrintf(fixed);
+}
+
+//// Reading
+// OBJ indices are 1-based, or relative to the end of the list so far when negative; 0 means absent
+static int resolveIndex(long index, size_t count) {
+    if (index > 0) return (int)(index - 1);
+    if (index < 0) return (int)count + (int)index;
+    return -1;
+}
+
+// Parses the corners of an "f" line
+static void readFace(const char* at, MeshImport& import) {
+    for (;;) {
+        char* end;
+        long position = strtol(at, &end, 10);
+        if (end == at) break;
+        at = end;
+
+        long texCoord = 0, normal = 0;
+        if (*at == '/') {
+            at++;
+            texCoord = strtol(at, &end, 10);
+            at = end;
+            if (*at == '/') {
+                at++;
+                normal = strtol(at, &end, 10);
+                at = end;
+            }
+        }
+
+        ObjCorner corner;
+        corner.position = resolveIndex(position, import.positions.size() / 3);
+        corner.texCoord = resolveIndex(texCoord, import.texCoords.size() / 2);
+        corner.normal = resolveIndex(normal, import.normals.size() / 3);
+        import.corners.push_back(corner);
+    }
+    import.faceStart.push_back((int)import.corners.size());
+}
+
+bool readObjMesh(const char* path, MeshImport& import) {
+    FILE* file = fopen(path, "r");
+    if (!file) return false;
+
+    import = MeshImport();
+    import.faceStart.push_back(0);
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        float x, y, z;
+        if (strncmp(line, "v ", 2) == 0 && sscanf(line, "v %f %f %f", &x, &y, &z) == 3) {
+            import.positions.insert(import.positions.end(), { x, y, z });
+        }
+        else if (strncmp(line, "vt ", 3) == 0 && sscanf(line, "vt %f %f", &x, &y) == 2) {
+            import.texCoords.insert(import.texCoords.end(), { x, y });
+        }
+        else if (strncmp(line, "vn ", 3) == 0 && sscanf(line, "vn %f %f %f", &x, &y, &z) == 3) {
+            import.normals.insert(import.normals.end(), { x, y, z });
+        }
+        else if (strncmp(line, "f ", 2) == 0) {
+            readFace(line + 2, import);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+//// Pipeline
+// A triangle corner before welding
+struct TriangleCorner {
+    int position;
+    int texCoord; // -1 for none
+    int normal;   // Into the file's normals, or -1 to use the generated one
+    int face;
+    int slot;   // Corner number within the face
+};
+
+// Shared by the normal generation passes
+struct NormalJob {
+    const MeshImport* import;
+    const std::vector<TriangleCorner>* corners;
+    std::vector<float> triangleNormals;   // Unnormalised, so larger triangles weigh more
+    std::vector<int> trianglesOfPosition; // Adjacency, only kept for this pass
+    std::vector<int> adjacencyStart;      // Position p's triangles start here
+    std::vector<float> positionNormals;
+};
+
+static void faceNormals(int begin, int end, int worker, void* context) {
+    NormalJob& job = *(NormalJob*)context;
+    const float* positions = job.import->positions.data();
+    const TriangleCorner* corners = job.corners->data();
+    for (int t = begin; t < end; t++) {
+        const float* a = &positions[corners[t * 3].position * 3];
+        const float* b = &positions[corners[t * 3 + 1].position * 3];
+        const float* c = &positions[corners[t * 3 + 2].position * 3];
+        float ux = b[0] - a[0], uy = b[1] - a[1], uz = b[2] - a[2];
+        float vx = c[0] - a[0], vy = c[1] - a[1], vz = c[2] - a[2];
+        job.triangleNormals[t * 3] = uy * vz - uz * vy;
+        job.triangleNormals[t * 3 + 1] = uz * vx - ux * vz;
+        job.triangleNormals[t * 3 + 2] = ux * vy - uy * vx;
+    }
+}
+
+static void smoothNormals(int begin, int end, int worker, void* context) {
+    NormalJob& job = *(NormalJob*)context;
+    for (int p = begin; p < end; p++) {
+        float x = 0.0f, y = 0.0f, z = 0.0f;
+        for (int k = job.adjacencyStart[p]; k < job.adjacencyStart[p + 1]; k++) {
+            const float* normal = &job.triangleNormals[job.trianglesOfPosition[k] * 3];
+            x += normal[0];
+            y += normal[1];
+            z += normal[2];
+        }
+        float length = sqrtf(x * x + y * y + z * z);
+        float scale = length > 0.0f ? 1.0f / length : 0.0f;
+        job.positionNormals[p * 3] = length > 0.0f ? x * scale : 0.0f;
+        job.positionNormals[p * 3 + 1] = length > 0.0f ? y * scale : 1.0f; // Unused points face up
+        job.positionNormals[p * 3 + 2] = z * scale;
+    }
+}
+
+// Area-weighted smooth normal of every position
+static void generateNormals(const MeshImport& import, const std::vector<TriangleCorner>& corners, std::vector<float>& normals) {
+    const int positionCount = (int)(import.positions.size() / 3);
+    const int triangleCount = (int)(corners.size() / 3);
+
+    NormalJob job;
+    job.import = &import;
+    job.corners = &corners;
+    job.triangleNormals.resize((size_t)triangleCount * 3);
+    job.positionNormals.resize((size_t)positionCount * 3);
+
+    job.adjacencyStart.assign(positionCount + 1, 0);
+    for (const TriangleCorner& corner : corners) job.adjacencyStart[corner.position + 1]++;
+    for (int p = 0; p < positionCount; p++) job.adjacencyStart[p + 1] += job.adjacencyStart[p];
+    job.trianglesOfPosition.resize(corners.size());
+    std::vector<int> fill(job.adjacencyStart.begin(), job.adjacencyStart.end() - 1);
+    for (size_t k = 0; k < corners.size(); k++) job.trianglesOfPosition[fill[corners[k].position]++] = (int)(k / 3);
+
+    const int grain = 4096;
+    parallelFor(triangleCount, grain, faceNormals, &job);
+    parallelFor(positionCount, grain, smoothNormals, &job);
+    normals.swap(job.positionNormals);
+}
+
+// Merges corners with identical packed vertices; remap gets each corner's vertex
+static void weldVertices(const std::vector<MeshVertex>& corners, std::vector<MeshVertex>& vertices, std::vector<uint32_t>& remap) {
+    size_t capacity = 16;
+    while (capacity < corners.size() * 2) capacity *= 2;
+    std::vector<int> table(capacity, -1); // Open addressing over vertex indices
+
+    vertices.clear();
+    remap.resize(corners.size());
+    for (size_t k = 0; k < corners.size(); k++) {
+        const MeshVertex& corner = corners[k];
+        uint32_t words[5];
+        memcpy(words, &corner, sizeof(words));
+        uint32_t hash = 2166136261u;
+        for (uint32_t word : words) hash = (hash ^ word) * 16777619u;
+
+        size_t slot = hash & (capacity - 1);
+        while (table[slot] >= 0 && memcmp(&vertices[table[slot]], &corner, sizeof(MeshVertex)) != 0) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        if (table[slot] < 0) {
+            table[slot] = (int)vertices.size();
+            vertices.push_back(corner);
+        }
+        remap[k] = (uint32_t)table[slot];
+    }
+}
+
+float averageCacheMissRatio(const std::vector<uint32_t>& indices, int vertexCount, int cacheSize) {
+    if (indices.empty()) return 0.0f;
+
+    // A vertex is cached while fewer than cacheSize misses have happened since it was loaded
+    std::vector<int> loadedAt(vertexCount, INT_MIN / 2);
+    int misses = 0;
+    for (uint32_t index : indices) {
+        if (misses - loadedAt[index] >= cacheSize) {
+            loadedAt[index] = misses;
+            misses++;
+        }
+    }
+    return (float)misses / (float)(indices.size() / 3);
+}
+
+// Tom Forsyth's linear-speed vertex cache optimisation: greedily emit the triangle whose vertices
+// score best, favouring vertices still in a modelled LRU cache and those with few triangles left
+const int forsythCacheSize = 32;
+
+static float vertexScore(int cachePosition, int trianglesLeft) {
+    if (trianglesLeft == 0) return -1.0f;
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        // The last triangle's vertices score a little lower so strips don't zigzag
+        if (cachePosition < 3) score = 0.75f;
+        else score = powf(1.0f - (float)(cachePosition - 3) / (forsythCacheSize - 3), 1.5f);
+    }
+    return score + 2.0f / sqrtf((float)trianglesLeft);
+}
+
+static void optimiseVertexCache(std::vector<uint32_t>& indices, int vertexCount) {
+    const int triangleCount = (int)(indices.size() / 3);
+
+    std::vector<int> trianglesLeft(vertexCount, 0);
+    for (uint32_t index : indices) trianglesLeft[index]++;
+    std::vector<int> adjacencyStart(vertexCount + 1, 0);
+    for (int v = 0; v < vertexCount; v++) adjacencyStart[v + 1] = adjacencyStart[v] + trianglesLeft[v];
+    std::vector<int> adjacency(indices.size());
+    std::vector<int> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t k = 0; k < indices.size(); k++) adjacency[fill[indices[k]]++] = (int)(k / 3);
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> scores(vertexCount);
+    for (int v = 0; v < vertexCount; v++) scores[v] = vertexScore(-1, trianglesLeft[v]);
+
+    std::vector<float> triangleScores(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+    int best = -1;
+    float bestScore = -1.0f;
+    for (int t = 0; t < triangleCount; t++) {
+        triangleScores[t] = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+        if (triangleScores[t] > bestScore) {
+            bestScore = triangleScores[t];
+            best = t;
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    int cache[forsythCacheSize + 3];
+    int cached = 0;
+    int scanFrom = 0; // When the cache has nothing left to offer, restart from the first unemitted triangle
+
+    for (int emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (best < 0) {
+            while (emitted[scanFrom]) scanFrom++;
+            best = scanFrom;
+        }
+
+        const uint32_t* triangle = &indices[best * 3];
+        emitted[best] = 1;
+        output.insert(output.end(), triangle, triangle + 3);
+
+        // Drop the triangle from its vertices' lists
+        for (int i = 0; i < 3; i++) {
+            int v = (int)triangle[i];
+            int* list = &adjacency[adjacencyStart[v]];
+            for (int k = 0; k < trianglesLeft[v]; k++) {
+                if (list[k] == best) {
+                    list[k] = list[--trianglesLeft[v]];
+                    break;
+                }
+            }
+        }
+
+        // Its vertices move to the front of the cache
+        int updated[forsythCacheSize + 3];
+        int count = 0;
+        for (int i = 0; i < 3; i++) updated[count++] = (int)triangle[i];
+        for (int i = 0; i < cached; i++) {
+            int v = cache[i];
+            if (v != (int)triangle[0] && v != (int)triangle[1] && v != (int)triangle[2]) updated[count++] = v;
+        }
+
+        // Rescore everything that moved (including what fell out) and the triangles it touches
+        for (int i = 0; i < count; i++) {
+            int v = updated[i];
+            cachePosition[v] = i < forsythCacheSize ? i : -1;
+            scores[v] = vertexScore(cachePosition[v], trianglesLeft[v]);
+        }
+        best = -1;
+        bestScore = -1.0f;
+        for (int i = 0; i < count; i++) {
+            int v = updated[i];
+            for (int k = adjacencyStart[v]; k < adjacencyStart[v] + trianglesLeft[v]; k++) {
+                int t = adjacency[k];
+                float score = scores[indices[t * 3]] + scores[indices[t * 3 + 1]] + scores[indices[t * 3 + 2]];
+                triangleScores[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        cached = count < forsythCacheSize ? count : forsythCacheSize;
+        memcpy(cache, updated, cached * sizeof(int));
+    }
+    indices.swap(output);
+}
+
+// Renumbers vertices in the order the indices first use them, so fetches walk the array forwards
+static void orderVerticesByFirstUse(Mesh& mesh) {
+    std::vector<int> newIndex(mesh.vertices.size(), -1);
+    std::vector<MeshVertex> ordered;
+    ordered.reserve(mesh.vertices.size());
+    for (uint32_t& index : mesh.indices) {
+        if (newIndex[index] < 0) {
+            newIndex[index] = (int)ordered.size();
+            ordered.push_back(mesh.vertices[index]);
+        }
+        index = (uint32_t)newIndex[index];
+    }
+    mesh.vertices.swap(ordered);
+}
+
+void buildMesh(const MeshImport& import, const MeshGrid& grid, Mesh& mesh, MeshStats& stats) {
+    const int positionCount = (int)(import.positions.size() / 3);
+    const int texCoordCount = (int)(import.texCoords.size() / 2);
+    const int normalCount = (int)(import.normals.size() / 3);
+    const int faceCount = (int)import.faceStart.size() - 1;
+
+    // Triangulate as fans (the faces are convex quads in practice)
+    std::vector<TriangleCorner> corners;
+    bool needNormals = false;
+    stats = MeshStats();
+    for (int f = 0; f < faceCount; f++) {
+        const ObjCorner* face = &import.corners[import.faceStart[f]];
+        int size = import.faceStart[f + 1] - import.faceStart[f];
+        bool valid = size >= 3;
+        for (int i = 0; i < size; i++) valid = valid && face[i].position >= 0 && face[i].position < positionCount;
+        if (!valid) continue;
+
+        stats.faces++;
+        for (int i = 1; i + 1 < size; i++) {
+            const int slots[3] = { 0, i, i + 1 };
+            for (int slot : slots) {
+                TriangleCorner corner;
+                corner.position = face[slot].position;
+                corner.texCoord = face[slot].texCoord < texCoordCount ? face[slot].texCoord : -1;
+                corner.normal = face[slot].normal >= 0 && face[slot].normal < normalCount ? face[slot].normal : -1;
+                corner.face = f;
+                corner.slot = slot;
+                needNormals = needNormals || corner.normal < 0;
+                corners.push_back(corner);
+            }
+        }
+    }
+
+    // Any corner without a usable normal means the file's normals can't be trusted for the mesh
+    std::vector<float> generated;
+    if (needNormals) generateNormals(import, corners, generated);
+
+    const bool sweepGrid = texCoordCount == 0 && grid.rows > 0 && grid.columns > 0 && faceCount == grid.rows * grid.columns;
+
+    std::vector<MeshVertex> cornerVertices(corners.size());
+    for (size_t k = 0; k < corners.size(); k++) {
+        const TriangleCorner& corner = corners[k];
+        const float* position = &import.positions[(size_t)corner.position * 3];
+        const float* normal = needNormals ? &generated[(size_t)corner.position * 3] : &import.normals[(size_t)corner.normal * 3];
+
+        MeshVertex& vertex = cornerVertices[k];
+        vertex.x = position[0];
+        vertex.y = position[1];
+        vertex.z = position[2];
+        vertex.normal = packNormal(normal[0], normal[1], normal[2]);
+
+        if (sweepGrid) {
+            // Same per-corner stretch the immediate-mode version used (col / (columns / slot)),
+            // multiplied out so the first corner is 0 rather than a division by zero
+            int row = corner.face / grid.columns;
+            int col = corner.face % grid.columns;
+            vertex.s = packTexCoord((float)(col * corner.slot) / (float)grid.columns);
+            vertex.t = packTexCoord((float)(row * corner.slot) / (float)grid.rows);
+        }
+        else if (corner.texCoord >= 0) {
+            vertex.s = packTexCoord(import.texCoords[(size_t)corner.texCoord * 2]);
+            vertex.t = packTexCoord(import.texCoords[(size_t)corner.texCoord * 2 + 1]);
+        }
+        else {
+            vertex.s = vertex.t = 0;
+        }
+    }
+
+    weldVertices(cornerVertices, mesh.vertices, mesh.indices);
+    stats.triangles = (int)(corners.size() / 3);
+    stats.corners = (int)corners.size();
+    stats.vertices = (int)mesh.vertices.size();
+    stats.generatedNormals = needNormals;
+    stats.acmrBefore = averageCacheMissRatio(mesh.indices, stats.vertices, meshCacheSize);
+
+    optimiseVertexCache(mesh.indices, stats.vertices);
+    orderVerticesByFirstUse(mesh);
+    stats.acmrAfter = averageCacheMissRatio(mesh.indices, stats.vertices, meshCacheSize);
+}
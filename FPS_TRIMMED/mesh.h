@@ -0,0 +1,80 @@
+#pragma once
+// Imported meshes
+// The OBJ is parsed into a MeshImport, which only lives while loading, and run through the import
+// pipeline: faces are triangulated, smooth normals are generated (in parallel) where the file's are
+// missing or don't line up, identical vertices are welded and the triangles are reordered for the
+// post-transform vertex cache. The result is a Mesh of packed MeshVertex records and triangle
+// indices that go to GL as they are. No GL in here, so tools can build it headless.
+#include <cstdint>
+#include <vector>
+
+// Vertex as the GPU reads it (20 bytes, was 72 as doubles with quad adjacency):
+//   position   3 floats
+//   normal     signed 10:10:10:2 (GL_INT_2_10_10_10_REV), w unused
+//   texcoords  signed 16-bit fixed point, meshUvScale steps per texture repeat
+typedef struct MeshVertex {
+    float x, y, z;
+    uint32_t normal;
+    int16_t s, t;
+} MeshVertex;
+
+const float meshUvScale = 1024.0f; // Covers +-32 repeats at 1/1024 precision
+
+// Texture coords for an OBJ without "vt" whose faces were swept out as a grid, face f at row
+// f / columns, column f % columns (the cannon belt's, from A2). Left out (0 x 0), or when the file
+// has texture coords or not exactly rows * columns faces, nothing is laid out.
+typedef struct MeshGrid {
+    int rows = 0;
+    int columns = 0;
+} MeshGrid;
+
+// Post-transform cache the ACMR figures are measured against (FIFO, the common hardware model)
+const int meshCacheSize = 16;
+
+// One corner of an OBJ face ("v", "v/vt", "v//vn" or "v/vt/vn"), 0-based, -1 when absent
+typedef struct ObjCorner {
+    int position;
+    int texCoord;
+    int normal;
+} ObjCorner;
+
+// The OBJ as read: only kept while the mesh is built
+typedef struct MeshImport {
+    std::vector<float> positions;   // x, y, z per "v"
+    std::vector<float> texCoords;   // s, t per "vt"
+    std::vector<float> normals;     // x, y, z per "vn"
+    std::vector<ObjCorner> corners; // Corners of every face, face after face
+    std::vector<int> faceStart;     // Face f is corners [faceStart[f], faceStart[f + 1])
+} MeshImport;
+
+// Draw-ready mesh: an indexed triangle list
+typedef struct Mesh {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+} Mesh;
+
+typedef struct MeshStats {
+    int faces = 0;
+    int triangles = 0;
+    int corners = 0;             // Vertices before welding (three per triangle)
+    int vertices = 0;            // After welding
+    bool generatedNormals = false;
+    float acmrBefore = 0.0f;     // Cache misses per triangle in file order (welded)
+    float acmrAfter = 0.0f;      // And after reordering
+} MeshStats;
+
+// Packs a unit vector to signed 10:10:10:2 (components clamped to [-1, 1])
+uint32_t packNormal(float x, float y, float z);
+void unpackNormal(uint32_t packed, float& x, float& y, float& z);
+
+int16_t packTexCoord(float value);
+
+// Reads the "v", "vt", "vn" and "f" lines of an OBJ (negative indices allowed); false if the file
+// can't be opened
+bool readObjMesh(const char* path, MeshImport& import);
+
+// Runs the import pipeline; faces with fewer than three corners or out-of-range positions are skipped
+void buildMesh(const MeshImport& import, const MeshGrid& grid, Mesh& mesh, MeshStats& stats);
+
+// Cache misses per triangle of an indexed triangle list, for a FIFO cache of cacheSize vertices
+float averageCacheMissRatio(const std::vector<uint32_t>& indices, int vertexCount, int cacheSize);
@@ -0,0 +1,104 @@
+#include "net.h"
+
+#ifdef _WIN32
+#include <winsock2.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef int socklen_t;
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+static sockaddr_in toSockaddr(const NetAddress& address) {
+    sockaddr_in result = {};
+    result.sin_family = AF_INET;
+    result.sin_addr.s_addr = htonl(address.ip);
+    result.sin_port = htons(address.port);
+    return result;
+}
+
+static NetAddress fromSockaddr(const sockaddr_in& address) {
+    NetAddress result;
+    result.ip = ntohl(address.sin_addr.s_addr);
+    result.port = ntohs(address.sin_port);
+    return result;
+}
+
+NetAddress loopbackAddress(uint16_t port) {
+    NetAddress result;
+    result.ip = 0x7F000001;
+    result.port = port;
+    return result;
+}
+
+NetSocket openUdpSocket(uint16_t port) {
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) return invalidSocket;
+        started = true;
+    }
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle == INVALID_SOCKET) return invalidSocket;
+#else
+    int handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle < 0) return invalidSocket;
+#endif
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    bool ok = bind(handle, (const sockaddr*)&address, sizeof(address)) == 0;
+
+#ifdef _WIN32
+    u_long nonBlocking = 1;
+    ok = ok && ioctlsocket(handle, FIONBIO, &nonBlocking) == 0;
+#else
+    ok = ok && fcntl(handle, F_SETFL, fcntl(handle, F_GETFL, 0) | O_NONBLOCK) == 0;
+#endif
+
+    if (!ok) {
+        closeUdpSocket((NetSocket)handle);
+        return invalidSocket;
+    }
+    return (NetSocket)handle;
+}
+
+void closeUdpSocket(NetSocket socket) {
+    if (socket == invalidSocket) return;
+#ifdef _WIN32
+    closesocket((SOCKET)socket);
+#else
+    close((int)socket);
+#endif
+}
+
+NetAddress boundAddress(NetSocket socket) {
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    getsockname(socket, (sockaddr*)&address, &length);
+    return fromSockaddr(address);
+}
+
+void setReceiveBufferSize(NetSocket socket, int bytes) {
+    setsockopt(socket, SOL_SOCKET, SO_RCVBUF, (const char*)&bytes, sizeof(bytes));
+}
+
+bool sendPacket(NetSocket socket, const NetAddress& to, const uint8_t* data, size_t size) {
+    sockaddr_in address = toSockaddr(to);
+    return sendto(socket, (const char*)data, (int)size, 0, (const sockaddr*)&address, sizeof(address)) == (int)size;
+}
+
+int receivePacket(NetSocket socket, NetAddress& from, uint8_t* buffer, size_t capacity) {
+    sockaddr_in address = {};
+    socklen_t length = sizeof(address);
+    int size = (int)recvfrom(socket, (char*)buffer, (int)capacity, 0, (sockaddr*)&address, &length);
+    if (size < 0) return -1;
+    from = fromSockaddr(address);
+    return size;
+}
@@ -0,0 +1,34 @@
+#pragma once
+// Minimal non-blocking UDP sockets (Winsock on Windows, BSD sockets elsewhere)
+#include <cstddef>
+#include <cstdint>
+
+typedef intptr_t NetSocket;
+const NetSocket invalidSocket = -1;
+
+// IPv4 address and port, both in host byte order
+struct NetAddress {
+    uint32_t ip = 0;
+    uint16_t port = 0;
+};
+
+inline bool operator==(const NetAddress& a, const NetAddress& b) { return a.ip == b.ip && a.port == b.port; }
+
+// 127.0.0.1:port
+NetAddress loopbackAddress(uint16_t port);
+
+// Binds to port on all interfaces (0 picks a free port); invalidSocket on failure
+NetSocket openUdpSocket(uint16_t port);
+void closeUdpSocket(NetSocket socket);
+
+// Address the socket is bound to (for the port picked by openUdpSocket(0))
+NetAddress boundAddress(NetSocket socket);
+
+// Asks the OS for a bigger receive queue (it may grant less); full snapshots of large armies
+// arrive as bursts of fragments
+void setReceiveBufferSize(NetSocket socket, int bytes);
+
+bool sendPacket(NetSocket socket, const NetAddress& to, const uint8_t* data, size_t size);
+
+// Reads one waiting datagram; returns its size, or -1 if nothing is waiting
+int receivePacket(NetSocket socket, NetAddress& from, uint8_t* buffer, size_t capacity);
@@ -0,0 +1,185 @@
+// Loopback test for the server (no window, no GL)
+// Runs the server and a lobby of simulated clients in one process over real UDP sockets on
+// 127.0.0.1, for each combination of robot and client counts. One client drives (walks, turns and
+// fires), the rest spectate. Every decoded snapshot is checked against the server's own state, and
+// the run reports snapshot bandwidth per client and server tick time as JSON.
+//
+// Build (Linux):  g++ -O3 -std=c++17 sim.cpp timerwheel.cpp pose.cpp flowfield.cpp crowd.cpp jobs.cpp workers.cpp scenequery.cpp alloctrack.cpp net.cpp netcodec.cpp server.cpp netclient.cpp netbench.cpp -lpthread -o fps_netbench
+// Usage:          fps_netbench [--robots N,N,...] [--clients N,N,...] [--ticks N] [--out file.json]
+// The process exits with status 1 if any client decoded a state that differs from the server's.
+#include "netclient.h"
+#include "server.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+const int warmupTicks = 20; // Joining and the first full snapshots
+
+struct Result {
+    int fullSnapshotBytes = 0; // First snapshot the driver received
+    double bytesPerClientTick = 0.0;
+    double meanTickMs = 0.0, p99TickMs = 0.0, maxTickMs = 0.0;
+    int decoded = 0, dropped = 0, mismatches = 0;
+};
+
+// Parses "a,b,c"
+static std::vector<int> parseList(const char* text) {
+    std::vector<int> values;
+    for (const char* at = text; *at;) {
+        values.push_back(atoi(at));
+        const char* comma = strchr(at, ',');
+        if (!comma) break;
+        at = comma + 1;
+    }
+    return values;
+}
+
+static void queueKey(NetClient& client, SimInputType type, unsigned char key) {
+    SimInput input = { type, key, 0, 0 };
+    queueClientInput(client, input);
+}
+
+// The driver walks forward for a while, sweeping the view and firing as it goes
+static void scriptDriver(NetClient& driver, int tick) {
+    if (tick == 1) queueKey(driver, INPUT_KEY_DOWN, 'w');
+    if (tick == 150) queueKey(driver, INPUT_KEY_UP, 'w');
+    if (tick % 7 == 0) {
+        SimInput look = { INPUT_LOOK, 0, (tick / 70) % 2 ? -12 : 12, 0 };
+        queueClientInput(driver, look);
+    }
+    if (tick % 40 == 0) {
+        SimInput fire = { INPUT_MOUSE_FIRE, 0, 0, 0 };
+        queueClientInput(driver, fire);
+    }
+}
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static Result runLoopback(int robotCount, int clientCount, int ticks) {
+    Result result;
+    resetSimulation();
+    setRobotCount(robotCount);
+    spawnRobots();
+    if (!startServer(0, clientCount)) {
+        fprintf(stderr, "Could not open the server socket\n");
+        exit(2);
+    }
+
+    std::vector<NetClient> clients(clientCount);
+    for (NetClient& client : clients) {
+        if (!connectClient(client, loopbackAddress(serverPort()))) {
+            fprintf(stderr, "Could not open a client socket\n");
+            exit(2);
+        }
+        setReceiveBufferSize(client.socket, 8 << 20); // A full snapshot of a big army is one burst
+    }
+
+    std::vector<double> tickMs;
+    long long measuredBytes = 0;
+    for (int tick = 1; tick <= warmupTicks + ticks; tick++) {
+        scriptDriver(clients[0], tick);
+        for (NetClient& client : clients) sendClientInput(client);
+
+        // Server time only: each client drains its socket between the server's sends
+        auto start = std::chrono::steady_clock::now();
+        serverReceive();
+        serverSimulate();
+        double serverMs = elapsedMs(start);
+
+        const NetState* truth = serverState(serverTickCount());
+        for (int i = 0; i < serverClientCount(); i++) {
+            start = std::chrono::steady_clock::now();
+            size_t bytes = serverSendSnapshot(i);
+            serverMs += elapsedMs(start);
+
+            if (i == 0 && result.fullSnapshotBytes == 0) result.fullSnapshotBytes = (int)bytes;
+            if (tick > warmupTicks) measuredBytes += (long long)bytes;
+
+            NetClient& client = clients[i];
+            pollClient(client);
+            const NetState* decoded = clientLatestState(client);
+            if (decoded && decoded->tick == truth->tick && !(*decoded == *truth)) result.mismatches++;
+        }
+        if (tick > warmupTicks) tickMs.push_back(serverMs);
+    }
+
+    for (NetClient& client : clients) {
+        result.decoded += client.snapshotsDecoded;
+        result.dropped += client.snapshotsDropped;
+        closeClient(client);
+    }
+    stopServer();
+
+    std::sort(tickMs.begin(), tickMs.end());
+    double total = 0.0;
+    for (double ms : tickMs) total += ms;
+    result.meanTickMs = total / tickMs.size();
+    result.p99TickMs = tickMs[std::min(tickMs.size() - 1, (size_t)(tickMs.size() * 0.99))];
+    result.maxTickMs = tickMs.back();
+    result.bytesPerClientTick = (double)measuredBytes / ((double)ticks * clientCount);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> robotCounts = { 2, 100, 1000, 10000 };
+    std::vector<int> clientCounts = { 1, 4, 16 };
+    int ticks = 200;
+    const char* outPath = "netbench_results.json";
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--robots") == 0 && i + 1 < argc) {
+            robotCounts = parseList(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--clients") == 0 && i + 1 < argc) {
+            clientCounts = parseList(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--ticks") == 0 && i + 1 < argc) {
+            ticks = std::max(atoi(argv[++i]), 1);
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+
+    FILE* out = stdout;
+    if (strcmp(outPath, "-") != 0 && !(out = fopen(outPath, "w"))) {
+        fprintf(stderr, "Could not open file: %s\n", outPath);
+        return 2;
+    }
+
+    bool passed = true;
+    bool first = true;
+    fprintf(out, "{\n  \"tick_ms\": %u,\n  \"runs\": [\n", serverTickMs);
+    for (int robotCount : robotCounts) {
+        for (int clientCount : clientCounts) {
+            if (clientCount < 1) continue;
+            Result result = runLoopback(robotCount, clientCount, ticks);
+            passed = passed && result.mismatches == 0;
+
+            fprintf(stderr, "robots %6d  clients %3d  full %8d B  delta %9.1f B/tick/client  tick mean %7.3f ms  p99 %7.3f ms  dropped %d%s\n",
+                robotCount, clientCount, result.fullSnapshotBytes, result.bytesPerClientTick,
+                result.meanTickMs, result.p99TickMs, result.dropped, result.mismatches ? "  MISMATCH" : "");
+
+            fprintf(out,
+                "%s    { \"robots\": %d, \"clients\": %d, \"ticks\": %d, \"full_snapshot_bytes\": %d, "
+                "\"bytes_per_tick_per_client\": %.1f, \"server_tick_mean_ms\": %.4f, \"server_tick_p99_ms\": %.4f, "
+                "\"server_tick_max_ms\": %.4f, \"snapshots_decoded\": %d, \"snapshots_dropped\": %d, \"mismatches\": %d }",
+                first ? "" : ",\n", robotCount, clientCount, ticks, result.fullSnapshotBytes, result.bytesPerClientTick,
+                result.meanTickMs, result.p99TickMs, result.maxTickMs, result.decoded, result.dropped, result.mismatches);
+            first = false;
+        }
+    }
+    fprintf(out, "\n  ],\n  \"passed\": %s\n}\n", passed ? "true" : "false");
+    if (out != stdout) fclose(out);
+
+    return passed ? 0 : 1;
+}
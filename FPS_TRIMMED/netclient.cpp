@@ -0,0 +1,101 @@
+#include "netclient.h"
+#include <algorithm>
+#include <cstring>
+
+static const NetState emptyState;
+
+bool connectClient(NetClient& client, const NetAddress& server) {
+    client.socket = openUdpSocket(0);
+    client.server = server;
+    return client.socket != invalidSocket;
+}
+
+void closeClient(NetClient& client) {
+    closeUdpSocket(client.socket);
+    client.socket = invalidSocket;
+}
+
+void queueClientInput(NetClient& client, const SimInput& input) {
+    client.unackedInputs.push_back(input);
+}
+
+void sendClientInput(NetClient& client) {
+    NetInputPacket packet;
+    packet.ackTick = client.latestTick;
+    packet.firstInput = client.firstUnackedInput;
+    packet.inputCount = std::min((int)client.unackedInputs.size(), netMaxInputsPerPacket);
+    std::copy(client.unackedInputs.begin(), client.unackedInputs.begin() + packet.inputCount, packet.inputs);
+
+    uint8_t buffer[netMaxPacketSize];
+    size_t size = writeInputPacket(packet, buffer);
+    sendPacket(client.socket, client.server, buffer, size);
+}
+
+// The server has applied every input up to sequence number inputAck
+static void acknowledgeInputs(NetClient& client, uint32_t inputAck) {
+    if (inputAck < client.firstUnackedInput) return;
+    size_t count = std::min((size_t)(inputAck - client.firstUnackedInput + 1), client.unackedInputs.size());
+    client.unackedInputs.erase(client.unackedInputs.begin(), client.unackedInputs.begin() + count);
+    client.firstUnackedInput += (uint32_t)count;
+}
+
+static void completeSnapshot(NetClient& client) {
+    const NetState* base = &emptyState;
+    if (client.pendingBaseTick != 0) {
+        base = &client.states[client.pendingBaseTick % clientHistoryStates];
+        if (base->tick != client.pendingBaseTick) {
+            client.snapshotsDropped++; // Already overwritten; the next ack will get us a usable base
+            return;
+        }
+    }
+
+    if (!decodeSnapshot(*base, client.pendingTick, client.pendingPayload.data(), client.pendingPayload.size(), client.decoded)) {
+        client.snapshotsDropped++;
+        return;
+    }
+
+    // Decoded into a separate state first: the base may sit in the slot this tick replaces
+    std::swap(client.decoded, client.states[client.pendingTick % clientHistoryStates]);
+    client.latestTick = client.pendingTick;
+    client.snapshotsDecoded++;
+    acknowledgeInputs(client, client.pendingInputAck);
+}
+
+int pollClient(NetClient& client) {
+    uint8_t buffer[netMaxPacketSize];
+    NetAddress from;
+    NetSnapshotFragment fragment;
+    int decoded = 0;
+    int size;
+    while ((size = receivePacket(client.socket, from, buffer, sizeof(buffer))) >= 0) {
+        if (!(from == client.server) || !readSnapshotFragment(buffer, (size_t)size, fragment)) continue;
+        client.bytesReceived += size;
+
+        // Only ever assemble the newest snapshot; fragments of older ones are stale
+        if (fragment.tick <= client.latestTick || fragment.tick < client.pendingTick) continue;
+        if (fragment.tick > client.pendingTick) {
+            client.pendingTick = fragment.tick;
+            client.pendingBaseTick = fragment.baseTick;
+            client.pendingInputAck = fragment.inputAck;
+            client.pendingMissing = fragment.count;
+            client.pendingPayload.resize(fragment.payloadSize);
+            client.pendingReceived.assign(fragment.count, 0);
+        }
+        if (fragment.payloadSize != client.pendingPayload.size() || fragment.count != client.pendingReceived.size() ||
+            client.pendingReceived[fragment.index]) continue;
+
+        memcpy(&client.pendingPayload[(size_t)fragment.index * netFragmentCapacity], fragment.data, fragment.dataSize);
+        client.pendingReceived[fragment.index] = 1;
+        if (--client.pendingMissing == 0) {
+            int before = client.snapshotsDecoded;
+            completeSnapshot(client);
+            decoded += client.snapshotsDecoded - before;
+        }
+    }
+    return decoded;
+}
+
+const NetState* clientLatestState(const NetClient& client) {
+    if (client.latestTick == 0) return nullptr;
+    return &client.states[client.latestTick % clientHistoryStates];
+}
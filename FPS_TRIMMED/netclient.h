@@ -0,0 +1,51 @@
+#pragma once
+// Client side of the server protocol (server.h): sends input, reassembles and decodes snapshots
+// Several clients can live in one process (the loopback test runs a whole lobby).
+#include "net.h"
+#include "netcodec.h"
+#include <cstdint>
+#include <vector>
+
+const int clientHistoryStates = 8; // Decoded states kept as bases for the snapshots still in flight
+
+struct NetClient {
+    NetSocket socket = invalidSocket;
+    NetAddress server;
+
+    NetState states[clientHistoryStates]; // Indexed by tick % clientHistoryStates
+    NetState decoded;                     // Decode target, swapped into states
+    uint32_t latestTick = 0;
+
+    // Snapshot being reassembled
+    uint32_t pendingTick = 0;
+    uint32_t pendingBaseTick = 0;
+    uint32_t pendingInputAck = 0;
+    int pendingMissing = 0;
+    std::vector<uint8_t> pendingPayload;
+    std::vector<uint8_t> pendingReceived; // Per fragment
+
+    // Inputs the server hasn't acknowledged yet, oldest first
+    std::vector<SimInput> unackedInputs;
+    uint32_t firstUnackedInput = 1; // Sequence number of unackedInputs[0]
+
+    // Totals, for tests
+    long long bytesReceived = 0;
+    int snapshotsDecoded = 0;
+    int snapshotsDropped = 0; // Base no longer held, or the payload didn't decode
+};
+
+// Opens the client's socket; the server sees it on its first sendClientInput()
+bool connectClient(NetClient& client, const NetAddress& server);
+void closeClient(NetClient& client);
+
+// Queues input for the server; it's resent with every sendClientInput() until acknowledged
+void queueClientInput(NetClient& client, const SimInput& input);
+
+// Sends the newest decoded tick as the ack along with the unacknowledged inputs
+void sendClientInput(NetClient& client);
+
+// Reads every waiting packet; returns the number of snapshots completed and decoded
+int pollClient(NetClient& client);
+
+// Newest decoded state, or nullptr before the first snapshot
+const NetState* clientLatestState(const NetClient& client);
@@ -0,0 +1,353 @@
+#include "netcodec.h"
+#include <cstring>
+
+static const int32_t zeroRecord[16] = {}; // Base for entities the base state doesn't have
+
+// Protects the decoder from counts that would make it allocate without bound
+const uint32_t netMaxEntities = 1 << 18;
+
+bool operator==(const NetState& a, const NetState& b) {
+    return a.tick == b.tick && memcmp(a.player, b.player, sizeof(a.player)) == 0 && a.robots == b.robots &&
+           a.bulletIds == b.bulletIds && a.bullets == b.bullets && a.spheres == b.spheres;
+}
+
+//// Quantisation
+static inline int32_t quantise(float value, float scale) {
+    float scaled = value * scale;
+    const float limit = 1073741824.0f; // 2^30: far outside anything the sim produces
+    if (scaled > limit) scaled = limit;
+    if (scaled < -limit) scaled = -limit;
+    return (int32_t)lrintf(scaled);
+}
+
+void captureNetState(uint32_t tick, NetState& state) {
+    state.tick = tick;
+
+    int32_t* player = state.player;
+    player[PLAYER_X] = quantise(cameraX, netPositionScale);
+    player[PLAYER_Y] = quantise(cameraY, netPositionScale);
+    player[PLAYER_Z] = quantise(cameraZ, netPositionScale);
+    player[PLAYER_ANGLE_H] = quantise(cameraAngleH, netRadianScale);
+    player[PLAYER_ANGLE_V] = quantise(cameraAngleV, netRadianScale);
+    player[PLAYER_CANNON_ANGLE] = quantise(cannonAngle, netDegreeScale);
+    player[PLAYER_CANNON_DISABLED] = isCannonDisabled ? 1 : 0;
+
+    state.robots.resize(robots.size() * ROBOT_FIELDS);
+    for (size_t i = 0; i < robots.size(); i++) {
+        const Robot& robot = robots[i];
+        const RobotDetail& detail = robotDetails[i];
+        int32_t* record = &state.robots[i * ROBOT_FIELDS];
+        record[ROBOT_X] = quantise(robot.pos.x, netPositionScale);
+        record[ROBOT_Y] = quantise(robot.pos.y, netPositionScale);
+        record[ROBOT_Z] = quantise(robot.pos.z, netPositionScale);
+        record[ROBOT_FLAGS] = (robot.isActive ? ROBOT_FLAG_ACTIVE : 0) | (robot.isDestroyed ? ROBOT_FLAG_DESTROYED : 0) |
+                              (detail.isHit ? ROBOT_FLAG_HIT : 0) | (detail.isSpinning ? ROBOT_FLAG_SPINNING : 0) |
+                              (robot.legForward ? ROBOT_FLAG_LEG_FORWARD : 0) | (detail.isWalking ? ROBOT_FLAG_WALKING : 0);
+        record[ROBOT_HEALTH] = detail.health;
+        record[ROBOT_LEG] = quantise(detail.legAngle, netDegreeScale);
+        record[ROBOT_LOWER_LEG] = quantise(detail.lowerLegAngle, netDegreeScale);
+        record[ROBOT_ARM] = quantise(detail.armAngle, netDegreeScale);
+        record[ROBOT_LOWER_ARM] = quantise(detail.lowerArmAngle, netDegreeScale);
+        record[ROBOT_LEAN] = quantise(detail.bodyLeanAngle, netDegreeScale);
+        record[ROBOT_CANNON_ROTATION] = quantise(detail.cannonRotation, netDegreeScale);
+        record[ROBOT_REDNESS] = quantise(detail.rednessFactor, netFractionScale);
+        record[ROBOT_UPPER_BODY] = quantise(detail.upperBodyAngle, netDegreeScale);
+        record[ROBOT_HEAD_Y] = quantise(detail.headOffsetY, netPositionScale);
+        record[ROBOT_HEAD_Z] = quantise(detail.headOffsetZ, netPositionScale);
+    }
+
+    state.bulletIds.resize(bullets.size());
+    state.bullets.resize(bullets.size() * BULLET_FIELDS);
+    for (size_t i = 0; i < bullets.size(); i++) {
+        const Bullet& bullet = bullets[i];
+        int32_t* record = &state.bullets[i * BULLET_FIELDS];
+        state.bulletIds[i] = bullet.id;
+        record[BULLET_X] = quantise(bullet.x, netPositionScale);
+        record[BULLET_Y] = quantise(bullet.y, netPositionScale);
+        record[BULLET_Z] = quantise(bullet.z, netPositionScale);
+        record[BULLET_DIR_X] = quantise(bullet.dirX, netDirectionScale);
+        record[BULLET_DIR_Y] = quantise(bullet.dirY, netDirectionScale);
+        record[BULLET_DIR_Z] = quantise(bullet.dirZ, netDirectionScale);
+        record[BULLET_PLAYER] = bullet.isPlayerBullet ? 1 : 0;
+    }
+
+    state.spheres.resize(spheres.size() * SPHERE_FIELDS);
+    for (size_t i = 0; i < spheres.size(); i++) {
+        int32_t* record = &state.spheres[i * SPHERE_FIELDS];
+        record[SPHERE_X] = quantise(spheres[i].x, netPositionScale);
+        record[SPHERE_Y] = quantise(spheres[i].y, netPositionScale);
+        record[SPHERE_Z] = quantise(spheres[i].z, netPositionScale);
+    }
+}
+
+//// Byte stream
+// Unsigned LEB128 varints; signed values are zigzagged first so small negatives stay short
+static void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+    while (value >= 0x80) {
+        out.push_back((uint8_t)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((uint8_t)value);
+}
+
+static inline uint32_t zigzag(int32_t value) {
+    return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t value) {
+    return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+struct Reader {
+    const uint8_t* at;
+    const uint8_t* end;
+    bool ok = true;
+
+    uint32_t varint() {
+        uint32_t value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (at == end) break;
+            uint8_t byte = *at++;
+            value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        ok = false;
+        return 0;
+    }
+};
+
+//// Records
+// Field mask, then the (wrapping) difference from base for each changed field
+static void encodeRecord(const int32_t* base, const int32_t* record, int fields, std::vector<uint8_t>& out) {
+    uint32_t mask = 0;
+    for (int f = 0; f < fields; f++) {
+        if (record[f] != base[f]) mask |= 1u << f;
+    }
+    putVarint(out, mask);
+    for (int f = 0; f < fields; f++) {
+        if (mask & (1u << f)) putVarint(out, zigzag((int32_t)((uint32_t)record[f] - (uint32_t)base[f])));
+    }
+}
+
+static void decodeRecord(const int32_t* base, int32_t* record, int fields, Reader& in) {
+    uint32_t mask = in.varint();
+    if (mask >> fields) in.ok = false;
+    for (int f = 0; f < fields; f++) {
+        record[f] = (mask & (1u << f)) ? (int32_t)((uint32_t)base[f] + (uint32_t)unzigzag(in.varint())) : base[f];
+    }
+}
+
+// Where the base bullet would be now if it kept flying (both ends compute this identically)
+static void predictBullet(const int32_t* base, uint32_t ticks, int32_t* predicted) {
+    memcpy(predicted, base, BULLET_FIELDS * sizeof(int32_t));
+    for (int axis = 0; axis < 3; axis++) {
+        int64_t travel = (int64_t)base[BULLET_DIR_X + axis] * ticks / netBulletStepDivisor;
+        predicted[BULLET_X + axis] = (int32_t)((uint32_t)base[BULLET_X + axis] + (uint32_t)travel);
+    }
+}
+
+//// Snapshots
+// Layout: player record | robot count, then (unchanged run, changed record)... |
+//         bullet count, then (id delta, record vs predicted base or zero)... | sphere count, records
+void encodeSnapshot(const NetState& base, const NetState& state, std::vector<uint8_t>& out) {
+    encodeRecord(base.player, state.player, PLAYER_FIELDS, out);
+
+    // Robots keep their slots, so most ticks are runs of robots that didn't move
+    const int robotCount = state.robotCount();
+    const int baseRobots = base.robotCount();
+    putVarint(out, (uint32_t)robotCount);
+    uint32_t run = 0;
+    for (int i = 0; i < robotCount; i++) {
+        const int32_t* record = &state.robots[(size_t)i * ROBOT_FIELDS];
+        const int32_t* baseRecord = i < baseRobots ? &base.robots[(size_t)i * ROBOT_FIELDS] : zeroRecord;
+        if (memcmp(record, baseRecord, ROBOT_FIELDS * sizeof(int32_t)) == 0) {
+            run++;
+            continue;
+        }
+        putVarint(out, run);
+        run = 0;
+        encodeRecord(baseRecord, record, ROBOT_FIELDS, out);
+    }
+    if (run > 0) putVarint(out, run);
+
+    // Bullets come and go, so they're matched to the base by id (both lists are in id order)
+    const int bulletCount = state.bulletCount();
+    const int baseBullets = base.bulletCount();
+    const uint32_t ticks = state.tick - base.tick;
+    putVarint(out, (uint32_t)bulletCount);
+    uint32_t previousId = 0;
+    int b = 0;
+    int32_t predicted[BULLET_FIELDS];
+    for (int i = 0; i < bulletCount; i++) {
+        uint32_t id = state.bulletIds[i];
+        putVarint(out, id - previousId);
+        previousId = id;
+
+        while (b < baseBullets && base.bulletIds[b] < id) b++;
+        const int32_t* baseRecord = zeroRecord;
+        if (b < baseBullets && base.bulletIds[b] == id) {
+            predictBullet(&base.bullets[(size_t)b * BULLET_FIELDS], ticks, predicted);
+            baseRecord = predicted;
+            b++;
+        }
+        encodeRecord(baseRecord, &state.bullets[(size_t)i * BULLET_FIELDS], BULLET_FIELDS, out);
+    }
+
+    const int sphereCount = state.sphereCount();
+    const int baseSpheres = base.sphereCount();
+    putVarint(out, (uint32_t)sphereCount);
+    for (int i = 0; i < sphereCount; i++) {
+        const int32_t* baseRecord = i < baseSpheres ? &base.spheres[(size_t)i * SPHERE_FIELDS] : zeroRecord;
+        encodeRecord(baseRecord, &state.spheres[(size_t)i * SPHERE_FIELDS], SPHERE_FIELDS, out);
+    }
+}
+
+bool decodeSnapshot(const NetState& base, uint32_t tick, const uint8_t* data, size_t size, NetState& state) {
+    Reader in = { data, data + size };
+    state.tick = tick;
+    decodeRecord(base.player, state.player, PLAYER_FIELDS, in);
+
+    uint32_t robotCount = in.varint();
+    if (!in.ok || robotCount > netMaxEntities) return false;
+    const uint32_t baseRobots = (uint32_t)base.robotCount();
+    state.robots.resize((size_t)robotCount * ROBOT_FIELDS);
+    for (uint32_t i = 0; i < robotCount;) {
+        uint32_t run = in.varint();
+        if (!in.ok || run > robotCount - i) return false;
+        for (uint32_t end = i + run; i < end; i++) {
+            const int32_t* baseRecord = i < baseRobots ? &base.robots[(size_t)i * ROBOT_FIELDS] : zeroRecord;
+            memcpy(&state.robots[(size_t)i * ROBOT_FIELDS], baseRecord, ROBOT_FIELDS * sizeof(int32_t));
+        }
+        if (i == robotCount) break;
+
+        const int32_t* baseRecord = i < baseRobots ? &base.robots[(size_t)i * ROBOT_FIELDS] : zeroRecord;
+        decodeRecord(baseRecord, &state.robots[(size_t)i * ROBOT_FIELDS], ROBOT_FIELDS, in);
+        i++;
+    }
+
+    uint32_t bulletCount = in.varint();
+    if (!in.ok || bulletCount > netMaxEntities) return false;
+    const int baseBullets = base.bulletCount();
+    const uint32_t ticks = tick - base.tick;
+    state.bulletIds.resize(bulletCount);
+    state.bullets.resize((size_t)bulletCount * BULLET_FIELDS);
+    uint32_t previousId = 0;
+    int b = 0;
+    int32_t predicted[BULLET_FIELDS];
+    for (uint32_t i = 0; i < bulletCount && in.ok; i++) {
+        uint32_t id = previousId + in.varint();
+        state.bulletIds[i] = id;
+        previousId = id;
+
+        while (b < baseBullets && base.bulletIds[b] < id) b++;
+        const int32_t* baseRecord = zeroRecord;
+        if (b < baseBullets && base.bulletIds[b] == id) {
+            predictBullet(&base.bullets[(size_t)b * BULLET_FIELDS], ticks, predicted);
+            baseRecord = predicted;
+            b++;
+        }
+        decodeRecord(baseRecord, &state.bullets[(size_t)i * BULLET_FIELDS], BULLET_FIELDS, in);
+    }
+
+    uint32_t sphereCount = in.varint();
+    if (!in.ok || sphereCount > netMaxEntities) return false;
+    const uint32_t baseSpheres = (uint32_t)base.sphereCount();
+    state.spheres.resize((size_t)sphereCount * SPHERE_FIELDS);
+    for (uint32_t i = 0; i < sphereCount && in.ok; i++) {
+        const int32_t* baseRecord = i < baseSpheres ? &base.spheres[(size_t)i * SPHERE_FIELDS] : zeroRecord;
+        decodeRecord(baseRecord, &state.spheres[(size_t)i * SPHERE_FIELDS], SPHERE_FIELDS, in);
+    }
+
+    return in.ok && in.at == in.end;
+}
+
+//// Packets
+// Fixed-width header fields, little-endian
+static uint8_t* put16(uint8_t* out, uint16_t value) {
+    out[0] = (uint8_t)value;
+    out[1] = (uint8_t)(value >> 8);
+    return out + 2;
+}
+
+static uint8_t* put32(uint8_t* out, uint32_t value) {
+    for (int i = 0; i < 4; i++) out[i] = (uint8_t)(value >> (8 * i));
+    return out + 4;
+}
+
+static uint16_t get16(const uint8_t* in) {
+    return (uint16_t)(in[0] | (in[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* in) {
+    return (uint32_t)in[0] | ((uint32_t)in[1] << 8) | ((uint32_t)in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+const size_t inputHeaderSize = 2 + 1 + 4 + 4 + 1;
+const size_t inputSize = 1 + 1 + 2 + 2;
+
+size_t writeInputPacket(const NetInputPacket& packet, uint8_t* out) {
+    uint8_t* at = put16(out, netProtocolId);
+    *at++ = PACKET_INPUT;
+    at = put32(at, packet.ackTick);
+    at = put32(at, packet.firstInput);
+    *at++ = (uint8_t)packet.inputCount;
+    for (int i = 0; i < packet.inputCount; i++) {
+        const SimInput& input = packet.inputs[i];
+        *at++ = (uint8_t)input.type;
+        *at++ = input.key;
+        at = put16(at, (uint16_t)(int16_t)input.dx);
+        at = put16(at, (uint16_t)(int16_t)input.dy);
+    }
+    return at - out;
+}
+
+bool readInputPacket(const uint8_t* data, size_t size, NetInputPacket& packet) {
+    if (size < inputHeaderSize || get16(data) != netProtocolId || data[2] != PACKET_INPUT) return false;
+    packet.ackTick = get32(data + 3);
+    packet.firstInput = get32(data + 7);
+    packet.inputCount = data[11];
+    if (packet.inputCount > netMaxInputsPerPacket || size != inputHeaderSize + packet.inputCount * inputSize) return false;
+
+    const uint8_t* at = data + inputHeaderSize;
+    for (int i = 0; i < packet.inputCount; i++, at += inputSize) {
+        if (at[0] > INPUT_LOOK) return false;
+        SimInput& input = packet.inputs[i];
+        input.type = (SimInputType)at[0];
+        input.key = at[1];
+        input.dx = (int16_t)get16(at + 2);
+        input.dy = (int16_t)get16(at + 4);
+    }
+    return true;
+}
+
+size_t writeSnapshotFragment(const NetSnapshotFragment& fragment, uint8_t* out) {
+    uint8_t* at = put16(out, netProtocolId);
+    *at++ = PACKET_SNAPSHOT;
+    at = put32(at, fragment.tick);
+    at = put32(at, fragment.baseTick);
+    at = put32(at, fragment.inputAck);
+    at = put32(at, fragment.payloadSize);
+    at = put16(at, fragment.index);
+    at = put16(at, fragment.count);
+    memcpy(at, fragment.data, fragment.dataSize);
+    return netSnapshotHeaderSize + fragment.dataSize;
+}
+
+bool readSnapshotFragment(const uint8_t* data, size_t size, NetSnapshotFragment& fragment) {
+    if (size < netSnapshotHeaderSize || get16(data) != netProtocolId || data[2] != PACKET_SNAPSHOT) return false;
+    fragment.tick = get32(data + 3);
+    fragment.baseTick = get32(data + 7);
+    fragment.inputAck = get32(data + 11);
+    fragment.payloadSize = get32(data + 15);
+    fragment.index = get16(data + 19);
+    fragment.count = get16(data + 21);
+    fragment.data = data + netSnapshotHeaderSize;
+    fragment.dataSize = size - netSnapshotHeaderSize;
+
+    // Every fragment but the last is full, and the last one ends the payload
+    size_t offset = (size_t)fragment.index * netFragmentCapacity;
+    bool isLast = fragment.index + 1 == fragment.count;
+    return fragment.payloadSize > 0 && fragment.index < fragment.count &&
+           fragment.count == (fragment.payloadSize + netFragmentCapacity - 1) / netFragmentCapacity &&
+           offset + fragment.dataSize == (isLast ? fragment.payloadSize : offset + netFragmentCapacity);
+}
@@ -0,0 +1,121 @@
+#pragma once
+// Wire format for networked play
+// The server reduces the sim to a NetState: every field a client needs, quantised to fixed-point
+// integers. A snapshot is a NetState encoded as the difference from one the client has
+// acknowledged: unchanged robots collapse into run lengths, changed ones send a field mask plus
+// small varint deltas, and bullets are predicted along their direction so one in flight costs
+// about as much as one standing still. Against an empty base the same encoding is a full snapshot.
+#include "sim.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Fixed-point scales (steps per unit)
+const float netPositionScale = 256.0f;  // World units
+const float netDegreeScale = 64.0f;     // Robot animation angles (degrees)
+const float netRadianScale = 4096.0f;   // Camera angles (radians)
+const float netDirectionScale = 4096.0f; // Bullet direction components
+const float netFractionScale = 256.0f;  // 0..1 values (rednessFactor)
+
+// Quantised bullet direction steps per position step moved in one tick (bullets move 0.5 per simTick)
+const int netBulletStepDivisor = (int)(netDirectionScale / (0.5f * netPositionScale));
+
+enum NetPlayerField {
+    PLAYER_X, PLAYER_Y, PLAYER_Z,
+    PLAYER_ANGLE_H, PLAYER_ANGLE_V,
+    PLAYER_CANNON_ANGLE, PLAYER_CANNON_DISABLED,
+    PLAYER_FIELDS
+};
+
+// Fields that change every tick while walking come first, so their mask fits in one varint byte
+enum NetRobotField {
+    ROBOT_X, ROBOT_Y, ROBOT_Z,
+    ROBOT_LEG, ROBOT_LOWER_LEG, ROBOT_LEAN, ROBOT_CANNON_ROTATION,
+    ROBOT_FLAGS, ROBOT_HEALTH, ROBOT_REDNESS,
+    ROBOT_ARM, ROBOT_LOWER_ARM,
+    ROBOT_UPPER_BODY, ROBOT_HEAD_Y, ROBOT_HEAD_Z,
+    ROBOT_FIELDS
+};
+
+enum NetRobotFlag {
+    ROBOT_FLAG_ACTIVE = 1,
+    ROBOT_FLAG_DESTROYED = 2,
+    ROBOT_FLAG_HIT = 4,
+    ROBOT_FLAG_SPINNING = 8,
+    ROBOT_FLAG_LEG_FORWARD = 16,
+    ROBOT_FLAG_WALKING = 32
+};
+
+enum NetBulletField {
+    BULLET_X, BULLET_Y, BULLET_Z,
+    BULLET_DIR_X, BULLET_DIR_Y, BULLET_DIR_Z,
+    BULLET_PLAYER,
+    BULLET_FIELDS
+};
+
+enum NetSphereField { SPHERE_X, SPHERE_Y, SPHERE_Z, SPHERE_FIELDS };
+
+// Quantised world state at the end of a server tick
+struct NetState {
+    uint32_t tick = 0; // 0: empty (the base of a full snapshot)
+    int32_t player[PLAYER_FIELDS] = {};
+    std::vector<int32_t> robots;     // ROBOT_FIELDS per robot, in sim order
+    std::vector<uint32_t> bulletIds; // Increasing, like the sim's bullet list
+    std::vector<int32_t> bullets;    // BULLET_FIELDS per bullet
+    std::vector<int32_t> spheres;    // SPHERE_FIELDS per sphere
+
+    int robotCount() const { return (int)(robots.size() / ROBOT_FIELDS); }
+    int bulletCount() const { return (int)bulletIds.size(); }
+    int sphereCount() const { return (int)(spheres.size() / SPHERE_FIELDS); }
+};
+
+bool operator==(const NetState& a, const NetState& b);
+
+// Quantises the sim globals into state (reuses state's buffers)
+void captureNetState(uint32_t tick, NetState& state);
+
+// Appends state encoded against base to out
+void encodeSnapshot(const NetState& base, const NetState& state, std::vector<uint8_t>& out);
+
+// Rebuilds the state encoded against base; false if the payload is malformed
+bool decodeSnapshot(const NetState& base, uint32_t tick, const uint8_t* data, size_t size, NetState& state);
+
+//// Packets
+const uint16_t netProtocolId = 0xF95A;
+const size_t netMaxPacketSize = 1200; // Stays under common path MTUs
+
+enum NetPacketType {
+    PACKET_INPUT = 1,   // Client -> server (also how a client joins)
+    PACKET_SNAPSHOT = 2 // Server -> client, one fragment of a snapshot
+};
+
+// Input packet: the client's acknowledged snapshot tick plus every input the server hasn't
+// acknowledged yet (resent until it has, so a lost packet can't leave a key stuck down)
+const int netMaxInputsPerPacket = 32;
+
+struct NetInputPacket {
+    uint32_t ackTick = 0;    // Newest snapshot tick the client decoded (0: none yet)
+    uint32_t firstInput = 0; // Sequence number of inputs[0] (sequence numbers start at 1)
+    int inputCount = 0;
+    SimInput inputs[netMaxInputsPerPacket];
+};
+
+size_t writeInputPacket(const NetInputPacket& packet, uint8_t* out); // out: netMaxPacketSize bytes
+bool readInputPacket(const uint8_t* data, size_t size, NetInputPacket& packet);
+
+// Snapshot fragment header; the payload follows
+struct NetSnapshotFragment {
+    uint32_t tick = 0;
+    uint32_t baseTick = 0;  // Tick the payload is encoded against (0: full snapshot)
+    uint32_t inputAck = 0;  // Newest input sequence number the server has applied for this client
+    uint32_t payloadSize = 0;
+    uint16_t index = 0, count = 0;
+    const uint8_t* data = nullptr; // This fragment's slice of the payload
+    size_t dataSize = 0;
+};
+
+const size_t netSnapshotHeaderSize = 2 + 1 + 4 * 4 + 2 * 2;
+const size_t netFragmentCapacity = netMaxPacketSize - netSnapshotHeaderSize;
+
+size_t writeSnapshotFragment(const NetSnapshotFragment& fragment, uint8_t* out); // out: netMaxPacketSize bytes
+bool readSnapshotFragment(const uint8_t* data, size_t size, NetSnapshotFragment& fragment);
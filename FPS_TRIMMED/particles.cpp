@@ -0,0 +1,267 @@
+#include "particles.h"
+#include <algorithm>
+#include <cmath>
+
+const float floorY = 0.0f;
+const float maxStepSeconds = 0.1f; // Longer gaps (a stall, a breakpoint) don't fling everything at once
+
+// How one kind of particle moves and looks over its life
+typedef struct ParticleLook {
+    ParticleMaterial material;
+    float gravity;     // Units per second squared, downwards
+    float drag;        // Velocity lost per second (exponential)
+    float bounce;      // Vertical speed kept when hitting the floor (0: slides along it)
+    float growth;      // Size at the end of life, relative to the start
+    float startColor[4];
+    float endColor[4];
+} ParticleLook;
+
+static const ParticleLook looks[NUM_PARTICLE_KINDS] = {
+    { PARTICLE_ADDITIVE, 0.0f,  12.0f, 0.0f, 0.4f, { 1.0f, 0.95f, 0.6f, 1.0f }, { 1.0f, 0.45f, 0.1f, 0.0f } },  // Flash
+    { PARTICLE_ADDITIVE, 20.0f, 0.5f,  0.4f, 0.6f, { 1.0f, 0.85f, 0.4f, 1.0f }, { 1.0f, 0.25f, 0.0f, 0.0f } },  // Spark
+    { PARTICLE_ADDITIVE, 12.0f, 0.3f,  0.3f, 0.5f, { 1.0f, 0.6f, 0.2f, 1.0f },  { 0.5f, 0.1f, 0.0f, 0.0f } },   // Debris
+    { PARTICLE_ALPHA,    -0.5f, 1.5f,  0.0f, 3.0f, { 0.35f, 0.33f, 0.3f, 0.5f }, { 0.2f, 0.2f, 0.2f, 0.0f } },  // Smoke
+};
+
+// Structure-of-arrays storage, allocated once at full capacity
+typedef struct ParticlePool {
+    int count;
+    std::vector<float> x, y, z;
+    std::vector<float> vx, vy, vz;
+    std::vector<float> age, life; // Seconds
+    std::vector<float> size;      // Half-width of the billboard at birth
+} ParticlePool;
+
+// One burst of an effect: speed is random in [speedMin, speedMax] in a random direction, plus
+// `along` times the effect's direction and `lift` upwards
+typedef struct ParticleBurst {
+    ParticleKind kind;
+    int count;
+    float along, lift;
+    float speedMin, speedMax;
+    float lifeMin, lifeMax;
+    float sizeMin, sizeMax;
+} ParticleBurst;
+
+const int maxBurstsPerEffect = 3;
+
+typedef struct EffectRecipe {
+    int burstCount;
+    ParticleBurst bursts[maxBurstsPerEffect];
+} EffectRecipe;
+
+static const EffectRecipe recipes[NUM_SIM_EFFECTS] = {
+    // Muzzle flash
+    { 2, { { PARTICLE_FLASH, 24, 12.0f, 0.0f, 0.0f, 3.0f, 0.05f, 0.12f, 0.25f, 0.5f },
+           { PARTICLE_SMOKE, 4,  2.0f,  0.8f, 0.0f, 0.5f, 0.6f,  1.0f,  0.15f, 0.3f } } },
+    // Robot hit: sparks thrown back towards the shooter
+    { 1, { { PARTICLE_SPARK, 32, -3.0f, 2.0f, 3.0f, 8.0f, 0.25f, 0.6f, 0.05f, 0.1f } } },
+    // Robot destroyed
+    { 3, { { PARTICLE_DEBRIS, 160, 0.0f, 6.0f, 2.0f, 8.0f,  0.8f, 1.6f, 0.08f, 0.2f },
+           { PARTICLE_SPARK,  60,  0.0f, 3.0f, 4.0f, 10.0f, 0.3f, 0.7f, 0.05f, 0.1f },
+           { PARTICLE_SMOKE,  40,  0.0f, 1.5f, 0.5f, 2.0f,  1.2f, 2.2f, 0.4f,  0.8f } } },
+    // Robot smoke
+    { 1, { { PARTICLE_SMOKE, 2, 0.0f, 1.2f, 0.0f, 0.4f, 1.0f, 1.6f, 0.2f, 0.4f } } },
+    // Cannon hit
+    { 2, { { PARTICLE_SPARK, 48, -3.0f, 2.0f, 3.0f, 8.0f, 0.25f, 0.6f, 0.05f, 0.1f },
+           { PARTICLE_SMOKE, 8,  0.0f,  1.0f, 0.2f, 0.8f, 0.8f,  1.4f, 0.3f,  0.5f } } },
+};
+
+static ParticlePool pools[NUM_PARTICLE_KINDS];
+static bool poolsCreated = false;
+static std::vector<ParticleInstance> instances;
+static int materialFirst[NUM_PARTICLE_MATERIALS], materialCount[NUM_PARTICLE_MATERIALS];
+static uint64_t lastSimTime = 0;
+static bool clockStarted = false;
+static unsigned int randomCounter = 0;
+
+static void createPools() {
+    if (poolsCreated) return;
+    int total = 0;
+    for (int k = 0; k < NUM_PARTICLE_KINDS; k++) {
+        ParticlePool& pool = pools[k];
+        size_t capacity = (size_t)particleCapacity[k];
+        pool.count = 0;
+        for (std::vector<float>* field : { &pool.x, &pool.y, &pool.z, &pool.vx, &pool.vy, &pool.vz, &pool.age, &pool.life, &pool.size }) {
+            field->resize(capacity);
+        }
+        total += particleCapacity[k];
+    }
+    instances.resize(total);
+    poolsCreated = true;
+}
+
+// Counter-based, so a replay of the same effects makes the same particles
+static float randomUnit() {
+    unsigned int x = (randomCounter++) * 0x9E3779B9u + 0x27D4EB2Fu;
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return (float)(x >> 8) * (1.0f / 16777216.0f);
+}
+
+static float randomRange(float low, float high) {
+    return low + (high - low) * randomUnit();
+}
+
+static void spawnBurst(const ParticleBurst& burst, const SimEffect& effect) {
+    ParticlePool& pool = pools[burst.kind];
+    int count = std::min(burst.count, particleCapacity[burst.kind] - pool.count);
+    for (int n = 0; n < count; n++) {
+        // Uniform direction on the sphere
+        float dirY = randomRange(-1.0f, 1.0f);
+        float angle = randomRange(0.0f, 6.2831853f);
+        float ring = sqrtf(1.0f - dirY * dirY);
+        float speed = randomRange(burst.speedMin, burst.speedMax);
+
+        int i = pool.count++;
+        pool.x[i] = effect.x;
+        pool.y[i] = effect.y;
+        pool.z[i] = effect.z;
+        pool.vx[i] = ring * cosf(angle) * speed + effect.dirX * burst.along;
+        pool.vy[i] = dirY * speed + effect.dirY * burst.along + burst.lift;
+        pool.vz[i] = ring * sinf(angle) * speed + effect.dirZ * burst.along;
+        pool.age[i] = 0.0f;
+        pool.life[i] = randomRange(burst.lifeMin, burst.lifeMax);
+        pool.size[i] = randomRange(burst.sizeMin, burst.sizeMax);
+    }
+}
+
+void spawnEffect(const SimEffect& effect) {
+    if (effect.type < 0 || effect.type >= NUM_SIM_EFFECTS) return;
+    createPools();
+    const EffectRecipe& recipe = recipes[effect.type];
+    for (int b = 0; b < recipe.burstCount; b++) {
+        spawnBurst(recipe.bursts[b], effect);
+    }
+}
+
+// Straight loops over float arrays; restrict parameters (the fields never alias) let the compiler
+// vectorise them
+static void integrateParticles(int count, float dt, float keep, float fall, float* __restrict x, float* __restrict y,
+    float* __restrict z, float* __restrict vx, float* __restrict vy, float* __restrict vz, float* __restrict age) {
+    for (int i = 0; i < count; i++) {
+        vx[i] *= keep;
+        vy[i] = vy[i] * keep - fall;
+        vz[i] *= keep;
+        x[i] += vx[i] * dt;
+        y[i] += vy[i] * dt;
+        z[i] += vz[i] * dt;
+        age[i] += dt;
+    }
+}
+
+static void bounceParticles(int count, float bounce, float* __restrict y, float* __restrict vy) {
+    for (int i = 0; i < count; i++) {
+        float height = y[i];
+        float speed = vy[i];
+        y[i] = height < floorY ? floorY : height;
+        vy[i] = height < floorY ? -speed * bounce : speed;
+    }
+}
+
+// Moves the particles, then moves the survivors down over the dead
+static void updatePool(ParticlePool& pool, const ParticleLook& look, float dt) {
+    const int count = pool.count;
+    float* x = pool.x.data();
+    float* y = pool.y.data();
+    float* z = pool.z.data();
+    float* vx = pool.vx.data();
+    float* vy = pool.vy.data();
+    float* vz = pool.vz.data();
+    float* age = pool.age.data();
+    float* life = pool.life.data();
+    float* size = pool.size.data();
+
+    integrateParticles(count, dt, expf(-look.drag * dt), look.gravity * dt, x, y, z, vx, vy, vz, age);
+    bounceParticles(count, look.bounce, y, vy);
+
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (age[i] >= life[i]) continue;
+        if (kept != i) {
+            x[kept] = x[i]; y[kept] = y[i]; z[kept] = z[i];
+            vx[kept] = vx[i]; vy[kept] = vy[i]; vz[kept] = vz[i];
+            age[kept] = age[i]; life[kept] = life[i]; size[kept] = size[i];
+        }
+        kept++;
+    }
+    pool.count = kept;
+}
+
+// Writes a pool's particles as instances, faded and grown by age
+static ParticleInstance* writeInstances(const ParticlePool& pool, const ParticleLook& look, ParticleInstance* out) {
+    const float* x = pool.x.data();
+    const float* y = pool.y.data();
+    const float* z = pool.z.data();
+    const float* age = pool.age.data();
+    const float* life = pool.life.data();
+    const float* size = pool.size.data();
+    float colorStep[4];
+    for (int c = 0; c < 4; c++) colorStep[c] = look.endColor[c] - look.startColor[c];
+
+    for (int i = 0; i < pool.count; i++) {
+        float t = age[i] / life[i];
+        ParticleInstance& instance = out[i];
+        instance.x = x[i];
+        instance.y = y[i];
+        instance.z = z[i];
+        instance.size = size[i] * (1.0f + (look.growth - 1.0f) * t);
+        instance.r = (uint8_t)((look.startColor[0] + colorStep[0] * t) * 255.0f + 0.5f);
+        instance.g = (uint8_t)((look.startColor[1] + colorStep[1] * t) * 255.0f + 0.5f);
+        instance.b = (uint8_t)((look.startColor[2] + colorStep[2] * t) * 255.0f + 0.5f);
+        instance.a = (uint8_t)((look.startColor[3] + colorStep[3] * t) * 255.0f + 0.5f);
+    }
+    return out + pool.count;
+}
+
+void updateParticles(uint64_t simTime) {
+    createPools();
+    float dt = 0.0f;
+    if (clockStarted && simTime > lastSimTime) {
+        dt = std::min((float)(simTime - lastSimTime) * 0.001f, maxStepSeconds);
+    }
+    lastSimTime = simTime;
+    clockStarted = true;
+
+    ParticleInstance* out = instances.data();
+    for (int m = 0; m < NUM_PARTICLE_MATERIALS; m++) {
+        materialFirst[m] = (int)(out - instances.data());
+        for (int k = 0; k < NUM_PARTICLE_KINDS; k++) {
+            if (looks[k].material != m) continue;
+            if (dt > 0.0f) updatePool(pools[k], looks[k], dt);
+            out = writeInstances(pools[k], looks[k], out);
+        }
+        materialCount[m] = (int)(out - instances.data()) - materialFirst[m];
+    }
+}
+
+void clearParticles() {
+    for (ParticlePool& pool : pools) pool.count = 0;
+    for (int m = 0; m < NUM_PARTICLE_MATERIALS; m++) {
+        materialFirst[m] = 0;
+        materialCount[m] = 0;
+    }
+    clockStarted = false;
+    randomCounter = 0;
+}
+
+int liveParticles() {
+    int total = 0;
+    for (const ParticlePool& pool : pools) total += pool.count;
+    return total;
+}
+
+const std::vector<ParticleInstance>& particleInstances() {
+    return instances;
+}
+
+int particleMaterialFirst(ParticleMaterial material) {
+    return materialFirst[material];
+}
+
+int particleMaterialCount(ParticleMaterial material) {
+    return materialCount[material];
+}
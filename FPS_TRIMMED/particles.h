@@ -0,0 +1,50 @@
+#pragma once
+// Particle effects: muzzle flashes, impact sparks, robot debris and smoke
+// The sim only reports what happened (SimEffect, sim.h); the render thread turns each effect into
+// a burst of particles here. Each kind of particle lives in its own fixed-capacity pool stored as
+// structure-of-arrays, so the per-frame update is a handful of straight loops over float arrays
+// the compiler vectorises, and dead particles are compacted away in place. Nothing allocates
+// after the pools are created; bursts that don't fit are cut short.
+// The instances are laid out per material, ready for one instanced draw each. No GL in here.
+#include "sim.h"
+#include <cstdint>
+#include <vector>
+
+enum ParticleKind {
+    PARTICLE_FLASH,  // Muzzle flash: bright, short, fast
+    PARTICLE_SPARK,  // Impacts: small, fall and bounce off the floor
+    PARTICLE_DEBRIS, // Robot destruction: glowing chunks thrown up
+    PARTICLE_SMOKE,  // Slow, rising, growing
+    NUM_PARTICLE_KINDS
+};
+
+enum ParticleMaterial {
+    PARTICLE_ADDITIVE, // Glowing: flashes, sparks, debris
+    PARTICLE_ALPHA,    // Blended over the scene: smoke
+    NUM_PARTICLE_MATERIALS
+};
+
+const int particleCapacity[NUM_PARTICLE_KINDS] = { 8192, 65536, 65536, 32768 };
+
+// 20 bytes per particle drawn: centre and size (world units), color (GL_UNSIGNED_BYTE x4)
+typedef struct ParticleInstance {
+    float x, y, z, size;
+    uint8_t r, g, b, a;
+} ParticleInstance;
+
+// Adds the burst of particles an effect makes
+void spawnEffect(const SimEffect& effect);
+
+// Ages, moves and culls every particle up to simTime (sim ms, so frames drawn from the same
+// snapshots match); a simTime that goes backwards (sim reset) only restarts the clock
+void updateParticles(uint64_t simTime);
+
+// Removes every particle and restarts the clock and the random sequence
+void clearParticles();
+
+int liveParticles();
+
+// The instances to draw, grouped by material: material m is count(m) instances from first(m)
+const std::vector<ParticleInstance>& particleInstances();
+int particleMaterialFirst(ParticleMaterial material);
+int particleMaterialCount(ParticleMaterial material);
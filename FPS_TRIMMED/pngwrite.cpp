@@ -0,0 +1,239 @@
+#include "pngwrite.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+//// Checksums
+static uint32_t crcTable[256];
+
+static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+    if (crcTable[1] == 0) {
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            crcTable[n] = c;
+        }
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++) crc = crcTable[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+static uint32_t adler32(const uint8_t* data, size_t size) {
+    uint32_t a = 1, b = 0;
+    for (size_t i = 0; i < size; i++) {
+        a = (a + data[i]) % 65521;
+        b = (b + a) % 65521;
+    }
+    return (b << 16) | a;
+}
+
+//// Deflate (fixed Huffman codes, RFC 1951 3.2.6)
+typedef struct BitWriter {
+    std::vector<uint8_t>* out;
+    uint32_t bits;
+    int count;
+} BitWriter;
+
+static void putBits(BitWriter& writer, uint32_t value, int count) {
+    writer.bits |= value << writer.count;
+    writer.count += count;
+    while (writer.count >= 8) {
+        writer.out->push_back((uint8_t)writer.bits);
+        writer.bits >>= 8;
+        writer.count -= 8;
+    }
+}
+
+// Huffman codes go out most significant bit first
+static void putCode(BitWriter& writer, uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int i = 0; i < length; i++) reversed |= ((code >> i) & 1) << (length - 1 - i);
+    putBits(writer, reversed, length);
+}
+
+static void putLiteral(BitWriter& writer, int symbol) {
+    if (symbol < 144) putCode(writer, 0x30 + symbol, 8);
+    else if (symbol < 256) putCode(writer, 0x190 + symbol - 144, 9);
+    else if (symbol < 280) putCode(writer, symbol - 256, 7);
+    else putCode(writer, 0xC0 + symbol - 280, 8);
+}
+
+static const uint16_t lengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                         35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+static const uint8_t lengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                         3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+static const uint16_t distanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                           257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+static const uint8_t distanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                           7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+static void putMatch(BitWriter& writer, int length, int distance) {
+    int code = 28;
+    while (lengthBase[code] > length) code--;
+    putLiteral(writer, 257 + code);
+    putBits(writer, length - lengthBase[code], lengthExtra[code]);
+
+    code = 29;
+    while (distanceBase[code] > distance) code--;
+    putCode(writer, code, 5);
+    putBits(writer, distance - distanceBase[code], distanceExtra[code]);
+}
+
+const int deflateWindow = 32768;
+const int deflateHashBits = 15;
+const int deflateMaxChain = 32; // Match candidates tried per position
+const int deflateMinMatch = 3;
+const int deflateMaxMatch = 258;
+
+static uint32_t hash3(const uint8_t* p) {
+    return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - deflateHashBits);
+}
+
+// One fixed-Huffman block wrapped in a zlib stream
+static void deflate(const uint8_t* data, size_t size, std::vector<uint8_t>& out) {
+    out.push_back(0x78); // 32K window, deflate
+    out.push_back(0x01);
+
+    BitWriter writer = { &out, 0, 0 };
+    putBits(writer, 1, 1); // Final block
+    putBits(writer, 1, 2); // Fixed codes
+
+    // head: latest position per hash; prev: the position before it with the same hash (windowed)
+    std::vector<int32_t> head(1 << deflateHashBits, -1);
+    std::vector<int32_t> prev(deflateWindow, -1);
+    size_t position = 0;
+    while (position < size) {
+        int bestLength = 0, bestDistance = 0;
+        if (position + deflateMinMatch <= size) {
+            uint32_t hash = hash3(data + position);
+            int32_t candidate = head[hash];
+            int limit = (int)std::min(size - position, (size_t)deflateMaxMatch);
+            for (int chain = 0; chain < deflateMaxChain && candidate >= 0; chain++) {
+                int distance = (int)(position - candidate);
+                if (distance > deflateWindow) break;
+                if (data[candidate + bestLength] == data[position + bestLength]) {
+                    int length = 0;
+                    while (length < limit && data[candidate + length] == data[position + length]) length++;
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = distance;
+                        if (length == limit) break;
+                    }
+                }
+                candidate = prev[candidate % deflateWindow];
+            }
+        }
+
+        int advance = 1;
+        if (bestLength >= deflateMinMatch) {
+            putMatch(writer, bestLength, bestDistance);
+            advance = bestLength;
+        }
+        else {
+            putLiteral(writer, data[position]);
+        }
+        for (int i = 0; i < advance; i++, position++) {
+            if (position + deflateMinMatch > size) continue;
+            uint32_t hash = hash3(data + position);
+            prev[position % deflateWindow] = head[hash];
+            head[hash] = (int32_t)position;
+        }
+    }
+    putLiteral(writer, 256); // End of block
+    putBits(writer, 0, 7);   // Flush to a byte boundary
+
+    uint32_t adler = adler32(data, size);
+    out.push_back((uint8_t)(adler >> 24));
+    out.push_back((uint8_t)(adler >> 16));
+    out.push_back((uint8_t)(adler >> 8));
+    out.push_back((uint8_t)adler);
+}
+
+//// PNG
+static void putBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+    out.push_back((uint8_t)(value >> 24));
+    out.push_back((uint8_t)(value >> 16));
+    out.push_back((uint8_t)(value >> 8));
+    out.push_back((uint8_t)value);
+}
+
+static void putChunk(std::vector<uint8_t>& png, const char* type, const std::vector<uint8_t>& data) {
+    putBigEndian(png, (uint32_t)data.size());
+    size_t start = png.size();
+    png.insert(png.end(), type, type + 4);
+    png.insert(png.end(), data.begin(), data.end());
+    putBigEndian(png, crc32(png.data() + start, png.size() - start));
+}
+
+static uint8_t paeth(int a, int b, int c) {
+    int p = a + b - c;
+    int pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+    if (pa <= pb && pa <= pc) return (uint8_t)a;
+    return (uint8_t)(pb <= pc ? b : c);
+}
+
+void encodePng(int width, int height, const uint8_t* rgba, bool bottomUp, std::vector<uint8_t>& png) {
+    const int bytesPerPixel = 3;
+    const size_t rowSize = (size_t)width * bytesPerPixel;
+
+    // Each row gets the filter (none, sub, up, paeth) with the smallest sum of absolute residuals
+    std::vector<uint8_t> filtered;
+    filtered.reserve((rowSize + 1) * height);
+    std::vector<uint8_t> row(rowSize), above(rowSize, 0), candidate(rowSize), best(rowSize);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* source = rgba + (size_t)(bottomUp ? height - 1 - y : y) * width * 4;
+        for (int x = 0; x < width; x++) {
+            memcpy(&row[(size_t)x * 3], source + (size_t)x * 4, 3);
+        }
+
+        uint32_t bestCost = UINT32_MAX;
+        uint8_t bestFilter = 0;
+        const uint8_t filters[] = { 0, 1, 2, 4 };
+        for (uint8_t filter : filters) {
+            uint32_t cost = 0;
+            for (size_t i = 0; i < rowSize; i++) {
+                int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+                int up = above[i];
+                int upLeft = i >= bytesPerPixel ? above[i - bytesPerPixel] : 0;
+                uint8_t predicted = filter == 0 ? 0 : filter == 1 ? (uint8_t)left : filter == 2 ? (uint8_t)up : paeth(left, up, upLeft);
+                candidate[i] = (uint8_t)(row[i] - predicted);
+                cost += (uint32_t)abs((int8_t)candidate[i]);
+            }
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestFilter = filter;
+                best.swap(candidate);
+            }
+        }
+        filtered.push_back(bestFilter);
+        filtered.insert(filtered.end(), best.begin(), best.end());
+        above.swap(row);
+    }
+
+    static const uint8_t signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    png.assign(signature, signature + 8);
+
+    std::vector<uint8_t> header;
+    putBigEndian(header, (uint32_t)width);
+    putBigEndian(header, (uint32_t)height);
+    header.insert(header.end(), { 8, 2, 0, 0, 0 }); // 8-bit RGB, deflate, adaptive filtering, no interlace
+    putChunk(png, "IHDR", header);
+
+    std::vector<uint8_t> compressed;
+    deflate(filtered.data(), filtered.size(), compressed);
+    putChunk(png, "IDAT", compressed);
+    putChunk(png, "IEND", std::vector<uint8_t>());
+}
+
+bool writePng(const char* path, int width, int height, const uint8_t* rgba, bool bottomUp) {
+    std::vector<uint8_t> png;
+    encodePng(width, height, rgba, bottomUp, png);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) return false;
+    bool written = fwrite(png.data(), 1, png.size(), file) == png.size();
+    return fclose(file) == 0 && written;
+}
@@ -0,0 +1,15 @@
+#pragma once
+// PNG writing
+// Frames read back from GL (render bench captures, golden images) are saved as 8-bit RGB PNGs.
+// Self-contained: rows are filtered per PNG's adaptive heuristic and compressed with fixed-Huffman
+// deflate and a hash-chain matcher, which gets rendered frames to a fraction of their raw size
+// without pulling in zlib. Reading PNGs back is left to SOIL.
+#include <cstdint>
+#include <vector>
+
+// Encodes width x height RGBA pixels (alpha dropped), rows top to bottom; bottomUp for rows in
+// glReadPixels order
+void encodePng(int width, int height, const uint8_t* rgba, bool bottomUp, std::vector<uint8_t>& png);
+
+// encodePng() to a file; false if it couldn't be written
+bool writePng(const char* path, int width, int height, const uint8_t* rgba, bool bottomUp);
@@ -0,0 +1,597 @@
+#include "pose.h"
+#include "sim.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// robots.size() * JOINT_COUNT matrices, robot-major, each robot's valid once posed in the current
+// generation. A robot's state is the generation it was last posed in, with posingBit set while a
+// thread is posing it; generations are even and never 0, which is every state's start
+const uint32_t posingBit = 1;
+static std::vector<glm::mat4> robotJointMatrices;
+static std::vector<std::atomic<uint32_t>> robotPoseStates;
+static uint32_t poseGeneration = 2;
+
+const float truePi = 3.14159265f; // glRotatef takes true degrees
+const float degToRad = truePi / 180.0f;
+
+// A robot's joint angles, in the order poseRobot() reads their cosines and sines
+enum PoseAngle {
+    ANGLE_FALL,
+    ANGLE_LEAN,
+    ANGLE_ARM,
+    ANGLE_LOWER_ARM,
+    ANGLE_LEG,
+    ANGLE_LOWER_LEG,
+    ANGLE_SPIN,
+    POSE_ANGLE_COUNT
+};
+const int poseTrigWidth = 8; // POSE_ANGLE_COUNT padded to two 4-wide vectors
+
+// Fills c/s[0, poseTrigWidth) from angle (degrees)
+// Branch-free polynomial sin/cos (error < 2e-6) so the compiler can vectorise the loop,
+// which sinf/cosf calls prevent (selects only: fminf/copysignf calls also block it)
+static void evalTrig(const float* angle, float* c, float* s) {
+    for (int i = 0; i < poseTrigWidth; i++) {
+        // Wrap to [-pi, pi] (the +1024 keeps the truncating cast a floor for any sane angle)
+        float r = angle[i] * degToRad;
+        float turns = r * (0.5f / truePi);
+        r -= (2.0f * truePi) * (float)((int)(turns + 1024.5f) - 1024);
+
+        // Fold into [-pi/2, pi/2], where the series converge fast; cos changes sign when folded
+        float magnitude = fabsf(r);
+        float mirrored = truePi - magnitude;
+        float folded = magnitude < mirrored ? magnitude : mirrored;
+        float cosSign = magnitude > 0.5f * truePi ? -1.0f : 1.0f;
+        r = r < 0.0f ? -folded : folded;
+
+        float r2 = r * r;
+        s[i] = r * (1.0f + r2 * (-1.0f / 6.0f + r2 * (1.0f / 120.0f + r2 * (-1.0f / 5040.0f + r2 * (1.0f / 362880.0f)))));
+        c[i] = cosSign * (1.0f + r2 * (-0.5f + r2 * (1.0f / 24.0f + r2 * (-1.0f / 720.0f + r2 * (1.0f / 40320.0f + r2 * (-1.0f / 3628800.0f))))));
+    }
+}
+
+// In-place right-multiplications (m = m * T / m * R), written as 4-wide column operations
+static inline void translateBy(glm::mat4& m, float x, float y, float z) {
+    m[3] = m[0] * x + m[1] * y + m[2] * z + m[3];
+}
+
+static inline void rotateXBy(glm::mat4& m, float c, float s) {
+    glm::vec4 col1 = m[1], col2 = m[2];
+    m[1] = col1 * c + col2 * s;
+    m[2] = col2 * c - col1 * s;
+}
+
+static inline void rotateYBy(glm::mat4& m, float c, float s) {
+    glm::vec4 col0 = m[0], col2 = m[2];
+    m[0] = col0 * c - col2 * s;
+    m[2] = col0 * s + col2 * c;
+}
+
+static inline void rotateZBy(glm::mat4& m, float c, float s) {
+    glm::vec4 col0 = m[0], col1 = m[1];
+    m[0] = col0 * c + col1 * s;
+    m[1] = col1 * c - col0 * s;
+}
+
+void poseRobot(const Robot& robot, const RobotDetail& detail, float eyeX, float eyeZ, glm::mat4* joint) {
+    // Only the right arm swings (the left holds the cannon at -90), so its angle is -armAngle
+    float angle[poseTrigWidth] = {};
+    angle[ANGLE_FALL] = detail.upperBodyAngle;
+    angle[ANGLE_LEAN] = detail.bodyLeanAngle;
+    angle[ANGLE_ARM] = -detail.armAngle;
+    angle[ANGLE_LOWER_ARM] = detail.lowerArmAngle;
+    angle[ANGLE_LEG] = detail.legAngle;
+    angle[ANGLE_LOWER_LEG] = detail.lowerLegAngle;
+    angle[ANGLE_SPIN] = detail.isSpinning ? detail.cannonRotation : 0.0f;
+    float c[poseTrigWidth], s[poseTrigWidth];
+    evalTrig(angle, c, s);
+
+    // Facing the camera: the angle drawRobots() used to compute was atan2(dx, dz), whose cosine and
+    // sine are just the direction to the camera, normalised
+    float dx = eyeX - robot.pos.x, dz = eyeZ - robot.pos.z;
+    float lengthSquared = dx * dx + dz * dz;
+    float inverse = lengthSquared > 0.0f ? 1.0f / sqrtf(lengthSquared) : 0.0f;
+    float facingCos = lengthSquared > 0.0f ? dz * inverse : 1.0f; // atan2(0, 0) is 0
+    float facingSin = dx * inverse;
+
+    // Compose the hierarchy (mirrors the transform order of drawBot/drawArm/drawLeg)
+    const float fallPivot = 0.4f * scaleRobot;
+    glm::mat4 root(1.0f);
+    root[3] = glm::vec4(robot.pos.x, robot.pos.y, robot.pos.z, 1.0f);
+    rotateYBy(root, facingCos, facingSin);
+    root[0] = root[0] * scaleRobot;
+    root[1] = root[1] * scaleRobot;
+    root[2] = root[2] * scaleRobot;
+    joint[JOINT_ROOT] = root;
+
+    glm::mat4 upper = root;
+    translateBy(upper, 0.0f, -fallPivot, 0.0f);
+    rotateXBy(upper, c[ANGLE_FALL], s[ANGLE_FALL]);
+    translateBy(upper, 0.0f, fallPivot, 0.0f);
+    joint[JOINT_UPPER_BODY] = upper;
+
+    glm::mat4 head = upper;
+    translateBy(head, 0.0f, detail.headOffsetY, detail.headOffsetZ);
+    joint[JOINT_HEAD] = head;
+
+    glm::mat4 torso = upper;
+    rotateZBy(torso, c[ANGLE_LEAN], s[ANGLE_LEAN]);
+    joint[JOINT_TORSO] = torso;
+
+    // Left/right limbs use +angle/-angle: same cosine, negated sine
+    for (int side = 0; side < 2; side++) {
+        bool isLeft = side == 0;
+        float direction = isLeft ? -1.0f : 1.0f;
+        float mirror = isLeft ? 1.0f : -1.0f; // Sign of the limb angle on this side
+        int armBase = isLeft ? JOINT_LEFT_UPPER_ARM : JOINT_RIGHT_UPPER_ARM;
+        int legBase = isLeft ? JOINT_LEFT_UPPER_LEG : JOINT_RIGHT_UPPER_LEG;
+
+        glm::mat4 upperArm = upper;
+        translateBy(upperArm, 0.85f * direction, 0.65f, 0.0f);
+        if (isLeft) rotateXBy(upperArm, 0.0f, -1.0f); // Fixed -90: holds the cannon forward
+        else rotateXBy(upperArm, c[ANGLE_ARM], s[ANGLE_ARM]);
+        translateBy(upperArm, 0.0f, -0.25f, 0.0f);
+        joint[armBase] = upperArm;
+
+        glm::mat4 lowerArm = upperArm;
+        translateBy(lowerArm, 0.0f, -0.7f, 0.0f);
+        rotateXBy(lowerArm, c[ANGLE_LOWER_ARM], mirror * s[ANGLE_LOWER_ARM]);
+        translateBy(lowerArm, 0.0f, -0.1f, 0.0f);
+        joint[armBase + 1] = lowerArm;
+
+        glm::mat4 cannon = lowerArm;
+        rotateYBy(cannon, c[ANGLE_SPIN], s[ANGLE_SPIN]);
+        rotateXBy(cannon, 0.0f, 1.0f); // 90: barrel along the arm
+        joint[armBase + 2] = cannon;
+
+        glm::mat4 upperLeg = root;
+        translateBy(upperLeg, 0.4f * direction, -1.125f, 0.0f);
+        rotateXBy(upperLeg, c[ANGLE_LEG], mirror * s[ANGLE_LEG]);
+        translateBy(upperLeg, 0.0f, -0.375f, 0.0f);
+        joint[legBase] = upperLeg;
+
+        glm::mat4 lowerLeg = upperLeg;
+        translateBy(lowerLeg, 0.0f, -0.75f, 0.0f);
+        rotateXBy(lowerLeg, c[ANGLE_LOWER_LEG], mirror * s[ANGLE_LOWER_LEG]);
+        translateBy(lowerLeg, 0.0f, -0.25f, 0.0f);
+        joint[legBase + 1] = lowerLeg;
+    }
+}
+
+void invalidateRobotPoses() {
+    const size_t count = robots.size();
+    if (robotPoseStates.size() != count) {
+        robotJointMatrices.resize(count * JOINT_COUNT);
+        std::vector<std::atomic<uint32_t>> states(count); // Zeroed: nothing posed
+        robotPoseStates.swap(states);
+    }
+    poseGeneration += 2;
+    if (poseGeneration == 0) { // Wrapped: clear states left from the generation it's back at
+        for (std::atomic<uint32_t>& state : robotPoseStates) state.store(0, std::memory_order_relaxed);
+        poseGeneration = 2;
+    }
+}
+
+const glm::mat4* robotJoints(int robotIndex) {
+    glm::mat4* joints = &robotJointMatrices[(size_t)robotIndex * JOINT_COUNT];
+    std::atomic<uint32_t>& state = robotPoseStates[robotIndex];
+    uint32_t seen = state.load(std::memory_order_acquire);
+    if (seen == poseGeneration) return joints;
+
+    // The first reader poses it; any other waits the fraction of a microsecond that takes
+    const uint32_t posing = poseGeneration | posingBit;
+    if (seen != posing && state.compare_exchange_strong(seen, posing, std::memory_order_acquire)) {
+        poseRobot(robots[robotIndex], robotDetails[robotIndex], cameraX, cameraZ, joints);
+        state.store(poseGeneration, std::memory_order_release);
+        return joints;
+    }
+    while (state.load(std::memory_order_acquire) != poseGeneration) std::this_thread::yield();
+    return joints;
+}
+
+//// Hitboxes
+// A capsule: the points within radius of the segment a-b, in its joint's space
+struct LimbCapsule {
+    RobotJoint joint;
+    glm::vec3 a, b;
+    float radius;
+};
+
+// Against drawHead/drawBody/drawArm/drawLeg: head cube and dome; body, jetpack and hips; shoulder
+// to elbow; forearm; arm cannon (along z); hip to knee; shin
+static const LimbCapsule limbCapsules[LIMB_COUNT] = {
+    { JOINT_HEAD,            { 0.0f, 1.3f, 0.0f },    { 0.0f, 1.85f, 0.0f },   0.6f },
+    { JOINT_TORSO,           { 0.0f, -0.35f, 0.0f },  { 0.0f, 0.2f, 0.0f },    0.6f },
+    { JOINT_LEFT_UPPER_ARM,  { 0.0f, 0.25f, 0.0f },   { 0.0f, -0.4f, 0.0f },   0.2f },
+    { JOINT_LEFT_LOWER_ARM,  { 0.0f, 0.1f, 0.0f },    { 0.0f, -0.1f, 0.0f },   0.2f },
+    { JOINT_LEFT_CANNON,     { 0.0f, 0.0f, 0.1f },    { 0.0f, 0.0f, 0.4f },    0.2f },
+    { JOINT_RIGHT_UPPER_ARM, { 0.0f, 0.25f, 0.0f },   { 0.0f, -0.4f, 0.0f },   0.2f },
+    { JOINT_RIGHT_LOWER_ARM, { 0.0f, 0.1f, 0.0f },    { 0.0f, -0.1f, 0.0f },   0.2f },
+    { JOINT_RIGHT_CANNON,    { 0.0f, 0.0f, 0.1f },    { 0.0f, 0.0f, 0.4f },    0.2f },
+    { JOINT_LEFT_UPPER_LEG,  { 0.0f, 0.375f, 0.0f },  { 0.0f, -0.375f, 0.0f }, 0.25f },
+    { JOINT_LEFT_LOWER_LEG,  { 0.0f, 0.15f, 0.0f },   { 0.0f, -0.15f, 0.0f },  0.23f },
+    { JOINT_RIGHT_UPPER_LEG, { 0.0f, 0.375f, 0.0f },  { 0.0f, -0.375f, 0.0f }, 0.25f },
+    { JOINT_RIGHT_LOWER_LEG, { 0.0f, 0.15f, 0.0f },   { 0.0f, -0.15f, 0.0f },  0.23f },
+};
+
+// Squared distance between segments p1-q1 and p2-q2; s is where along p1-q1 (0..1) the closest
+// points are (Ericson, Real-Time Collision Detection 5.1.9)
+static float segmentSegmentDistanceSquared(const glm::vec3& p1, const glm::vec3& q1, const glm::vec3& p2, const glm::vec3& q2, float& s) {
+    const float epsilon = 1e-8f;
+    glm::vec3 d1 = q1 - p1, d2 = q2 - p2, r = p1 - p2;
+    float a = glm::dot(d1, d1), e = glm::dot(d2, d2), f = glm::dot(d2, r);
+    float t;
+    if (a <= epsilon && e <= epsilon) {
+        s = t = 0.0f;
+    }
+    else if (a <= epsilon) {
+        s = 0.0f;
+        t = glm::clamp(f / e, 0.0f, 1.0f);
+    }
+    else {
+        float c = glm::dot(d1, r);
+        if (e <= epsilon) {
+            t = 0.0f;
+            s = glm::clamp(-c / a, 0.0f, 1.0f);
+        }
+        else {
+            float b = glm::dot(d1, d2);
+            float denominator = a * e - b * b;
+            s = denominator != 0.0f ? glm::clamp((b * f - c * e) / denominator, 0.0f, 1.0f) : 0.0f;
+            t = (b * s + f) / e;
+            if (t < 0.0f) {
+                t = 0.0f;
+                s = glm::clamp(-c / a, 0.0f, 1.0f);
+            }
+            else if (t > 1.0f) {
+                t = 1.0f;
+                s = glm::clamp((b - c) / a, 0.0f, 1.0f);
+            }
+        }
+    }
+    glm::vec3 offset = (p1 + d1 * s) - (p2 + d2 * t);
+    return glm::dot(offset, offset);
+}
+
+int findLimbHit(int robotIndex, const glm::vec3& from, const glm::vec3& to) {
+    const glm::mat4* joints = robotJoints(robotIndex);
+    const glm::vec3 step = to - from;
+    const float stepSquared = glm::dot(step, step);
+    int hit = -1;
+    float hitAlong = 2.0f;
+    for (int limb = 0; limb < LIMB_COUNT; limb++) {
+        const LimbCapsule& capsule = limbCapsules[limb];
+        const glm::mat4& joint = joints[capsule.joint];
+        glm::vec3 halfAxis = (capsule.b - capsule.a) * 0.5f;
+        glm::vec3 center(joint * glm::vec4(capsule.a + halfAxis, 1.0f));
+        float radius = capsule.radius * scaleRobot; // Joints scale uniformly by scaleRobot
+
+        // Most limbs are nowhere near: reject against the sphere around the capsule first
+        glm::vec3 toCenter = center - from;
+        float t = stepSquared > 0.0f ? glm::clamp(glm::dot(toCenter, step) / stepSquared, 0.0f, 1.0f) : 0.0f;
+        glm::vec3 offset = toCenter - step * t;
+        float reach = glm::length(halfAxis) * scaleRobot + radius;
+        if (glm::dot(offset, offset) >= reach * reach) continue;
+
+        glm::vec3 worldHalfAxis(joint * glm::vec4(halfAxis, 0.0f));
+        float along;
+        if (segmentSegmentDistanceSquared(from, to, center - worldHalfAxis, center + worldHalfAxis, along) < radius * radius && along < hitAlong) {
+            hit = limb;
+            hitAlong = along;
+        }
+    }
+    return hit;
+}
+
+// How far each limb's capsule reaches from its joint's origin, in robot units: a sphere test that
+// needs no matrix product, for the scene queries' first rejection
+struct LimbReach {
+    float reach[LIMB_COUNT];
+    LimbReach() {
+        for (int limb = 0; limb < LIMB_COUNT; limb++) {
+            const LimbCapsule& capsule = limbCapsules[limb];
+            reach[limb] = std::max(glm::length(capsule.a), glm::length(capsule.b)) + capsule.radius;
+        }
+    }
+};
+static const LimbReach limbReach;
+
+// Each limb's capsule as the sphere around its middle, in its joint's space: a robot's box is the
+// box around these
+struct LimbSpheres {
+    glm::vec3 center[LIMB_COUNT];
+    float radius[LIMB_COUNT];
+    LimbSpheres() {
+        for (int limb = 0; limb < LIMB_COUNT; limb++) {
+            const LimbCapsule& capsule = limbCapsules[limb];
+            center[limb] = (capsule.a + capsule.b) * 0.5f;
+            radius[limb] = glm::length(capsule.b - capsule.a) * 0.5f + capsule.radius;
+        }
+    }
+};
+static const LimbSpheres limbSpheres;
+
+// Robots boxed at once by boundRobots(), one per lane of its loops, which the compiler vectorises
+// (evalTrig()'s width, so each angle's cosines and sines are one call)
+const int boundLanes = poseTrigWidth;
+
+// A joint's frame in the robot's own space (before its facing, scale and position), for each
+// lane's robot, while the hierarchy has only rotated it about X, so its X axis is still the
+// robot's: Y is (0, yy, yz) and Z is (0, zy, zz). Every joint but the torso's lean and the
+// cannons' spin is one
+typedef struct LimbFrames {
+    float x[boundLanes], y[boundLanes], z[boundLanes];
+    float yy[boundLanes], yz[boundLanes], zy[boundLanes], zz[boundLanes];
+} LimbFrames;
+
+// Each lane's robot placed in the world, and the box growing around its limbs
+typedef struct LimbBoxes {
+    float posX[boundLanes], posY[boundLanes], posZ[boundLanes];
+    float facingCos[boundLanes], facingSin[boundLanes];
+    float minX[boundLanes], minY[boundLanes], minZ[boundLanes];
+    float maxX[boundLanes], maxY[boundLanes], maxZ[boundLanes];
+} LimbBoxes;
+
+// translateBy and rotateXBy, lane by lane
+static inline void translateFrames(LimbFrames& frames, float x, float y, float z) {
+    for (int i = 0; i < boundLanes; i++) {
+        frames.x[i] += x;
+        frames.y[i] += frames.yy[i] * y + frames.zy[i] * z;
+        frames.z[i] += frames.yz[i] * y + frames.zz[i] * z;
+    }
+}
+
+static inline void rotateFramesX(LimbFrames& frames, const float* c, const float* s, float sign) {
+    for (int i = 0; i < boundLanes; i++) {
+        float yy = frames.yy[i], yz = frames.yz[i], sine = sign * s[i];
+        frames.yy[i] = yy * c[i] + frames.zy[i] * sine;
+        frames.yz[i] = yz * c[i] + frames.zz[i] * sine;
+        frames.zy[i] = frames.zy[i] * c[i] - yy * sine;
+        frames.zz[i] = frames.zz[i] * c[i] - yz * sine;
+    }
+}
+
+// Grows each lane's box by a limb's sphere, centred at (x[i], y[i], z) in the lane's frame
+static inline void boxSphere(LimbBoxes& boxes, const LimbFrames& frames, const float* x, const float* y, float z, float radius) {
+    const float worldRadius = radius * scaleRobot;
+    for (int i = 0; i < boundLanes; i++) {
+        float pointX = frames.x[i] + x[i];
+        float pointY = frames.y[i] + frames.yy[i] * y[i] + frames.zy[i] * z;
+        float pointZ = frames.z[i] + frames.yz[i] * y[i] + frames.zz[i] * z;
+        float worldX = boxes.posX[i] + (pointX * boxes.facingCos[i] + pointZ * boxes.facingSin[i]) * scaleRobot;
+        float worldY = boxes.posY[i] + pointY * scaleRobot;
+        float worldZ = boxes.posZ[i] + (pointZ * boxes.facingCos[i] - pointX * boxes.facingSin[i]) * scaleRobot;
+        // Selects rather than fminf/fmaxf, which would keep the loop from vectorising
+        boxes.minX[i] = worldX - worldRadius < boxes.minX[i] ? worldX - worldRadius : boxes.minX[i];
+        boxes.minY[i] = worldY - worldRadius < boxes.minY[i] ? worldY - worldRadius : boxes.minY[i];
+        boxes.minZ[i] = worldZ - worldRadius < boxes.minZ[i] ? worldZ - worldRadius : boxes.minZ[i];
+        boxes.maxX[i] = worldX + worldRadius > boxes.maxX[i] ? worldX + worldRadius : boxes.maxX[i];
+        boxes.maxY[i] = worldY + worldRadius > boxes.maxY[i] ? worldY + worldRadius : boxes.maxY[i];
+        boxes.maxZ[i] = worldZ + worldRadius > boxes.maxZ[i] ? worldZ + worldRadius : boxes.maxZ[i];
+    }
+}
+
+static inline void boxLimb(LimbBoxes& boxes, const LimbFrames& frames, const glm::vec3& point, float radius) {
+    float x[boundLanes], y[boundLanes];
+    for (int i = 0; i < boundLanes; i++) {
+        x[i] = point.x;
+        y[i] = point.y;
+    }
+    boxSphere(boxes, frames, x, y, point.z, radius);
+}
+
+// Walks the hierarchy as poseRobot() does (keep the two in step) for boundLanes robots at a time,
+// to each limb's sphere centre rather than its joint's matrix
+void boundRobots(int first, int count, glm::vec3* boundsMin, glm::vec3* boundsMax) {
+    const glm::vec3* center = limbSpheres.center;
+    const float* radius = limbSpheres.radius;
+    for (int group = 0; group < count; group += boundLanes) {
+        // A last group short of robots repeats its last one in the spare lanes
+        float angle[POSE_ANGLE_COUNT][poseTrigWidth] = {}, headY[boundLanes], headZ[boundLanes];
+        LimbBoxes boxes;
+        for (int i = 0; i < boundLanes; i++) {
+            int robotIndex = first + std::min(group + i, count - 1);
+            const Robot& robot = robots[robotIndex];
+            const RobotDetail& detail = robotDetails[robotIndex];
+            angle[ANGLE_FALL][i] = detail.upperBodyAngle;
+            angle[ANGLE_LEAN][i] = detail.bodyLeanAngle;
+            angle[ANGLE_ARM][i] = -detail.armAngle;
+            angle[ANGLE_LOWER_ARM][i] = detail.lowerArmAngle;
+            angle[ANGLE_LEG][i] = detail.legAngle;
+            angle[ANGLE_LOWER_LEG][i] = detail.lowerLegAngle;
+            headY[i] = detail.headOffsetY;
+            headZ[i] = detail.headOffsetZ;
+
+            // Facing the camera, as in poseRobot()
+            float dx = cameraX - robot.pos.x, dz = cameraZ - robot.pos.z;
+            float lengthSquared = dx * dx + dz * dz;
+            float inverse = lengthSquared > 0.0f ? 1.0f / sqrtf(lengthSquared) : 0.0f;
+            boxes.facingCos[i] = lengthSquared > 0.0f ? dz * inverse : 1.0f;
+            boxes.facingSin[i] = dx * inverse;
+            boxes.posX[i] = robot.pos.x;
+            boxes.posY[i] = robot.pos.y;
+            boxes.posZ[i] = robot.pos.z;
+            boxes.minX[i] = boxes.minY[i] = boxes.minZ[i] = 1e30f;
+            boxes.maxX[i] = boxes.maxY[i] = boxes.maxZ[i] = -1e30f;
+        }
+        // The cannons' spin is left out: see below
+        float c[POSE_ANGLE_COUNT][poseTrigWidth], s[POSE_ANGLE_COUNT][poseTrigWidth];
+        for (int a = 0; a < ANGLE_SPIN; a++) evalTrig(angle[a], c[a], s[a]);
+
+        const float fallPivot = 0.4f * scaleRobot;
+        LimbFrames root;
+        for (int i = 0; i < boundLanes; i++) {
+            root.x[i] = root.y[i] = root.z[i] = 0.0f;
+            root.yy[i] = root.zz[i] = 1.0f;
+            root.yz[i] = root.zy[i] = 0.0f;
+        }
+        LimbFrames upper = root;
+        translateFrames(upper, 0.0f, -fallPivot, 0.0f);
+        rotateFramesX(upper, c[ANGLE_FALL], s[ANGLE_FALL], 1.0f);
+        translateFrames(upper, 0.0f, fallPivot, 0.0f);
+
+        LimbFrames head = upper;
+        for (int i = 0; i < boundLanes; i++) {
+            head.y[i] += head.yy[i] * headY[i] + head.zy[i] * headZ[i];
+            head.z[i] += head.yz[i] * headY[i] + head.zz[i] * headZ[i];
+        }
+        boxLimb(boxes, head, center[LIMB_HEAD], radius[LIMB_HEAD]);
+
+        // The lean turns the torso's X and Y axes about Z: its point (x, y) is (x c - y s, x s + y c)
+        // along the upper body's
+        const glm::vec3& torso = center[LIMB_TORSO];
+        float torsoX[boundLanes], torsoY[boundLanes];
+        for (int i = 0; i < boundLanes; i++) {
+            torsoX[i] = torso.x * c[ANGLE_LEAN][i] - torso.y * s[ANGLE_LEAN][i];
+            torsoY[i] = torso.x * s[ANGLE_LEAN][i] + torso.y * c[ANGLE_LEAN][i];
+        }
+        boxSphere(boxes, upper, torsoX, torsoY, torso.z, radius[LIMB_TORSO]);
+
+        const float armDownC[boundLanes] = {}, armDownS[boundLanes] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+        for (int side = 0; side < 2; side++) {
+            bool isLeft = side == 0;
+            float direction = isLeft ? -1.0f : 1.0f;
+            float mirror = isLeft ? 1.0f : -1.0f;
+            int armBase = isLeft ? LIMB_LEFT_UPPER_ARM : LIMB_RIGHT_UPPER_ARM;
+            int legBase = isLeft ? LIMB_LEFT_UPPER_LEG : LIMB_RIGHT_UPPER_LEG;
+
+            LimbFrames upperArm = upper;
+            translateFrames(upperArm, 0.85f * direction, 0.65f, 0.0f);
+            if (isLeft) rotateFramesX(upperArm, armDownC, armDownS, -1.0f);
+            else rotateFramesX(upperArm, c[ANGLE_ARM], s[ANGLE_ARM], 1.0f);
+            translateFrames(upperArm, 0.0f, -0.25f, 0.0f);
+            boxLimb(boxes, upperArm, center[armBase], radius[armBase]);
+
+            LimbFrames lowerArm = upperArm;
+            translateFrames(lowerArm, 0.0f, -0.7f, 0.0f);
+            rotateFramesX(lowerArm, c[ANGLE_LOWER_ARM], s[ANGLE_LOWER_ARM], mirror);
+            translateFrames(lowerArm, 0.0f, -0.1f, 0.0f);
+            boxLimb(boxes, lowerArm, center[armBase + 1], radius[armBase + 1]);
+
+            // The cannon spins about its barrel, the lower arm's -Y once turned 90 about X, and its
+            // sphere's centre is on the barrel: the spin never moves it
+            boxLimb(boxes, lowerArm, glm::vec3(0.0f, -center[armBase + 2].z, 0.0f), radius[armBase + 2]);
+
+            LimbFrames upperLeg = root;
+            translateFrames(upperLeg, 0.4f * direction, -1.125f, 0.0f);
+            rotateFramesX(upperLeg, c[ANGLE_LEG], s[ANGLE_LEG], mirror);
+            translateFrames(upperLeg, 0.0f, -0.375f, 0.0f);
+            boxLimb(boxes, upperLeg, center[legBase], radius[legBase]);
+
+            LimbFrames lowerLeg = upperLeg;
+            translateFrames(lowerLeg, 0.0f, -0.75f, 0.0f);
+            rotateFramesX(lowerLeg, c[ANGLE_LOWER_LEG], s[ANGLE_LOWER_LEG], mirror);
+            translateFrames(lowerLeg, 0.0f, -0.25f, 0.0f);
+            boxLimb(boxes, lowerLeg, center[legBase + 1], radius[legBase + 1]);
+        }
+
+        for (int i = 0; i < boundLanes && group + i < count; i++) {
+            boundsMin[group + i] = glm::vec3(boxes.minX[i], boxes.minY[i], boxes.minZ[i]);
+            boundsMax[group + i] = glm::vec3(boxes.maxX[i], boxes.maxY[i], boxes.maxZ[i]);
+        }
+    }
+}
+
+// Squared distance from p to the segment a-b
+static float segmentPointDistanceSquared(const glm::vec3& a, const glm::vec3& b, const glm::vec3& p) {
+    glm::vec3 ab = b - a;
+    float lengthSquared = glm::dot(ab, ab);
+    float t = lengthSquared > 0.0f ? glm::clamp(glm::dot(p - a, ab) / lengthSquared, 0.0f, 1.0f) : 0.0f;
+    glm::vec3 offset = a + ab * t - p;
+    return glm::dot(offset, offset);
+}
+
+// Distance along the ray to the sphere, or -1; the origin is outside it
+static float raySphere(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& center, float radius) {
+    glm::vec3 toOrigin = origin - center;
+    float b = glm::dot(dir, toOrigin);
+    float h = b * b - (glm::dot(toOrigin, toOrigin) - radius * radius);
+    if (h < 0.0f || b > 0.0f) return -1.0f;
+    return -b - sqrtf(h);
+}
+
+// Distance along the ray to the capsule a-b, or -1: the cylinder between the caps, then the cap on
+// the side the ray reaches (Quilez). The origin is outside the capsule
+static float rayCapsule(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& a, const glm::vec3& b, float radius) {
+    glm::vec3 axis = b - a, fromA = origin - a;
+    float axisAxis = glm::dot(axis, axis);
+    float axisDir = glm::dot(axis, dir);
+    float axisFromA = glm::dot(axis, fromA);
+    float qa = axisAxis - axisDir * axisDir;
+    if (qa <= 1e-6f * axisAxis) { // Along the axis: only the caps can be hit first
+        float first = raySphere(origin, dir, a, radius), second = raySphere(origin, dir, b, radius);
+        return first < 0.0f ? second : (second < 0.0f ? first : std::min(first, second));
+    }
+    float qb = axisAxis * glm::dot(dir, fromA) - axisFromA * axisDir;
+    float qc = axisAxis * glm::dot(fromA, fromA) - axisFromA * axisFromA - radius * radius * axisAxis;
+    float h = qb * qb - qa * qc;
+    if (h < 0.0f) return -1.0f;
+    float t = (-qb - sqrtf(h)) / qa;
+    float along = axisFromA + t * axisDir;
+    if (along > 0.0f && along < axisAxis) return t >= 0.0f ? t : -1.0f;
+    return raySphere(origin, dir, along <= 0.0f ? a : b, radius);
+}
+
+float raycastLimbs(int robotIndex, const glm::vec3& origin, const glm::vec3& dir, float maxDistance, int& limb) {
+    const glm::mat4* joints = robotJoints(robotIndex);
+    float nearest = maxDistance;
+    limb = -1;
+    for (int l = 0; l < LIMB_COUNT; l++) {
+        const LimbCapsule& capsule = limbCapsules[l];
+        const glm::mat4& joint = joints[capsule.joint];
+        glm::vec3 toJoint = glm::vec3(joint[3]) - origin;
+        glm::vec3 offset = toJoint - dir * glm::clamp(glm::dot(toJoint, dir), 0.0f, nearest);
+        float reach = limbReach.reach[l] * scaleRobot;
+        if (glm::dot(offset, offset) >= reach * reach) continue;
+
+        glm::vec3 a(joint * glm::vec4(capsule.a, 1.0f));
+        glm::vec3 b(joint * glm::vec4(capsule.b, 1.0f));
+        float radius = capsule.radius * scaleRobot;
+        float t = segmentPointDistanceSquared(a, b, origin) < radius * radius ? 0.0f : rayCapsule(origin, dir, a, b, radius);
+        if (t >= 0.0f && (t < nearest || (t == nearest && limb < 0))) {
+            nearest = t;
+            limb = l;
+        }
+    }
+    return limb >= 0 ? nearest : -1.0f;
+}
+
+float limbSurfaceDistance(int robotIndex, const glm::vec3& point, float within, int& limb) {
+    const glm::mat4* joints = robotJoints(robotIndex);
+    float nearest = within;
+    limb = -1;
+    for (int l = 0; l < LIMB_COUNT; l++) {
+        const LimbCapsule& capsule = limbCapsules[l];
+        const glm::mat4& joint = joints[capsule.joint];
+        glm::vec3 fromJoint = point - glm::vec3(joint[3]);
+        float reach = nearest + limbReach.reach[l] * scaleRobot;
+        if (glm::dot(fromJoint, fromJoint) > reach * reach) continue;
+
+        glm::vec3 a(joint * glm::vec4(capsule.a, 1.0f));
+        glm::vec3 b(joint * glm::vec4(capsule.b, 1.0f));
+        float distance = std::max(sqrtf(segmentPointDistanceSquared(a, b, point)) - capsule.radius * scaleRobot, 0.0f);
+        if (distance < nearest || (distance == nearest && limb < 0)) {
+            nearest = distance;
+            limb = l;
+        }
+    }
+    return limb >= 0 ? nearest : -1.0f;
+}
+
+int limbWithin(int robotIndex, const glm::vec3& point, float within) {
+    const glm::mat4* joints = robotJoints(robotIndex);
+    for (int l = 0; l < LIMB_COUNT; l++) {
+        const LimbCapsule& capsule = limbCapsules[l];
+        const glm::mat4& joint = joints[capsule.joint];
+        glm::vec3 fromJoint = point - glm::vec3(joint[3]);
+        float reach = within + limbReach.reach[l] * scaleRobot;
+        if (glm::dot(fromJoint, fromJoint) >= reach * reach) continue;
+
+        glm::vec3 a(joint * glm::vec4(capsule.a, 1.0f));
+        glm::vec3 b(joint * glm::vec4(capsule.b, 1.0f));
+        if (std::max(sqrtf(segmentPointDistanceSquared(a, b, point)) - capsule.radius * scaleRobot, 0.0f) < within) return l;
+    }
+    return -1;
+}
@@ -0,0 +1,88 @@
+#pragma once
+// CPU pose for the robots
+// Computes the world matrix of every joint of a robot, replacing the glTranslatef/glRotatef/
+// glScalef chains in drawBot/drawArm/drawLeg. The sim poses a robot only when a hit test first
+// reads its joints after it last moved, so the robots nothing reaches cost nothing (the scene tree
+// boxes robots without posing them); the renderer poses the robots it draws from its snapshot
+// with the same poseRobot(), so what is drawn is what gets hit.
+//
+// Hit-testing uses one capsule per limb, fixed in its joint's space and sized to what drawBot
+// draws there, so it follows the animation exactly. A sphere around the whole robot (any pose)
+// rejects nearly every bullet before any joint matrix is read.
+#include <glm/glm.hpp>
+
+struct Robot;
+struct RobotDetail;
+
+// Joints of the robot hierarchy (parents listed before children)
+enum RobotJoint {
+    JOINT_ROOT,            // Position, facing the camera, robot scale
+    JOINT_UPPER_BODY,      // Pivot for the forward fall when defeated
+    JOINT_HEAD,            // Head (falls off when defeated)
+    JOINT_TORSO,           // Body and jetpack, with the walking lean
+    JOINT_LEFT_UPPER_ARM,
+    JOINT_LEFT_LOWER_ARM,
+    JOINT_LEFT_CANNON,
+    JOINT_RIGHT_UPPER_ARM,
+    JOINT_RIGHT_LOWER_ARM,
+    JOINT_RIGHT_CANNON,
+    JOINT_LEFT_UPPER_LEG,
+    JOINT_LEFT_LOWER_LEG,
+    JOINT_RIGHT_UPPER_LEG,
+    JOINT_RIGHT_LOWER_LEG,
+    JOINT_COUNT
+};
+
+// Parts a bullet can hit
+enum RobotLimb {
+    LIMB_HEAD,
+    LIMB_TORSO,
+    LIMB_LEFT_UPPER_ARM,
+    LIMB_LEFT_LOWER_ARM,
+    LIMB_LEFT_CANNON,
+    LIMB_RIGHT_UPPER_ARM,
+    LIMB_RIGHT_LOWER_ARM,
+    LIMB_RIGHT_CANNON,
+    LIMB_LEFT_UPPER_LEG,
+    LIMB_LEFT_LOWER_LEG,
+    LIMB_RIGHT_UPPER_LEG,
+    LIMB_RIGHT_LOWER_LEG,
+    LIMB_COUNT
+};
+
+// Bounding sphere of a robot in any pose, in robot units (times scaleRobot in the world), centred
+// at pos offset by robotBoundsCenterY vertically
+const float robotBoundsCenterY = -0.2f;
+const float robotBoundsRadius = 2.8f;
+
+// Writes the robot's JOINT_COUNT joint matrices, facing it towards (eyeX, eyeZ)
+void poseRobot(const Robot& robot, const RobotDetail& detail, float eyeX, float eyeZ, glm::mat4* joints);
+
+// The robots moved, animated or were replaced: each is posed again the next time its joints are
+// read. Called where nothing is reading them (between the tick's job graph stages, after loading)
+void invalidateRobotPoses();
+
+// The robot's joint matrices as it is now (JOINT_COUNT, by RobotJoint), posing it first if it
+// is the first read since invalidateRobotPoses(). Job threads may read the same robot at once
+const glm::mat4* robotJoints(int robotIndex);
+
+// The boxes around the limb capsules of robots [first, first + count) as they stand now, what
+// their robotJoints() would give, worked out without posing them (into boundsMin/Max[0, count)):
+// the scene tree's boxes, refitted every tick there are queries
+void boundRobots(int first, int count, glm::vec3* boundsMin, glm::vec3* boundsMax);
+
+// The limb whose capsule the segment from -> to passes through (the one it reaches first, if
+// several), or -1. Reads the robot's current joint matrices
+int findLimbHit(int robotIndex, const glm::vec3& from, const glm::vec3& to);
+
+// Distance along the ray (dir unit length) to where it first enters a limb, if within maxDistance,
+// or -1; limb is set to that limb. 0 when the origin is inside one
+float raycastLimbs(int robotIndex, const glm::vec3& origin, const glm::vec3& dir, float maxDistance, int& limb);
+
+// Distance from point to the surface of the nearest limb (0 inside it), if within `within`, or -1;
+// limb is set to that limb
+float limbSurfaceDistance(int robotIndex, const glm::vec3& point, float within, int& limb);
+
+// A limb whose surface is closer than `within` to point, or -1: overlap tests, which stop at the
+// first one rather than looking for the nearest
+int limbWithin(int robotIndex, const glm::vec3& point, float within);
@@ -0,0 +1,1373 @@
+#include <GL/glew.h> // Buffer objects (must come before the other GL headers)
+#include <GL/glu.h>
+#include <SOIL.h> // Include SOIL for texture loading
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include "render.h"
+#include "pose.h"
+#include "mesh.h"
+#include "alloctrack.h"
+#include "framepacing.h"
+#include "hud.h"
+#include "latency.h"
+#include "lights.h"
+#include "particles.h"
+#include "renderprep.h"
+#include "staticbatch.h"
+
+#ifndef GL_INT_2_10_10_10_REV
+#define GL_INT_2_10_10_10_REV 0x8D9F // GL 3.3 packed normals; the Windows gl.h stops at 1.1
+#endif
+
+// Texture IDs
+GLuint planeTexture;
+GLuint wallTexture;
+GLuint robotTexture;
+GLuint gunTexture;
+GLuint cannonTexture;
+GLuint beltTexture;
+
+//// Mesh importing stuff
+// The imported mesh, built once by loadMesh()
+Mesh importedMesh;
+bool meshImported = false;
+
+//// Static arena geometry
+// Floor and walls, built once by buildArena() and drawn with one call per material
+enum ArenaMaterial { MATERIAL_FLOOR, MATERIAL_WALL, NUM_ARENA_MATERIALS };
+GLuint arenaTextures[NUM_ARENA_MATERIALS];
+StaticBatch arenaBatch;
+GLuint arenaVertexBuffer = 0; // 0 when buffer objects are unavailable: drawn from arenaBatch's arrays
+GLuint arenaIndexBuffer = 0;
+const float arenaCellSize = 2.0f; // Tessellation of the floor and walls, in world units
+
+//// HUD
+// Crosshair and perf panel, queued through hud.h and drawn in one call by drawHud()
+GLuint hudTexture;
+GLuint hudBuffer = 0; // 0 when buffer objects are unavailable: drawn from hudVertices()
+bool showPerfPanel = false; // Toggled with F3
+int windowWidth = 1920, windowHeight = 1080; // Set by resizeRenderer()
+int drawCalls = 0; // Draw submissions this frame (a GLU shape counts as one)
+const int perfHistoryFrames = 120;
+float frameTimesMs[perfHistoryFrames]; // Ring of recent present-to-present times
+int frameTimeNext = 0, frameTimeCount = 0;
+uint64_t frameAllocations = 0; // new on this thread between the last two renderFrame() calls (alloctrack.h)
+uint64_t frameAllocationsMark = 0;
+
+//// Particles
+// Camera-facing quads drawn instanced from particles.h's instances, one draw per material
+GLuint particleProgram = 0; // 0 when instancing or shaders are unavailable: particles aren't drawn
+GLuint particleCornerBuffer = 0;
+GLuint particleInstanceBuffer = 0;
+bool coreInstancing = false; // GL 3.3 entry points, else the ARB extensions'
+enum ParticleAttribute { ATTRIBUTE_CORNER, ATTRIBUTE_CENTER, ATTRIBUTE_COLOR };
+
+//// Lighting
+// Clustered point lights (lights.h) on the arena and the robots, shaded by litProgram from three
+// float textures the grid is uploaded to each frame. 0 without GL 3.0 (float textures, GLSL 1.30):
+// everything is drawn unlit, as it is in a frame with no lights on screen
+GLuint litProgram = 0;
+GLuint lightTexture = 0;      // Two texels per light: eye-space position and radius, then color
+GLuint clusterTexture = 0;    // First index and count per cluster: x is the tile, y the slice
+GLuint lightIndexTexture = 0; // The clusters' light indices
+GLint litTileScaleUniform = -1, litSliceUniform = -1;
+const int lightTextureShift = 10;
+const int lightTextureWidth = 1 << lightTextureShift; // Texels per row of the light and index textures
+LightClusters lightClusters;
+bool lightingOn = false;      // Lights on screen this frame
+bool litProgramBound = false;
+int frameLights = 0;
+
+// This frame's aim: the snapshot's camera angles plus the looks the sim hasn't applied yet (set by setCamera())
+float aimAngleH = 0.0f, aimAngleV = 0.0f;
+
+// One quadric for every GLU shape (solid, smooth normals, textured), created by initRenderer() so
+// drawing a shape never allocates
+GLUquadric* quadric = nullptr;
+
+// Render items for the current frame (culled, LOD-selected and sorted by renderprep)
+std::vector<RenderItem> renderItems;
+int detailLevel = 0; // LOD of the item being drawn: each level halves sphere/cylinder tessellation
+float windowAspect = 1920.0f / 1080.0f;
+
+
+// Function Declarations
+GLuint loadTexture(const char* fileName);
+void buildArena();
+void drawArena();
+void bindPackedVertices(const char* base);
+void unbindPackedVertices();
+void drawBullet(const Bullet& bullet);
+void drawCannon(const SimSnapshot& snapshot);
+void buildHud();
+void drawHud(const SimSnapshot& snapshot);
+void buildParticles();
+void drawParticles();
+void buildLighting();
+void uploadLights(const SimSnapshot& snapshot, const RenderView& view);
+void setLighting(bool lit);
+void drawSphere(const Sphere& sphere);
+void drawHitFlash(const Robot& robot);
+void drawRenderItems(const SimSnapshot& snapshot);
+void setCamera(const SimSnapshot& snapshot);
+
+void drawMesh();
+void loadMesh();
+
+
+void drawBot(const RobotDetail& detail, const glm::mat4* joints);
+void drawHead();
+void drawNeck(const glm::mat4* joints);
+void drawBody(const glm::mat4* joints);
+void drawArm(bool isLeft, const RobotDetail& detail, const glm::mat4* joints);
+void drawLeg(bool isLeft, const glm::mat4* joints);
+void drawCube(float width, float height, float depth);
+void drawSolidCube(float size);
+void drawSolidSphere(float radius, int slices, int stacks);
+void drawCylinder(float radius, float height, int slices);
+void drawTrapezoid(float topWidth, float bottomWidth, float height, float depth);
+
+
+// Function Definitions
+
+// Function to load a texture
+GLuint loadTexture(const char* fileName) {
+    GLuint tex;
+    tex = SOIL_load_OGL_texture(
+        fileName,
+        SOIL_LOAD_AUTO,
+        SOIL_CREATE_NEW_ID,
+        SOIL_FLAG_MIPMAPS | SOIL_FLAG_INVERT_Y | SOIL_FLAG_TEXTURE_REPEATS
+    );
+
+    if (!tex) {
+        printf("SOIL loading error: '%s'\n", SOIL_last_result());
+    }
+
+    glBindTexture(GL_TEXTURE_2D, tex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    return tex;
+}
+
+// Points the fixed-function arrays at packed MeshVertex records, either in memory or at an offset
+// into the bound GL_ARRAY_BUFFER (base null), and scales their fixed-point texture coords back
+void bindPackedVertices(const char* base) {
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+    glVertexPointer(3, GL_FLOAT, sizeof(MeshVertex), base + offsetof(MeshVertex, x));
+    glNormalPointer(GL_INT_2_10_10_10_REV, sizeof(MeshVertex), base + offsetof(MeshVertex, normal));
+    glTexCoordPointer(2, GL_SHORT, sizeof(MeshVertex), base + offsetof(MeshVertex, s));
+
+    glMatrixMode(GL_TEXTURE);
+    glPushMatrix();
+    glLoadIdentity();
+    glScalef(1.0f / meshUvScale, 1.0f / meshUvScale, 1.0f);
+    glMatrixMode(GL_MODELVIEW);
+}
+
+void unbindPackedVertices() {
+    glMatrixMode(GL_TEXTURE);
+    glPopMatrix();
+    glMatrixMode(GL_MODELVIEW);
+
+    glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+    glDisableClientState(GL_NORMAL_ARRAY);
+    glDisableClientState(GL_VERTEX_ARRAY);
+}
+
+// Tessellates the floor and walls into the static batch and uploads it (at level load)
+void buildArena() {
+    const float size = (float)planeSize;
+    arenaTextures[MATERIAL_FLOOR] = planeTexture;
+    arenaTextures[MATERIAL_WALL] = wallTexture;
+
+    // The texture spans each surface once, as it did when they were single quads
+    StaticSurface floor = { glm::vec3(-size, 0.0f, -size), glm::vec3(2.0f * size, 0.0f, 0.0f), glm::vec3(0.0f, 0.0f, 2.0f * size), glm::vec3(0.0f, 1.0f, 0.0f) };
+    StaticSurface frontWall = { glm::vec3(-size, 0.0f, -size), glm::vec3(2.0f * size, 0.0f, 0.0f), glm::vec3(0.0f, size, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+    StaticSurface backWall = { glm::vec3(-size, 0.0f, size), glm::vec3(2.0f * size, 0.0f, 0.0f), glm::vec3(0.0f, size, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f) };
+    StaticSurface leftWall = { glm::vec3(-size, 0.0f, -size), glm::vec3(0.0f, 0.0f, 2.0f * size), glm::vec3(0.0f, size, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f) };
+    StaticSurface rightWall = { glm::vec3(size, 0.0f, -size), glm::vec3(0.0f, 0.0f, 2.0f * size), glm::vec3(0.0f, size, 0.0f), glm::vec3(-1.0f, 0.0f, 0.0f) };
+
+    addStaticSurface(arenaBatch, MATERIAL_FLOOR, floor, arenaCellSize);
+    addStaticSurface(arenaBatch, MATERIAL_WALL, frontWall, arenaCellSize);
+    addStaticSurface(arenaBatch, MATERIAL_WALL, backWall, arenaCellSize);
+    addStaticSurface(arenaBatch, MATERIAL_WALL, leftWall, arenaCellSize);
+    addStaticSurface(arenaBatch, MATERIAL_WALL, rightWall, arenaCellSize);
+    finishStaticBatch(arenaBatch);
+
+    if (!GLEW_VERSION_1_5) return;
+    glGenBuffers(1, &arenaVertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, arenaVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, arenaBatch.vertices.size() * sizeof(MeshVertex), arenaBatch.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenBuffers(1, &arenaIndexBuffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arenaIndexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, arenaBatch.indices.size() * sizeof(uint32_t), arenaBatch.indices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// Draws the floor and walls: one call per material
+void drawArena() {
+    glEnable(GL_TEXTURE_2D);
+    glColor3f(1.0f, 1.0f, 1.0f); // White to show texture colors
+
+    const char* vertexBase = nullptr;
+    const char* indexBase = nullptr;
+    if (arenaVertexBuffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, arenaVertexBuffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, arenaIndexBuffer);
+    }
+    else {
+        vertexBase = (const char*)arenaBatch.vertices.data();
+        indexBase = (const char*)arenaBatch.indices.data();
+    }
+
+    bindPackedVertices(vertexBase);
+    for (const StaticRange& range : arenaBatch.ranges) {
+        glBindTexture(GL_TEXTURE_2D, arenaTextures[range.material]);
+        glDrawElements(GL_TRIANGLES, (GLsizei)range.indexCount, GL_UNSIGNED_INT, indexBase + range.firstIndex * sizeof(uint32_t));
+        drawCalls++;
+    }
+    unbindPackedVertices();
+
+    if (arenaVertexBuffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    }
+    glDisable(GL_TEXTURE_2D);
+}
+
+// Tessellation for the current detail level (never below 4)
+int lodSlices(int slices) {
+    return std::max(slices >> detailLevel, 4);
+}
+
+// Function to draw a bullet
+void drawBullet(const Bullet& bullet) {
+    glColor3f(1.0f, 1.0f, 0.0f); // Yellow color for bullets
+    glPushMatrix();
+    glTranslatef(bullet.x, bullet.y, bullet.z);
+    drawSolidSphere(0.2f, 16, 16); // Draw bullet as a small sphere
+    glPopMatrix();
+}
+
+// Function to draw a sphere
+void drawSphere(const Sphere& sphere) {
+    glColor3f(1.0f, 0.0f, 0.0f); // Red color for spheres
+    glPushMatrix();
+    glTranslatef(sphere.x, sphere.y, sphere.z);
+    drawSolidSphere(0.3f, 32, 32); // Draw sphere
+    glPopMatrix();
+}
+
+void drawCannon(const SimSnapshot& snapshot) {
+    glPushMatrix();
+
+    // Position the cannon higher on the screen
+    glTranslatef(snapshot.cameraX, snapshot.cameraY - 0.5f, snapshot.cameraZ);
+    glRotatef(-aimAngleH * 180.0f / M_PI, 0.0f, 1.0f, 0.0f);
+    glRotatef(aimAngleV * 180.0f / M_PI, 1.0f, 0.0f, 0.0f);
+    glTranslatef(0.0f, -0.5f, -2.5f);
+
+    // Rotate cannon (will rotate downward if disabled)
+    glRotatef(snapshot.cannonAngle, 1.0f, 0.0f, 0.0f);
+
+    // Draw base of the cannon (with texture)
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, gunTexture); // Bind 'rough.png'
+
+    glColor3f(1.0f, 1.0f, 1.0f); // White to display the texture properly
+    gluCylinder(quadric, 0.2f, 0.2f, 2.0f, 32, 32);
+    drawCalls++;
+    glDisable(GL_TEXTURE_2D); // Disable texture for other parts
+
+    // Draw the cannon barrel (with muzzle texture)
+    glTranslatef(0.0f, 0.0f, -2.0f);  // Move to position for the barrel
+    glBindTexture(GL_TEXTURE_2D, cannonTexture);  // Bind muzzle texture
+    glEnable(GL_TEXTURE_2D);  // Enable texturing
+
+    glColor3f(1.0f, 1.0f, 1.0f); // White to properly display the texture
+    gluCylinder(quadric, 0.1f, 0.1f, 3.0f, 32, 32);  // Draw barrel with the new texture
+    drawCalls++;
+
+    glDisable(GL_TEXTURE_2D); // Disable texture after drawing barrel
+
+    // Draw the scope for the cannon
+    glPushMatrix();
+    glTranslatef(0.0f, 0.2f, 1.0f); // Position the scope above the barrel
+    glColor3f(0.3f, 0.3f, 0.3f); // Darker grey color for the scope
+
+    // Draw the scope cylinder
+    gluCylinder(quadric, 0.05f, 0.05f, 1.0f, 32, 32); // Increase slices for smoother look
+    drawCalls++;
+
+    // Draw the scope lens (front)
+    glPushMatrix();
+    glTranslatef(0.0f, 0.0f, 1.0f);
+    glColor3f(0.1f, 0.1f, 0.1f); // Dark color for the lens
+    gluDisk(quadric, 0.0f, 0.05f, 32, 1); // Draw a disk at the end of the scope with higher slices
+    drawCalls++;
+    glPopMatrix();
+
+    // Draw the back lens of the scope
+    glPushMatrix();
+    glTranslatef(0.0f, 0.0f, -0.05f); // Slightly behind the start of the scope
+    glColor3f(0.1f, 0.1f, 0.1f); // Same color for the back lens
+    gluDisk(quadric, 0.0f, 0.05f, 32, 1); // Draw a disk at the back of the scope
+    drawCalls++;
+    glPopMatrix();
+
+    // Add details to make the scope more realistic
+    glPushMatrix();
+    glTranslatef(0.0f, 0.08f, 0.5f); // Position the adjustment knob on top of the scope
+    glColor3f(0.2f, 0.2f, 0.2f); // Darker grey for the knob
+    gluCylinder(quadric, 0.02f, 0.02f, 0.1f, 16, 16); // Draw the adjustment knob
+    drawCalls++;
+    glTranslatef(0.0f, 0.0f, 0.1f);
+    gluDisk(quadric, 0.0f, 0.02f, 16, 1); // Cap the knob with a disk
+    drawCalls++;
+    glPopMatrix();
+
+    glPopMatrix();
+
+    // Render the imported mesh with robotTexture
+    if (!meshImported) {
+        loadMesh(); // Ensure the mesh is loaded
+        meshImported = true;
+    }
+
+    glPushMatrix();
+    // Position and scale the mesh appropriately relative to the cannon
+    glTranslatef(0.0f, -3.0f, 1.0f); // Adjust position as needed
+    glScalef(0.51f, 0.51f, 0.51f);  // Adjust scale as needed
+
+    // Enable texturing and bind the robotTexture
+    glEnable(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, beltTexture); // Bind the robot texture
+
+
+    glColor3f(1.0f, 1.0f, 1.0f); // White to properly display the texture
+    drawMesh(); // Render the imported mesh with the new texture
+
+    // Disable texturing after rendering
+    glDisable(GL_TEXTURE_2D);
+    glPopMatrix();
+
+    glPopMatrix();
+}
+
+
+
+// Submits the frame's render items in sorted order (robots, lit, then hit flashes, spheres, bullets)
+void drawRenderItems(const SimSnapshot& snapshot) {
+    for (const RenderItem& item : renderItems) {
+        detailLevel = item.lod;
+        setLighting(item.kind == ITEM_ROBOT);
+        switch (item.kind) {
+        case ITEM_ROBOT: {
+            // Posed from the snapshot as the sim poses it for hit tests, facing the snapshot's camera
+            glm::mat4 joints[JOINT_COUNT];
+            poseRobot(snapshot.robots[item.index], snapshot.robotDetails[item.index], snapshot.cameraX, snapshot.cameraZ, joints);
+            drawBot(snapshot.robotDetails[item.index], joints);
+            break;
+        }
+        case ITEM_HIT_FLASH:
+            drawHitFlash(snapshot.robots[item.index]);
+            break;
+        case ITEM_SPHERE:
+            drawSphere(snapshot.spheres[item.index]);
+            break;
+        case ITEM_BULLET:
+            drawBullet(snapshot.bullets[item.index]);
+            break;
+        }
+    }
+    setLighting(false);
+    detailLevel = 0;
+}
+
+// Create "red flash" briefly when robot is hit
+// Draws flash independently of the robot being active so it persists after it dies
+void drawHitFlash(const Robot& robot) {
+    glPushMatrix();
+    glColor3f(1.0f, 0.0f, 0.0f); // Red color for spheres
+
+    glTranslatef(robot.pos.x, robot.pos.y, robot.pos.z);
+    drawSolidSphere(robotRadius(), 32, 32); // Draw sphere
+    glPopMatrix();
+}
+
+// Multiplies a joint's world matrix onto the current (camera) modelview
+void applyJoint(const glm::mat4& joint) {
+    glMultMatrixf(glm::value_ptr(joint));
+}
+
+void drawBot(const RobotDetail& detail, const glm::mat4* joints) {
+    glEnable(GL_TEXTURE_2D); // Enable texturing
+    glBindTexture(GL_TEXTURE_2D, robotTexture); // Bind robot texture
+
+    //glEnable(GL_BLEND); // Get transparency for texture
+    //glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    // Adjust colors based on rednessFactor
+    float baseRed = 1.0f, baseGreen = 0.55f, baseBlue = 0.0f;
+    float red = baseRed + detail.rednessFactor;
+    float green = baseGreen - detail.rednessFactor * 0.2f; // Slightly desaturate green
+    float blue = baseBlue - detail.rednessFactor * 0.2f;  // Slightly desaturate blue
+
+    // Clamp the colors to avoid overflow
+    red = std::min(red, 1.0f);
+    green = std::max(green, 0.0f);
+    blue = std::max(blue, 0.0f);
+
+    glColor3f(red, green, blue);
+
+    // Head falls off and the upper body rotates forwards when defeated (baked into the joints)
+    glPushMatrix();
+    applyJoint(joints[JOINT_HEAD]);
+    drawHead();
+    glPopMatrix();
+
+    drawNeck(joints);
+    drawBody(joints);
+    drawArm(true, detail, joints);
+    drawArm(false, detail, joints);
+    drawLeg(true, joints);
+    drawLeg(false, joints);
+
+    //glDisable(GL_BLEND);
+    glDisable(GL_TEXTURE_2D); // Disable texturing after
+}
+
+
+void drawHead() {
+    // Draw Head - Bottom part (Cube)
+    glPushMatrix();
+        glColor3f(1.0f, 0.55f, 0.0f);
+        glTranslatef(0.0f, 1.3f, 0.0f);
+        glScalef(1.05f, 1.0f, 1.05f);
+        drawCube(1.0f, 1.0f, 1.0f);
+    glPopMatrix();
+
+    // Draw Head - Top part (Sphere)
+    glPushMatrix();
+        glColor3f(1.0f, 0.6f, 0.0f);
+        glTranslatef(0.0f, 1.85f, 0.0f);
+        drawSolidSphere(0.6f, 20, 20);
+    glPopMatrix();
+
+    // Draw Ears + Antennas
+    for (int i = -1; i <= 1; i += 2) {
+        // Ears
+        glPushMatrix();
+            glColor3f(0.9f, 0.45f, 0.0f);
+            glTranslatef(i * 0.6f, 1.5f, 0.0f);
+            glScalef(0.2f, 0.3f, 0.05f);
+            drawCube(0.5f, 1.0f, 4.0f);
+        glPopMatrix();
+
+        // Antennas
+        glPushMatrix();
+            glColor3f(0.7f, 0.3f, 0.0f);
+            glTranslatef(i * 0.6f, 2.3f, -0.5f);
+            glRotatef(60, 1.0f, 0.0f, 0.0f);
+            drawCylinder(0.05f, 1.0f, 10);
+        glPopMatrix();
+    }
+
+    // Draw Screen and Visor
+    glPushMatrix();
+        glColor3f(0.0f, 0.0f, 0.0f);
+        glTranslatef(0.0f, 1.4f, 0.54f);
+        glScalef(0.8f, 0.5f, 0.05f);
+        drawCube(1.0f, 1.0f, 1.0f);
+    glPopMatrix();
+
+    glPushMatrix();
+        glColor3f(1.0f, 0.5f, 0.0f);
+        glTranslatef(0.0f, 1.8f, 0.8f);
+        glScalef(1.2f, 0.1f, 0.5f);
+        drawCube(1.0f, 1.0f, 1.0f);
+    glPopMatrix();
+}
+
+void drawNeck(const glm::mat4* joints) {
+    glPushMatrix();
+        applyJoint(joints[JOINT_UPPER_BODY]);
+        glColor3f(0.0f, 0.0f, 0.0f);
+        glTranslatef(0.0f, 0.95f, 0.0f);
+        glRotatef(90, 1.0f, 0.0f, 0.0f);
+        drawCylinder(0.2f, 0.3f, 20);
+    glPopMatrix();
+}
+
+void drawBody(const glm::mat4* joints) {
+    // leaning (baked into the torso joint)
+    glPushMatrix();
+        applyJoint(joints[JOINT_TORSO]);
+
+        // Draw Body and jetpack
+        glPushMatrix();
+            glColor3f(1.0f, 0.55f, 0.0f);
+            glTranslatef(0.0f, 0.2f, 0.0f);
+            drawTrapezoid(1.2f, 1.0f, 1.0f, 0.5f);
+        glPopMatrix();
+
+        glPushMatrix();
+            glColor3f(0.8f, 0.45f, 0.0f);
+            glTranslatef(0.0f, 0.3f, -0.4f);
+            glScalef(0.7f, 0.9f, 0.3f);
+            drawCube(1.0f, 1.0f, 1.0f);
+        glPopMatrix();
+
+        // Draw Black Ridge and Hips
+        glPushMatrix();
+            glColor3f(0.6f, 0.3f, 0.0f);
+            glTranslatef(0.0f, -0.35f, 0.0f);
+            drawCube(1.0f, 0.1f, 0.5f);
+        glPopMatrix();
+
+        glPushMatrix();
+            glColor3f(0.9f, 0.5f, 0.1f);
+            glTranslatef(0.0f, -0.6f, 0.0f);
+            drawTrapezoid(1.0f, 0.7f, 0.4f, 0.5f);
+        glPopMatrix();
+
+    glPopMatrix();
+}
+
+// Note: Right arm will be drawn facing outward
+void drawArm(bool isLeft, const RobotDetail& detail, const glm::mat4* joints) {
+    float direction = isLeft ? -1.0f : 1.0f;
+    int upperArm = isLeft ? JOINT_LEFT_UPPER_ARM : JOINT_RIGHT_UPPER_ARM;
+
+    // Connect Shoulder + Upper Arm
+    glPushMatrix();
+        applyJoint(joints[JOINT_UPPER_BODY]);
+        glColor3f(0.0f, 0.0f, 0.0f);
+        glTranslatef(0.85f * direction, 0.9f, 0.0f);
+        drawSolidSphere(0.25, 20, 20);
+    glPopMatrix();
+
+    glPushMatrix();
+        applyJoint(joints[upperArm]);
+        glColor3f(1.0f, 0.55f, 0.0f);
+        drawCube(0.3f, 0.5f, 0.3f);
+
+        // Connect Elbow + Lower Arm
+        glColor3f(0.8f, 0.3f, 0.0f);
+        glTranslatef(0.0f, -0.4f, 0.0f);
+        drawSolidSphere(0.15, 20, 20);
+    glPopMatrix();
+
+    glPushMatrix();
+        applyJoint(joints[upperArm + 1]);
+        glColor3f(1.0f, 0.4f, 0.0f);
+        drawCube(0.3f, 0.5f, 0.3f);
+    glPopMatrix();
+
+    // Cannon
+    glPushMatrix();
+        applyJoint(joints[upperArm + 2]);
+        glColor3f(0.8f, 0.3f, 0.0f);
+        drawCylinder(0.2f, 0.5f, 20);
+
+        // Spinning Indicators for cannon
+        if (detail.isSpinning) {
+            for (int i = -1; i <= 1; i += 2) {
+                glPushMatrix();
+                    glColor3f(1.0f, 0.6f, 0.2f);
+                    glTranslatef(i * 0.4f, 0.0f, 0.1f);
+                    glRotatef(detail.cannonRotation, 0.0f, 1.0f, 0.0f);
+                    drawCube(0.05f, 0.05f, 0.05f);
+                glPopMatrix();
+            }
+            glPushMatrix();
+                glColor3f(1.0f, 0.8f, 0.4f);
+                glTranslatef(0.0f, 0.5f, 0.0f);
+                glRotatef(detail.cannonRotation, 0.0f, 1.0f, 0.0f);
+                glScalef(1.2f, 1.2f, 1.2f);
+                drawSolidSphere(0.05f, 20, 20);
+            glPopMatrix();
+        }
+    glPopMatrix();
+}
+
+void drawLeg(bool isLeft, const glm::mat4* joints) {
+    float direction = isLeft ? -1.0f : 1.0f;
+    int upperLeg = isLeft ? JOINT_LEFT_UPPER_LEG : JOINT_RIGHT_UPPER_LEG;
+
+    // Draw Hip, Upper Leg, Knee, and Lower Leg
+    glPushMatrix();
+        applyJoint(joints[JOINT_ROOT]);
+        glColor3f(0.0f, 0.0f, 0.0f);
+        glTranslatef(0.4f * direction, -0.75f, 0.0f);
+        drawSolidSphere(0.25, 20, 20);
+    glPopMatrix();
+
+    glPushMatrix();
+        applyJoint(joints[upperLeg]);
+        glColor3f(1.0f, 0.55f, 0.0f);
+        drawCube(0.4f, 0.75f, 0.4f);
+
+        glColor3f(0.8f, 0.3f, 0.0f);
+        glTranslatef(0.0f, -0.375f, 0.0f);
+        drawSolidSphere(0.25, 20, 20);
+    glPopMatrix();
+
+    glPushMatrix();
+        applyJoint(joints[upperLeg + 1]);
+        glColor3f(1.0f, 0.4f, 0.0f);
+        drawCube(0.4f, 0.75f, 0.4f);
+    glPopMatrix();
+}
+
+// Draws solid cube w/ dimensions given
+void drawCube(float width, float height, float depth) {
+    glPushMatrix();
+        glScalef(width, height, depth);
+        drawSolidCube(1.0);
+    glPopMatrix();
+}
+
+void drawCylinder(float radius, float height, int slices) {
+    slices = lodSlices(slices);
+    gluCylinder(quadric, radius, radius, height, slices, 1);
+    drawCalls += 3; // Side and both caps
+
+    // Bottom cap of cylinder
+    glPushMatrix();
+        glTranslatef(0.0f, 0.0f, 0.0f);
+        gluDisk(quadric, 0.0f, radius, slices, 1);
+    glPopMatrix();
+
+    // Top cap
+    glPushMatrix();
+        glTranslatef(0.0f, 0.0f, height);
+        gluDisk(quadric, 0.0f, radius, slices, 1);
+    glPopMatrix();
+}
+
+void drawTrapezoid(float topWidth, float bottomWidth, float height, float depth) {
+    float halfTopWidth = topWidth / 2.0f;
+    float halfBottomWidth = bottomWidth / 2.0f;
+    float halfDepth = depth / 2.0f;
+
+    glBegin(GL_QUADS);
+        // Front face
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfTopWidth, height / 2.0f, halfDepth);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfTopWidth, height / 2.0f, halfDepth);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfBottomWidth, -height / 2.0f, halfDepth);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfBottomWidth, -height / 2.0f, halfDepth);
+
+        // Back face
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfTopWidth, height / 2.0f, -halfDepth);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfTopWidth, height / 2.0f, -halfDepth);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfBottomWidth, -height / 2.0f, -halfDepth);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfBottomWidth, -height / 2.0f, -halfDepth);
+
+        // Left face
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfTopWidth, height / 2.0f, halfDepth);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(-halfTopWidth, height / 2.0f, -halfDepth);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(-halfBottomWidth, -height / 2.0f, -halfDepth);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfBottomWidth, -height / 2.0f, halfDepth);
+
+        // Right face
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(halfTopWidth, height / 2.0f, halfDepth);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfTopWidth, height / 2.0f, -halfDepth);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfBottomWidth, -height / 2.0f, -halfDepth);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(halfBottomWidth, -height / 2.0f, halfDepth);
+
+        // Top face
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfTopWidth, height / 2.0f, halfDepth);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfTopWidth, height / 2.0f, halfDepth);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfTopWidth, height / 2.0f, -halfDepth);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfTopWidth, height / 2.0f, -halfDepth);
+
+        // Bottom face
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfBottomWidth, -height / 2.0f, halfDepth);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfBottomWidth, -height / 2.0f, halfDepth);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfBottomWidth, -height / 2.0f, -halfDepth);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfBottomWidth, -height / 2.0f, -halfDepth);
+    glEnd();
+    drawCalls++;
+}
+
+// Draws a solid cube with proper texture mapping
+void drawSolidCube(float size) {
+    float halfSize = size / 2.0f;
+
+    glBegin(GL_QUADS);
+        // Front face
+        glNormal3f(0.0f, 0.0f, 1.0f);
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfSize, -halfSize, halfSize);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfSize, -halfSize, halfSize);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfSize, halfSize, halfSize);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfSize, halfSize, halfSize);
+
+        // Back face
+        glNormal3f(0.0f, 0.0f, -1.0f);
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(halfSize, -halfSize, -halfSize);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(-halfSize, -halfSize, -halfSize);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(-halfSize, halfSize, -halfSize);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(halfSize, halfSize, -halfSize);
+
+        // Left face
+        glNormal3f(-1.0f, 0.0f, 0.0f);
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfSize, -halfSize, -halfSize);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(-halfSize, -halfSize, halfSize);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(-halfSize, halfSize, halfSize);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfSize, halfSize, -halfSize);
+
+        // Right face
+        glNormal3f(1.0f, 0.0f, 0.0f);
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(halfSize, -halfSize, halfSize);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfSize, -halfSize, -halfSize);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfSize, halfSize, -halfSize);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(halfSize, halfSize, halfSize);
+
+        // Top face
+        glNormal3f(0.0f, 1.0f, 0.0f);
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfSize, halfSize, halfSize);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfSize, halfSize, halfSize);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfSize, halfSize, -halfSize);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfSize, halfSize, -halfSize);
+
+        // Bottom face
+        glNormal3f(0.0f, -1.0f, 0.0f);
+        glTexCoord2f(0.0f, 0.0f); glVertex3f(-halfSize, -halfSize, -halfSize);
+        glTexCoord2f(1.0f, 0.0f); glVertex3f(halfSize, -halfSize, -halfSize);
+        glTexCoord2f(1.0f, 1.0f); glVertex3f(halfSize, -halfSize, halfSize);
+        glTexCoord2f(0.0f, 1.0f); glVertex3f(-halfSize, -halfSize, halfSize);
+    glEnd();
+    drawCalls++;
+}
+
+
+// Draw spheres using GLU instead of using GLUT primitives
+void drawSolidSphere(float radius, int slices, int stacks) {
+    gluSphere(quadric, radius, lodSlices(slices), lodSlices(stacks));
+    drawCalls++;
+}
+
+
+// Builds the HUD atlas from the crosshair image and the built-in font and uploads it (at startup)
+void buildHud() {
+    int width = 0, height = 0, channels = 0;
+    unsigned char* crosshair = SOIL_load_image("crosshair.png", &width, &height, &channels, SOIL_LOAD_RGBA);
+    if (!crosshair) {
+        printf("SOIL loading error: '%s'\n", SOIL_last_result());
+    }
+
+    HudAtlas atlas;
+    buildHudAtlas(crosshair, width, height, atlas);
+    SOIL_free_image_data(crosshair);
+
+    glGenTextures(1, &hudTexture);
+    glBindTexture(GL_TEXTURE_2D, hudTexture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST); // Keeps the font crisp
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlas.width, atlas.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, atlas.rgba.data());
+
+    if (GLEW_VERSION_1_5) {
+        glGenBuffers(1, &hudBuffer);
+    }
+}
+
+// Billboards expanded in eye space, so they always face the camera; the round falloff is computed
+// per fragment, so no texture is needed
+const char* particleVertexShader =
+    "#version 120\n"
+    "attribute vec2 corner;\n" // Per vertex: quad corner in [-1, 1]
+    "attribute vec4 center;\n" // Per instance: position and size
+    "attribute vec4 color;\n"  // Per instance
+    "varying vec2 offset;\n"
+    "varying vec4 tint;\n"
+    "void main() {\n"
+    "    vec4 eye = gl_ModelViewMatrix * vec4(center.xyz, 1.0);\n"
+    "    eye.xy += corner * center.w;\n"
+    "    gl_Position = gl_ProjectionMatrix * eye;\n"
+    "    offset = corner;\n"
+    "    tint = color;\n"
+    "}\n";
+
+const char* particleFragmentShader =
+    "#version 120\n"
+    "varying vec2 offset;\n"
+    "varying vec4 tint;\n"
+    "void main() {\n"
+    "    float falloff = 1.0 - dot(offset, offset);\n"
+    "    if (falloff <= 0.0) discard;\n"
+    "    gl_FragColor = vec4(tint.rgb, tint.a * falloff * falloff);\n"
+    "}\n";
+
+GLuint compileShader(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (!compiled) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        printf("Shader error: %s\n", log);
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// Compiles the billboard shader and creates the buffers (at startup)
+void buildParticles() {
+    bool instancing = GLEW_VERSION_3_3 || (GLEW_ARB_instanced_arrays && GLEW_ARB_draw_instanced);
+    if (!GLEW_VERSION_2_0 || !instancing) {
+        printf("Particles disabled: instanced drawing is unavailable\n");
+        return;
+    }
+    coreInstancing = GLEW_VERSION_3_3;
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, particleVertexShader);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, particleFragmentShader);
+    if (!vertexShader || !fragmentShader) return;
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, ATTRIBUTE_CORNER, "corner"); // Attribute 0 must be per vertex
+    glBindAttribLocation(program, ATTRIBUTE_CENTER, "center");
+    glBindAttribLocation(program, ATTRIBUTE_COLOR, "color");
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        printf("Particle shader failed to link\n");
+        glDeleteProgram(program);
+        return;
+    }
+    particleProgram = program;
+
+    const float corners[8] = { -1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f }; // Triangle strip
+    glGenBuffers(1, &particleCornerBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, particleCornerBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+    glGenBuffers(1, &particleInstanceBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void setInstanceDivisor(GLuint attribute, GLuint divisor) {
+    if (coreInstancing) glVertexAttribDivisor(attribute, divisor);
+    else glVertexAttribDivisorARB(attribute, divisor);
+}
+
+// Uploads this frame's instances and draws each material with one instanced call. Depth-tested
+// against the scene but not written, so particles never hide each other
+void drawParticles() {
+    int total = 0;
+    for (int m = 0; m < NUM_PARTICLE_MATERIALS; m++) total += particleMaterialCount((ParticleMaterial)m);
+    if (!particleProgram || total == 0) return;
+
+    // Orphan last frame's storage so the driver doesn't wait for it to be read
+    const std::vector<ParticleInstance>& instances = particleInstances();
+    size_t used = (size_t)(particleMaterialFirst(PARTICLE_ALPHA) + particleMaterialCount(PARTICLE_ALPHA)) * sizeof(ParticleInstance);
+    glBindBuffer(GL_ARRAY_BUFFER, particleInstanceBuffer);
+    glBufferData(GL_ARRAY_BUFFER, used, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, used, instances.data());
+
+    glUseProgram(particleProgram);
+    glDepthMask(GL_FALSE);
+    glEnable(GL_BLEND);
+
+    glBindBuffer(GL_ARRAY_BUFFER, particleCornerBuffer);
+    glEnableVertexAttribArray(ATTRIBUTE_CORNER);
+    glVertexAttribPointer(ATTRIBUTE_CORNER, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glBindBuffer(GL_ARRAY_BUFFER, particleInstanceBuffer);
+    glEnableVertexAttribArray(ATTRIBUTE_CENTER);
+    glEnableVertexAttribArray(ATTRIBUTE_COLOR);
+    setInstanceDivisor(ATTRIBUTE_CENTER, 1);
+    setInstanceDivisor(ATTRIBUTE_COLOR, 1);
+
+    for (int m = 0; m < NUM_PARTICLE_MATERIALS; m++) {
+        int count = particleMaterialCount((ParticleMaterial)m);
+        if (count == 0) continue;
+        if (m == PARTICLE_ADDITIVE) glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+        else glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        const char* base = (const char*)nullptr + (size_t)particleMaterialFirst((ParticleMaterial)m) * sizeof(ParticleInstance);
+        glVertexAttribPointer(ATTRIBUTE_CENTER, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), base + offsetof(ParticleInstance, x));
+        glVertexAttribPointer(ATTRIBUTE_COLOR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(ParticleInstance), base + offsetof(ParticleInstance, r));
+        if (coreInstancing) glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+        else glDrawArraysInstancedARB(GL_TRIANGLE_STRIP, 0, 4, count);
+        drawCalls++;
+    }
+
+    setInstanceDivisor(ATTRIBUTE_CENTER, 0);
+    setInstanceDivisor(ATTRIBUTE_COLOR, 0);
+    glDisableVertexAttribArray(ATTRIBUTE_COLOR);
+    glDisableVertexAttribArray(ATTRIBUTE_CENTER);
+    glDisableVertexAttribArray(ATTRIBUTE_CORNER);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glDisable(GL_BLEND);
+    glDepthMask(GL_TRUE);
+    glUseProgram(0);
+}
+
+// Base color as the fixed-function pipeline draws it (texture modulated by the vertex color), times
+// one plus the lights of the fragment's cluster. GLSL 1.30 for texelFetch; the fixed-function
+// state (matrices, color, texture coords) still comes through the compatibility built-ins.
+// Everything lit is flat (arena planes, robot boxes), so the normal is the face's, from the
+// screen-space slope of the position: no normals needed from the vertices (Mesa refuses the
+// packed ones)
+const char* litVertexShader =
+    "#version 130\n"
+    "out vec3 eyePosition;\n"
+    "out vec2 uv;\n"
+    "void main() {\n"
+    "    eyePosition = vec3(gl_ModelViewMatrix * gl_Vertex);\n"
+    "    uv = vec2(gl_TextureMatrix[0] * gl_MultiTexCoord0);\n"
+    "    gl_FrontColor = gl_Color;\n"
+    "    gl_Position = ftransform();\n" // Same depth as the unlit draws
+    "}\n";
+
+const char* litFragmentShader =
+    "#version 130\n"
+    "uniform sampler2D baseTexture;\n"
+    "uniform sampler2D lightTexture;\n"
+    "uniform sampler2D clusterTexture;\n"
+    "uniform sampler2D lightIndexTexture;\n"
+    "uniform int tilesX;\n"
+    "uniform int slices;\n"
+    "uniform int textureShift;\n" // Rows of the light and index textures are 1 << textureShift wide
+    "uniform int textureMask;\n"
+    "uniform vec2 tileScale;\n" // Tiles per pixel
+    "uniform vec2 slice;\n"     // Slice of a depth: log(depth) * x - y
+    "in vec3 eyePosition;\n"
+    "in vec2 uv;\n"
+    "void main() {\n"
+    "    vec4 base = texture2D(baseTexture, uv) * gl_Color;\n"
+    "    ivec2 tile = ivec2(gl_FragCoord.xy * tileScale);\n"
+    "    int depthSlice = clamp(int(floor(log(-eyePosition.z) * slice.x - slice.y)), 0, slices - 1);\n"
+    "    vec2 range = texelFetch(clusterTexture, ivec2(tile.y * tilesX + tile.x, depthSlice), 0).xy;\n"
+    "    int first = int(range.x);\n"
+    "    int count = int(range.y);\n"
+    "    vec3 normal = normalize(cross(dFdx(eyePosition), dFdy(eyePosition)));\n"
+    "    vec3 lit = vec3(0.0);\n"
+    "    for (int i = 0; i < count; i++) {\n"
+    "        int entry = first + i;\n"
+    "        int light = 2 * int(texelFetch(lightIndexTexture, ivec2(entry & textureMask, entry >> textureShift), 0).r);\n"
+    "        vec4 position = texelFetch(lightTexture, ivec2(light & textureMask, light >> textureShift), 0);\n"
+    "        vec3 toLight = position.xyz - eyePosition;\n"
+    "        float distanceSquared = dot(toLight, toLight);\n"
+    "        float falloff = 1.0 - distanceSquared / (position.w * position.w);\n" // Nothing past the radius
+    "        if (falloff <= 0.0) continue;\n"
+    "        vec3 color = texelFetch(lightTexture, ivec2((light + 1) & textureMask, light >> textureShift), 0).rgb;\n"
+    "        float diffuse = max(dot(normal, toLight) * inversesqrt(distanceSquared), 0.0);\n"
+    "        lit += color * (falloff * falloff * diffuse);\n"
+    "    }\n"
+    "    gl_FragColor = vec4(base.rgb * (1.0 + lit), base.a);\n"
+    "}\n";
+
+GLuint createFloatTexture(GLenum internalFormat, GLenum format, int width, int height) {
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_FLOAT, nullptr);
+    return texture;
+}
+
+// Compiles the lit shader and creates the light textures (at startup)
+void buildLighting() {
+    if (!GLEW_VERSION_3_0) {
+        printf("Lighting disabled: float textures or GLSL 1.30 are unavailable\n");
+        return;
+    }
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, litVertexShader);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, litFragmentShader);
+    if (!vertexShader || !fragmentShader) return;
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        printf("Lit shader failed to link\n");
+        glDeleteProgram(program);
+        return;
+    }
+    litProgram = program;
+
+    // The base texture stays on unit 0, where the fixed-function draws bind it
+    glUseProgram(litProgram);
+    glUniform1i(glGetUniformLocation(litProgram, "baseTexture"), 0);
+    glUniform1i(glGetUniformLocation(litProgram, "lightTexture"), 1);
+    glUniform1i(glGetUniformLocation(litProgram, "clusterTexture"), 2);
+    glUniform1i(glGetUniformLocation(litProgram, "lightIndexTexture"), 3);
+    glUniform1i(glGetUniformLocation(litProgram, "tilesX"), lightTilesX);
+    glUniform1i(glGetUniformLocation(litProgram, "slices"), lightSlices);
+    glUniform1i(glGetUniformLocation(litProgram, "textureShift"), lightTextureShift);
+    glUniform1i(glGetUniformLocation(litProgram, "textureMask"), lightTextureWidth - 1);
+    litTileScaleUniform = glGetUniformLocation(litProgram, "tileScale");
+    litSliceUniform = glGetUniformLocation(litProgram, "slice");
+    glUseProgram(0);
+
+    lightTexture = createFloatTexture(GL_RGBA32F, GL_RGBA, lightTextureWidth, 2 * maxFrameLights / lightTextureWidth);
+    clusterTexture = createFloatTexture(GL_RG32F, GL_RG, lightTilesX * lightTilesY, lightSlices);
+    lightIndexTexture = createFloatTexture(GL_R32F, GL_RED, lightTextureWidth, maxClusterLightIndices / lightTextureWidth);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Bins this frame's lights (lights.h) and uploads the grid: only the rows of lights and indices in
+// use. Lighting stays off when no light is on screen
+void uploadLights(const SimSnapshot& snapshot, const RenderView& view) {
+    updateLights(snapshot.simTime);
+    lightingOn = false;
+    frameLights = 0;
+    if (!litProgram) return;
+    clusterLights(snapshot, view, lightClusters);
+    frameLights = lightClusters.lightCount;
+    if (lightClusters.lightCount == 0) return;
+    lightingOn = true;
+
+    int lightRows = (2 * lightClusters.lightCount + lightTextureWidth - 1) / lightTextureWidth;
+    int indexRows = (lightClusters.indexCount + lightTextureWidth - 1) / lightTextureWidth;
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, lightTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, lightTextureWidth, lightRows, GL_RGBA, GL_FLOAT, lightClusters.lights.data());
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, clusterTexture);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, lightTilesX * lightTilesY, lightSlices, GL_RG, GL_FLOAT, lightClusters.ranges.data());
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, lightIndexTexture);
+    if (indexRows > 0) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, lightTextureWidth, indexRows, GL_RED, GL_FLOAT, lightClusters.indices.data());
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glUseProgram(litProgram);
+    glUniform2f(litTileScaleUniform, (float)lightTilesX / windowWidth, (float)lightTilesY / windowHeight);
+    glUniform2f(litSliceUniform, lightClusters.sliceScale, lightClusters.sliceBias);
+    glUseProgram(0);
+}
+
+// Switches the lit shader on or off for the draws that follow (it stays off in a frame with no
+// lights)
+void setLighting(bool lit) {
+    lit = lit && lightingOn;
+    if (lit == litProgramBound) return;
+    glUseProgram(lit ? litProgram : 0);
+    litProgramBound = lit;
+}
+
+// Keeps a presented frame's time for the perf panel's graph
+void recordFrameTime(float ms) {
+    if (ms <= 0.0f) return; // First frame
+    frameTimesMs[frameTimeNext] = ms;
+    frameTimeNext = (frameTimeNext + 1) % perfHistoryFrames;
+    frameTimeCount = std::min(frameTimeCount + 1, perfHistoryFrames);
+}
+
+// Queues the perf panel in the top-left corner: frame and sim times, counts, and a frame-time graph
+void queuePerfPanel(const SimSnapshot& snapshot) {
+    const HudColor background = { 0, 0, 0, 160 };
+    const HudColor textColor = { 255, 255, 255, 255 };
+    const HudColor barColor = { 80, 220, 80, 255 };
+    const HudColor slowBarColor = { 240, 70, 50, 255 };
+    const HudColor lineColor = { 255, 255, 255, 90 };
+    const float scale = 2.0f;
+    const float lineHeight = (hudGlyphHeight + 3) * scale;
+    const float margin = 10.0f;
+    const float graphHeight = 80.0f;
+    const float graphMaxMs = 40.0f;
+    const float barWidth = 2.0f;
+    const int textLines = 10;
+
+    float averageMs = 0.0f;
+    for (int i = 0; i < frameTimeCount; i++) averageMs += frameTimesMs[i];
+    if (frameTimeCount > 0) averageMs /= frameTimeCount;
+
+    int activeRobots = 0;
+    for (const Robot& robot : snapshot.robots) {
+        if (robot.isActive && !robot.isDestroyed) activeRobots++;
+    }
+
+    // + 1: the HUD's own draw, issued after this is queued
+    char lines[textLines][64];
+    snprintf(lines[0], sizeof(lines[0]), "FPS %.0f (%.2f MS)", averageMs > 0.0f ? 1000.0f / averageMs : 0.0f, averageMs);
+    snprintf(lines[1], sizeof(lines[1]), "SIM TICK %.2f MS %d%% OF %d", snapshot.tickMs, (int)(snapshot.tickUtilisation * 100.0f + 0.5f), snapshot.tickThreads);
+    snprintf(lines[2], sizeof(lines[2]), "ROBOTS %d", activeRobots);
+    snprintf(lines[3], sizeof(lines[3]), "BULLETS %d", (int)snapshot.bullets.size());
+    snprintf(lines[4], sizeof(lines[4]), "SPHERES %d", (int)snapshot.spheres.size());
+    snprintf(lines[5], sizeof(lines[5]), "PARTICLES %d LIGHTS %d", liveParticles(), frameLights);
+    snprintf(lines[6], sizeof(lines[6]), "DRAW CALLS %d", drawCalls + 1);
+    snprintf(lines[7], sizeof(lines[7]), "%s P50 %.1f P99 %.1f MS", pacingModeName(pacingMode()), frameTimePercentileMs(50.0f), frameTimePercentileMs(99.0f));
+    snprintf(lines[8], sizeof(lines[8]), "LATENCY LOOK %.1f FIRE %.1f MS", inputLatencyPercentileMs(LATENCY_LOOK, LATENCY_TO_PRESENT, 50.0f),
+        inputLatencyPercentileMs(LATENCY_FIRE, LATENCY_TO_PRESENT, 50.0f));
+    if (allocationTrackingEnabled()) {
+        snprintf(lines[9], sizeof(lines[9]), "ALLOCS FRAME %llu TICK %u", (unsigned long long)frameAllocations, snapshot.tickAllocations);
+    }
+    else {
+        snprintf(lines[9], sizeof(lines[9]), "ALLOCS NOT TRACKED");
+    }
+
+    // Wide enough for the graph and the longest line
+    size_t longestLine = 0;
+    for (int i = 0; i < textLines; i++) longestLine = std::max(longestLine, strlen(lines[i]));
+    float panelWidth = std::max(perfHistoryFrames * barWidth, longestLine * hudGlyphAdvance * scale) + 2.0f * margin;
+    float panelHeight = textLines * lineHeight + graphHeight + 3.0f * margin;
+    float left = margin;
+    float top = windowHeight - margin;
+    hudRect(left, top - panelHeight, panelWidth, panelHeight, background);
+
+    float y = top - margin;
+    for (int i = 0; i < textLines; i++) {
+        y -= lineHeight;
+        hudText(left + margin, y, scale, textColor, lines[i]);
+    }
+
+    // Oldest frame on the left; reference lines at 60 and 30 FPS
+    float graphLeft = left + margin;
+    float graphBottom = top - panelHeight + margin;
+    for (int i = 0; i < frameTimeCount; i++) {
+        int slot = (frameTimeNext - frameTimeCount + i + perfHistoryFrames) % perfHistoryFrames;
+        float ms = frameTimesMs[slot];
+        float barHeight = std::min(ms / graphMaxMs, 1.0f) * graphHeight;
+        hudRect(graphLeft + i * barWidth, graphBottom, barWidth, barHeight, ms > 1000.0f / 60.0f ? slowBarColor : barColor);
+    }
+    hudRect(graphLeft, graphBottom + (1000.0f / 60.0f) / graphMaxMs * graphHeight, perfHistoryFrames * barWidth, 1.0f, lineColor);
+    hudRect(graphLeft, graphBottom + (1000.0f / 30.0f) / graphMaxMs * graphHeight, perfHistoryFrames * barWidth, 1.0f, lineColor);
+}
+
+// Draws the 2D layer (crosshair, and the perf panel when shown) in one call
+void drawHud(const SimSnapshot& snapshot) {
+    const HudColor white = { 255, 255, 255, 255 };
+    const float crosshairSize = 100.0f;
+
+    hudBegin();
+    // Centred horizontally, slightly below the middle
+    hudSprite(HUD_SPRITE_CROSSHAIR, (windowWidth - crosshairSize) * 0.5f, (windowHeight - crosshairSize) * 0.5f - 15.0f,
+        crosshairSize, crosshairSize, white);
+    if (showPerfPanel) {
+        queuePerfPanel(snapshot);
+    }
+    const std::vector<HudVertex>& vertices = hudVertices();
+
+    const char* base = (const char*)vertices.data();
+    if (hudBuffer) {
+        // Orphan last frame's storage so the driver doesn't wait for it to be read
+        glBindBuffer(GL_ARRAY_BUFFER, hudBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(HudVertex), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(HudVertex), vertices.data());
+        base = nullptr;
+    }
+
+    glMatrixMode(GL_PROJECTION);
+    glPushMatrix();
+        glLoadIdentity();
+        gluOrtho2D(0, windowWidth, 0, windowHeight); // One unit per window pixel
+
+        glMatrixMode(GL_MODELVIEW);
+        glPushMatrix();
+            glLoadIdentity();
+
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_TEXTURE_2D);
+            glBindTexture(GL_TEXTURE_2D, hudTexture);
+
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA); // Enable transparency handling
+
+            glEnableClientState(GL_VERTEX_ARRAY);
+            glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+            glEnableClientState(GL_COLOR_ARRAY);
+            glVertexPointer(2, GL_FLOAT, sizeof(HudVertex), base + offsetof(HudVertex, x));
+            glTexCoordPointer(2, GL_FLOAT, sizeof(HudVertex), base + offsetof(HudVertex, s));
+            glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(HudVertex), base + offsetof(HudVertex, color));
+            glDrawArrays(GL_QUADS, 0, (GLsizei)vertices.size());
+            drawCalls++;
+            glDisableClientState(GL_COLOR_ARRAY);
+            glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+            glDisableClientState(GL_VERTEX_ARRAY);
+
+            glDisable(GL_BLEND);
+            glDisable(GL_TEXTURE_2D);
+            glEnable(GL_DEPTH_TEST);
+
+            glMatrixMode(GL_PROJECTION);
+        glPopMatrix();
+
+        glMatrixMode(GL_MODELVIEW);
+    glPopMatrix();
+
+    if (hudBuffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+// Function to set the camera
+// Late-latches the aim first: mouse looks still queued for the sim are applied here, so the view
+// uses the newest mouse position rather than the last tick's
+void setCamera(const SimSnapshot& snapshot) {
+    aimAngleH = snapshot.cameraAngleH;
+    aimAngleV = snapshot.cameraAngleV;
+    latchLook(snapshot.lastInput, aimAngleH, aimAngleV);
+
+    float dirX = sin(aimAngleH) * cos(aimAngleV);
+    float dirY = sin(aimAngleV);
+    float dirZ = -cos(aimAngleH) * cos(aimAngleV);
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    gluLookAt(snapshot.cameraX, snapshot.cameraY, snapshot.cameraZ,
+              snapshot.cameraX + dirX, snapshot.cameraY + dirY, snapshot.cameraZ + dirZ, 0.0f, 1.0f, 0.0f);
+}
+
+// Draws the snapshot: arena, cannon, visible robots, spheres and bullets (the arena and robots lit
+// by the frame's lights), particles, then the HUD
+void renderFrame(const SimSnapshot& snapshot) {
+    drawCalls = 0;
+    uint64_t allocations = threadAllocations().allocations;
+    frameAllocations = allocations - frameAllocationsMark;
+    frameAllocationsMark = allocations;
+
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    setCamera(snapshot);
+
+    // Cull, pick LODs and sort on the worker threads (against the latched aim); GL calls stay on this thread
+    RenderView view = { snapshot.cameraX, snapshot.cameraY, snapshot.cameraZ,
+                        aimAngleH, aimAngleV,
+                        45.0f, windowAspect, 1.0f, planeSize * 3.0f };
+    {
+        ALLOC_ZONE("render_prep");
+        prepareRenderItems(snapshot, view, renderItems);
+    }
+
+    {
+        ALLOC_ZONE("lights");
+        uploadLights(snapshot, view);
+    }
+
+    {
+        ALLOC_ZONE("draw_scene");
+        setLighting(true);
+        drawArena();
+        setLighting(false);
+        drawCannon(snapshot);
+
+        // Draw visible robots, spheres and bullets
+        drawRenderItems(snapshot);
+    }
+
+    {
+        // Advanced by sim time, so the same snapshots always give the same particles
+        ALLOC_ZONE("particles");
+        updateParticles(snapshot.simTime);
+        drawParticles();
+    }
+
+    // Render the 2D UI Overlay
+    ALLOC_ZONE("hud");
+    drawHud(snapshot);
+}
+
+void initRenderer() {
+    glEnable(GL_DEPTH_TEST);
+
+    // Load textures
+    planeTexture = loadTexture("land.jpg");
+    wallTexture = loadTexture("wall.jpg");
+    robotTexture = loadTexture("rough.png");
+    gunTexture = loadTexture("gun.jpg");
+    cannonTexture = loadTexture("cannon.jpg");
+    beltTexture = loadTexture("belt.jpg");
+
+    quadric = gluNewQuadric();
+    gluQuadricDrawStyle(quadric, GLU_FILL); // Solid shapes
+    gluQuadricNormals(quadric, GLU_SMOOTH); // Smooth normals for lighting
+    gluQuadricTexture(quadric, GL_TRUE);    // Automatic texture coordinates
+
+    buildArena();
+    buildHud();
+    buildParticles();
+    buildLighting();
+}
+
+void resizeRenderer(int w, int h) {
+    windowAspect = (float)w / (float)(h > 0 ? h : 1); // Culling uses the same frustum
+    windowWidth = w;
+    windowHeight = h;
+    glViewport(0, 0, w, h);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(45.0, (double)w / (double)h, 1.0, planeSize * 3);
+}
+
+void resetFrameTimes() {
+    frameTimeCount = 0;
+    frameTimeNext = 0;
+}
+
+//// Mesh Importing
+// Load mesh from file (within "fps" folder of project)
+void loadMesh() {
+    const char* folder = "ImportMesh"; // Note: Files and folders NEED to be this name exactly
+    const char* fileName = "mesh.obj";
+
+    char filePath[256];
+
+    // Get file path
+    snprintf(filePath, sizeof(filePath), "%s/%s", folder, fileName);
+
+    // The parsed OBJ is only needed until the mesh is built
+    MeshImport import;
+    if (!readObjMesh(filePath, import)) {
+        printf("Could not open file: %s\n", filePath);
+        return;
+    }
+    // The cannon belt's OBJ has no texture coords: they go on its sweep grid (numCurvePoints - 1
+    // rows of NUMBEROFSIDES quads in A2)
+    MeshGrid grid;
+    grid.rows = 32;
+    grid.columns = 16;
+    MeshStats stats;
+    buildMesh(import, grid, importedMesh, stats);
+    printf("Mesh imported: %d faces, %d triangles, %d vertices (%d corners welded)%s, ACMR %.3f -> %.3f\n",
+        stats.faces, stats.triangles, stats.vertices, stats.corners, stats.generatedNormals ? ", normals generated" : "",
+        stats.acmrBefore, stats.acmrAfter);
+}
+
+void drawMesh()
+{
+    if (importedMesh.indices.empty()) return;
+
+    glPushMatrix();
+        glTranslatef(0.0f, 5.0f, 0.0f); // Position mesh w/ cannon parts
+        //glScalef(1.0f, 1.0f, 1.0f); // Scale mesh if needed
+
+        // The whole mesh in one indexed draw, straight from the packed arrays
+        bindPackedVertices((const char*)importedMesh.vertices.data());
+        glDrawElements(GL_TRIANGLES, (GLsizei)importedMesh.indices.size(), GL_UNSIGNED_INT, importedMesh.indices.data());
+        drawCalls++;
+        unbindPackedVertices();
+    glPopMatrix();
+}
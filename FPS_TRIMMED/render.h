@@ -0,0 +1,25 @@
+#pragma once
+// Scene rendering
+// Draws a sim snapshot with the fixed-function pipeline (particles use a small billboard shader,
+// and the arena and robots a clustered lighting shader when there are lights on screen):
+// arena, cannon, robots, spheres, bullets, particles
+// and the HUD. It needs a current GL context but no window, so the game (main.cpp, GLUT) and the
+// offscreen render bench (renderbench.cpp, EGL) draw exactly the same frames.
+#include "simthread.h"
+
+extern bool showPerfPanel; // Toggled with F3
+extern int drawCalls;      // Draw submissions in the last frame (a GLU shape counts as one)
+extern int frameLights;    // Point lights shaded in the last frame (lights.h)
+
+// Once the context is current and glewInit() has run: loads the textures, builds the arena and HUD
+void initRenderer();
+
+// Viewport and projection for a drawable of w x h pixels
+void resizeRenderer(int w, int h);
+
+// Draws one frame into the current draw buffer (the caller swaps)
+void renderFrame(const SimSnapshot& snapshot);
+
+// The perf panel's frame-time graph: one entry per presented frame
+void recordFrameTime(float ms);
+void resetFrameTimes();
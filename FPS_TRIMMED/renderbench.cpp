@@ -0,0 +1,522 @@
+// Offscreen render benchmark with image regression checks (no window)
+// Renders scripted scenarios through the game's own renderer (render.h) into an EGL pbuffer at a
+// fixed resolution, one sim tick per frame, and reports frame times as JSON. Selected frames are
+// written to PNG and compared against golden images, so a render optimisation can be shown to be
+// faster and to draw the same picture. Runs on any EGL driver, including Mesa's llvmpipe on a
+// machine with no GPU (set EGL_PLATFORM=surfaceless if there's no display server).
+//
+// Build (Linux):  g++ -O2 -std=c++17 -DFPS_TRACK_ALLOCATIONS sim.cpp timerwheel.cpp pose.cpp flowfield.cpp crowd.cpp checkpoint.cpp
+//                     jobs.cpp workers.cpp scenequery.cpp alloctrack.cpp renderprep.cpp mesh.cpp staticbatch.cpp hud.cpp framepacing.cpp latency.cpp
+//                     simthread.cpp particles.cpp lights.cpp render.cpp pngwrite.cpp framecapture.cpp renderbench.cpp -lGLEW -lSOIL -lGLU -lGL -lEGL -lpthread -o fps_renderbench
+// Usage:          fps_renderbench [--scenario name]... [--frames N] [--size WxH] [--out file.json]
+//                                 [--golden-dir dir] [--capture-dir dir] [--update-goldens]
+//                                 [--tolerance N] [--max-differing F] [--checkpoint file] [--list]
+//                                 [--record dir] [--record-format raw|png]
+// Frames are checked when a scenario lists them (and --frames reaches them). A pixel differs when
+// any channel is more than --tolerance (default 8) off; a frame fails when more than
+// --max-differing (default 0.001) of its pixels differ, or when it has no golden. --update-goldens
+// writes the frames as the new goldens instead. Run from the game folder (textures are loaded
+// from it). The process exits with status 1 when any frame fails.
+// --record captures every frame through framecapture.h into dir/<scenario>/, inside the timed
+// part of the frame, so comparing frame times with and without it gives the recording overhead.
+#include <GL/glew.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <SOIL.h>
+#include "alloctrack.h"
+#include "checkpoint.h"
+#include "framecapture.h"
+#include "lights.h"
+#include "particles.h"
+#include "pngwrite.h"
+#include "render.h"
+#include "sim.h"
+#include "simthread.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+static const char* startCheckpoint = nullptr; // --checkpoint
+static const char* goldenDir = "goldens";
+static const char* captureDir = "render_out";
+static bool updateGoldens = false;
+static int channelTolerance = 8;
+static double maxDiffering = 0.001;
+static const char* recordDir = nullptr; // --record
+static CaptureFormat recordFormat = CAPTURE_RAW;
+static bool allocReport = false; // --alloc-report
+const int warmUpFrames = 30; // Allocations after these count as steady-state ones
+
+//// Scenarios
+static void spawnRobotArmy(int count) {
+    setRobotCount(count);
+    spawnRobots();
+}
+
+void setupIdle() {
+    setRobotCount(0);
+}
+
+void setupRobots100() { spawnRobotArmy(100); }
+
+// Bullets fanned out ahead of the camera, with spheres chasing it
+void setupBullets2000() {
+    setRobotCount(0);
+    for (int i = 0; i < 2000; i++) {
+        float spread = (float)(i % 200 - 100) * 0.004f;
+        Bullet bullet = { cameraX + spread * 40.0f, cameraY + (float)(i / 200) * 0.5f - 2.0f, cameraZ - 5.0f - (float)(i % 37),
+                          spread, 0.0f, -1.0f, true };
+        bullets.push_back(bullet);
+    }
+    for (int i = 0; i < 50; i++) {
+        spawnSphere();
+    }
+}
+
+void setupSphereSwarm() {
+    setRobotCount(0);
+    for (int i = 0; i < 500; i++) {
+        spawnSphere();
+    }
+}
+
+// The player sweeps the cannon across the swarm and fires every few frames
+void scriptSphereSwarm(int frame) {
+    cameraAngleH = 0.6f * sin(frame * 0.02f);
+    if (frame % 5 == 0) {
+        fireBullet();
+    }
+}
+
+// Destruction all over the arena ahead of the camera, as effects (sim.h) without the robots, so
+// the frame time is the particles': sustains over 100k live particles
+void scriptParticleStorm(int frame) {
+    for (int i = 0; i < 16; i++) {
+        SimEffectType type = i < 4 ? EFFECT_ROBOT_DESTROYED : EFFECT_ROBOT_HIT;
+        float x = (float)(rand() % 600) * 0.1f - 30.0f;
+        float z = (float)(rand() % 400) * 0.1f - 30.0f;
+        simEffects.push_back({ type, x, groundLevel, z, 0.0f, 0.0f, -1.0f });
+    }
+    cameraAngleH = 0.3f * sin(frame * 0.02f);
+    if (frame % 5 == 0) {
+        fireBullet();
+    }
+}
+
+// The robots_100 scene under a field of long-lived point lights scattered over the arena, sized
+// like bullet glows and impacts: against robots_100, shows what the clustered lighting costs as
+// the light count grows
+static void scatterLights(int count) {
+    const float palette[4][3] = { { 1.0f, 0.6f, 0.2f }, { 1.0f, 0.9f, 0.4f }, { 0.4f, 0.7f, 1.0f }, { 1.0f, 0.3f, 0.2f } };
+    for (int i = 0; i < count; i++) {
+        float x = (float)(rand() % 1000) * 0.1f - 50.0f;
+        float z = (float)(rand() % 1000) * 0.1f - 50.0f;
+        float y = 0.5f + (float)(rand() % 30) * 0.1f;
+        float radius = 2.0f + (float)(rand() % 20) * 0.1f;
+        const float* color = palette[i % 4];
+        spawnLight(x, y, z, radius, color[0], color[1], color[2], 1.0f, 1e6f);
+    }
+}
+
+void setupLights100() {
+    spawnRobotArmy(100);
+    scatterLights(100);
+}
+
+void setupLights1000() {
+    spawnRobotArmy(100);
+    scatterLights(1000);
+}
+
+const int maxCheckedFrames = 4;
+
+struct Scenario {
+    const char* name;
+    int frames;
+    void (*setup)();
+    void (*script)(int frame); // Optional per-frame script, runs before the tick
+    int checkedFrames[maxCheckedFrames]; // 1-based; 0 ends the list
+};
+
+static Scenario scenarios[] = {
+    { "arena_idle",   60,  setupIdle,        nullptr,           { 60 } },
+    { "robots_100",   120, setupRobots100,   nullptr,           { 1, 120 } },
+    { "bullets_2000", 60,  setupBullets2000, nullptr,           { 30 } },
+    { "sphere_swarm", 120, setupSphereSwarm, scriptSphereSwarm, { 60, 120 } },
+    { "particle_storm", 240, setupIdle,      scriptParticleStorm, { 240 } },
+    { "lights_100",   120, setupLights100,   nullptr,           { 120 } },
+    { "lights_1000",  120, setupLights1000,  nullptr,           { 120 } },
+};
+const int numScenarios = sizeof(scenarios) / sizeof(scenarios[0]);
+
+static Scenario* findScenario(const char* name) {
+    for (int i = 0; i < numScenarios; i++) {
+        if (strcmp(scenarios[i].name, name) == 0) return &scenarios[i];
+    }
+    return nullptr;
+}
+
+//// Offscreen context
+// A pbuffer on the surfaceless platform when Mesa offers it (no display server needed), else on
+// the default display
+static bool createOffscreenContext(int width, int height) {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    if (clientExtensions && strstr(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (getPlatformDisplay) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        fprintf(stderr, "EGL init error: 0x%x\n", eglGetError());
+        return false;
+    }
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_DEPTH_SIZE, 24,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+        fprintf(stderr, "No EGL config for desktop GL with a pbuffer\n");
+        return false;
+    }
+
+    const EGLint surfaceAttributes[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+    EGLSurface surface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+
+    // Desktop GL (the renderer is fixed-function), default version: a compatibility context
+    eglBindAPI(EGL_OPENGL_API);
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+    if (surface == EGL_NO_SURFACE || context == EGL_NO_CONTEXT || !eglMakeCurrent(display, surface, surface, context)) {
+        fprintf(stderr, "EGL context error: 0x%x\n", eglGetError());
+        return false;
+    }
+
+    // GLEW built for GLX reports an error here (no GLX display), but only after loading the core
+    // entry points, which are all the renderer uses
+    GLenum glewStatus = glewInit();
+    if (glewStatus != GLEW_OK && !GLEW_VERSION_1_5) {
+        fprintf(stderr, "GLEW init error: '%s'\n", (const char*)glewGetErrorString(glewStatus));
+        return false;
+    }
+    fprintf(stderr, "Rendering with %s (%s), EGL %d.%d\n", (const char*)glGetString(GL_RENDERER),
+        (const char*)glGetString(GL_VERSION), major, minor);
+    return true;
+}
+
+//// Image checks
+struct ImageCheck {
+    int frame;
+    long long differing; // Pixels with a channel off by more than the tolerance (-1: no golden)
+    int maxChannelDiff;
+    bool passed;
+};
+
+// frame: glReadPixels output (bottom-up RGBA)
+static ImageCheck checkFrame(const Scenario& scenario, int frame, int width, int height, const std::vector<uint8_t>& pixels) {
+    ImageCheck check = { frame, -1, 0, false };
+    char name[128], capturePath[512], goldenPath[512];
+    snprintf(name, sizeof(name), "%s_%04d.png", scenario.name, frame);
+    snprintf(capturePath, sizeof(capturePath), "%s/%s", captureDir, name);
+    snprintf(goldenPath, sizeof(goldenPath), "%s/%s", goldenDir, name);
+
+    if (!writePng(capturePath, width, height, pixels.data(), true)) {
+        fprintf(stderr, "Could not write %s\n", capturePath);
+    }
+    if (updateGoldens) {
+        check.passed = writePng(goldenPath, width, height, pixels.data(), true);
+        if (!check.passed) fprintf(stderr, "Could not write %s\n", goldenPath);
+        check.differing = 0;
+        return check;
+    }
+
+    int goldenWidth, goldenHeight, goldenChannels;
+    unsigned char* golden = SOIL_load_image(goldenPath, &goldenWidth, &goldenHeight, &goldenChannels, SOIL_LOAD_RGBA);
+    if (!golden) {
+        fprintf(stderr, "%s: no golden image (run with --update-goldens to create it)\n", goldenPath);
+        return check;
+    }
+    if (goldenWidth != width || goldenHeight != height) {
+        fprintf(stderr, "%s: golden is %dx%d, frame is %dx%d\n", goldenPath, goldenWidth, goldenHeight, width, height);
+        SOIL_free_image_data(golden);
+        return check;
+    }
+
+    check.differing = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* frameRow = &pixels[(size_t)(height - 1 - y) * width * 4];
+        const uint8_t* goldenRow = golden + (size_t)y * width * 4;
+        for (int x = 0; x < width; x++) {
+            int pixelDiff = 0;
+            for (int c = 0; c < 3; c++) {
+                pixelDiff = std::max(pixelDiff, abs((int)frameRow[x * 4 + c] - (int)goldenRow[x * 4 + c]));
+            }
+            check.maxChannelDiff = std::max(check.maxChannelDiff, pixelDiff);
+            if (pixelDiff > channelTolerance) check.differing++;
+        }
+    }
+    SOIL_free_image_data(golden);
+
+    check.passed = check.differing <= (long long)(maxDiffering * width * height);
+    return check;
+}
+
+//// Running
+struct Result {
+    double meanMs, p50Ms, p99Ms, maxMs;
+    int drawCalls;
+    int peakParticles;
+    int peakLights;           // Lights shaded in a frame
+    double allocsPerFrame;    // new, whole process (sim tick, render and job threads), mean over all frames
+    double cAllocsPerFrame;   // C allocations (mostly the GL driver), likewise
+    uint64_t steadyAllocs;    // new in the frame loop after warmUpFrames: should be none
+    std::vector<ImageCheck> checks;
+    bool recorded;
+    CaptureStats capture;
+};
+
+Result runScenario(const Scenario& scenario, int frames, int width, int height) {
+    // Fresh state (and a fixed seed) for every scenario so frames are reproducible
+    resetSimulation();
+    clearParticles();
+    clearLights();
+    srand(1234);
+    if (startCheckpoint) {
+        if (!loadCheckpoint(startCheckpoint)) exit(2);
+    }
+    else {
+        scenario.setup();
+    }
+
+    // One untimed frame first: the driver compiles its shaders and uploads the textures on first use
+    SimSnapshot snapshot;
+    captureSnapshot(snapshot);
+    renderFrame(snapshot);
+    glFinish();
+
+    Result result;
+    result.peakParticles = 0;
+    result.peakLights = 0;
+    result.recorded = false;
+    if (recordDir) {
+        std::string directory = std::string(recordDir) + "/" + scenario.name;
+        result.recorded = startCapture(directory.c_str(), width, height, recordFormat);
+        if (!result.recorded) fprintf(stderr, "Could not record to %s\n", directory.c_str());
+    }
+
+    std::vector<double> frameTimes;
+    frameTimes.reserve(frames);
+    std::vector<uint8_t> pixels((size_t)width * height * 4);
+
+    // The frame loop runs on this thread, so it goes into steady state after warming up; scripts and
+    // image checks are the bench's own work and may allocate
+    AllocStats allocsStart = allocationTotals();
+    uint64_t violationsStart = allocationViolations();
+    for (int frame = 1; frame <= frames; frame++) {
+        if (frame == warmUpFrames + 1) setSteadyState(true);
+        if (scenario.script) {
+            ALLOW_ALLOCATIONS();
+            scenario.script(frame);
+        }
+        simTick(simStepMs);
+        captureSnapshot(snapshot);
+
+        // glFinish: the frame's time includes the GPU's work, not just submitting it; spawning the
+        // tick's effects is render-thread work too
+        auto start = std::chrono::steady_clock::now();
+        for (const SimEffect& effect : simEffects) {
+            spawnEffect(effect);
+            spawnEffectLight(effect);
+        }
+        simEffects.clear();
+        renderFrame(snapshot);
+        captureFrame();
+        glFinish();
+        auto end = std::chrono::steady_clock::now();
+        frameTimes.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+        result.peakParticles = std::max(result.peakParticles, liveParticles());
+        result.peakLights = std::max(result.peakLights, frameLights);
+
+        for (int frameToCheck : scenario.checkedFrames) {
+            if (frameToCheck != frame) continue;
+            ALLOW_ALLOCATIONS();
+            glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+            result.checks.push_back(checkFrame(scenario, frame, width, height, pixels));
+        }
+    }
+    setSteadyState(false);
+    result.drawCalls = drawCalls;
+    AllocStats allocsEnd = allocationTotals();
+    result.allocsPerFrame = frames > 0 ? (double)(allocsEnd.allocations - allocsStart.allocations) / frames : 0.0;
+    result.cAllocsPerFrame = frames > 0 ? (double)(allocsEnd.cAllocations - allocsStart.cAllocations) / frames : 0.0;
+    result.steadyAllocs = allocationViolations() - violationsStart;
+    if (result.recorded) {
+        stopCapture();
+        result.capture = captureStats();
+    }
+
+    double total = 0.0;
+    for (double t : frameTimes) total += t;
+    std::sort(frameTimes.begin(), frameTimes.end());
+    size_t n = frameTimes.size();
+    result.meanMs = n ? total / n : 0.0;
+    result.p50Ms = n ? frameTimes[n / 2] : 0.0;
+    result.p99Ms = n ? frameTimes[std::min(n - 1, (size_t)ceil(n * 0.99) - 1)] : 0.0;
+    result.maxMs = n ? frameTimes[n - 1] : 0.0;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::vector<Scenario*> selected;
+    int framesOverride = 0;
+    int width = 640, height = 360;
+    const char* outPath = "render_results.json";
+    setAllocationAssert(false); // Steady-state allocations are counted in the results instead
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--scenario") == 0 && i + 1 < argc) {
+            Scenario* scenario = findScenario(argv[++i]);
+            if (!scenario) {
+                fprintf(stderr, "Unknown scenario: %s\n", argv[i]);
+                return 2;
+            }
+            selected.push_back(scenario);
+        }
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            framesOverride = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc) {
+            if (sscanf(argv[++i], "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+                fprintf(stderr, "Bad size: %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            outPath = argv[++i];
+        }
+        else if (strcmp(argv[i], "--golden-dir") == 0 && i + 1 < argc) {
+            goldenDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--capture-dir") == 0 && i + 1 < argc) {
+            captureDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--update-goldens") == 0) {
+            updateGoldens = true;
+        }
+        else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) {
+            channelTolerance = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--max-differing") == 0 && i + 1 < argc) {
+            maxDiffering = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) {
+            startCheckpoint = argv[++i];
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordDir = argv[++i];
+        }
+        else if (strcmp(argv[i], "--record-format") == 0 && i + 1 < argc) {
+            recordFormat = strcmp(argv[++i], "png") == 0 ? CAPTURE_PNG : CAPTURE_RAW;
+        }
+        else if (strcmp(argv[i], "--alloc-report") == 0) {
+            allocReport = true;
+        }
+        else if (strcmp(argv[i], "--list") == 0) {
+            for (const Scenario& scenario : scenarios) printf("%s\n", scenario.name);
+            return 0;
+        }
+        else {
+            fprintf(stderr, "Unknown argument: %s\n", argv[i]);
+            return 2;
+        }
+    }
+    if (selected.empty()) {
+        for (Scenario& scenario : scenarios) selected.push_back(&scenario);
+    }
+
+    std::error_code ignored; // A failed write reports the path
+    std::filesystem::create_directories(captureDir, ignored);
+    if (updateGoldens) std::filesystem::create_directories(goldenDir, ignored);
+
+    if (!createOffscreenContext(width, height)) return 2;
+    initRenderer();
+    resizeRenderer(width, height);
+
+    FILE* out = stdout;
+    if (strcmp(outPath, "-") != 0 && !(out = fopen(outPath, "w"))) {
+        fprintf(stderr, "Could not open file: %s\n", outPath);
+        return 2;
+    }
+
+    bool passed = true;
+    fprintf(out, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"renderer\": \"%s\",\n  \"scenarios\": [\n",
+        width, height, (const char*)glGetString(GL_RENDERER));
+    for (size_t i = 0; i < selected.size(); i++) {
+        const Scenario& scenario = *selected[i];
+        int frames = framesOverride > 0 ? framesOverride : scenario.frames;
+        Result result = runScenario(scenario, frames, width, height);
+
+        std::string checks;
+        bool scenarioPassed = true;
+        for (const ImageCheck& check : result.checks) {
+            char entry[160];
+            snprintf(entry, sizeof(entry), "%s{ \"frame\": %d, \"differing_pixels\": %lld, \"max_channel_diff\": %d, \"passed\": %s }",
+                checks.empty() ? "" : ", ", check.frame, check.differing, check.maxChannelDiff, check.passed ? "true" : "false");
+            checks += entry;
+            scenarioPassed = scenarioPassed && check.passed;
+        }
+        passed = passed && scenarioPassed;
+
+        fprintf(stderr, "%-14s mean %8.3f ms  p99 %8.3f ms  max %8.3f ms  draw calls %d  particles %d  lights %d  images %s\n",
+            scenario.name, result.meanMs, result.p99Ms, result.maxMs, result.drawCalls, result.peakParticles, result.peakLights,
+            result.checks.empty() ? "-" : updateGoldens ? "updated" : scenarioPassed ? "match" : "DIFFER");
+        if (result.recorded) {
+            fprintf(stderr, "%-14s recorded %llu, dropped %llu, %.3f ms per frame in captureFrame\n", "",
+                (unsigned long long)result.capture.framesWritten, (unsigned long long)result.capture.framesDropped,
+                result.capture.renderThreadMs / frames);
+        }
+        if (allocationTrackingEnabled()) {
+            fprintf(stderr, "%-14s new %.1f per frame (%llu after frame %d), C allocations %.1f per frame\n", "",
+                result.allocsPerFrame, (unsigned long long)result.steadyAllocs, warmUpFrames, result.cAllocsPerFrame);
+        }
+
+        char capture[160] = "";
+        if (result.recorded) {
+            snprintf(capture, sizeof(capture), ", \"recorded\": %llu, \"dropped\": %llu, \"capture_ms\": %.4f",
+                (unsigned long long)result.capture.framesWritten, (unsigned long long)result.capture.framesDropped,
+                result.capture.renderThreadMs / frames);
+        }
+
+        char allocs[160] = "";
+        if (allocationTrackingEnabled()) {
+            snprintf(allocs, sizeof(allocs), ", \"allocs_per_frame\": %.2f, \"c_allocs_per_frame\": %.2f, \"steady_allocs\": %llu",
+                result.allocsPerFrame, result.cAllocsPerFrame, (unsigned long long)result.steadyAllocs);
+        }
+
+        fprintf(out,
+            "    { \"name\": \"%s\", \"frames\": %d, \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p99_ms\": %.4f, \"max_ms\": %.4f, "
+            "\"draw_calls\": %d, \"peak_particles\": %d, \"peak_lights\": %d%s, \"images\": [%s]%s }%s\n",
+            scenario.name, frames, result.meanMs, result.p50Ms, result.p99Ms, result.maxMs, result.drawCalls, result.peakParticles,
+            result.peakLights,
+            allocs, checks.c_str(), capture,
+            i + 1 < selected.size() ? "," : "");
+    }
+    fprintf(out, "  ],\n  \"passed\": %s\n}\n", passed ? "true" : "false");
+    if (out != stdout) fclose(out);
+    if (allocReport) printAllocationReport("Allocations by zone");
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+#include "renderprep.h"
+#include "alloctrack.h"
+#include "workers.h"
+#include <algorithm>
+#include <cstring>
+
+const int prepGrain = 1024; // Objects per chunk handed to a worker
+
+// Distance thresholds for the LOD levels
+const float lodDistance1 = 25.0f;
+const float lodDistance2 = 60.0f;
+
+// Bounding radii for culling (generous: a robot is about 3 units tall before scaling)
+const float robotCullRadius = 2.0f;  // Multiplied by scaleRobot
+const float bulletCullRadius = 0.2f;
+const float sphereCullRadius = 0.3f;
+
+struct FrustumPlane {
+    float nx, ny, nz, d; // Inside when n . p + d >= 0
+};
+
+// Shared by the workers for one prepareRenderItems() call
+struct PrepJob {
+    const SimSnapshot* snapshot;
+    FrustumPlane planes[6];
+    float eyeX, eyeY, eyeZ;
+    int robotCount, sphereCount, bulletCount;
+    std::vector<std::vector<RenderItem>>* buffers; // One per worker
+};
+
+static std::vector<std::vector<RenderItem>> workerBuffers;
+static std::vector<RenderItem> mergeScratch;
+
+// Planes of the view frustum in world space, built from the camera basis
+static void buildFrustum(const RenderView& view, FrustumPlane planes[6]) {
+    float forwardX = sin(view.angleH) * cos(view.angleV);
+    float forwardY = sin(view.angleV);
+    float forwardZ = -cos(view.angleH) * cos(view.angleV);
+
+    // right = forward x up(0, 1, 0), normalised; up = right x forward
+    float rightX = -forwardZ, rightY = 0.0f, rightZ = forwardX;
+    float rightLength = sqrt(rightX * rightX + rightZ * rightZ);
+    rightX /= rightLength;
+    rightZ /= rightLength;
+    float upX = rightY * forwardZ - rightZ * forwardY;
+    float upY = rightZ * forwardX - rightX * forwardZ;
+    float upZ = rightX * forwardY - rightY * forwardX;
+
+    const float degToRad = 3.14159265f / 180.0f; // gluPerspective takes true degrees
+    float tanY = tan(0.5f * view.fovYDegrees * degToRad);
+    float tanX = tanY * view.aspect;
+
+    // Side planes: normal = forward * tan - side, normalised, through the eye
+    auto sidePlane = [&](FrustumPlane& plane, float sideX, float sideY, float sideZ, float tanAngle) {
+        float x = forwardX * tanAngle - sideX;
+        float y = forwardY * tanAngle - sideY;
+        float z = forwardZ * tanAngle - sideZ;
+        float length = sqrt(x * x + y * y + z * z);
+        plane.nx = x / length;
+        plane.ny = y / length;
+        plane.nz = z / length;
+        plane.d = -(plane.nx * view.eyeX + plane.ny * view.eyeY + plane.nz * view.eyeZ);
+    };
+    sidePlane(planes[0], rightX, rightY, rightZ, tanX);
+    sidePlane(planes[1], -rightX, -rightY, -rightZ, tanX);
+    sidePlane(planes[2], upX, upY, upZ, tanY);
+    sidePlane(planes[3], -upX, -upY, -upZ, tanY);
+
+    float eyeAlongForward = forwardX * view.eyeX + forwardY * view.eyeY + forwardZ * view.eyeZ;
+    planes[4] = { forwardX, forwardY, forwardZ, -(eyeAlongForward + view.zNear) };
+    planes[5] = { -forwardX, -forwardY, -forwardZ, eyeAlongForward + view.zFar };
+}
+
+static bool sphereVisible(const FrustumPlane planes[6], float x, float y, float z, float radius) {
+    for (int i = 0; i < 6; i++) {
+        if (planes[i].nx * x + planes[i].ny * y + planes[i].nz * z + planes[i].d < -radius) return false;
+    }
+    return true;
+}
+
+// Kind (2 bits) | LOD (2 bits) | distance^2 as float bits (31 bits, order-preserving for positives) | index (28 bits)
+static uint64_t makeSortKey(int kind, int lod, float distanceSquared, int index) {
+    uint32_t distanceBits;
+    memcpy(&distanceBits, &distanceSquared, sizeof(distanceBits));
+    return ((uint64_t)kind << 62) | ((uint64_t)lod << 60) | ((uint64_t)(distanceBits & 0x7FFFFFFFu) << 28) | (uint64_t)(index & 0x0FFFFFFF);
+}
+
+// Culls one object and records it in the worker's buffer if it's visible
+static void addItem(const PrepJob& job, std::vector<RenderItem>& buffer, int kind, int index,
+                    float x, float y, float z, float radius) {
+    if (!sphereVisible(job.planes, x, y, z, radius)) return;
+
+    float dx = x - job.eyeX, dy = y - job.eyeY, dz = z - job.eyeZ;
+    float distanceSquared = dx * dx + dy * dy + dz * dz;
+    int lod = distanceSquared < lodDistance1 * lodDistance1 ? 0 : distanceSquared < lodDistance2 * lodDistance2 ? 1 : 2;
+
+    RenderItem item = { makeSortKey(kind, lod, distanceSquared, index), kind, lod, index };
+    buffer.push_back(item);
+}
+
+// Worker body: objects [begin, end) of robots, then spheres, then bullets as one index space
+static void prepareRange(int begin, int end, int worker, void* context) {
+    const PrepJob& job = *(const PrepJob*)context;
+    const SimSnapshot& snapshot = *job.snapshot;
+    std::vector<RenderItem>& buffer = (*job.buffers)[worker];
+
+    for (int i = begin; i < end; i++) {
+        if (i < job.robotCount) {
+            const Robot& robot = snapshot.robots[i];
+            if (robot.isActive) {
+                addItem(job, buffer, ITEM_ROBOT, i, robot.pos.x, robot.pos.y, robot.pos.z, robotCullRadius * scaleRobot);
+            }
+            // The flash is drawn whether or not the robot is still active
+            if (snapshot.robotDetails[i].isHit) {
+                addItem(job, buffer, ITEM_HIT_FLASH, i, robot.pos.x, robot.pos.y, robot.pos.z, robotRadius());
+            }
+        }
+        else if (i < job.robotCount + job.sphereCount) {
+            int index = i - job.robotCount;
+            const Sphere& sphere = snapshot.spheres[index];
+            addItem(job, buffer, ITEM_SPHERE, index, sphere.x, sphere.y, sphere.z, sphereCullRadius);
+        }
+        else {
+            int index = i - job.robotCount - job.sphereCount;
+            const Bullet& bullet = snapshot.bullets[index];
+            addItem(job, buffer, ITEM_BULLET, index, bullet.x, bullet.y, bullet.z, bulletCullRadius);
+        }
+    }
+}
+
+static bool itemLess(const RenderItem& a, const RenderItem& b) {
+    return a.sortKey < b.sortKey;
+}
+
+static void sortBuffers(int begin, int end, int worker, void* context) {
+    for (int i = begin; i < end; i++) {
+        std::sort(workerBuffers[i].begin(), workerBuffers[i].end(), itemLess);
+    }
+}
+
+void prepareRenderItems(const SimSnapshot& snapshot, const RenderView& view, std::vector<RenderItem>& items) {
+    // Room for every item the snapshot's storage can hold (a robot can be two: itself and its hit
+    // flash), in each buffer since a worker may take every chunk. That storage follows the sim's,
+    // which only grows in explicit events, so frames don't allocate as the counts change
+    size_t mostItems = 2 * snapshot.robots.capacity() + snapshot.spheres.capacity() + snapshot.bullets.capacity();
+    int workers = workerCount();
+    if ((int)workerBuffers.size() < workers || items.capacity() < mostItems) {
+        ALLOW_ALLOCATIONS();
+        workerBuffers.resize(workers);
+        for (std::vector<RenderItem>& buffer : workerBuffers) buffer.reserve(mostItems);
+        items.reserve(mostItems);
+        mergeScratch.reserve(mostItems);
+    }
+    for (std::vector<RenderItem>& buffer : workerBuffers) buffer.clear();
+
+    PrepJob job;
+    job.snapshot = &snapshot;
+    buildFrustum(view, job.planes);
+    job.eyeX = view.eyeX;
+    job.eyeY = view.eyeY;
+    job.eyeZ = view.eyeZ;
+    job.robotCount = (int)snapshot.robots.size();
+    job.sphereCount = (int)snapshot.spheres.size();
+    job.bulletCount = (int)snapshot.bullets.size();
+    job.buffers = &workerBuffers;
+
+    parallelFor(job.robotCount + job.sphereCount + job.bulletCount, prepGrain, prepareRange, &job);
+    parallelFor(workers, 1, sortBuffers, nullptr);
+
+    // Merge the sorted per-worker buffers into one list (through a kept scratch list, so no allocation)
+    items.clear();
+    for (const std::vector<RenderItem>& buffer : workerBuffers) {
+        mergeScratch.resize(items.size() + buffer.size());
+        std::merge(items.begin(), items.end(), buffer.begin(), buffer.end(), mergeScratch.begin(), itemLess);
+        items.swap(mergeScratch);
+    }
+}
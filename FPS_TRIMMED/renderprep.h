@@ -0,0 +1,34 @@
+#pragma once
+// Render preparation: turns a sim snapshot into the sorted list of things to draw this frame
+// Frustum culling, LOD selection and sort keys are computed on the worker threads, each writing
+// its own command buffer. The buffers are sorted in parallel and merged, and display() then
+// submits the merged list on the GL thread. Nothing in here calls GL.
+#include "simthread.h"
+#include <cstdint>
+#include <vector>
+
+enum RenderItemKind {
+    ITEM_ROBOT,     // Textured: drawn first so the texture stays bound
+    ITEM_HIT_FLASH, // Red sphere over a robot that was just hit
+    ITEM_SPHERE,
+    ITEM_BULLET
+};
+
+const int renderLodCount = 3; // 0 = full detail; each level halves the tessellation
+
+struct RenderItem {
+    uint64_t sortKey; // Kind, then LOD, then front-to-back distance (then index, for determinism)
+    int kind;
+    int lod;
+    int index;        // Into the snapshot's robots, spheres or bullets
+};
+
+// Camera the items are culled and sorted against (matches setCamera() and reshape())
+struct RenderView {
+    float eyeX, eyeY, eyeZ;
+    float angleH, angleV;
+    float fovYDegrees, aspect, zNear, zFar;
+};
+
+// Fills `items` with the visible objects of the snapshot, sorted by sortKey
+void prepareRenderItems(const SimSnapshot& snapshot, const RenderView& view, std::vector<RenderItem>& items);
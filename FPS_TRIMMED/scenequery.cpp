@@ -0,0 +1,808 @@
+#include "scenequery.h"
+#include "alloctrack.h"
+#include "pose.h"
+#include "sim.h"
+#include "workers.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+const int maxLeafObjects = 2;         // Robots are tested limb by limb: leaves are kept small
+const int splitBins = 16;             // Candidate split planes per axis, for the surface area heuristic
+const int maxTreeDepth = 64;          // Traversal stack; the build keeps every leaf within this many levels
+const float rebuildAreaRatio = 2.0f;  // Rebuild once refits have doubled the boxes' total area
+const float arenaThickness = 1.0f;    // The floor and walls as boxes this thick, outside the arena
+const int queryGrain = 64;            // Queries per chunk handed to a job thread
+const int refitGrain = 256;           // Objects per chunk when refitting
+const float emptyBound = 1e30f;
+
+// count > 0: a leaf holding objects [first, first + count); 0: children first and first + 1;
+// -1: unused (a leaf whose last object left, or the sibling that took its parent's place)
+// Children always come after their parent, so a reverse walk over the array refits bottom-up
+typedef struct SceneNode {
+    glm::vec3 boundsMin;
+    int first;
+    glm::vec3 boundsMax;
+    int count;
+} SceneNode;
+
+typedef struct BuildEntry {
+    int order;  // Position in object order
+    glm::vec3 boundsMin, boundsMax;
+} BuildEntry;
+
+typedef struct BuildTask {
+    int node, depth;
+} BuildTask;
+
+// Objects in object order are each robot, the spheres, then the cannon; only the ones that are
+// there (living robots) are in the tree
+struct SceneTree {
+    std::vector<SceneNode> nodes;
+    std::vector<int> parents;                       // Of each node, -1 for the root
+    std::vector<SceneObject> objects;               // In leaf order
+    std::vector<glm::vec3> objectMin, objectMax;    // Their boxes, same order
+    std::vector<int> leaves;                        // The node holding each, same order
+    std::vector<int> slots;                         // Leaf position of each object in object order, or -1
+    std::vector<BuildEntry> entries;                // Build scratch
+    std::vector<BuildTask> buildStack;
+    int robotCount = -1, sphereCount = -1;          // What the shape was built for
+    float builtArea = 0.0f;                         // Total node area right after the last build
+    bool stale = true;                              // The sim has moved on since the last refit
+    std::atomic<bool> robotsChanged{ false };       // A refit found robots that died or came back
+    int rebuilds = 0;
+};
+static SceneTree tree;
+static SceneQueryStats queryStats;
+
+//// Objects
+// The floor and walls are kept out of the tree (boxes that size would widen every node above them)
+// and tested directly by each query
+static const glm::vec3 arenaMin[NUM_ARENA_PARTS] = {
+    glm::vec3(-planeSize, -arenaThickness, -planeSize),
+    glm::vec3(-planeSize, 0.0f, -planeSize - arenaThickness),
+    glm::vec3(-planeSize, 0.0f, planeSize),
+    glm::vec3(-planeSize - arenaThickness, 0.0f, -planeSize),
+    glm::vec3(planeSize, 0.0f, -planeSize),
+};
+static const glm::vec3 arenaMax[NUM_ARENA_PARTS] = {
+    glm::vec3(planeSize, 0.0f, planeSize),
+    glm::vec3(planeSize, planeSize, -planeSize),
+    glm::vec3(planeSize, planeSize, planeSize + arenaThickness),
+    glm::vec3(-planeSize, planeSize, planeSize),
+    glm::vec3(planeSize + arenaThickness, planeSize, planeSize),
+};
+
+static inline bool robotAlive(int index) {
+    return index < (int)robots.size() && robots[index].isActive && !robots[index].isDestroyed;
+}
+
+// Whether the object is still there, for queries between refits (robots shot, spheres removed)
+static inline bool objectPresent(const SceneObject& object) {
+    if (object.type == SCENE_ROBOT) return robotAlive(object.index);
+    if (object.type == SCENE_SPHERE) return object.index < (int)spheres.size();
+    return true;
+}
+
+static inline SceneObject objectAt(int order) {
+    SceneObject object = { SCENE_ROBOT, order };
+    if (order >= tree.robotCount) {
+        object.index = order - tree.robotCount;
+        object.type = object.index < tree.sphereCount ? SCENE_SPHERE : SCENE_CANNON;
+        if (object.type == SCENE_CANNON) object.index = 0;
+    }
+    return object;
+}
+
+static inline int objectOrder(const SceneObject& object) {
+    if (object.type == SCENE_ROBOT) return object.index;
+    if (object.type == SCENE_SPHERE) return tree.robotCount + object.index;
+    return tree.robotCount + tree.sphereCount;
+}
+
+// A sphere or the cannon as a sphere; false when it's gone
+static inline bool objectSphere(const SceneObject& object, glm::vec3& center, float& radius) {
+    if (object.type == SCENE_SPHERE) {
+        if (object.index >= (int)spheres.size()) return false;
+        center = glm::vec3(spheres[object.index].x, spheres[object.index].y, spheres[object.index].z);
+        radius = sphereHitThreshold;
+        return true;
+    }
+    center = glm::vec3(cannonCollisionSphere.x, cannonCollisionSphere.y, cannonCollisionSphere.z);
+    radius = cannonCollisionSphere.radius;
+    return true;
+}
+
+// The box around the object; false when it's gone. A robot's is the one around its limbs, found
+// without posing it (pose.h), so refitting never touches the joint matrices
+static bool computeObject(const SceneObject& object, glm::vec3& boundsMin, glm::vec3& boundsMax) {
+    if (object.type == SCENE_ROBOT) {
+        if (!robotAlive(object.index)) return false;
+        boundRobots(object.index, 1, &boundsMin, &boundsMax);
+        return true;
+    }
+    glm::vec3 center;
+    float radius;
+    if (!objectSphere(object, center, radius)) return false;
+    boundsMin = center - glm::vec3(radius);
+    boundsMax = center + glm::vec3(radius);
+    return true;
+}
+
+static inline float surfaceArea(const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 size = boundsMax - boundsMin;
+    if (size.x < 0.0f || size.y < 0.0f || size.z < 0.0f) return 0.0f;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+// Smallest d with 2^d >= count: the depth a median split needs to get count objects to leaves
+static inline int levelsBelow(int count) {
+    int levels = 0;
+    while ((1 << levels) < count) levels++;
+    return levels;
+}
+
+//// Build and refit
+void reserveSceneTree(int robotCount, int sphereCount) {
+    size_t objectCount = (size_t)(robotCount + sphereCount + 1);
+    if (tree.objects.capacity() >= objectCount) return;
+    tree.nodes.reserve(2 * objectCount);
+    tree.parents.reserve(2 * objectCount);
+    tree.objects.reserve(objectCount);
+    tree.objectMin.reserve(objectCount);
+    tree.objectMax.reserve(objectCount);
+    tree.leaves.reserve(objectCount);
+    tree.slots.reserve(objectCount);
+    tree.entries.reserve(objectCount);
+    tree.buildStack.reserve(2 * maxTreeDepth);
+}
+
+// Median of entries [first, first + count) on the longest axis of their centres; ties broken by
+// object, so the shape only depends on the positions
+static int medianSplit(int first, int count) {
+    glm::vec3 low(emptyBound), high(-emptyBound);
+    for (int i = first; i < first + count; i++) {
+        glm::vec3 center = tree.entries[i].boundsMin + tree.entries[i].boundsMax;
+        low = glm::min(low, center);
+        high = glm::max(high, center);
+    }
+    int axis = 0;
+    for (int a = 1; a < 3; a++) {
+        if (high[a] - low[a] > high[axis] - low[axis]) axis = a;
+    }
+    int middle = first + count / 2;
+    std::nth_element(tree.entries.begin() + first, tree.entries.begin() + middle, tree.entries.begin() + first + count,
+        [axis](const BuildEntry& a, const BuildEntry& b) {
+            float centerA = a.boundsMin[axis] + a.boundsMax[axis], centerB = b.boundsMin[axis] + b.boundsMax[axis];
+            return centerA != centerB ? centerA < centerB : a.order < b.order;
+        });
+    return middle;
+}
+
+// Splits entries [first, first + count) of a node at `depth` and returns where the second half
+// starts. Binned surface area heuristic: the centres are sorted into splitBins slabs per axis, and
+// the plane between slabs that minimises (area x objects) summed over both sides wins. Falls back
+// to the median when no plane separates anything, or when a side would be too big to reach leaves
+// within maxTreeDepth (the median always can: it halves the count per level). Nodes with no more
+// objects than bins take the median straight away: the bins cost more than they'd find there
+static int splitEntries(int first, int count, int depth) {
+    if (count <= splitBins) return medianSplit(first, count);
+
+    glm::vec3 low(emptyBound), high(-emptyBound);
+    for (int i = first; i < first + count; i++) {
+        glm::vec3 center = tree.entries[i].boundsMin + tree.entries[i].boundsMax; // Twice the centre
+        low = glm::min(low, center);
+        high = glm::max(high, center);
+    }
+
+    struct Bin {
+        glm::vec3 boundsMin, boundsMax;
+        int count;
+    };
+    int bestAxis = -1, bestSplit = 0;
+    float bestCost = emptyBound;
+    for (int axis = 0; axis < 3; axis++) {
+        float extent = high[axis] - low[axis];
+        if (extent <= 0.0f) continue;
+        const float toBin = splitBins * 0.9999f / extent;
+
+        Bin bins[splitBins];
+        for (Bin& bin : bins) bin = { glm::vec3(emptyBound), glm::vec3(-emptyBound), 0 };
+        for (int i = first; i < first + count; i++) {
+            const BuildEntry& entry = tree.entries[i];
+            Bin& bin = bins[(int)((entry.boundsMin[axis] + entry.boundsMax[axis] - low[axis]) * toBin)];
+            bin.boundsMin = glm::min(bin.boundsMin, entry.boundsMin);
+            bin.boundsMax = glm::max(bin.boundsMax, entry.boundsMax);
+            bin.count++;
+        }
+
+        // Area and count of the bins above each plane, then sweep up from the bottom
+        float aboveArea[splitBins];
+        int aboveCount[splitBins];
+        glm::vec3 boundsMin(emptyBound), boundsMax(-emptyBound);
+        int objects = 0;
+        for (int b = splitBins - 1; b > 0; b--) {
+            boundsMin = glm::min(boundsMin, bins[b].boundsMin);
+            boundsMax = glm::max(boundsMax, bins[b].boundsMax);
+            objects += bins[b].count;
+            aboveArea[b] = surfaceArea(boundsMin, boundsMax);
+            aboveCount[b] = objects;
+        }
+        boundsMin = glm::vec3(emptyBound);
+        boundsMax = glm::vec3(-emptyBound);
+        objects = 0;
+        for (int b = 1; b < splitBins; b++) {
+            boundsMin = glm::min(boundsMin, bins[b - 1].boundsMin);
+            boundsMax = glm::max(boundsMax, bins[b - 1].boundsMax);
+            objects += bins[b - 1].count;
+            if (objects == 0 || aboveCount[b] == 0) continue;
+            float cost = surfaceArea(boundsMin, boundsMax) * objects + aboveArea[b] * aboveCount[b];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = b;
+            }
+        }
+    }
+
+    if (bestAxis >= 0) {
+        const float split = low[bestAxis] + (high[bestAxis] - low[bestAxis]) * bestSplit / (splitBins * 0.9999f);
+        const int axis = bestAxis;
+        BuildEntry* middle = std::partition(tree.entries.data() + first, tree.entries.data() + first + count,
+            [axis, split](const BuildEntry& entry) { return entry.boundsMin[axis] + entry.boundsMax[axis] < split; });
+        int below = (int)(middle - (tree.entries.data() + first));
+        if (below > 0 && below < count && depth + 1 + levelsBelow(std::max(below, count - below)) <= maxTreeDepth) {
+            return first + below;
+        }
+    }
+    return medianSplit(first, count);
+}
+
+// Total area of the nodes, a measure of how much a query has to look at. Bottom-up over the array
+static float refitNodes() {
+    float area = 0.0f;
+    for (int n = (int)tree.nodes.size() - 1; n >= 0; n--) {
+        SceneNode& node = tree.nodes[n];
+        if (node.count < 0) continue;
+        glm::vec3 boundsMin(emptyBound), boundsMax(-emptyBound);
+        if (node.count > 0) {
+            for (int i = node.first; i < node.first + node.count; i++) {
+                boundsMin = glm::min(boundsMin, tree.objectMin[i]);
+                boundsMax = glm::max(boundsMax, tree.objectMax[i]);
+            }
+        }
+        else {
+            const SceneNode& left = tree.nodes[node.first];
+            const SceneNode& right = tree.nodes[node.first + 1];
+            boundsMin = glm::min(left.boundsMin, right.boundsMin);
+            boundsMax = glm::max(left.boundsMax, right.boundsMax);
+        }
+        node.boundsMin = boundsMin;
+        node.boundsMax = boundsMax;
+        area += surfaceArea(boundsMin, boundsMax);
+    }
+    return area;
+}
+
+// Builds the shape around the objects that are there, leaves of up to maxLeafObjects
+static void buildSceneTree() {
+    const int robotCount = (int)robots.size();
+    const int sphereCount = (int)spheres.size();
+    {
+        // Grows only past what reserveSimStorage() sized for (spheres spawned past it)
+        ALLOW_ALLOCATIONS();
+        reserveSceneTree(robotCount, sphereCount);
+    }
+    tree.robotCount = robotCount;
+    tree.sphereCount = sphereCount;
+
+    const int orderCount = robotCount + sphereCount + 1;
+    tree.entries.clear();
+    for (int k = 0; k < orderCount; k++) {
+        BuildEntry entry;
+        entry.order = k;
+        if (computeObject(objectAt(k), entry.boundsMin, entry.boundsMax)) tree.entries.push_back(entry);
+    }
+    const int objectCount = (int)tree.entries.size(); // At least the cannon
+    tree.objects.resize(objectCount);
+    tree.objectMin.resize(objectCount);
+    tree.objectMax.resize(objectCount);
+    tree.leaves.resize(objectCount);
+
+    tree.nodes.clear();
+    tree.parents.clear();
+    SceneNode root = { glm::vec3(0.0f), 0, glm::vec3(0.0f), objectCount };
+    tree.nodes.push_back(root);
+    tree.parents.push_back(-1);
+    tree.buildStack.clear();
+    tree.buildStack.push_back({ 0, 0 });
+    while (!tree.buildStack.empty()) {
+        BuildTask task = tree.buildStack.back();
+        tree.buildStack.pop_back();
+        int first = tree.nodes[task.node].first;
+        int count = tree.nodes[task.node].count;
+        if (count <= maxLeafObjects) {
+            for (int i = first; i < first + count; i++) tree.leaves[i] = task.node;
+            continue;
+        }
+
+        int middle = splitEntries(first, count, task.depth);
+        int left = (int)tree.nodes.size();
+        SceneNode leftNode = { glm::vec3(0.0f), first, glm::vec3(0.0f), middle - first };
+        SceneNode rightNode = { glm::vec3(0.0f), middle, glm::vec3(0.0f), first + count - middle };
+        tree.nodes.push_back(leftNode);
+        tree.nodes.push_back(rightNode);
+        tree.parents.push_back(task.node);
+        tree.parents.push_back(task.node);
+        tree.nodes[task.node].first = left;
+        tree.nodes[task.node].count = 0;
+        tree.buildStack.push_back({ left + 1, task.depth + 1 });
+        tree.buildStack.push_back({ left, task.depth + 1 });
+    }
+
+    tree.slots.assign(orderCount, -1);
+    for (int i = 0; i < objectCount; i++) {
+        const BuildEntry& entry = tree.entries[i];
+        tree.objects[i] = objectAt(entry.order);
+        tree.objectMin[i] = entry.boundsMin;
+        tree.objectMax[i] = entry.boundsMax;
+        tree.slots[entry.order] = i;
+    }
+    tree.builtArea = refitNodes();
+    tree.rebuilds++;
+}
+
+// Takes a robot that died out of its leaf. The leaf's last object moves into its place; a leaf
+// left empty is dropped, and its sibling moves up into their parent's node
+static void removeRobot(int robotIndex) {
+    int slot = tree.slots[robotIndex];
+    int leaf = tree.leaves[slot];
+    SceneNode& node = tree.nodes[leaf];
+    int last = node.first + node.count - 1;
+    tree.objects[slot] = tree.objects[last];
+    tree.objectMin[slot] = tree.objectMin[last];
+    tree.objectMax[slot] = tree.objectMax[last];
+    tree.slots[objectOrder(tree.objects[slot])] = slot;
+    tree.slots[robotIndex] = -1;
+    if (--node.count > 0) return;
+
+    // The cannon is never removed, so the root is never the leaf emptied
+    int parent = tree.parents[leaf];
+    SceneNode& parentNode = tree.nodes[parent];
+    int sibling = parentNode.first == leaf ? leaf + 1 : leaf - 1;
+    SceneNode& siblingNode = tree.nodes[sibling];
+    parentNode.first = siblingNode.first;
+    parentNode.count = siblingNode.count;
+    if (siblingNode.count > 0) {
+        for (int i = siblingNode.first; i < siblingNode.first + siblingNode.count; i++) tree.leaves[i] = parent;
+    }
+    else {
+        tree.parents[siblingNode.first] = parent;
+        tree.parents[siblingNode.first + 1] = parent;
+    }
+    node.count = -1;
+    siblingNode.count = -1;
+}
+
+// In object order, so the robots are read straight through, and boxed refitGrain at a time
+// (pose.h; chunks can be bigger). Robots whose presence no longer matches the tree are left for
+// refitSceneTree() to sort out
+static void refitObjects(int begin, int end, int worker, void* context) {
+    glm::vec3 robotMin[refitGrain], robotMax[refitGrain];
+    for (int block = begin; block < end; block += refitGrain) {
+        const int blockEnd = std::min(block + refitGrain, end);
+        const int robotEnd = std::min(blockEnd, tree.robotCount);
+        if (block < robotEnd) boundRobots(block, robotEnd - block, robotMin, robotMax);
+        for (int k = block; k < blockEnd; k++) {
+            int slot = tree.slots[k];
+            bool present = k < tree.robotCount ? robotAlive(k) : true;
+            if (present != (slot >= 0)) {
+                tree.robotsChanged.store(true, std::memory_order_relaxed);
+                continue;
+            }
+            if (slot < 0) continue;
+            if (k < robotEnd) {
+                tree.objectMin[slot] = robotMin[k - block];
+                tree.objectMax[slot] = robotMax[k - block];
+            }
+            else computeObject(objectAt(k), tree.objectMin[slot], tree.objectMax[slot]);
+        }
+    }
+}
+
+// Refits the tree to the sim as it is now, rebuilding it when objects came (or went, for all but
+// robots) or once the movers have drifted far enough that the refitted boxes overlap badly
+static void refitSceneTree() {
+    tree.stale = false;
+    if ((int)robots.size() != tree.robotCount || (int)spheres.size() != tree.sphereCount) {
+        buildSceneTree();
+        return;
+    }
+
+    tree.robotsChanged.store(false, std::memory_order_relaxed);
+    parallelFor((int)tree.slots.size(), refitGrain, refitObjects, nullptr);
+    if (tree.robotsChanged.load(std::memory_order_relaxed)) {
+        for (int k = 0; k < tree.robotCount; k++) {
+            bool present = robotAlive(k);
+            if (present && tree.slots[k] < 0) { // Back from the dead: it needs a place in the shape
+                buildSceneTree();
+                return;
+            }
+            if (!present && tree.slots[k] >= 0) removeRobot(k);
+        }
+    }
+
+    if (refitNodes() > rebuildAreaRatio * tree.builtArea) buildSceneTree();
+}
+
+void invalidateSceneTree() {
+    tree.stale = true;
+}
+
+//// Primitive tests
+// Distance along the ray to where it enters the box, or -1 (0 from inside); inverseDir is 1 / dir
+static inline float rayBox(const glm::vec3& origin, const glm::vec3& inverseDir, const glm::vec3& boundsMin, const glm::vec3& boundsMax, float maxDistance) {
+    float t1 = (boundsMin.x - origin.x) * inverseDir.x, t2 = (boundsMax.x - origin.x) * inverseDir.x;
+    float enter = std::min(t1, t2), leave = std::max(t1, t2);
+    t1 = (boundsMin.y - origin.y) * inverseDir.y;
+    t2 = (boundsMax.y - origin.y) * inverseDir.y;
+    enter = std::max(enter, std::min(t1, t2));
+    leave = std::min(leave, std::max(t1, t2));
+    t1 = (boundsMin.z - origin.z) * inverseDir.z;
+    t2 = (boundsMax.z - origin.z) * inverseDir.z;
+    enter = std::max(enter, std::min(t1, t2));
+    leave = std::min(leave, std::max(t1, t2));
+    if (leave < enter || leave < 0.0f || enter > maxDistance) return -1.0f;
+    return std::max(enter, 0.0f);
+}
+
+// Distance along the ray to the sphere, or -1; the origin is outside it
+static inline float raySphere(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& center, float radius) {
+    glm::vec3 toOrigin = origin - center;
+    float b = glm::dot(dir, toOrigin);
+    float h = b * b - (glm::dot(toOrigin, toOrigin) - radius * radius);
+    if (h < 0.0f || b > 0.0f) return -1.0f;
+    return -b - sqrtf(h);
+}
+
+// Distance along the ray to the sphere, or -1 (0 from inside)
+static inline float raySphereFrom(const glm::vec3& origin, const glm::vec3& dir, const glm::vec3& center, float radius) {
+    glm::vec3 toOrigin = origin - center;
+    if (glm::dot(toOrigin, toOrigin) <= radius * radius) return 0.0f;
+    return raySphere(origin, dir, center, radius);
+}
+
+// Squared distance from the point to the box (0 inside); the walks compare it with squared limits
+static inline float pointBoxDistanceSquared(const glm::vec3& point, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 outside = glm::max(glm::max(boundsMin - point, point - boundsMax), glm::vec3(0.0f));
+    return glm::dot(outside, outside);
+}
+
+// Results are ordered by distance, then object and limb, so they don't depend on the tree's shape
+static inline bool objectLess(const SceneObject& a, const SceneObject& b) {
+    return a.type != b.type ? a.type < b.type : a.index < b.index;
+}
+
+static inline bool closer(float distance, const SceneObject& object, int limb, const SceneHit& best) {
+    if (best.object.type < 0) return distance <= best.distance;
+    if (distance != best.distance) return distance < best.distance;
+    if (objectLess(object, best.object)) return true;
+    return !objectLess(best.object, object) && limb < best.limb;
+}
+
+static inline void keepHit(const SceneObject& object, int limb, float distance, SceneHit& hit) {
+    hit.object = object;
+    hit.limb = limb;
+    hit.distance = distance;
+}
+
+// The object's surface along the ray within maxDistance, or -1, and the limb hit (robots)
+static inline float raycastObject(const SceneObject& object, const SceneRay& ray, float maxDistance, int& limb) {
+    if (object.type == SCENE_ROBOT) return raycastLimbs(object.index, ray.origin, ray.dir, maxDistance, limb);
+    glm::vec3 center;
+    float radius;
+    limb = -1;
+    if (!objectSphere(object, center, radius)) return -1.0f;
+    float distance = raySphereFrom(ray.origin, ray.dir, center, radius);
+    return distance <= maxDistance ? distance : -1.0f;
+}
+
+// Distance from the point to the object's surface (0 inside), if within `within`, or -1
+static inline float objectDistance(const SceneObject& object, const glm::vec3& point, float within, int& limb) {
+    if (object.type == SCENE_ROBOT) return limbSurfaceDistance(object.index, point, within, limb);
+    glm::vec3 center;
+    float radius;
+    limb = -1;
+    if (!objectSphere(object, center, radius)) return -1.0f;
+    float distance = std::max(glm::length(point - center) - radius, 0.0f);
+    return distance <= within ? distance : -1.0f;
+}
+
+// Whether any part of the object is closer than radius to the point
+static inline bool objectTouches(const SceneObject& object, const glm::vec3& point, float radius) {
+    if (object.type == SCENE_ROBOT) return limbWithin(object.index, point, radius) >= 0;
+    int limb;
+    float distance = objectDistance(object, point, radius, limb);
+    return distance >= 0.0f && distance < radius;
+}
+
+//// Queries
+// A node left for later, and how far from the query it is (along the ray, or squared from the point)
+typedef struct StackEntry {
+    int node;
+    float distance;
+} StackEntry;
+
+// The next node on the stack that is still within `limit`, or -1
+static inline int popNode(const StackEntry* stack, int& top, float limit) {
+    while (top > 0) {
+        const StackEntry& entry = stack[--top];
+        if (entry.distance <= limit) return entry.node;
+    }
+    return -1;
+}
+
+// With anyHit, stops at the first object found rather than the nearest
+static void raycastOne(const SceneRay& ray, SceneHit& hit, bool anyHit) {
+    hit.object.type = -1;
+    hit.object.index = -1;
+    hit.limb = -1;
+    hit.distance = ray.maxDistance;
+
+    const glm::vec3 inverseDir(1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z);
+    // The floor and walls first: they are few, and shorten the ray before the tree is walked
+    if (ray.mask & SCENE_MASK_ARENA) {
+        for (int p = 0; p < NUM_ARENA_PARTS; p++) {
+            SceneObject object = { SCENE_ARENA, p };
+            float distance = rayBox(ray.origin, inverseDir, arenaMin[p], arenaMax[p], hit.distance);
+            if (distance < 0.0f || !closer(distance, object, -1, hit)) continue;
+            keepHit(object, -1, distance, hit);
+            if (anyHit) break;
+        }
+    }
+
+    // Nodes waiting on the stack keep the distance the ray enters them at: by the time one comes
+    // off, a nearer hit may have ruled it out
+    const SceneNode* nodes = tree.nodes.data();
+    StackEntry stack[maxTreeDepth];
+    int top = 0;
+    int node = 0;
+    if ((anyHit && hit.object.type >= 0) ||
+        rayBox(ray.origin, inverseDir, nodes[0].boundsMin, nodes[0].boundsMax, hit.distance) < 0.0f) {
+        node = -1;
+    }
+
+    while (node >= 0) {
+        const SceneNode& current = nodes[node];
+        if (current.count > 0) {
+            for (int i = current.first; i < current.first + current.count; i++) {
+                const SceneObject& object = tree.objects[i];
+                if (!(ray.mask & (1u << object.type))) continue;
+                if (object.type == SCENE_ROBOT && object.index == ray.ignoreRobot) continue;
+                // A leaf of one object has the object's box, which the ray was just found to enter
+                float boxDistance = current.count > 1 || anyHit ? rayBox(ray.origin, inverseDir, tree.objectMin[i], tree.objectMax[i], hit.distance) : 0.0f;
+                if (boxDistance < 0.0f || !objectPresent(object)) continue;
+
+                // Line of sight takes a robot's box for the robot (occludedInScene())
+                int limb = -1;
+                float distance = anyHit && object.type == SCENE_ROBOT ? boxDistance : raycastObject(object, ray, hit.distance, limb);
+                if (distance < 0.0f || !closer(distance, object, limb, hit)) continue;
+                keepHit(object, limb, distance, hit);
+                if (anyHit) {
+                    hit.point = ray.origin + ray.dir * hit.distance;
+                    return;
+                }
+            }
+            node = popNode(stack, top, hit.distance);
+            continue;
+        }
+
+        // Nearer child first; the other waits on the stack unless the ray misses it
+        int left = current.first, right = current.first + 1;
+        float leftDistance = rayBox(ray.origin, inverseDir, nodes[left].boundsMin, nodes[left].boundsMax, hit.distance);
+        float rightDistance = rayBox(ray.origin, inverseDir, nodes[right].boundsMin, nodes[right].boundsMax, hit.distance);
+        if (leftDistance < 0.0f && rightDistance < 0.0f) {
+            node = popNode(stack, top, hit.distance);
+        }
+        else if (leftDistance < 0.0f || rightDistance < 0.0f) {
+            node = leftDistance < 0.0f ? right : left;
+        }
+        else {
+            bool leftFirst = leftDistance <= rightDistance;
+            stack[top++] = leftFirst ? StackEntry{ right, rightDistance } : StackEntry{ left, leftDistance }; // At most one per level
+            node = leftFirst ? left : right;
+        }
+    }
+    hit.point = ray.origin + ray.dir * hit.distance;
+}
+
+static void nearestOne(const SceneNearestQuery& query, SceneHit& hit) {
+    hit.object.type = -1;
+    hit.object.index = -1;
+    hit.limb = -1;
+    hit.distance = query.maxDistance;
+    hit.point = query.point;
+    if (query.mask & SCENE_MASK_ARENA) {
+        for (int p = 0; p < NUM_ARENA_PARTS; p++) {
+            SceneObject object = { SCENE_ARENA, p };
+            float distance = sqrtf(pointBoxDistanceSquared(query.point, arenaMin[p], arenaMax[p]));
+            if (closer(distance, object, -1, hit)) keepHit(object, -1, distance, hit);
+        }
+    }
+
+    const SceneNode* nodes = tree.nodes.data();
+    StackEntry stack[maxTreeDepth];
+    int top = 0;
+    int node = pointBoxDistanceSquared(query.point, nodes[0].boundsMin, nodes[0].boundsMax) <= hit.distance * hit.distance ? 0 : -1;
+    while (node >= 0) {
+        const SceneNode& current = nodes[node];
+        if (current.count > 0) {
+            for (int i = current.first; i < current.first + current.count; i++) {
+                const SceneObject& object = tree.objects[i];
+                if (!(query.mask & (1u << object.type))) continue;
+                if (current.count > 1 && pointBoxDistanceSquared(query.point, tree.objectMin[i], tree.objectMax[i]) > hit.distance * hit.distance) continue;
+                if (!objectPresent(object)) continue;
+
+                int limb;
+                float distance = objectDistance(object, query.point, hit.distance, limb);
+                if (distance >= 0.0f && closer(distance, object, limb, hit)) keepHit(object, limb, distance, hit);
+            }
+            node = popNode(stack, top, hit.distance * hit.distance);
+            continue;
+        }
+
+        // Nearer child first, as for rays
+        int left = current.first, right = current.first + 1;
+        float leftDistance = pointBoxDistanceSquared(query.point, nodes[left].boundsMin, nodes[left].boundsMax);
+        float rightDistance = pointBoxDistanceSquared(query.point, nodes[right].boundsMin, nodes[right].boundsMax);
+        const float limit = hit.distance * hit.distance;
+        if (leftDistance > limit && rightDistance > limit) {
+            node = popNode(stack, top, limit);
+        }
+        else if (leftDistance > limit || rightDistance > limit) {
+            node = leftDistance > limit ? right : left;
+        }
+        else {
+            bool leftFirst = leftDistance <= rightDistance;
+            stack[top++] = leftFirst ? StackEntry{ right, rightDistance } : StackEntry{ left, leftDistance };
+            node = leftFirst ? left : right;
+        }
+    }
+}
+
+static int overlapOne(const SceneSphereQuery& query, int maxResults, SceneObject* results) {
+    int found = 0;
+    const float radiusSquared = query.radius * query.radius;
+    if (query.mask & SCENE_MASK_ARENA) {
+        for (int p = 0; p < NUM_ARENA_PARTS && found < maxResults; p++) {
+            SceneObject object = { SCENE_ARENA, p };
+            if (pointBoxDistanceSquared(query.center, arenaMin[p], arenaMax[p]) < radiusSquared) results[found++] = object;
+        }
+    }
+
+    const SceneNode* nodes = tree.nodes.data();
+    int stack[maxTreeDepth];
+    int top = 0;
+    int node = 0;
+    while (node >= 0 && found < maxResults) {
+        const SceneNode& current = nodes[node];
+        if (pointBoxDistanceSquared(query.center, current.boundsMin, current.boundsMax) >= radiusSquared) {
+            node = top > 0 ? stack[--top] : -1;
+            continue;
+        }
+        if (current.count > 0) {
+            for (int i = current.first; i < current.first + current.count && found < maxResults; i++) {
+                const SceneObject& object = tree.objects[i];
+                if (!(query.mask & (1u << object.type))) continue;
+                if (current.count > 1 && pointBoxDistanceSquared(query.center, tree.objectMin[i], tree.objectMax[i]) >= radiusSquared) continue;
+                if (objectPresent(object) && objectTouches(object, query.center, query.radius)) results[found++] = object;
+            }
+            node = top > 0 ? stack[--top] : -1;
+            continue;
+        }
+        stack[top++] = current.first + 1;
+        node = current.first;
+    }
+    std::sort(results, results + found, objectLess);
+    return found;
+}
+
+//// Batches
+struct RayBatch {
+    const SceneRay* rays;
+    SceneHit* hits;
+};
+
+struct NearestBatch {
+    const SceneNearestQuery* queries;
+    SceneHit* hits;
+};
+
+struct OverlapBatch {
+    const SceneSphereQuery* queries;
+    int maxPerQuery;
+    SceneObject* objects;
+    int* counts;
+};
+
+static void raycastChunk(int begin, int end, int worker, void* context) {
+    RayBatch& batch = *(RayBatch*)context;
+    for (int i = begin; i < end; i++) raycastOne(batch.rays[i], batch.hits[i], false);
+}
+
+static void occlusionChunk(int begin, int end, int worker, void* context) {
+    RayBatch& batch = *(RayBatch*)context;
+    for (int i = begin; i < end; i++) raycastOne(batch.rays[i], batch.hits[i], true);
+}
+
+static void nearestChunk(int begin, int end, int worker, void* context) {
+    NearestBatch& batch = *(NearestBatch*)context;
+    for (int i = begin; i < end; i++) nearestOne(batch.queries[i], batch.hits[i]);
+}
+
+static void overlapChunk(int begin, int end, int worker, void* context) {
+    OverlapBatch& batch = *(OverlapBatch*)context;
+    for (int i = begin; i < end; i++) {
+        batch.counts[i] = overlapOne(batch.queries[i], batch.maxPerQuery, batch.objects + (size_t)i * batch.maxPerQuery);
+    }
+}
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void raycastScene(const SceneRay* rays, SceneHit* hits, int count) {
+    auto start = std::chrono::steady_clock::now();
+    if (tree.stale) refitSceneTree();
+    RayBatch batch = { rays, hits };
+    parallelFor(count, queryGrain, raycastChunk, &batch);
+    queryStats.rays += count;
+    queryStats.ms += millisecondsSince(start);
+}
+
+void occludedInScene(const SceneRay* rays, SceneHit* hits, int count) {
+    auto start = std::chrono::steady_clock::now();
+    if (tree.stale) refitSceneTree();
+    RayBatch batch = { rays, hits };
+    parallelFor(count, queryGrain, occlusionChunk, &batch);
+    queryStats.rays += count;
+    queryStats.ms += millisecondsSince(start);
+}
+
+void nearestInScene(const SceneNearestQuery* queries, SceneHit* hits, int count) {
+    auto start = std::chrono::steady_clock::now();
+    if (tree.stale) refitSceneTree();
+    NearestBatch batch = { queries, hits };
+    parallelFor(count, queryGrain, nearestChunk, &batch);
+    queryStats.nearest += count;
+    queryStats.ms += millisecondsSince(start);
+}
+
+int overlapScene(const SceneSphereQuery* queries, int count, int maxPerQuery, SceneObject* objects, int* counts) {
+    auto start = std::chrono::steady_clock::now();
+    if (tree.stale) refitSceneTree();
+    OverlapBatch batch = { queries, maxPerQuery, objects, counts };
+    parallelFor(count, queryGrain, overlapChunk, &batch);
+    int total = 0;
+    for (int i = 0; i < count; i++) total += counts[i];
+    queryStats.overlaps += count;
+    queryStats.ms += millisecondsSince(start);
+    return total;
+}
+
+SceneQueryStats sceneQueryStats() {
+    return queryStats;
+}
+
+void resetSceneQueryStats() {
+    queryStats = SceneQueryStats();
+}
+
+int sceneTreeNodeCount() {
+    return (int)tree.nodes.size();
+}
+
+int sceneTreeRebuildCount() {
+    return tree.rebuilds;
+}
@@ -0,0 +1,109 @@
+#pragma once
+// Scene queries: raycasts, sphere overlaps and nearest-object searches over the arena
+// A bounding volume hierarchy over the robots, spheres and the cannon, stored as one flat node
+// array; the arena's floor and walls, five boxes as big as the arena, are tested beside it. Its
+// shape (binned surface area heuristic, leaves of one or two objects) is rebuilt only when objects
+// are added, or once the movers have drifted far enough that refitted boxes overlap badly; robots
+// that die are just taken out of their leaves. Otherwise the boxes are refitted bottom-up, by the
+// first batch of queries after the sim has moved on, so ticks without queries never pay for it.
+// Queries come in batches that are split over the job threads; each walks the tree with a fixed
+// stack, nearest child first, and never allocates. A robot whose box (around its posed limbs) is
+// hit is then tested limb by limb (pose.h), so a ray through the gap under an arm misses; only
+// line-of-sight checks stop at the box.
+// Batches are issued from one thread at a time (the sim's).
+#include <glm/glm.hpp>
+
+enum SceneObjectType {
+    SCENE_ROBOT,  // Living robots; index into robots
+    SCENE_SPHERE, // Index into spheres
+    SCENE_CANNON, // The player's cannon (cannonCollisionSphere)
+    SCENE_ARENA,  // The floor and the four walls; index is a SceneArenaPart
+    NUM_SCENE_OBJECT_TYPES
+};
+
+enum SceneArenaPart {
+    ARENA_FLOOR,
+    ARENA_FRONT_WALL, // z = -planeSize
+    ARENA_BACK_WALL,  // z = planeSize
+    ARENA_LEFT_WALL,  // x = -planeSize
+    ARENA_RIGHT_WALL, // x = planeSize
+    NUM_ARENA_PARTS
+};
+
+// Which object types a query sees
+const unsigned int SCENE_MASK_ROBOTS = 1u << SCENE_ROBOT;
+const unsigned int SCENE_MASK_SPHERES = 1u << SCENE_SPHERE;
+const unsigned int SCENE_MASK_CANNON = 1u << SCENE_CANNON;
+const unsigned int SCENE_MASK_ARENA = 1u << SCENE_ARENA;
+const unsigned int SCENE_MASK_ALL = (1u << NUM_SCENE_OBJECT_TYPES) - 1;
+
+typedef struct SceneObject {
+    int type;  // SceneObjectType
+    int index;
+} SceneObject;
+
+typedef struct SceneRay {
+    glm::vec3 origin;
+    glm::vec3 dir;     // Unit length
+    float maxDistance;
+    unsigned int mask;
+    int ignoreRobot;   // A robot the ray starts inside (its own shooter), or -1
+} SceneRay;
+
+// Nearest-object queries look for the closest surface within maxDistance of point
+typedef struct SceneNearestQuery {
+    glm::vec3 point;
+    float maxDistance;
+    unsigned int mask;
+} SceneNearestQuery;
+
+typedef struct SceneSphereQuery {
+    glm::vec3 center;
+    float radius;
+    unsigned int mask;
+} SceneSphereQuery;
+
+// Result of a query; object.type is -1 when nothing was found
+typedef struct SceneHit {
+    SceneObject object;
+    int limb;          // RobotLimb, for robots
+    float distance;    // Along the ray / from the point to the surface (0 inside)
+    glm::vec3 point;   // Raycasts: where the ray entered the object
+} SceneHit;
+
+// Queries issued since the last resetSceneQueryStats() and the time spent on them
+typedef struct SceneQueryStats {
+    int rays, overlaps, nearest;
+    double ms;
+} SceneQueryStats;
+
+// The sim has moved on: the next batch of queries refits the tree to it first (simTick() calls
+// this once everything has moved)
+void invalidateSceneTree();
+
+// Sizes the tree for this many robots and spheres, so updates don't allocate (reserveSimStorage())
+void reserveSceneTree(int robotCount, int sphereCount);
+
+// hits[i] is the first object rays[i] enters (or, when it enters none, object.type is -1 and
+// distance and point are the end of the ray)
+void raycastScene(const SceneRay* rays, SceneHit* hits, int count);
+
+// Line-of-sight checks: hits[i] is any object rays[i] enters, not necessarily the first, so a
+// blocked ray stops looking as soon as it is blocked. Robots block it with their box (limb -1):
+// close enough to decide whether to fire, and in a crowd a muzzle sits inside dozens of other
+// robots' boxes, each of which limb tests would have to rule out first
+void occludedInScene(const SceneRay* rays, SceneHit* hits, int count);
+
+// hits[i] is the object whose surface is nearest queries[i].point
+void nearestInScene(const SceneNearestQuery* queries, SceneHit* hits, int count);
+
+// The objects each sphere touches: query i gets up to maxPerQuery of them, in
+// objects[i * maxPerQuery ...], and counts[i] says how many (more are dropped). Returns the total
+int overlapScene(const SceneSphereQuery* queries, int count, int maxPerQuery, SceneObject* objects, int* counts);
+
+SceneQueryStats sceneQueryStats();
+void resetSceneQueryStats();
+
+// Tree shape, for benchmarks and the perf panel
+int sceneTreeNodeCount();
+int sceneTreeRebuildCount();
@@ -0,0 +1,163 @@
+#include "server.h"
+#include "net.h"
+#include <algorithm>
+#include <vector>
+
+struct ServerClient {
+    NetAddress address;
+    uint32_t ackTick = 0;       // Newest snapshot the client decoded (0: none, send full)
+    uint32_t inputSequence = 0; // Newest input sequence number already applied
+    uint32_t lastHeardTick = 0;
+};
+
+// An encoded payload, kept for the rest of the tick: clients that acked the same tick share it
+struct EncodedSnapshot {
+    uint32_t tick = 0;
+    uint32_t baseTick = 0;
+    std::vector<uint8_t> payload;
+};
+const int encodeCacheSize = 4;
+
+static NetSocket serverSocket = invalidSocket;
+static int maxServerClients = 0;
+static std::vector<ServerClient> clients; // clients[0] drives the player
+static NetState history[serverHistoryTicks];
+static const NetState emptyState;
+static uint32_t tickCount = 0;
+static EncodedSnapshot encodeCache[encodeCacheSize];
+static int nextCacheSlot = 0;
+
+bool startServer(uint16_t port, int maxClients) {
+    stopServer();
+    serverSocket = openUdpSocket(port);
+    if (serverSocket == invalidSocket) return false;
+
+    maxServerClients = maxClients;
+    clients.clear();
+    tickCount = 0;
+    for (EncodedSnapshot& cached : encodeCache) cached.tick = 0;
+    for (NetState& state : history) state.tick = 0;
+
+    // Tick 0 is reserved for "no state", so the first recorded tick is 1
+    serverSimulate();
+    return true;
+}
+
+void stopServer() {
+    closeUdpSocket(serverSocket);
+    serverSocket = invalidSocket;
+}
+
+uint16_t serverPort() {
+    return boundAddress(serverSocket).port;
+}
+
+int serverClientCount() {
+    return (int)clients.size();
+}
+
+uint32_t serverTickCount() {
+    return tickCount;
+}
+
+const NetState* serverState(uint32_t tick) {
+    const NetState& state = history[tick % serverHistoryTicks];
+    return tick != 0 && state.tick == tick ? &state : nullptr;
+}
+
+static ServerClient* findClient(const NetAddress& address) {
+    for (ServerClient& client : clients) {
+        if (client.address == address) return &client;
+    }
+    if ((int)clients.size() >= maxServerClients) return nullptr;
+
+    ServerClient client;
+    client.address = address;
+    clients.push_back(client);
+    return &clients.back();
+}
+
+void serverReceive() {
+    uint8_t buffer[netMaxPacketSize];
+    NetAddress from;
+    NetInputPacket packet;
+    int size;
+    while ((size = receivePacket(serverSocket, from, buffer, sizeof(buffer))) >= 0) {
+        if (!readInputPacket(buffer, (size_t)size, packet)) continue; // Not ours, or damaged
+
+        ServerClient* client = findClient(from);
+        if (!client) continue; // Full
+        client->lastHeardTick = tickCount;
+        if (packet.ackTick <= tickCount && packet.ackTick > client->ackTick) client->ackTick = packet.ackTick;
+
+        // Inputs are resent until acknowledged: apply only the ones not seen yet
+        bool isDriver = client == &clients[0];
+        for (int i = 0; i < packet.inputCount; i++) {
+            uint32_t sequence = packet.firstInput + (uint32_t)i;
+            if (sequence <= client->inputSequence) continue;
+            if (isDriver) applySimInput(packet.inputs[i]);
+            client->inputSequence = sequence;
+        }
+    }
+
+    // Drop clients that went quiet; if that was the driver, don't leave its keys held down
+    for (size_t i = clients.size(); i-- > 0;) {
+        if (tickCount - clients[i].lastHeardTick <= clientTimeoutTicks) continue;
+        if (i == 0) activeKeys.reset();
+        clients.erase(clients.begin() + i);
+    }
+}
+
+void serverSimulate() {
+    if (tickCount > 0) simTick(serverTickMs);
+    tickCount++;
+    captureNetState(tickCount, history[tickCount % serverHistoryTicks]);
+}
+
+// The payload for the current tick against baseTick, encoded at most once per tick
+static const std::vector<uint8_t>& snapshotPayload(uint32_t baseTick) {
+    for (EncodedSnapshot& cached : encodeCache) {
+        if (cached.tick == tickCount && cached.baseTick == baseTick) return cached.payload;
+    }
+
+    EncodedSnapshot& cached = encodeCache[nextCacheSlot];
+    nextCacheSlot = (nextCacheSlot + 1) % encodeCacheSize;
+    cached.tick = tickCount;
+    cached.baseTick = baseTick;
+    cached.payload.clear();
+    const NetState* base = serverState(baseTick);
+    encodeSnapshot(base ? *base : emptyState, *serverState(tickCount), cached.payload);
+    return cached.payload;
+}
+
+size_t serverSendSnapshot(int clientIndex) {
+    const ServerClient& client = clients[clientIndex];
+    uint32_t baseTick = serverState(client.ackTick) ? client.ackTick : 0; // Too old (or none): full snapshot
+    const std::vector<uint8_t>& payload = snapshotPayload(baseTick);
+
+    NetSnapshotFragment fragment;
+    fragment.tick = tickCount;
+    fragment.baseTick = baseTick;
+    fragment.inputAck = client.inputSequence;
+    fragment.payloadSize = (uint32_t)payload.size();
+    fragment.count = (uint16_t)((payload.size() + netFragmentCapacity - 1) / netFragmentCapacity);
+
+    uint8_t buffer[netMaxPacketSize];
+    size_t bytesSent = 0;
+    for (size_t offset = 0; offset < payload.size(); offset += netFragmentCapacity) {
+        fragment.data = payload.data() + offset;
+        fragment.dataSize = std::min(netFragmentCapacity, payload.size() - offset);
+        size_t size = writeSnapshotFragment(fragment, buffer);
+        if (sendPacket(serverSocket, client.address, buffer, size)) bytesSent += size;
+        fragment.index++;
+    }
+    return bytesSent;
+}
+
+void runServerTick() {
+    serverReceive();
+    serverSimulate();
+    for (int i = 0; i < serverClientCount(); i++) {
+        serverSendSnapshot(i);
+    }
+}
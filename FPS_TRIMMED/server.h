@@ -0,0 +1,32 @@
+#pragma once
+// Authoritative game server (headless: nothing in here touches GL/GLUT)
+// Clients send their input over UDP; every tick the server runs the sim and sends each client a
+// snapshot encoded against the newest state that client acknowledged (see netcodec.h). The sim has
+// a single player, so the first client to connect drives the camera and the rest spectate; when
+// the driver goes quiet the next client in line takes over.
+#include "netcodec.h"
+#include <cstddef>
+#include <cstdint>
+
+const unsigned int serverTickMs = 10;         // Same fixed step as the sim thread
+const uint32_t clientTimeoutTicks = 500;      // Clients silent for 5s are dropped
+const uint32_t serverHistoryTicks = 64;       // States kept as delta bases; older acks get a full snapshot
+
+// Binds the server socket (port 0 picks a free one); false if the socket couldn't be opened
+bool startServer(uint16_t port, int maxClients);
+void stopServer();
+uint16_t serverPort();
+
+// One server tick: serverReceive(), serverSimulate(), then serverSendSnapshot() for every client
+void runServerTick();
+
+// The steps of a tick, for callers that interleave their own work (the loopback test)
+void serverReceive();    // Drains waiting packets: joins, acks and the driver's inputs
+void serverSimulate();   // Advances the sim one step and records the quantised state
+size_t serverSendSnapshot(int clientIndex); // Returns the bytes sent, headers included
+
+int serverClientCount();
+uint32_t serverTickCount();
+
+// The state recorded for tick, or nullptr once it has left the history
+const NetState* serverState(uint32_t tick);
@@ -0,0 +1,1012 @@
+#include "sim.h"
+#include "alloctrack.h"
+#include "crowd.h"
+#include "flowfield.h"
+#include "pose.h"
+#include "scenequery.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+float scaleRobot = 2.0f; // Robot size
+
+// Camera position
+float cameraX = 0.0f, cameraY = 5.0f, cameraZ = planeSize - 5.0f; // Position at back of room
+float cameraAngleH = 0.0f; // Horizontal angle
+float cameraAngleV = 0.0f; // Vertical angle (for yaw)
+
+// Jumping mechanics
+bool isJumping = false;
+float jumpVelocity = 0.2f; // Vertical velocity
+
+// Key state tracking
+std::bitset<256> activeKeys;
+
+// Bullet container
+std::vector<Bullet> bullets;
+
+// Sphere container
+std::vector<Sphere> spheres;
+
+//// Robot Importing
+float robotFireInterval = 2000; // Bullet fire interval in MS
+float robotFireActive = false;
+
+std::vector<Robot> robots(NUM_ROBOTS);
+std::vector<RobotDetail> robotDetails(NUM_ROBOTS);
+
+// Cannon collision and disabling
+Sphere cannonCollisionSphere = { 0.0f, 0.0f, 0.0f, 2.0f }; // Cannon hitbox
+float cannonAngle = 0.0f;
+bool isCannonDisabled = false;
+
+TimerWheel simTimers;
+
+unsigned int nextBulletId = 1;
+
+RobotGait robotGait;
+
+JobGraph simJobs;
+SimTickStats simTickStats;
+std::vector<SimEffect> simEffects;
+
+// Bullets in flight the storage is sized for: robots fire once per robotFireInterval and a bullet
+// leaves the arena within a few seconds; the player's are limited by how fast they can fire
+const int bulletsInFlightPerRobot = 2;
+const int playerBulletsInFlight = 256;
+const int timersPerRobot = 2;          // Hit flash and destroy animation
+const float bulletArenaMargin = 2.0f;  // Bullets this far past a wall, the floor or the wall tops are dropped
+const float bulletSpeed = 0.5f;        // Units per tick
+
+static void emitEffect(SimEffectType type, float x, float y, float z, float dirX = 0.0f, float dirY = 0.0f, float dirZ = 0.0f) {
+    if (simEffects.size() >= (size_t)maxPendingEffects) return; // Nobody is taking them
+    simEffects.push_back({ type, x, y, z, dirX, dirY, dirZ });
+}
+
+// Chunk sizes of the tick's parallel jobs
+const int robotGrain = 512;
+const int bulletGrain = 2048;
+const int sphereGrain = 1024;
+
+// Each living robot's share of the walk cycle this tick: the zigzag angle it moves at and its step
+// progress, or -1 if it's pausing between steps (or not walking). The gait is shared and advances
+// once per robot, so this is worked out in robot order before the robots move in parallel.
+// Reused between ticks.
+struct RobotSteps {
+    std::vector<float> zigzag;
+    std::vector<float> progress;
+};
+static RobotSteps robotSteps;
+
+// Collision passes (see Collisions below)
+static void hitRobot(int robotIndex, int limb, float x, float y, float z, float dirX, float dirY, float dirZ);
+static void prepareBulletHits();
+static void testBulletHits(int begin, int end, int thread, void* context);
+static void resolveBulletHits(int begin, int end, int thread, void* context);
+
+// Steps the shared walk cycle for every living robot, in robot order
+static void advanceRobotGait() {
+    const float stepFrequency = 0.005f; // Slower frequency for deliberate steps
+    const float stopDuration = 0.2f; // Pause duration between steps
+    const float zigzagFrequency = 0.01f;
+
+    robotSteps.zigzag.resize(robots.size());
+    robotSteps.progress.resize(robots.size());
+    for (size_t i = 0; i < robots.size(); i++) {
+        Robot& robot = robots[i];
+        robotSteps.progress[i] = -1.0f;
+        if (!robot.isActive || robot.isDestroyed) continue;
+
+        // Update zigzag angle
+        robotSteps.zigzag[i] = robotGait.zigzagAngle;
+        robotGait.zigzagAngle += zigzagFrequency;
+
+        // Stop between steps
+        if (robotGait.isStopping) {
+            robotGait.stopTimer += stepFrequency;
+            if (robotGait.stopTimer >= stopDuration) {
+                robotGait.isStopping = false;
+                robotGait.stopTimer = 0.0f;
+            }
+            continue; // Do not proceed with movement while stopping
+        }
+
+        // Step progression
+        robotGait.stepProgress += stepFrequency;
+
+        if (robotGait.stepProgress >= 1.0f) {
+            robotGait.stepProgress = 0.0f;
+            robot.legForward = !robot.legForward; // Switch legs
+            robotGait.isStopping = true; // Pause for dramatic effect
+        }
+        robotSteps.progress[i] = robotGait.stepProgress;
+    }
+}
+
+// Moves robots [begin, end) that step this tick (hot data only)
+static void moveRobots(int begin, int end, int thread, void* context) {
+    const float stepHeight = 0.8f; // Increased vertical lift for stomping
+    const float zigzagAmplitude = 0.3f;
+
+    for (int i = begin; i < end; i++) {
+        float stepProgress = robotSteps.progress[i];
+        if (stepProgress < 0.0f) continue;
+        Robot& robot = robots[i];
+
+        // Direction towards the player from the shared flow field (already unit length)
+        float dirX, dirZ;
+        sampleFlowField(robot.pos.x, robot.pos.z, dirX, dirZ);
+
+        // Apply zigzag motion perpendicular to the forward direction
+        float zigzagAngle = robotSteps.zigzag[i];
+        float zigzagOffsetX = -dirZ * zigzagAmplitude * sin(zigzagAngle);
+        float zigzagOffsetZ = dirX * zigzagAmplitude * sin(zigzagAngle);
+
+        // Update robot position
+        robot.pos.x += (dirX + zigzagOffsetX) * robot.speed * 0.3f; // Slower forward movement
+        robot.pos.z += (dirZ + zigzagOffsetZ) * robot.speed * 0.3f;
+
+        float stepLift = sin(stepProgress * M_PI) * stepHeight; // Sinusoidal lift motion
+
+        // Raise the knee sphere
+        robot.pos.y = groundLevel + stepLift;
+    }
+}
+
+// Leg and body pose of robots [begin, end) that step this tick
+static void animateRobots(int begin, int end, int thread, void* context) {
+    const float stepHeight = 0.8f;
+    const float bodyTiltAngle = 5.0f; // Angle to tilt the body toward the support leg
+
+    for (int robotIndex = begin; robotIndex < end; robotIndex++) {
+        float stepProgress = robotSteps.progress[robotIndex];
+        if (stepProgress < 0.0f) continue;
+        RobotDetail& detail = robotDetails[robotIndex];
+        float stepLift = sin(stepProgress * M_PI) * stepHeight;
+
+        // Lift and drop one leg while keeping the other leg as support
+        if (robots[robotIndex].legForward) {
+            // Left leg stepping
+            detail.legAngle = stepLift * 30.0f; // Exaggerated forward lift
+            detail.lowerLegAngle = -detail.legAngle * 0.8f;
+
+            // Rotate the quadriceps to mimic a stomp
+            detail.lowerLegAngle += stepLift * 20.0f;
+
+            // Tilt body toward the right leg (support leg)
+            detail.bodyLeanAngle = -bodyTiltAngle;
+        }
+        else {
+            // Right leg stepping
+            detail.legAngle = -stepLift * 30.0f;
+            detail.lowerLegAngle = -detail.legAngle * 0.8f;
+
+            // Rotate the quadriceps to mimic a stomp
+            detail.lowerLegAngle -= stepLift * 20.0f;
+
+            // Tilt body toward the left leg (support leg)
+            detail.bodyLeanAngle = bodyTiltAngle;
+        }
+
+        // Simulate a slight body tilt when transitioning between steps
+        if (stepProgress > 0.8f) {
+            detail.bodyLeanAngle *= 0.5f; // Reduce tilt as the robot transitions to the next step
+        }
+    }
+}
+
+static void spinRobotCannons(int begin, int end, int thread, void* context) {
+    for (int i = begin; i < end; i++) {
+        RobotDetail& detail = robotDetails[i];
+        if (detail.isSpinning) {
+            detail.cannonRotation += 5.0f;
+            if (detail.cannonRotation > 360.0f) detail.cannonRotation -= 360.0f;
+        }
+    }
+}
+
+static void integrateBullets(int begin, int end, int thread, void* context) {
+    for (int i = begin; i < end; i++) {
+        Bullet& bullet = bullets[i];
+        bullet.x += bullet.dirX * bulletSpeed;
+        bullet.y += bullet.dirY * bulletSpeed;
+        bullet.z += bullet.dirZ * bulletSpeed;
+    }
+}
+
+static void chaseSpheres(int begin, int end, int thread, void* context) {
+    for (int i = begin; i < end; i++) {
+        Sphere& sphere = spheres[i];
+        float dirX = cameraX - sphere.x;
+        float dirY = cameraY - sphere.y;
+        float dirZ = cameraZ - sphere.z;
+        float length = sqrt(dirX * dirX + dirY * dirY + dirZ * dirZ);
+
+        dirX /= length;
+        dirY /= length;
+        dirZ /= length;
+
+        sphere.x += dirX * 0.05f;
+        sphere.y += dirY * 0.05f;
+        sphere.z += dirZ * 0.05f;
+    }
+}
+
+// Whole-array passes that split themselves with parallelFor()
+static void separateRobotsJob(int begin, int end, int thread, void* context) { separateRobots(); }
+static void invalidatePosesJob(int begin, int end, int thread, void* context) { invalidateRobotPoses(); }
+
+// Advances the simulation by one step (player movement, robots, bullets, spheres, collisions)
+// elapsedMs moves the sim clock forward, running any animation timers that expire. Timers, player
+// movement and the walk cycle run first on the calling thread; the rest is simJobs
+void simTick(unsigned int elapsedMs) {
+    ALLOC_ZONE("sim_tick");
+    auto tickStart = std::chrono::steady_clock::now();
+    {
+        ALLOC_ZONE("sim_timers"); // Robot fire, hit resets, defeat animations
+        simTimers.advance(elapsedMs);
+    }
+
+    const float baseSpeed = 0.15f;
+    float speed = baseSpeed;
+
+    if (activeKeys.test('c')) {
+        speed *= 2.0f;
+    }
+
+    float dirX = sin(cameraAngleH) * cos(cameraAngleV);
+    float dirZ = -cos(cameraAngleH) * cos(cameraAngleV);
+
+    if (activeKeys.test('w')) {
+        cameraX += dirX * speed;
+        cameraZ += dirZ * speed;
+    }
+    if (activeKeys.test('s')) {
+        cameraX -= dirX * speed;
+        cameraZ -= dirZ * speed;
+    }
+    if (activeKeys.test('a')) {
+        cameraX -= cos(cameraAngleH) * speed;
+        cameraZ -= sin(cameraAngleH) * speed;
+    }
+    if (activeKeys.test('d')) {
+        cameraX += cos(cameraAngleH) * speed;
+        cameraZ += sin(cameraAngleH) * speed;
+    }
+
+    if (cameraX < -planeSize + 2.0f) cameraX = -planeSize + 2.0f;
+    if (cameraX > planeSize - 2.0f) cameraX = planeSize - 2.0f;
+    if (cameraZ < -planeSize + 2.0f) cameraZ = -planeSize + 2.0f;
+    if (cameraZ > planeSize - 2.0f) cameraZ = planeSize - 2.0f;
+
+    if (isJumping) {
+        cameraY += jumpVelocity;
+        jumpVelocity += gravity;
+
+        if (cameraY <= groundLevel) {
+            cameraY = groundLevel;
+            isJumping = false;
+            jumpVelocity = 0.0f;
+        }
+    }
+
+    // Robots steer by the flow field (only rebuilt when the player changes cells)
+    {
+        ALLOC_ZONE("flow_field");
+        updateFlowField(cameraX, cameraZ);
+    }
+    advanceRobotGait();
+
+    // Set cannon's collision sphere position
+    cannonCollisionSphere.x = cameraX;
+    cannonCollisionSphere.y = cameraY - 1.5f;
+    cannonCollisionSphere.z = cameraZ;
+
+    prepareBulletHits();
+    auto serialEnd = std::chrono::steady_clock::now();
+
+    // The rest of the tick as a job graph: robots, bullets and spheres update side by side, and
+    // the collision passes wait for everything they read
+    const int robotCount = (int)robots.size();
+    simJobs.clear();
+    JobId move = simJobs.add("move_robots", moveRobots, nullptr, robotCount, robotGrain);
+    JobId animate = simJobs.add("animate_robots", animateRobots, nullptr, robotCount, robotGrain);
+    JobId spin = simJobs.add("spin_cannons", spinRobotCannons, nullptr, robotCount, robotGrain);
+    JobId separate = simJobs.add("separate_robots", separateRobotsJob, nullptr); // Then push apart robots that overlap
+    JobId integrate = simJobs.add("integrate_bullets", integrateBullets, nullptr, (int)bullets.size(), bulletGrain);
+    JobId chase = simJobs.add("chase_spheres", chaseSpheres, nullptr, (int)spheres.size(), sphereGrain);
+    JobId pose = simJobs.add("invalidate_poses", invalidatePosesJob, nullptr); // The hit tests pose the robots they reach (pose.h)
+    JobId hitTest = simJobs.add("test_bullet_hits", testBulletHits, nullptr, (int)bullets.size(), bulletGrain);
+    JobId resolve = simJobs.add("resolve_hits", resolveBulletHits, nullptr);
+    simJobs.dependsOn(separate, move);
+    simJobs.dependsOn(pose, animate);
+    simJobs.dependsOn(pose, spin);
+    simJobs.dependsOn(pose, separate);
+    simJobs.dependsOn(hitTest, separate);
+    simJobs.dependsOn(hitTest, integrate);
+    simJobs.dependsOn(hitTest, chase);
+    simJobs.dependsOn(hitTest, pose); // Limb hitboxes follow this tick's pose
+    simJobs.dependsOn(resolve, hitTest);
+    simJobs.run();
+    invalidateSceneTree(); // The next query (robot fire) refits it to where everything ended up
+
+    const JobGraphStats& jobs = simJobs.stats();
+    simTickStats.serialMs = std::chrono::duration<double, std::milli>(serialEnd - tickStart).count();
+    simTickStats.tickMs = simTickStats.serialMs + jobs.wallMs;
+    simTickStats.threads = jobs.threads;
+    simTickStats.utilisation = simTickStats.tickMs > 0.0
+        ? (float)((simTickStats.serialMs + jobs.busyMs) / (simTickStats.tickMs * jobs.threads)) : 0.0f;
+}
+
+// What the GLUT input callbacks used to do directly (now run on whichever thread owns the sim)
+void applySimInput(const SimInput& input) {
+    switch (input.type) {
+    case INPUT_KEY_DOWN:
+        activeKeys.set(input.key);
+        /*
+        if (input.key == ' ' && !isJumping) { // Jump on space key if not already jumping
+            isJumping = true;
+            jumpVelocity = jumpStrength;
+        }
+        */
+        if (input.key == 'f' || input.key == ' ') { // Fire bullet when 'f' or spacebar key is pressed
+            fireBullet();
+        }
+        if (input.key == 'r' && !isCannonDisabled) {
+            fireHitscan();
+        }
+        /*
+        if (input.key == 'g') { // Spawn sphere when 'g' key is pressed
+            spawnSphere();
+        }
+        */
+        if (input.key == 'e') { // Spawn robot (for testing, put this stuff in key == g later (or comment it out)
+            spawnRobots();
+        }
+        break;
+
+    case INPUT_KEY_UP:
+        activeKeys.reset(input.key);
+        break;
+
+    case INPUT_MOUSE_FIRE:
+        if (!isCannonDisabled) {
+            fireBullet();
+        }
+        break;
+
+    case INPUT_LOOK:
+        applyLookDelta(cameraAngleH, cameraAngleV, input.dx, input.dy);
+        break;
+    }
+}
+
+void applyLookDelta(float& angleH, float& angleV, int dx, int dy) {
+    const float verticalLimit = 0.349f; // ~20 degrees in radians
+
+    // Update camera angles based on delta movement
+    angleH += dx * sensitivity;
+    angleV -= dy * sensitivity;
+
+    // Clamp the vertical angle to -Limit to +Limit degrees
+    if (angleV > verticalLimit)
+        angleV = verticalLimit;
+    if (angleV < -verticalLimit)
+        angleV = -verticalLimit;
+}
+
+// Function to fire a bullet
+void fireBullet() {
+    // Bullet travel direction
+    float dirX = sin(cameraAngleH) * cos(cameraAngleV);
+    float dirY = sin(cameraAngleV);
+    float dirZ = -cos(cameraAngleH) * cos(cameraAngleV);
+    
+    // Bullet initial spawn position (tip of cannon)
+    float tipX = cameraX  + dirX * cannonBaseLength;
+    float tipY = (cameraY - 1.0f) + dirY * cannonBaseLength; // Note: (cameraY - 1.0f) is kinda hard coded in here, if you change the cannon position change this too
+    float tipZ = cameraZ + dirZ * cannonBaseLength;
+
+    Bullet bullet = { tipX, tipY, tipZ, dirX, dirY, dirZ, true, nextBulletId++ };
+    bullets.push_back(bullet);
+    emitEffect(EFFECT_MUZZLE_FLASH, tipX, tipY, tipZ, dirX, dirY, dirZ);
+}
+
+// Hitscan shot: whatever the aim line meets first is hit at once, with no bullet in flight
+void fireHitscan() {
+    const float hitscanRange = 3.0f * planeSize; // Past the far corner of the arena
+    float dirX = sin(cameraAngleH) * cos(cameraAngleV);
+    float dirY = sin(cameraAngleV);
+    float dirZ = -cos(cameraAngleH) * cos(cameraAngleV);
+    float tipX = cameraX + dirX * cannonBaseLength;
+    float tipY = (cameraY - 1.0f) + dirY * cannonBaseLength; // As fireBullet()
+    float tipZ = cameraZ + dirZ * cannonBaseLength;
+    emitEffect(EFFECT_MUZZLE_FLASH, tipX, tipY, tipZ, dirX, dirY, dirZ);
+
+    SceneRay ray = { glm::vec3(tipX, tipY, tipZ), glm::vec3(dirX, dirY, dirZ), hitscanRange,
+                     SCENE_MASK_ROBOTS | SCENE_MASK_SPHERES | SCENE_MASK_ARENA, -1 };
+    SceneHit hit;
+    raycastScene(&ray, &hit, 1);
+    if (hit.object.type == SCENE_ROBOT) {
+        hitRobot(hit.object.index, hit.limb, hit.point.x, hit.point.y, hit.point.z, dirX, dirY, dirZ);
+    }
+    else if (hit.object.type == SCENE_SPHERE) {
+        spheres.erase(spheres.begin() + hit.object.index);
+        invalidateSceneTree(); // The spheres after it moved down; another shot before the next tick must see that
+    }
+}
+
+//// Robot fire
+// Every robot fires once per robotFireInterval, but at its own phase within the interval, so a
+// large army's shots are spread evenly over the ticks instead of landing in one burst.
+// The handler runs every robotFireSliceMs and fires the robots whose phase fell in the elapsed slice.
+const unsigned int robotFireSliceMs = 10;
+
+unsigned int robotFireOrigin = 0;    // Sim time of phase 0 of the first volley
+unsigned int robotFireCheckedTo = 0; // Sim time the handler has fired up to
+
+// Robot indices sorted by fire phase (rebuilt when the robot count changes)
+static std::vector<int> robotsByPhase;
+
+// Per-volley scratch, reused between volleys
+struct FireBatch {
+    std::vector<int> robot;
+    std::vector<unsigned int> shot;
+    std::vector<float> tipX, tipY, tipZ;
+    std::vector<float> dirX, dirY, dirZ;
+    std::vector<SceneRay> sightRays;
+    std::vector<SceneHit> sightHits;
+};
+static FireBatch fireBatch;
+
+// Golden-ratio stagger: phases are evenly spread for any robot count
+static unsigned int robotFirePhase(int robotIndex, unsigned int interval) {
+    float turns = robotIndex * 0.61803398875f;
+    return (unsigned int)((turns - (int)turns) * interval) % interval;
+}
+
+// Counter-based RNG: a hash of (robot, counter) with no shared generator state, so shots can be
+// generated in any order and in a vector loop (unlike rand())
+static inline unsigned int robotNoise(unsigned int robotIndex, unsigned int counter) {
+    unsigned int x = robotIndex * 0x9E3779B9u + counter * 0x85EBCA6Bu + 0x27D4EB2Fu;
+    x ^= x >> 16;
+    x *= 0x7FEB352Du;
+    x ^= x >> 15;
+    x *= 0x846CA68Bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// 1 / sqrt(x) for x > 0: bit-trick estimate refined by two Newton steps (relative error < 1e-5)
+// Branch-free, so loops using it vectorise (sqrtf's errno check blocks that)
+static inline float fastInverseSqrt(float x) {
+    unsigned int bits;
+    memcpy(&bits, &x, sizeof(bits));
+    bits = 0x5F375A86u - (bits >> 1);
+    float y;
+    memcpy(&y, &bits, sizeof(y));
+    y = y * (1.5f - 0.5f * x * y * y);
+    return y * (1.5f - 0.5f * x * y * y);
+}
+
+// Adds the robots whose phase is in [from, to) (phases, to <= interval) to the fire batch
+static void collectFiringRobots(unsigned int from, unsigned int to, unsigned int interval) {
+    auto phaseLess = [interval](int robotIndex, unsigned int phase) { return robotFirePhase(robotIndex, interval) < phase; };
+    auto first = std::lower_bound(robotsByPhase.begin(), robotsByPhase.end(), from, phaseLess);
+    auto last = std::lower_bound(first, robotsByPhase.end(), to, phaseLess);
+    for (auto it = first; it != last; ++it) {
+        if (robots[*it].isActive && !robots[*it].isDestroyed) fireBatch.robot.push_back(*it);
+    }
+}
+
+// Fills dir* from each tip towards the target plus random variation, normalised
+// One straight loop over flat arrays, which the compiler vectorises (__restrict: otherwise it
+// needs too many overlap checks between the arrays to bother)
+static void aimShots(int count, float targetX, float targetY, float targetZ,
+                     const int* robotIndex, const unsigned int* shot,
+                     const float* tipX, const float* tipY, const float* tipZ,
+                     float* __restrict dirX, float* __restrict dirY, float* __restrict dirZ) {
+    const float randomRange = 5.0f; // Max range of direction variation
+    const float toRange = 2.0f * randomRange / 16777216.0f; // 24 random bits to [0, 2 * randomRange)
+
+    for (int k = 0; k < count; k++) {
+        // Random bullet direction variation, three independent draws per shot
+        unsigned int counter = shot[k] * 3;
+        float jitterX = (float)(int)(robotNoise(robotIndex[k], counter) >> 8) * toRange - randomRange;
+        float jitterY = (float)(int)(robotNoise(robotIndex[k], counter + 1) >> 8) * toRange - randomRange;
+        float jitterZ = (float)(int)(robotNoise(robotIndex[k], counter + 2) >> 8) * toRange - randomRange;
+
+        float x = targetX - tipX[k] + jitterX;
+        float y = targetY - tipY[k] + jitterY;
+        float z = targetZ - tipZ[k] + jitterZ;
+        float inverseLength = fastInverseSqrt(x * x + y * y + z * z);
+
+        dirX[k] = x * inverseLength;
+        dirY[k] = y * inverseLength;
+        dirZ[k] = z * inverseLength;
+    }
+}
+
+// Drops the robots of the batch whose line from the tip to the target crosses another robot's
+// box or a sphere: they hold their fire. One batch of raycasts (scenequery.h)
+static int keepClearShots(int count, float targetX, float targetY, float targetZ) {
+    for (int k = 0; k < count; k++) {
+        glm::vec3 tip(fireBatch.tipX[k], fireBatch.tipY[k], fireBatch.tipZ[k]);
+        glm::vec3 toTarget = glm::vec3(targetX, targetY, targetZ) - tip;
+        float distance = glm::length(toTarget);
+        SceneRay& ray = fireBatch.sightRays[k];
+        ray.origin = tip;
+        ray.dir = distance > 0.0f ? toTarget / distance : glm::vec3(0.0f, 0.0f, 1.0f);
+        ray.maxDistance = distance;
+        ray.mask = SCENE_MASK_ROBOTS | SCENE_MASK_SPHERES | SCENE_MASK_ARENA;
+        ray.ignoreRobot = fireBatch.robot[k];
+    }
+    occludedInScene(fireBatch.sightRays.data(), fireBatch.sightHits.data(), count);
+
+    int kept = 0;
+    for (int k = 0; k < count; k++) {
+        if (fireBatch.sightHits[k].object.type >= 0) continue;
+        fireBatch.robot[kept] = fireBatch.robot[k];
+        fireBatch.tipX[kept] = fireBatch.tipX[k];
+        fireBatch.tipY[kept] = fireBatch.tipY[k];
+        fireBatch.tipZ[kept] = fireBatch.tipZ[k];
+        kept++;
+    }
+    return kept;
+}
+
+// Aims and spawns the batch's bullets: gather the tips, keep the robots with a clear line, aim
+// them all, then append the bullets
+static void fireBatchedBullets() {
+    int count = (int)fireBatch.robot.size();
+    if (count == 0) return;
+
+    // Note: Direction is calculated from where the end of the arm is, adjust initial offset to match
+    // (Basically just hard coded these values)
+    const float offsetX = -(0.45f * scaleRobot);
+    const float offsetY = (0.4f * scaleRobot);
+    const float offsetZ = (1.6f * scaleRobot);
+
+    // Note: the -1.5f is necessary to shoot at the cannon specifically
+    const float targetX = cameraX, targetY = cameraY - 1.5f, targetZ = cameraZ;
+
+    fireBatch.tipX.resize(count); fireBatch.tipY.resize(count); fireBatch.tipZ.resize(count);
+    fireBatch.sightRays.resize(count); fireBatch.sightHits.resize(count);
+    for (int k = 0; k < count; k++) {
+        const Robot& robot = robots[fireBatch.robot[k]];
+        fireBatch.tipX[k] = robot.pos.x + offsetX;
+        fireBatch.tipY[k] = robot.pos.y + offsetY;
+        fireBatch.tipZ[k] = robot.pos.z + offsetZ;
+    }
+    count = keepClearShots(count, targetX, targetY, targetZ);
+    if (count == 0) return;
+
+    fireBatch.robot.resize(count);
+    fireBatch.shot.resize(count);
+    fireBatch.tipX.resize(count); fireBatch.tipY.resize(count); fireBatch.tipZ.resize(count);
+    fireBatch.dirX.resize(count); fireBatch.dirY.resize(count); fireBatch.dirZ.resize(count);
+    for (int k = 0; k < count; k++) {
+        fireBatch.shot[k] = robotDetails[fireBatch.robot[k]].shotCount++;
+    }
+
+    const float* tipX = fireBatch.tipX.data();
+    const float* tipY = fireBatch.tipY.data();
+    const float* tipZ = fireBatch.tipZ.data();
+    float* dirX = fireBatch.dirX.data();
+    float* dirY = fireBatch.dirY.data();
+    float* dirZ = fireBatch.dirZ.data();
+
+    aimShots(count, targetX, targetY, targetZ, fireBatch.robot.data(), fireBatch.shot.data(),
+             tipX, tipY, tipZ, dirX, dirY, dirZ);
+
+    size_t first = bullets.size();
+    bullets.resize(first + count);
+    for (int k = 0; k < count; k++) {
+        bullets[first + k] = { tipX[k], tipY[k], tipZ[k], dirX[k], dirY[k], dirZ[k], false, nextBulletId++ };
+    }
+}
+
+// Allows robots to fire bullets at a set interval
+void robotFireHandler(int param) {
+    unsigned int interval = std::max((unsigned int)robotFireInterval, 1u);
+    unsigned int now = simTimers.now();
+
+    if (robotsByPhase.size() != robots.size()) {
+        robotsByPhase.resize(robots.size());
+        for (size_t i = 0; i < robots.size(); i++) robotsByPhase[i] = (int)i;
+        std::sort(robotsByPhase.begin(), robotsByPhase.end(), [interval](int a, int b) {
+            return robotFirePhase(a, interval) < robotFirePhase(b, interval);
+        });
+    }
+
+    // Fire everyone whose next shot time is in [checkedTo, now)
+    fireBatch.robot.clear();
+    unsigned int from = std::max(robotFireCheckedTo, robotFireOrigin);
+    if (now > from) {
+        unsigned int elapsed = now - from;
+        if (elapsed >= interval) {
+            collectFiringRobots(0, interval, interval); // A long step: everyone fires once
+        }
+        else {
+            unsigned int phaseFrom = (from - robotFireOrigin) % interval;
+            unsigned int phaseTo = phaseFrom + elapsed;
+            collectFiringRobots(phaseFrom, std::min(phaseTo, interval), interval);
+            if (phaseTo > interval) collectFiringRobots(0, phaseTo - interval, interval); // Wrapped into the next volley
+        }
+    }
+    robotFireCheckedTo = now;
+    fireBatchedBullets();
+
+    simTimers.schedule(robotFireSliceMs, robotFireHandler, 0);
+}
+
+void disableCannonHandler(int param) {
+    if (isCannonDisabled && cannonAngle > -10.0f) {
+        cannonAngle -= 0.1f; // Move cannon downward
+        simTimers.schedule(10, disableCannonHandler, 0);
+    }
+    else {
+        // Re-enable cannon after a second
+        simTimers.schedule(2000, enableCannonHandler, 0);
+    }
+}
+
+void enableCannonHandler(int param) {
+    // Play animation, then re-enable firing after
+    if (cannonAngle < 0.0f) {
+        cannonAngle += 0.2f; // Move cannon upward
+        simTimers.schedule(10, enableCannonHandler, 0);
+    }
+    else {
+        isCannonDisabled = false;
+    }
+}
+
+void robotHitReset(int robotIndex) {
+    if (robotIndex >= 0) {
+        robotDetails[robotIndex].isHit = false;
+    }
+}
+
+void robotDeactivate(int robotIndex) {
+    if (robotIndex >= 0 && robots[robotIndex].isDestroyed) {
+        robots[robotIndex].isActive = false;
+    }
+}
+
+// Animation that plays when a robot is destroyed
+void robotDestroyHandler(int robotIndex) {
+    RobotDetail& detail = robotDetails[robotIndex];
+
+    const Robot& robot = robots[robotIndex];
+
+    // Animation phase 1: Lean robot forward
+    if (robots[robotIndex].isDestroyed && detail.upperBodyAngle < 45.0f) {
+        detail.isWalking = false;
+        if (detail.upperBodyAngle == 0.0f) emitEffect(EFFECT_ROBOT_DESTROYED, robot.pos.x, robot.pos.y, robot.pos.z);
+
+        detail.upperBodyAngle += 0.5f;
+        detail.animationTimer = simTimers.schedule(10, robotDestroyHandler, robotIndex);
+    }
+    // Animation phase 2: Move robot head (Head falls off)
+    else if (robots[robotIndex].isDestroyed && detail.headOffsetY > -2.2 && detail.headOffsetZ < 2.2) {
+        emitEffect(EFFECT_ROBOT_SMOKE, robot.pos.x, robot.pos.y + 1.2f * scaleRobot, robot.pos.z);
+        detail.headOffsetY -= 0.05f;
+        detail.headOffsetZ += 0.05f;
+
+        detail.animationTimer = simTimers.schedule(10, robotDestroyHandler, robotIndex);
+    }
+    // Animation phase 3: Pause animation, then deactive robot after a second
+    else {
+        detail.animationTimer = simTimers.schedule(1000, robotDeactivate, robotIndex);
+    }
+}
+
+// Function to spawn a sphere
+void spawnSphere() {
+    // Calculate initial spawn position of spheres 
+
+    float initSphereX = (float)(rand() % (2 * planeSize) - planeSize); // Random X coord along room width
+    float initSphereY = 5.0f; // Adjust this later based on robot height / center
+    float initSphereZ = ( -planeSize + 1) - (float)(rand() % 3);
+
+    Sphere sphere = { initSphereX, initSphereY, initSphereZ };
+    spheres.push_back(sphere);
+}
+
+//// Collisions
+// Every bullet is tested against the spheres, robots and cannon in parallel, against the state at
+// the start of the pass. The hits are then applied in bullet order: spheres first, then robots,
+// then the cannon, as three sequential passes did. A sphere or robot an earlier bullet already
+// took is no longer there, so that bullet looks further along the list from its first hit.
+struct BulletHits {
+    std::vector<int> sphere;       // First sphere in reach, or -1
+    std::vector<int> robot;        // Player bullets: first living robot in reach, or -1
+    std::vector<uint8_t> limb;     // The limb of it that was hit (RobotLimb)
+    std::vector<uint8_t> cannon;   // Robot bullets: inside the cannon's hitbox
+    std::vector<uint8_t> removed;  // Bullet hit something
+    std::vector<uint8_t> sphereRemoved;
+};
+static BulletHits bulletHits;
+
+// Health a hit on each limb takes: headshots count double
+static const int limbDamage[LIMB_COUNT] = {
+    2,       // Head
+    1,       // Torso
+    1, 1, 1, // Left arm, forearm, cannon
+    1, 1, 1, // Right arm, forearm, cannon
+    1, 1,    // Left leg
+    1, 1,    // Right leg
+};
+
+static void prepareBulletHits() {
+    size_t count = bullets.size();
+    bulletHits.sphere.resize(count);
+    bulletHits.robot.resize(count);
+    bulletHits.limb.resize(count);
+    bulletHits.cannon.resize(count);
+    bulletHits.removed.assign(count, 0);
+}
+
+static inline float distanceSquared(const Bullet& bullet, float x, float y, float z) {
+    float dx = bullet.x - x;
+    float dy = bullet.y - y;
+    float dz = bullet.z - z;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// First sphere from `first` on within reach of the bullet (skipping ones already removed), or -1
+static int findSphereHit(const Bullet& bullet, int first, const uint8_t* sphereRemoved) {
+    const float thresholdSquared = sphereHitThreshold * sphereHitThreshold; // Precompute squared threshold
+    for (int s = first; s < (int)spheres.size(); s++) {
+        if (sphereRemoved && sphereRemoved[s]) continue;
+        if (distanceSquared(bullet, spheres[s].x, spheres[s].y, spheres[s].z) < thresholdSquared) return s;
+    }
+    return -1;
+}
+
+// First living robot from `first` on that the bullet went through a limb of this tick, or -1.
+// The bullet is tested along the whole step it just moved, so it can't pass through a forearm
+// between two ticks; the robot's bounding sphere turns most robots away before their limbs are read
+static int findRobotHit(const Bullet& bullet, int first, int& limb) {
+    const float boundsOffset = robotBoundsCenterY * scaleRobot;
+    const float boundsRadiusSquared = robotBoundsRadius * scaleRobot * robotBoundsRadius * scaleRobot;
+    // The step is from - dir * bulletSpeed to the bullet (dir is a unit vector)
+    const float fromX = bullet.x - bullet.dirX * bulletSpeed;
+    const float fromY = bullet.y - bullet.dirY * bulletSpeed;
+    const float fromZ = bullet.z - bullet.dirZ * bulletSpeed;
+    for (int r = first; r < (int)robots.size(); r++) {
+        const Robot& robot = robots[r];
+        if (!robot.isActive || robot.isDestroyed) continue;
+
+        // Closest point of the step to the bounding sphere's centre
+        float toCenterX = robot.pos.x - fromX;
+        float toCenterY = robot.pos.y + boundsOffset - fromY;
+        float toCenterZ = robot.pos.z - fromZ;
+        float along = glm::clamp(toCenterX * bullet.dirX + toCenterY * bullet.dirY + toCenterZ * bullet.dirZ, 0.0f, bulletSpeed);
+        float dx = toCenterX - bullet.dirX * along;
+        float dy = toCenterY - bullet.dirY * along;
+        float dz = toCenterZ - bullet.dirZ * along;
+        if (dx * dx + dy * dy + dz * dz >= boundsRadiusSquared) continue;
+
+        limb = findLimbHit(r, glm::vec3(fromX, fromY, fromZ), glm::vec3(bullet.x, bullet.y, bullet.z));
+        if (limb >= 0) return r;
+    }
+    return -1;
+}
+
+// Tests bullets [begin, end); reads only
+static void testBulletHits(int begin, int end, int thread, void* context) {
+    const float cannonRadiusSquared = cannonCollisionSphere.radius * cannonCollisionSphere.radius;
+    for (int b = begin; b < end; b++) {
+        const Bullet& bullet = bullets[b];
+        bulletHits.sphere[b] = findSphereHit(bullet, 0, nullptr);
+        // Player bullets hit robots, robot bullets the cannon
+        int limb = 0;
+        bulletHits.robot[b] = bullet.isPlayerBullet ? findRobotHit(bullet, 0, limb) : -1;
+        bulletHits.limb[b] = (uint8_t)limb;
+        bulletHits.cannon[b] = !bullet.isPlayerBullet &&
+            distanceSquared(bullet, cannonCollisionSphere.x, cannonCollisionSphere.y, cannonCollisionSphere.z) < cannonRadiusSquared;
+    }
+}
+
+static void checkCollisions() {
+    bulletHits.sphereRemoved.assign(spheres.size(), 0);
+    bool anyRemoved = false;
+    for (size_t b = 0; b < bullets.size(); b++) {
+        if (bulletHits.sphere[b] < 0) continue;
+        int sphere = findSphereHit(bullets[b], bulletHits.sphere[b], bulletHits.sphereRemoved.data());
+        if (sphere < 0) continue;
+
+        bulletHits.sphereRemoved[sphere] = 1; // Remove sphere
+        bulletHits.removed[b] = 1; // Bullet can't collide with multiple spheres
+        anyRemoved = true;
+    }
+    if (!anyRemoved) return;
+
+    size_t kept = 0;
+    for (size_t s = 0; s < spheres.size(); s++) {
+        if (!bulletHits.sphereRemoved[s]) spheres[kept++] = spheres[s];
+    }
+    spheres.resize(kept);
+}
+
+static void checkRobotCollisions() {
+    for (size_t b = 0; b < bullets.size(); b++) {
+        // Check collision only if bullet is owned by the PLAYER
+        if (bulletHits.removed[b] || bulletHits.robot[b] < 0) continue;
+
+        // The robot found in parallel, unless an earlier bullet destroyed it
+        int robotIndex = bulletHits.robot[b];
+        int limb = bulletHits.limb[b];
+        if (robots[robotIndex].isDestroyed) robotIndex = findRobotHit(bullets[b], robotIndex + 1, limb);
+        if (robotIndex < 0) continue;
+        const Bullet& bullet = bullets[b];
+        hitRobot(robotIndex, limb, bullet.x, bullet.y, bullet.z, bullet.dirX, bullet.dirY, bullet.dirZ);
+        bulletHits.removed[b] = 1; // Remove the bullet
+    }
+}
+
+// A player shot hit a robot's limb at (x, y, z), travelling along dir
+static void hitRobot(int robotIndex, int limb, float x, float y, float z, float dirX, float dirY, float dirZ) {
+    RobotDetail& detail = robotDetails[robotIndex];
+    emitEffect(EFFECT_ROBOT_HIT, x, y, z, dirX, dirY, dirZ);
+
+    // Reduce robot health and increase redness
+    detail.health -= limbDamage[limb];
+    detail.rednessFactor += 0.3f;
+
+    detail.isHit = true; // Set boolean that will briefly draw a red sphere on hit
+
+    // Reset isHit variable to false after a brief moment (restarting the flash if it's still showing)
+    simTimers.cancel(detail.hitResetTimer);
+    detail.hitResetTimer = simTimers.schedule(50, robotHitReset, robotIndex);
+
+    // Deactivate robot if health reaches zero
+    if (detail.health <= 0) {
+        //robots[robotIndex].isActive = false;
+        robots[robotIndex].isDestroyed = true;
+        robotDestroyHandler(robotIndex);
+    }
+}
+
+static void checkCannonCollisions() {
+    for (size_t b = 0; b < bullets.size(); b++) {
+        // Check collision only if bullet is owned by a robot
+        if (bulletHits.removed[b] || !bulletHits.cannon[b]) continue;
+        const Bullet& bullet = bullets[b];
+        emitEffect(EFFECT_CANNON_HIT, bullet.x, bullet.y, bullet.z, bullet.dirX, bullet.dirY, bullet.dirZ);
+
+        // Disable cannon when hit
+        if (!isCannonDisabled) {
+            fprintf(stderr, "Cannon has been hit!\n"); // Not stdout: the bench writes its JSON there
+            isCannonDisabled = true;
+            simTimers.schedule(10, disableCannonHandler, 0); // Play animation
+        }
+
+        bulletHits.removed[b] = 1; // Remove the bullet (regardless if cannon is disabled or not)
+    }
+}
+
+// Past the walls, below the floor or above the wall tops: nothing can hit it or see it any more
+static inline bool bulletLeftArena(const Bullet& bullet) {
+    const float limit = planeSize + bulletArenaMargin;
+    return bullet.x < -limit || bullet.x > limit || bullet.z < -limit || bullet.z > limit ||
+           bullet.y < -bulletArenaMargin || bullet.y > limit;
+}
+
+// Applies the hits found by testBulletHits() and drops the bullets that hit something or left the arena
+static void resolveBulletHits(int begin, int end, int thread, void* context) {
+    checkCollisions();
+    checkRobotCollisions();
+    checkCannonCollisions();
+
+    size_t kept = 0;
+    for (size_t b = 0; b < bullets.size(); b++) {
+        if (!bulletHits.removed[b] && !bulletLeftArena(bullets[b])) bullets[kept++] = bullets[b];
+    }
+    bullets.resize(kept);
+}
+
+void spawnRobots() {
+    for (size_t i = 0; i < robots.size(); i++) {
+        robots[i].pos.x = (float)(rand() % (2 * planeSize) - planeSize);
+        robots[i].pos.y = 6.0f;
+        robots[i].pos.z = (-planeSize + 4) - (float)(rand() % 3);
+        robots[i].isActive = true;
+        robots[i].isDestroyed = false;
+
+        RobotDetail& detail = robotDetails[i];
+        detail.isWalking = true;
+
+        // Stop a defeat animation still playing on this robot
+        simTimers.cancel(detail.animationTimer);
+
+        detail.health = 3; // Reset health
+        detail.rednessFactor = 0.0f; // Reset redness
+
+        detail.upperBodyAngle = 0.0f; // Reset body angle
+        detail.headOffsetY = 0.0f;
+        detail.headOffsetZ = 0.0f;
+    }
+    invalidateRobotPoses(); // Moved and stood back up
+
+    // Activates timer once to prevent stacking
+    if (!robotFireActive) {
+        // The first shots come one interval after spawning, as before; after that each robot keeps its phase
+        robotFireOrigin = simTimers.now() + (unsigned int)robotFireInterval;
+        robotFireCheckedTo = simTimers.now();
+        simTimers.schedule(robotFireSliceMs, robotFireHandler, 0); // Get robots to fire bullets at interval
+        robotFireActive = true;
+    }
+
+}
+
+// Resizes the robot containers (robots are inactive until spawnRobots() is called)
+void setRobotCount(int count) {
+    for (RobotDetail& detail : robotDetails) {
+        simTimers.cancel(detail.hitResetTimer);
+        simTimers.cancel(detail.animationTimer);
+    }
+    robots.assign(count, Robot());
+    robotDetails.assign(count, RobotDetail());
+    invalidateRobotPoses();
+    robotSteps.zigzag.resize(count); // Sized here so ticks don't allocate
+    robotSteps.progress.resize(count);
+    reserveSimStorage();
+}
+
+void reserveSimStorage() {
+    size_t robotCount = robots.size();
+    size_t bulletCount = std::max(robotCount * bulletsInFlightPerRobot + playerBulletsInFlight, bullets.size());
+    bullets.reserve(bulletCount);
+    bulletHits.sphere.reserve(bulletCount);
+    bulletHits.robot.reserve(bulletCount);
+    bulletHits.limb.reserve(bulletCount);
+    bulletHits.cannon.reserve(bulletCount);
+    bulletHits.removed.reserve(bulletCount);
+    bulletHits.sphereRemoved.reserve(spheres.size());
+    simEffects.reserve(maxPendingEffects);
+    simTimers.reserve((int)robotCount * timersPerRobot + 64);
+
+    // Robot fire: the phase order, and a volley slice's scratch (at most every robot at once)
+    robotsByPhase.reserve(robotCount);
+    for (std::vector<float>* scratch : { &fireBatch.tipX, &fireBatch.tipY, &fireBatch.tipZ, &fireBatch.dirX, &fireBatch.dirY, &fireBatch.dirZ }) {
+        scratch->reserve(robotCount);
+    }
+    fireBatch.robot.reserve(robotCount);
+    fireBatch.shot.reserve(robotCount);
+    fireBatch.sightRays.reserve(robotCount);
+    fireBatch.sightHits.reserve(robotCount);
+    reserveSceneTree((int)robotCount, (int)spheres.capacity());
+
+    // The tick's job graph (see simTick()) at those sizes
+    auto chunks = [](size_t count, int grain) { return (int)((count + grain - 1) / grain); };
+    simJobs.reserveTasks(3 * chunks(robotCount, robotGrain) + 2 * chunks(bullets.capacity(), bulletGrain) +
+        chunks(spheres.size(), sphereGrain) + 4);
+}
+
+// Puts the simulation back into its start-up state
+void resetSimulation() {
+    simTimers.clear();
+
+    cameraX = 0.0f; cameraY = 5.0f; cameraZ = planeSize - 5.0f;
+    cameraAngleH = 0.0f;
+    cameraAngleV = 0.0f;
+    isJumping = false;
+    jumpVelocity = 0.2f;
+
+    activeKeys.reset();
+    simEffects.clear();
+    bullets.clear();
+    spheres.clear();
+    setRobotCount(NUM_ROBOTS);
+    robotFireActive = false;
+    robotGait = RobotGait();
+
+    cannonCollisionSphere = { 0.0f, 0.0f, 0.0f, 2.0f };
+    cannonAngle = 0.0f;
+    isCannonDisabled = false;
+}
@@ -0,0 +1,210 @@
+#pragma once
+// Simulation state and update functions shared by the game (main.cpp) and the
+// headless benchmark runner (bench.cpp). Nothing in here may depend on GL/GLUT.
+#include <cmath>
+#include <bitset>
+#include <vector>
+#include "jobs.h"
+#include "timerwheel.h"
+
+#ifdef M_PI
+#undef M_PI
+#endif
+#define M_PI 3.14
+
+extern float scaleRobot; // Robot size
+
+// Structs and Global Variables
+struct Bullet {
+    float x, y, z;
+    float dirX, dirY, dirZ;
+    bool isPlayerBullet;
+    unsigned int id = 0; // Spawn order (increasing), so a bullet can be followed across snapshots
+};
+
+struct Sphere {
+    float x, y, z;
+    float radius = 1.0 * scaleRobot; // Radius dependent on the robot's scale
+};
+
+const float sphereHitThreshold = 0.40f; // Collision radius of the spheres (Sphere::radius is the cannon's)
+
+// Plane dimensions
+const int planeSize = 50;
+
+// Camera position
+extern float cameraX, cameraY, cameraZ;
+extern float cameraAngleH; // Horizontal angle
+extern float cameraAngleV; // Vertical angle (for yaw)
+
+// Jumping mechanics
+extern bool isJumping;
+extern float jumpVelocity; // Vertical velocity
+const float gravity = -0.003f; // Gravity effect
+const float jumpStrength = 0.3f; // Initial jump velocity
+const float groundLevel = 5.0f; // Default ground level
+
+// Mouse sensitivity
+const float sensitivity = 0.001f;
+
+// Cannon dimensions
+const float cannonBaseLength = 5.0f;
+const float cannonBaseRadius = 0.1f;
+
+const float cannonBarrelLength = cannonBaseLength * 1.5;
+const float cannonBarrelRadius = cannonBaseRadius * 0.5;
+
+// Key state tracking
+extern std::bitset<256> activeKeys; // Indexed by key (a fixed set: pressing keys never allocates)
+
+// Bullet container
+extern std::vector<Bullet> bullets;
+
+// Sphere container
+extern std::vector<Sphere> spheres;
+
+//// Robots
+#define NUM_ROBOTS 2 // Default number of robots spawned by spawnRobots()
+extern float robotFireInterval; // Bullet fire interval in MS
+extern float robotFireActive;
+
+typedef struct Position {
+    float x = 0.0, y = 0.0, z = 0.0; // Robot position Y is set by spawnRobots() later on
+} Position;
+
+// Robot state is split by how often it's touched. Robot holds what movement, separation, bullet
+// collision and aiming read every tick, kept small so those loops stream through packed memory;
+// RobotDetail (same index, in robotDetails) holds the animation, damage and render state.
+typedef struct Robot {
+    Position pos;
+    float speed = 0.05f; // Walking speed
+    bool isActive = false;
+    bool isDestroyed = false; // Defeated (the animation may still be playing)
+    bool legForward = true;   // Which leg the walk cycle is lifting
+} Robot;
+
+typedef struct RobotDetail {
+    float legAngle = 0.0f;
+    float lowerLegAngle = 0.0f;
+    float armAngle = 0.0f;
+    float lowerArmAngle = 0.0f;
+    float bodyLeanAngle = 0.0f;
+
+    bool isWalking = true;
+    bool isSpinning = false;
+    float cannonRotation = 0.0f;
+
+    int health = 3;         // Health of the robot
+    float rednessFactor = 0.0f; // Redness level (increases as health decreases)
+
+    unsigned int shotCount = 0; // Counter for this robot's aim noise
+
+    bool isHit = false;
+    TimerHandle hitResetTimer;  // Pending robotHitReset
+    TimerHandle animationTimer; // Pending step of the defeat animation
+
+    // Used for the robot's defeat animation
+    float upperBodyAngle = 0.0f;
+    float headOffsetY = 0.0f;
+    float headOffsetZ = 0.0f;
+} RobotDetail;
+
+// Robot containers, sized with setRobotCount() (NUM_ROBOTS by default)
+extern std::vector<Robot> robots;
+extern std::vector<RobotDetail> robotDetails; // robotDetails[i] belongs to robots[i]
+
+// Collision radius shared by every robot, centred on its pos
+inline float robotRadius() { return 1.0f * scaleRobot; }
+
+// Walk cycle, shared by every robot (they all step in unison)
+struct RobotGait {
+    float stepProgress = 0.0f; // Progress of the current step
+    bool isStopping = false;   // Pausing between steps
+    float stopTimer = 0.0f;
+    float zigzagAngle = 0.0f;
+};
+extern RobotGait robotGait;
+
+// Robot fire schedule (see robotFireHandler) and the id the next bullet gets
+extern unsigned int robotFireOrigin, robotFireCheckedTo;
+extern unsigned int nextBulletId;
+
+// Cannon collision and disabling
+extern Sphere cannonCollisionSphere; // Cannon hitbox
+extern float cannonAngle;
+extern bool isCannonDisabled;
+
+// Timers for the simulation's animations, advanced in sim time (1 tick = 1 ms) by simTick()
+extern TimerWheel simTimers;
+
+// Visual effects the sim triggers, for the renderer's particle system (particles.h)
+enum SimEffectType {
+    EFFECT_MUZZLE_FLASH,    // The player's cannon fired: position is the muzzle, dir the shot
+    EFFECT_ROBOT_HIT,       // A player bullet hit a robot: position is the bullet, dir its flight
+    EFFECT_ROBOT_DESTROYED, // A robot was defeated: position is the robot
+    EFFECT_ROBOT_SMOKE,     // A defeated robot's head coming off: position is the neck
+    EFFECT_CANNON_HIT,      // A robot bullet hit the cannon: position is the bullet, dir its flight
+    NUM_SIM_EFFECTS
+};
+
+struct SimEffect {
+    SimEffectType type;
+    float x, y, z;
+    float dirX, dirY, dirZ;
+};
+
+// Effects triggered since whoever owns the sim last took them (the sim thread hands them to the
+// renderer). Capped at maxPendingEffects, so a headless sim that never takes them stays bounded
+const int maxPendingEffects = 4096;
+extern std::vector<SimEffect> simEffects;
+
+// The job graph of the last simTick(), kept for its per-job timings
+extern JobGraph simJobs;
+
+// Where the last simTick() spent its time
+struct SimTickStats {
+    double tickMs = 0.0;
+    double serialMs = 0.0;   // Timers, player movement and the walk cycle, before the job graph
+    int threads = 1;         // Threads that could work on the tick
+    float utilisation = 0.0f; // Busy thread time over tickMs * threads
+};
+extern SimTickStats simTickStats;
+
+// Player input, applied by the sim between ticks (sent from the GLUT callbacks or over the network)
+enum SimInputType {
+    INPUT_KEY_DOWN,   // key
+    INPUT_KEY_UP,     // key
+    INPUT_MOUSE_FIRE, // Left click (ignored while the cannon is disabled)
+    INPUT_LOOK        // dx, dy: mouse movement in pixels
+};
+
+struct SimInput {
+    SimInputType type;
+    unsigned char key;
+    int dx, dy;
+};
+
+// Function Declarations
+void simTick(unsigned int elapsedMs);
+void applySimInput(const SimInput& input);
+void applyLookDelta(float& angleH, float& angleV, int dx, int dy); // INPUT_LOOK's turn, also used to late-latch aim
+void resetSimulation();
+void setRobotCount(int count);
+
+// Sizes everything a tick may grow (bullets in flight, timers, effects, per-tick scratch) for the
+// current robot count, so steady-state ticks never allocate. setRobotCount() calls it; call it
+// after filling the containers some other way (loading a checkpoint, the start-up defaults)
+void reserveSimStorage();
+
+void fireBullet();
+void fireHitscan();
+void spawnSphere();
+void spawnRobots();
+void robotFireHandler(int param);
+
+void disableCannonHandler(int param);
+void enableCannonHandler(int param);
+
+void robotHitReset(int robotIndex);
+void robotDeactivate(int robotIndex);
+void robotDestroyHandler(int robotIndex);
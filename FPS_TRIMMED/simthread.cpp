@@ -0,0 +1,138 @@
+#include "simthread.h"
+#include "alloctrack.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+// Inputs carry a sequence number so the renderer can tell which ones a snapshot includes
+struct QueuedInput {
+    SimInput input;
+    uint32_t sequence;
+};
+
+static SpscQueue<QueuedInput, 256> inputQueue;
+static uint32_t lastSequence = 0; // Input thread only
+static uint32_t lastApplied = 0;  // Sim thread only
+static std::chrono::steady_clock::time_point lastAppliedTime;
+static TripleBuffer<SimSnapshot> snapshots;
+static SpscQueue<SimEffect, maxPendingEffects> effectQueue; // Sim thread -> render thread
+static std::atomic<bool> simRunning(false);
+static std::thread simThread;
+
+// assign() reuses the copy's capacity. The copies grow with the sim's storage, which only grows in
+// explicit events (spawning, loading, player fire past the reserve), so that growth is allowed
+template <typename T>
+static void copyInto(std::vector<T>& copy, const std::vector<T>& source) {
+    if (copy.capacity() < source.capacity()) {
+        ALLOW_ALLOCATIONS();
+        copy.reserve(source.capacity());
+    }
+    copy.assign(source.begin(), source.end());
+}
+
+void captureSnapshot(SimSnapshot& snapshot) {
+    snapshot.simTime = simTimers.now();
+    snapshot.cameraX = cameraX;
+    snapshot.cameraY = cameraY;
+    snapshot.cameraZ = cameraZ;
+    snapshot.cameraAngleH = cameraAngleH;
+    snapshot.cameraAngleV = cameraAngleV;
+    snapshot.cannonAngle = cannonAngle;
+
+    copyInto(snapshot.bullets, bullets);
+    copyInto(snapshot.spheres, spheres);
+    copyInto(snapshot.robots, robots);
+    copyInto(snapshot.robotDetails, robotDetails);
+}
+
+static void simThreadMain() {
+    const std::chrono::milliseconds step(simStepMs);
+    auto nextTick = std::chrono::steady_clock::now();
+    int ticks = 0;
+
+    while (simRunning.load(std::memory_order_relaxed)) {
+        // Every container has reached its working size by now: later allocations are bugs
+        if (++ticks == simWarmUpTicks) setSteadyState(true);
+        AllocStats allocsBefore = threadAllocations();
+
+        QueuedInput queued;
+        bool anyInput = false;
+        {
+            // Input is an explicit event: a respawn, or player fire beyond the reserved bullets, may grow storage
+            ALLOC_ZONE("sim_input");
+            ALLOW_ALLOCATIONS();
+            while (inputQueue.pop(queued)) {
+                applySimInput(queued.input);
+                lastApplied = queued.sequence;
+                anyInput = true;
+            }
+        }
+        if (anyInput) lastAppliedTime = std::chrono::steady_clock::now();
+
+        auto tickStart = std::chrono::steady_clock::now();
+        simTick(simStepMs);
+        std::chrono::duration<float, std::milli> tickTime = std::chrono::steady_clock::now() - tickStart;
+
+        ALLOC_ZONE("sim_snapshot");
+
+        // Effects go out before the snapshot they belong to; ones the renderer has no room for are dropped
+        for (const SimEffect& effect : simEffects) {
+            if (!effectQueue.push(effect)) break;
+        }
+        simEffects.clear();
+
+        captureSnapshot(snapshots.back());
+        snapshots.back().tickMs = tickTime.count();
+        snapshots.back().tickUtilisation = simTickStats.utilisation;
+        snapshots.back().tickThreads = simTickStats.threads;
+        snapshots.back().lastInput = lastApplied;
+        snapshots.back().inputsApplied = lastAppliedTime;
+        snapshots.back().tickAllocations = (uint32_t)(threadAllocations().allocations - allocsBefore.allocations);
+        snapshots.publish();
+
+        // Fixed rate; after a long stall (e.g. a breakpoint) resume from now instead of catching up
+        nextTick += step;
+        auto now = std::chrono::steady_clock::now();
+        if (now - nextTick > 10 * step) nextTick = now;
+        std::this_thread::sleep_until(nextTick);
+    }
+}
+
+void startSimThread() {
+    if (simRunning.exchange(true)) return;
+
+    // The first frame may be drawn before the first tick finishes
+    reserveSimStorage();
+    captureSnapshot(snapshots.back());
+    snapshots.publish();
+    updateSnapshot();
+
+    simThread = std::thread(simThreadMain);
+    atexit(stopSimThread); // exit() from a key callback must not destroy a joinable thread
+}
+
+void stopSimThread() {
+    if (!simRunning.exchange(false)) return;
+    if (simThread.joinable()) simThread.join();
+}
+
+uint32_t sendSimInput(const SimInput& input) {
+    QueuedInput queued = { input, lastSequence + 1 };
+    if (!inputQueue.push(queued)) return 0;
+    return ++lastSequence;
+}
+
+bool updateSnapshot() {
+    return snapshots.update();
+}
+
+const SimSnapshot& currentSnapshot() {
+    return snapshots.front();
+}
+
+bool popSimEffect(SimEffect& effect) {
+    return effectQueue.pop(effect);
+}
@@ -0,0 +1,54 @@
+#pragma once
+// Simulation thread
+// The sim runs on its own thread at a fixed rate. The GLUT callbacks hand it input through a
+// lock-free queue, and after every tick it publishes an immutable snapshot of everything the
+// renderer draws through a triple buffer. display() only ever reads the latest snapshot, so a slow
+// frame doesn't hold up the sim (or the reverse) and neither thread waits on a lock.
+#include "sim.h"
+#include <chrono>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+const unsigned int simStepMs = 10; // Fixed sim step: 100 ticks per second
+const int simWarmUpTicks = 300;    // After these (a full robot volley and more) the sim thread must not allocate (alloctrack.h)
+
+// Copy of the sim state that rendering needs, taken at the end of a tick
+struct SimSnapshot {
+    uint64_t simTime = 0; // Sim ms at the end of the tick
+    float cameraX = 0.0f, cameraY = 0.0f, cameraZ = 0.0f;
+    float cameraAngleH = 0.0f, cameraAngleV = 0.0f;
+    float cannonAngle = 0.0f;
+    float tickMs = 0.0f; // Wall time simTick() took (input and snapshot copy excluded)
+    float tickUtilisation = 0.0f; // Share of the job threads' time the tick kept busy (SimTickStats)
+    int tickThreads = 1;
+    uint32_t tickAllocations = 0; // new calls the sim thread made for this tick (0 without alloctrack.h's tracking)
+    uint32_t lastInput = 0; // Sequence number of the last input applied (see sendSimInput())
+    std::chrono::steady_clock::time_point inputsApplied; // When the tick applied it
+
+    std::vector<Bullet> bullets;
+    std::vector<Sphere> spheres;
+    std::vector<Robot> robots;
+    std::vector<RobotDetail> robotDetails; // With robots and the camera, all poseRobot() needs (pose.h)
+};
+
+// Copies the render-visible sim state into a snapshot, from whichever thread owns the sim (the sim
+// thread, or the caller when it ticks the sim itself as the offscreen render bench does)
+void captureSnapshot(SimSnapshot& snapshot);
+
+// Starts ticking the sim in the background (stopped automatically at exit)
+void startSimThread();
+void stopSimThread();
+
+// Input thread: queues input for the next tick; returns its sequence number (counting from 1), or 0
+// if the queue was full
+uint32_t sendSimInput(const SimInput& input);
+
+// Render thread: takes the latest published snapshot; returns true if it's newer than the last one
+bool updateSnapshot();
+
+// Render thread: the snapshot taken by the last updateSnapshot()
+const SimSnapshot& currentSnapshot();
+
+// Render thread: takes the next effect the sim triggered (see simEffects); false when none are left
+bool popSimEffect(SimEffect& effect);
@@ -0,0 +1,36 @@
+#pragma once
+// Bounded lock-free single-producer/single-consumer queue
+// One thread may push() and one other thread may pop(); neither ever blocks or allocates.
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    // Producer only. Returns false (dropping the item) if the queue is full
+    bool push(const T& item) {
+        size_t head = writeIndex.load(std::memory_order_relaxed);
+        size_t next = (head + 1) % Capacity;
+        if (next == readIndex.load(std::memory_order_acquire)) return false;
+
+        items[head] = item;
+        writeIndex.store(next, std::memory_order_release); // Publishes the item
+        return true;
+    }
+
+    // Consumer only. Returns false if the queue is empty
+    bool pop(T& item) {
+        size_t tail = readIndex.load(std::memory_order_relaxed);
+        if (tail == writeIndex.load(std::memory_order_acquire)) return false;
+
+        item = items[tail];
+        readIndex.store((tail + 1) % Capacity, std::memory_order_release); // Frees the slot
+        return true;
+    }
+
+private:
+    T items[Capacity];
+    // On separate cache lines so the two threads don't contend on one line
+    alignas(64) std::atomic<size_t> writeIndex{ 0 };
+    alignas(64) std::atomic<size_t> readIndex{ 0 };
+};
@@ -0,0 +1,80 @@
+#include "staticbatch.h"
+#include <algorithm>
+#include <cmath>
+
+static std::vector<uint32_t>& indicesOf(StaticBatch& batch, int material) {
+    if ((int)batch.materialIndices.size() <= material) batch.materialIndices.resize(material + 1);
+    return batch.materialIndices[material];
+}
+
+void addStaticSurface(StaticBatch& batch, int material, const StaticSurface& surface, float cellSize) {
+    int cellsU = std::max((int)ceilf(glm::length(surface.edgeU) / cellSize), 1);
+    int cellsV = std::max((int)ceilf(glm::length(surface.edgeV) / cellSize), 1);
+    glm::vec3 normal = glm::normalize(surface.normal);
+    uint32_t packedNormal = packNormal(normal.x, normal.y, normal.z);
+
+    uint32_t first = (uint32_t)batch.vertices.size();
+    for (int v = 0; v <= cellsV; v++) {
+        for (int u = 0; u <= cellsU; u++) {
+            float s = (float)u / cellsU;
+            float t = (float)v / cellsV;
+            glm::vec3 position = surface.origin + surface.edgeU * s + surface.edgeV * t;
+
+            MeshVertex vertex;
+            vertex.x = position.x;
+            vertex.y = position.y;
+            vertex.z = position.z;
+            vertex.normal = packedNormal;
+            vertex.s = packTexCoord(s);
+            vertex.t = packTexCoord(t);
+            batch.vertices.push_back(vertex);
+        }
+    }
+
+    // Two triangles per cell, wound like the corner order above
+    std::vector<uint32_t>& indices = indicesOf(batch, material);
+    const uint32_t row = (uint32_t)cellsU + 1;
+    for (int v = 0; v < cellsV; v++) {
+        for (int u = 0; u < cellsU; u++) {
+            uint32_t corner = first + (uint32_t)v * row + (uint32_t)u;
+            indices.insert(indices.end(), { corner, corner + 1, corner + row + 1, corner, corner + row + 1, corner + row });
+        }
+    }
+}
+
+void addStaticMesh(StaticBatch& batch, int material, const Mesh& mesh, const glm::mat4& transform) {
+    uint32_t first = (uint32_t)batch.vertices.size();
+    for (const MeshVertex& source : mesh.vertices) {
+        glm::vec4 position = transform * glm::vec4(source.x, source.y, source.z, 1.0f);
+        glm::vec3 normal;
+        unpackNormal(source.normal, normal.x, normal.y, normal.z);
+        // Props are placed by rotation, translation and uniform scale, so the normal just turns with them
+        glm::vec4 turned = transform * glm::vec4(normal, 0.0f);
+        normal = glm::normalize(glm::vec3(turned.x, turned.y, turned.z));
+
+        MeshVertex vertex = source;
+        vertex.x = position.x;
+        vertex.y = position.y;
+        vertex.z = position.z;
+        vertex.normal = packNormal(normal.x, normal.y, normal.z);
+        batch.vertices.push_back(vertex);
+    }
+
+    std::vector<uint32_t>& indices = indicesOf(batch, material);
+    for (uint32_t index : mesh.indices) indices.push_back(first + index);
+}
+
+void finishStaticBatch(StaticBatch& batch) {
+    batch.indices.clear();
+    batch.ranges.clear();
+    for (int material = 0; material < (int)batch.materialIndices.size(); material++) {
+        const std::vector<uint32_t>& indices = batch.materialIndices[material];
+        if (indices.empty()) continue;
+
+        StaticRange range = { material, (uint32_t)batch.indices.size(), (uint32_t)indices.size() };
+        batch.ranges.push_back(range);
+        batch.indices.insert(batch.indices.end(), indices.begin(), indices.end());
+    }
+    batch.materialIndices.clear();
+    batch.materialIndices.shrink_to_fit();
+}
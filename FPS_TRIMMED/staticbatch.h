@@ -0,0 +1,40 @@
+#pragma once
+// Static level geometry
+// Everything that never moves is tessellated once at level load into one vertex array and one index
+// array (packed MeshVertex records, see mesh.h), with the triangles grouped by material. Drawing is
+// then one call per material however many surfaces and props went in: adding a prop costs
+// vertices, not draw calls. No GL in here; the caller uploads and draws the ranges.
+#include "mesh.h"
+#include <glm/glm.hpp>
+
+// The triangles of one material: indices [firstIndex, firstIndex + indexCount)
+typedef struct StaticRange {
+    int material;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+} StaticRange;
+
+typedef struct StaticBatch {
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices; // Grouped by material once finished
+    std::vector<StaticRange> ranges;
+
+    std::vector<std::vector<uint32_t>> materialIndices; // While building, indexed by material
+} StaticBatch;
+
+// A flat rectangle: corners origin, origin + edgeU, origin + edgeU + edgeV, origin + edgeV, with the
+// texture spanning it once (s along edgeU, t along edgeV)
+typedef struct StaticSurface {
+    glm::vec3 origin, edgeU, edgeV;
+    glm::vec3 normal;
+} StaticSurface;
+
+// Adds a surface split into cells of at most cellSize units, so per-vertex lighting has vertices to
+// work with across large floors and walls
+void addStaticSurface(StaticBatch& batch, int material, const StaticSurface& surface, float cellSize);
+
+// Adds a copy of a mesh placed by transform (props)
+void addStaticMesh(StaticBatch& batch, int material, const Mesh& mesh, const glm::mat4& transform);
+
+// Lays the indices out material by material and fills ranges; the batch is then ready to upload
+void finishStaticBatch(StaticBatch& batch);
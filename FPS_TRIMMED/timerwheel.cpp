@@ -0,0 +1,154 @@
+#include "timerwheel.h"
+
+TimerWheel::TimerWheel(int initialCapacity) {
+    nodes.reserve(initialCapacity);
+    for (int& head : heads) head = -1;
+}
+
+void TimerWheel::reserve(int count) {
+    nodes.reserve(count);
+}
+
+int TimerWheel::allocNode() {
+    if (freeHead < 0) {
+        nodes.push_back(Node());
+        return (int)nodes.size() - 1;
+    }
+    int index = freeHead;
+    freeHead = nodes[index].next;
+    return index;
+}
+
+void TimerWheel::freeNode(int index) {
+    Node& node = nodes[index];
+    node.list = FREE_LIST;
+    node.generation++; // Invalidates outstanding handles
+    node.next = freeHead;
+    freeHead = index;
+}
+
+void TimerWheel::link(int index, int list) {
+    Node& node = nodes[index];
+    node.list = list;
+    node.prev = -1;
+    node.next = heads[list];
+    if (node.next >= 0) nodes[node.next].prev = index;
+    heads[list] = index;
+}
+
+void TimerWheel::unlink(int index) {
+    Node& node = nodes[index];
+    if (node.prev >= 0) nodes[node.prev].next = node.next;
+    else heads[node.list] = node.next;
+    if (node.next >= 0) nodes[node.next].prev = node.prev;
+}
+
+// Files a node into the level whose span covers its remaining delay
+void TimerWheel::insert(int index) {
+    uint64_t expiry = nodes[index].expiry;
+    if (expiry < currentTick) expiry = currentTick;
+    uint64_t delta = expiry - currentTick;
+
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= ((uint64_t)SLOTS << (LEVEL_BITS * level))) {
+        level++;
+    }
+    // Anything beyond the wheel's range parks in the furthest slot and re-cascades from there
+    uint64_t range = (uint64_t)SLOTS << (LEVEL_BITS * level);
+    if (delta >= range) {
+        expiry = currentTick + range - 1;
+    }
+
+    int slot = (int)((expiry >> (LEVEL_BITS * level)) & (SLOTS - 1));
+    link(index, level * SLOTS + slot);
+}
+
+TimerHandle TimerWheel::schedule(uint32_t delay, TimerCallback callback, int value) {
+    int index = allocNode();
+    Node& node = nodes[index];
+    node.expiry = currentTick + (delay > 0 ? delay : 1); // The current tick has already run
+    node.callback = callback;
+    node.value = value;
+    insert(index);
+    numPending++;
+
+    TimerHandle handle;
+    handle.index = index;
+    handle.generation = node.generation;
+    return handle;
+}
+
+bool TimerWheel::cancel(TimerHandle handle) {
+    if (handle.index < 0 || handle.index >= (int)nodes.size()) return false;
+
+    Node& node = nodes[handle.index];
+    if (node.generation != handle.generation || node.list == FREE_LIST) return false;
+
+    unlink(handle.index);
+    freeNode(handle.index);
+    numPending--;
+    return true;
+}
+
+// Re-files every timer of the current slot at `level` into the finer levels below it
+void TimerWheel::cascade(int level) {
+    int list = level * SLOTS + (int)((currentTick >> (LEVEL_BITS * level)) & (SLOTS - 1));
+    int index = heads[list];
+    heads[list] = -1;
+    while (index >= 0) {
+        int next = nodes[index].next;
+        insert(index);
+        index = next;
+    }
+}
+
+// Executes the detached batch; callbacks may schedule or cancel timers (even ones in the batch)
+void TimerWheel::runBatch() {
+    while (heads[RUNNING_LIST] >= 0) {
+        int index = heads[RUNNING_LIST];
+        TimerCallback callback = nodes[index].callback;
+        int value = nodes[index].value;
+
+        unlink(index);
+        freeNode(index);
+        numPending--;
+
+        callback(value);
+    }
+}
+
+void TimerWheel::advance(uint32_t ticks) {
+    for (uint32_t i = 0; i < ticks; i++) {
+        currentTick++;
+        int slot = (int)(currentTick & (SLOTS - 1));
+
+        // Pull coarser levels down whenever a finer level wraps around
+        for (int level = 1; level < LEVELS && slot == 0; level++) {
+            cascade(level);
+            slot = (int)((currentTick >> (LEVEL_BITS * level)) & (SLOTS - 1));
+        }
+
+        // Detach everything expiring now as one batch
+        int list = (int)(currentTick & (SLOTS - 1));
+        int index = heads[list];
+        if (index < 0) continue;
+
+        heads[list] = -1;
+        while (index >= 0) {
+            int next = nodes[index].next;
+            link(index, RUNNING_LIST);
+            index = next;
+        }
+        runBatch();
+    }
+}
+
+void TimerWheel::clear(uint64_t startTick) {
+    // Nodes stay pooled; freeing them bumps generations so old handles can't cancel new timers
+    for (int i = 0; i < (int)nodes.size(); i++) {
+        if (nodes[i].list != FREE_LIST) freeNode(i);
+    }
+    for (int& head : heads) head = -1;
+    numPending = 0;
+    currentTick = startTick;
+}
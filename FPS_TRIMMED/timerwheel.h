@@ -0,0 +1,81 @@
+#pragma once
+// Hierarchical timer wheel driven by simulation time (1 wheel tick = 1 sim millisecond)
+// - schedule() and cancel() are O(1)
+// - Timers that expire on the same tick are detached as one batch and run together
+// - Nodes come from a pooled free list, so steady-state scheduling doesn't allocate
+#include <cstdint>
+#include <vector>
+
+typedef void (*TimerCallback)(int value);
+
+// Identifies a scheduled timer; stale handles (fired or cancelled) are ignored by cancel()
+struct TimerHandle {
+    int index = -1;
+    uint32_t generation = 0;
+};
+
+class TimerWheel {
+public:
+    explicit TimerWheel(int initialCapacity = 1024);
+
+    // Runs callback(value) once, `delay` ticks from now
+    TimerHandle schedule(uint32_t delay, TimerCallback callback, int value);
+
+    // Removes a pending timer; returns false if it already fired or was cancelled
+    bool cancel(TimerHandle handle);
+
+    // Moves time forward, running every timer that expires along the way
+    void advance(uint32_t ticks);
+
+    // Makes room for `count` pending timers, so scheduling up to that many never allocates
+    void reserve(int count);
+
+    // Drops every pending timer without running it and sets the clock to startTick
+    void clear(uint64_t startTick = 0);
+
+    uint64_t now() const { return currentTick; }
+    int pendingCount() const { return numPending; }
+
+    // Calls visit(handle, expiry, callback, value) for every pending timer (used by checkpoints)
+    template <typename Visitor>
+    void forEachPending(Visitor visit) const {
+        for (int i = 0; i < (int)nodes.size(); i++) {
+            const Node& node = nodes[i];
+            if (node.list == FREE_LIST) continue;
+            TimerHandle handle;
+            handle.index = i;
+            handle.generation = node.generation;
+            visit(handle, node.expiry, node.callback, node.value);
+        }
+    }
+
+private:
+    static const int LEVEL_BITS = 6;
+    static const int SLOTS = 1 << LEVEL_BITS; // Slots per level
+    static const int LEVELS = 4;              // 64^4 ticks (~4.6 hours of sim time) of range
+    static const int RUNNING_LIST = LEVELS * SLOTS; // Batch currently being executed
+    static const int FREE_LIST = -1;
+
+    struct Node {
+        int next = -1, prev = -1;
+        int list = FREE_LIST; // Slot the node is linked into
+        uint64_t expiry = 0;
+        TimerCallback callback = nullptr;
+        int value = 0;
+        uint32_t generation = 0;
+    };
+
+    std::vector<Node> nodes;
+    int heads[LEVELS * SLOTS + 1];
+    int freeHead = -1;
+    int numPending = 0;
+    uint64_t currentTick = 0;
+
+    int allocNode();
+    void freeNode(int index);
+    void link(int index, int list);
+    void unlink(int index);
+    void insert(int index);
+    void cascade(int level);
+    void runBatch();
+};
@@ -0,0 +1,39 @@
+#pragma once
+// Lock-free triple buffer for handing the latest value from one writer thread to one reader thread
+// The writer fills its back buffer and publishes it by swapping it with the middle buffer; the
+// reader swaps the middle buffer for its front buffer when something new was published. Neither
+// side waits, the reader always sees a complete value, and values it didn't get to are skipped.
+#include <atomic>
+
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer only: the buffer to fill next (holds whatever was published two swaps ago)
+    T& back() { return buffers[backIndex]; }
+
+    // Writer only: makes back() the latest value
+    void publish() {
+        int previous = middle.exchange(backIndex | FRESH_BIT, std::memory_order_acq_rel);
+        backIndex = previous & INDEX_MASK;
+    }
+
+    // Reader only: swaps in the latest published value if there is one; returns true if it changed
+    bool update() {
+        if (!(middle.load(std::memory_order_relaxed) & FRESH_BIT)) return false;
+        int previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+        frontIndex = previous & INDEX_MASK;
+        return true;
+    }
+
+    // Reader only: the value last swapped in by update()
+    const T& front() const { return buffers[frontIndex]; }
+
+private:
+    static const int FRESH_BIT = 4;  // Set when middle holds a value the reader hasn't taken
+    static const int INDEX_MASK = 3;
+
+    T buffers[3];
+    int backIndex = 0;                // Owned by the writer
+    int frontIndex = 1;               // Owned by the reader
+    std::atomic<int> middle{ 2 };     // Shared
+};
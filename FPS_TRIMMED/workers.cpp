@@ -0,0 +1,49 @@
+#include "workers.h"
+#include "jobs.h"
+
+const int maxLoopChunks = 256; // Plenty for the threads there are; bigger loops get a bigger grain
+
+// One single-job graph per job thread index, sized for the most chunks up front (before main) so
+// that no loop ever allocates, whichever thread first runs it
+static JobGraph loopGraphs[maxJobThreads];
+static thread_local bool loopRunning = false;
+
+static bool sizeLoopGraphs() {
+    for (JobGraph& graph : loopGraphs) {
+        graph.add("parallelFor", nullptr, nullptr);
+        graph.reserveTasks(maxLoopChunks);
+        graph.clear();
+    }
+    return true;
+}
+static bool loopGraphsSized = sizeLoopGraphs();
+
+int workerCount() {
+    return jobThreadCount();
+}
+
+void parallelFor(int count, int grain, ParallelForBody body, void* context) {
+    if (count <= 0) return;
+    grain = grain > 1 ? grain : 1;
+
+    // Small loops (or no pool threads) aren't worth handing out; a loop inside one of this thread's own loop
+    // bodies runs in place, since the thread's graph is in use. A thread on the shared index
+    // (currentJobThread()) goes through its own graph, whose run() makes it wait its turn on the index
+    int worker = currentJobThread();
+    bool shared = worker == jobThreadCount() - 1;
+    if (loopRunning || (!shared && (count <= grain || jobThreadCount() == maxCallerThreads + 1))) {
+        for (int begin = 0; begin < count; begin += grain) {
+            body(begin, begin + grain < count ? begin + grain : count, worker, context);
+        }
+        return;
+    }
+
+    if (count / grain >= maxLoopChunks) grain = (count + maxLoopChunks - 1) / maxLoopChunks;
+    static thread_local JobGraph sharedLoopGraph; // Allocates on a shared thread's first loop
+    JobGraph& graph = shared ? sharedLoopGraph : loopGraphs[worker];
+    loopRunning = true;
+    graph.clear();
+    graph.add("parallelFor", body, context, count, grain);
+    graph.run();
+    loopRunning = false;
+}
@@ -0,0 +1,15 @@
+#pragma once
+// Data-parallel loops on the job system (jobs.h)
+// parallelFor() splits [0, count) into chunks of `grain` items that the calling thread and the
+// job threads take in turn; it returns once every chunk is done. It can be called from inside a
+// job, including from the body of another parallelFor() on a different thread. Loops of more than
+// a few hundred chunks are split into bigger ones; it never allocates.
+
+// body(begin, end, worker, context): worker is 0..workerCount()-1, stable for the whole call and
+// unique among the threads running it, so it can index per-thread output buffers
+typedef void (*ParallelForBody)(int begin, int end, int worker, void* context);
+
+// Upper bound of the worker index (job threads plus the threads that may call parallelFor())
+int workerCount();
+
+void parallelFor(int count, int grain, ParallelForBody body, void* context);